@@ -60,70 +60,1884 @@ namespace alac
         MPEG_5_0_D      = (120 << 16) | 5,    // C L R Ls Rs
         MPEG_5_1_D      = (124 << 16) | 6,    // C L R Ls Rs LFE
         AAC_6_1         = (142 << 16) | 7,    // C L R Ls Rs Cs LFE
-        MPEG_7_1_B      = (127 << 16) | 8     // C Lc Rc L R Ls Rs LFE (doc: IS-13818-7 MPEG2-AAC)
+        MPEG_7_1_B      = (127 << 16) | 8,    // C Lc Rc L R Ls Rs LFE (doc: IS-13818-7 MPEG2-AAC)
+
+        discreteInOrder = (147 << 16)         // Or'd with the number of channels.
+    };
+
+    /** AudioChannelLayout from CoreAudioTypes.h.
+        We never need the AudioChannelDescription so we remove it.
+    */
+    struct ALACAudioChannelLayout final
+    {
+        uint32_t channelLayoutTag = 0,
+                 channelBitmap = 0,
+                 numberChannelDescriptions = 0;
+    };
+
+    /** The layout an ALAC stream has for a number of channels, when it doesn't say otherwise. */
+    static constexpr ChannelLayout defaultChannelLayouts[maxChannels] =
+    {
+        ChannelLayout::mono,
+        ChannelLayout::stereo,
+        ChannelLayout::MPEG_3_0_B,
+        ChannelLayout::MPEG_4_0_B,
+        ChannelLayout::MPEG_5_0_D,
+        ChannelLayout::MPEG_5_1_D,
+        ChannelLayout::AAC_6_1,
+        ChannelLayout::MPEG_7_1_B
+    };
+
+    /** The speakers of each of the default layouts, in ALAC channel order. */
+    static const AudioChannelSet::ChannelType defaultChannelTypes[maxChannels][maxChannels] =
+    {
+        { AudioChannelSet::centre },
+        { AudioChannelSet::left, AudioChannelSet::right },
+        { AudioChannelSet::centre, AudioChannelSet::left, AudioChannelSet::right },
+        { AudioChannelSet::centre, AudioChannelSet::left, AudioChannelSet::right, AudioChannelSet::centreSurround },
+        { AudioChannelSet::centre, AudioChannelSet::left, AudioChannelSet::right, AudioChannelSet::leftSurround, AudioChannelSet::rightSurround },
+        { AudioChannelSet::centre, AudioChannelSet::left, AudioChannelSet::right, AudioChannelSet::leftSurround, AudioChannelSet::rightSurround,
+          AudioChannelSet::LFE },
+        { AudioChannelSet::centre, AudioChannelSet::left, AudioChannelSet::right, AudioChannelSet::leftSurround, AudioChannelSet::rightSurround,
+          AudioChannelSet::centreSurround, AudioChannelSet::LFE },
+        { AudioChannelSet::centre, AudioChannelSet::leftCentre, AudioChannelSet::rightCentre, AudioChannelSet::left, AudioChannelSet::right,
+          AudioChannelSet::leftSurround, AudioChannelSet::rightSurround, AudioChannelSet::LFE }
+    };
+
+    /** @returns the layout to store for a number of channels, where the channels are either
+        in the default ALAC order or are to be left in the order they're given.
+    */
+    inline ALACAudioChannelLayout createChannelLayout (int numChannels, bool isInDefaultOrder) noexcept
+    {
+        jassert (isPositiveAndNotGreaterThan (numChannels, (int) maxChannels));
+
+        ALACAudioChannelLayout layout;
+        layout.channelLayoutTag = isInDefaultOrder
+                                    ? (uint32_t) defaultChannelLayouts[numChannels - 1]
+                                    : (uint32_t) ChannelLayout::discreteInOrder | (uint32_t) numChannels;
+        return layout;
+    }
+
+    /** @returns true if the channels are in the default ALAC order,
+        which is also the case for streams that don't store a layout.
+    */
+    inline bool isDefaultOrder (const ALACAudioChannelLayout& layout, int numChannels) noexcept
+    {
+        return layout.channelLayoutTag == 0
+            || layout.channelLayoutTag == (uint32_t) defaultChannelLayouts[numChannels - 1];
+    }
+
+    /** @returns the JUCE equivalent of the default ALAC layout for a number of channels. */
+    inline AudioChannelSet getDefaultChannelSet (int numChannels)
+    {
+        AudioChannelSet set;
+
+        for (int i = 0; i < numChannels; ++i)
+            set.addChannel (defaultChannelTypes[numChannels - 1][i]);
+
+        return set;
+    }
+
+    /** @returns where each ALAC channel of the default layout sits in a JUCE layout,
+        or nothing if the JUCE layout doesn't have the same speakers.
+    */
+    inline std::vector<int> findJUCEChannelIndices (const AudioChannelSet& set, int numChannels)
+    {
+        if (set.size() != numChannels || ! isPositiveAndNotGreaterThan (numChannels, (int) maxChannels))
+            return {};
+
+        std::vector<int> indices;
+
+        for (int i = 0; i < numChannels; ++i)
+        {
+            const auto index = set.getChannelIndexForType (defaultChannelTypes[numChannels - 1][i]);
+
+            if (index < 0)
+                return {};
+
+            indices.push_back (index);
+        }
+
+        return indices;
+    }
+
+    /** @returns the ALAC channel that each JUCE channel is read from, given the stored layout. */
+    inline std::vector<int> getSourceChannels (const ALACAudioChannelLayout& layout, int numChannels)
+    {
+        std::vector<int> sourceChannels ((size_t) numChannels);
+        std::iota (sourceChannels.begin(), sourceChannels.end(), 0);
+
+        if (isDefaultOrder (layout, numChannels))
+        {
+            const auto indices = findJUCEChannelIndices (getDefaultChannelSet (numChannels), numChannels);
+
+            for (size_t i = 0; i < indices.size(); ++i)
+                sourceChannels[(size_t) indices[i]] = (int) i;
+        }
+
+        return sourceChannels;
+    }
+
+    struct AudioFormatDescription final
+    {
+        double sampleRate = 0.0;
+        uint32_t formatID = 0,
+                 formatFlags = 0,
+                 bytesPerPacket = 0,
+                 framesPerPacket = 0,
+                 bytesPerFrame = 0,
+                 channelsPerFrame = 0,
+                 bitsPerChannel = 0,
+                 reserved = 0;
+    };
+
+    /** @note this struct is wrapped in an 'alac' atom in the sample description extension area
+        @note in QT movies, it will be further wrapped in a 'wave' atom surrounded by 'frma' and 'term' atoms
+    */
+    struct ALACSpecificConfig final
+    {
+        uint32_t frameLength = 0;
+        uint8_t compatibleVersion = 0,
+                bitDepth = 0,
+                pb = 0,
+                mb = 0,
+                kb = 0,
+                numChannels = 0;
+        uint16_t maxRun = 0;
+        uint32_t maxFrameBytes = 0,
+                 avgBitRate = 0,
+                 sampleRate = 0;
+    };
+
+    //==============================================================================
+    /** The syntactic elements that make up a packet. */
+    enum class Element
+    {
+        singleChannel = 0,
+        channelPair,
+        coupling,
+        lowFrequency,
+        data,
+        programConfig,
+        fill,
+        end
+    };
+
+    /** The elements used per channel count, in ALAC channel order
+        (eg: C, then L R, then Ls Rs...), as per Apple's reference encoder.
+    */
+    static const Element elementLayouts[maxChannels][5] =
+    {
+        { Element::singleChannel },
+        { Element::channelPair },
+        { Element::singleChannel, Element::channelPair },
+        { Element::singleChannel, Element::channelPair, Element::singleChannel },
+        { Element::singleChannel, Element::channelPair, Element::channelPair },
+        { Element::singleChannel, Element::channelPair, Element::channelPair, Element::singleChannel },
+        { Element::singleChannel, Element::channelPair, Element::channelPair, Element::singleChannel, Element::singleChannel },
+        { Element::singleChannel, Element::channelPair, Element::channelPair, Element::channelPair, Element::singleChannel }
+    };
+
+    static constexpr int numElementsPerLayout[maxChannels] = { 1, 1, 2, 3, 3, 4, 5, 5 };
+
+    enum
+    {
+        // Adaptive Golomb-Rice coding:
+        qbShift             = 9,
+        qb                  = 1 << qbShift,
+        mmulShift           = 2,
+        mdenShift           = qbShift - mmulShift - 1,
+        mOff                = 1 << (mdenShift - 2),
+        bitOff              = 24,
+        maxMeanClamp        = 0xffff,
+        meanClampValue      = 0xffff,
+        maxPrefix16         = 9,
+        maxPrefix32         = 9,
+        maxDataTypeBits16   = 16,
+        maxRunLength        = 65535,
+
+        // Defaults from the reference encoder:
+        defaultPB           = 40,
+        defaultMB           = 10,
+        defaultKB           = 14,
+        defaultMaxRun       = 255,
+        defaultDenShift     = 9,
+        defaultNumCoefs     = 8,
+        defaultPBFactor     = 4,
+        defaultMixBits      = 2,
+        maxMixRes           = 4
+    };
+
+    //==============================================================================
+    inline uint32 countLeadingZeros (uint32 x) noexcept
+    {
+        if (x == 0)
+            return 32;
+
+        uint32 n = 0;
+        if (x <= 0x0000ffff) { n += 16; x <<= 16; }
+        if (x <= 0x00ffffff) { n += 8;  x <<= 8; }
+        if (x <= 0x0fffffff) { n += 4;  x <<= 4; }
+        if (x <= 0x3fffffff) { n += 2;  x <<= 2; }
+        if (x <= 0x7fffffff) { n += 1; }
+        return n;
+    }
+
+    inline uint32 lg3a (uint32 x) noexcept                      { return 31 - countLeadingZeros (x + 3); }
+    inline int32 signOf (int32 x) noexcept                      { return (x > 0) - (x < 0); }
+    inline int32 signExtend (int32 value, uint32 shift) noexcept { return static_cast<int32> (static_cast<uint32> (value) << shift) >> shift; }
+
+    inline constexpr uint32 makeType (const char* t) noexcept
+    {
+        return ((uint32) (uint8) t[0] << 24) | ((uint32) (uint8) t[1] << 16) | ((uint32) (uint8) t[2] << 8) | (uint32) (uint8) t[3];
+    }
+
+    //==============================================================================
+    /** Reads big-endian bit fields of up to 32 bits from a block of memory.
+
+        Reading past the end yields zeros, and is reported by isOverrun().
+    */
+    class BitReader final
+    {
+    public:
+        BitReader (const uint8* d, size_t size) noexcept :
+            data (d),
+            numBytes (size)
+        {
+        }
+
+        [[nodiscard]] uint32 peek (uint32 numBits) const noexcept
+        {
+            jassert (numBits <= 32);
+            return numBits == 0 ? 0 : static_cast<uint32> (load (position) >> (64 - numBits));
+        }
+
+        uint32 read (uint32 numBits) noexcept
+        {
+            const auto value = peek (numBits);
+            position += numBits;
+            return value;
+        }
+
+        void skip (uint64 numBits) noexcept                 { position += numBits; }
+        void byteAlign() noexcept                           { position = (position + 7) & ~(uint64) 7; }
+        [[nodiscard]] bool isOverrun() const noexcept       { return position > (uint64) numBytes * 8; }
+
+    private:
+        const uint8* data = nullptr;
+        size_t numBytes = 0;
+        uint64 position = 0;
+
+        /** @returns the 64 bits starting at the bit position, left aligned (only the top 57 are complete). */
+        [[nodiscard]] uint64 load (uint64 bitPosition) const noexcept
+        {
+            const auto byteIndex = (size_t) (bitPosition >> 3);
+            uint64 value = 0;
+
+            if (byteIndex + 8 <= numBytes)
+            {
+                std::memcpy (&value, data + byteIndex, 8);
+                value = ByteOrder::swapIfLittleEndian (value);
+            }
+            else
+            {
+                for (size_t i = 0; i < 8; ++i)
+                    value = (value << 8) | (byteIndex + i < numBytes ? data[byteIndex + i] : 0);
+            }
+
+            return value << (bitPosition & 7);
+        }
+    };
+
+    /** Writes big-endian bit fields of up to 32 bits, keeping its memory between packets. */
+    class BitWriter final
+    {
+    public:
+        BitWriter() = default;
+
+        void reset() noexcept
+        {
+            bytes.clear();
+            accumulator = 0;
+            numAccumulatedBits = 0;
+        }
+
+        void write (uint32 value, uint32 numBits)
+        {
+            jassert (numBits <= 32);
+
+            if (numBits == 0)
+                return;
+
+            accumulator = (accumulator << numBits) | ((uint64) value & ((1ull << numBits) - 1));
+            numAccumulatedBits += numBits;
+
+            while (numAccumulatedBits >= 8)
+            {
+                numAccumulatedBits -= 8;
+                bytes.push_back ((uint8) (accumulator >> numAccumulatedBits));
+            }
+        }
+
+        void byteAlign()
+        {
+            if (numAccumulatedBits > 0)
+                write (0, 8 - numAccumulatedBits);
+        }
+
+        /** Discards anything written after the given bit position. */
+        void rewind (uint64 bitPosition)
+        {
+            jassert (bitPosition <= getNumBits());
+
+            const auto byteIndex = (size_t) (bitPosition >> 3);
+            const auto remainder = (uint32) (bitPosition & 7);
+
+            if (byteIndex >= bytes.size())
+            {
+                accumulator >>= numAccumulatedBits - remainder;
+            }
+            else
+            {
+                accumulator = (uint64) bytes[byteIndex] >> (8 - remainder);
+                bytes.resize (byteIndex);
+            }
+
+            numAccumulatedBits = remainder;
+        }
+
+        [[nodiscard]] uint64 getNumBits() const noexcept    { return (uint64) bytes.size() * 8 + numAccumulatedBits; }
+        [[nodiscard]] const uint8* getData() const noexcept { return bytes.data(); }
+        [[nodiscard]] size_t getNumBytes() const noexcept   { return bytes.size(); }
+
+    private:
+        std::vector<uint8> bytes;
+        uint64 accumulator = 0;
+        uint32 numAccumulatedBits = 0;
+    };
+
+    //==============================================================================
+    /** The state of the adaptive Golomb-Rice coder. */
+    struct AdaptiveGolombParams final
+    {
+        AdaptiveGolombParams (const ALACSpecificConfig& config, uint32 pbFactor) noexcept :
+            mb0 (config.mb),
+            pb ((config.pb * pbFactor) / 4),
+            kb (config.kb),
+            wb ((1u << config.kb) - 1)
+        {
+        }
+
+        uint32 mb0 = defaultMB, pb = defaultPB, kb = defaultKB, wb = (1u << defaultKB) - 1;
     };
 
-    /** AudioChannelLayout from CoreAudioTypes.h.
-        We never need the AudioChannelDescription so we remove it.
-    */
-    struct ALACAudioChannelLayout final
+    inline uint32 readSymbol (BitReader& bits, uint32 m, uint32 k, uint32 maxBits) noexcept
+    {
+        const auto prefix = countLeadingZeros (~bits.peek (32));
+
+        if (prefix >= maxPrefix32)
+        {
+            bits.skip (maxPrefix32);
+            return bits.read (maxBits);
+        }
+
+        bits.skip (prefix + 1);
+
+        if (k == 1)
+            return prefix;
+
+        const auto v = bits.peek (k);
+
+        if (v < 2)
+        {
+            bits.skip (k - 1);
+            return prefix * m;
+        }
+
+        bits.skip (k);
+        return prefix * m + v - 1;
+    }
+
+    inline uint32 readRunLength (BitReader& bits, uint32 m, uint32 k) noexcept
+    {
+        const auto prefix = countLeadingZeros (~bits.peek (32));
+
+        if (prefix >= maxPrefix16)
+        {
+            bits.skip (maxPrefix16);
+            return bits.read (maxDataTypeBits16);
+        }
+
+        bits.skip (prefix + 1);
+
+        const auto v = bits.peek (k);
+
+        if (v < 2)
+        {
+            bits.skip (k - 1);
+            return prefix * m;
+        }
+
+        bits.skip (k);
+        return prefix * m + v - 1;
+    }
+
+    inline void writeSymbol (BitWriter& bits, uint32 m, uint32 k, uint32 n, uint32 maxBits)
+    {
+        const auto div = n / m;
+
+        if (div < maxPrefix32)
+        {
+            const auto mod = n - m * div;
+            const auto de = mod == 0 ? 1u : 0u;
+            const auto numBits = div + k + 1 - de;
+
+            if (numBits <= 25)
+            {
+                bits.write ((((1u << div) - 1) << (numBits - div)) + mod + 1 - de, numBits);
+                return;
+            }
+        }
+
+        // Escape:
+        bits.write ((1u << maxPrefix32) - 1, maxPrefix32);
+        bits.write (n, maxBits);
+    }
+
+    inline void writeRunLength (BitWriter& bits, uint32 m, uint32 k, uint32 n)
+    {
+        const auto div = n / m;
+
+        if (div < maxPrefix16)
+        {
+            const auto mod = n - m * div;
+            const auto de = mod == 0 ? 1u : 0u;
+            const auto numBits = div + k + 1 - de;
+
+            if (numBits <= maxPrefix16 + maxDataTypeBits16)
+            {
+                bits.write ((((1u << div) - 1) << (numBits - div)) + mod + 1 - de, numBits);
+                return;
+            }
+        }
+
+        // Escape:
+        bits.write ((((1u << maxPrefix16) - 1) << maxDataTypeBits16) + n, maxPrefix16 + maxDataTypeBits16);
+    }
+
+    /** @returns the size of the Rice parameter for the running zero count. */
+    inline uint32 getRunParameter (uint32 mb) noexcept
+    {
+        return countLeadingZeros (mb) - bitOff + ((mb + mOff) >> mdenShift);
+    }
+
+    /** Decodes the adaptive Golomb-Rice coded prediction residuals. */
+    inline bool decompress (BitReader& bits, int32* out, int numSamples, uint32 maxBits, const AdaptiveGolombParams& params) noexcept
+    {
+        auto mb = params.mb0;
+        uint32 zmode = 0;
+        int c = 0;
+
+        while (c < numSamples)
+        {
+            if (bits.isOverrun())
+                return false;
+
+            const auto k = std::min (lg3a (mb >> qbShift), params.kb);
+            const auto m = (1u << k) - 1;
+            const auto n = readSymbol (bits, m, k, maxBits);
+
+            // The least significant bit is the sign:
+            const auto decoded = (uint64) n + zmode;
+            const auto magnitude = static_cast<int32> ((decoded + 1) >> 1);
+            out[c++] = (decoded & 1) != 0 ? -magnitude : magnitude;
+
+            mb = params.pb * (n + zmode) + mb - ((params.pb * mb) >> qbShift);
+
+            if (n > maxMeanClamp)
+                mb = meanClampValue;
+
+            zmode = 0;
+
+            if (((mb << mmulShift) < qb) && c < numSamples)
+            {
+                zmode = 1;
+
+                const auto kz = getRunParameter (mb);
+                const auto run = readRunLength (bits, ((1u << kz) - 1) & params.wb, kz);
+
+                if ((int64) c + run > numSamples)
+                    return false;
+
+                std::fill_n (out + c, run, 0);
+                c += (int) run;
+
+                if (run >= maxRunLength)
+                    zmode = 0;
+
+                mb = 0;
+            }
+        }
+
+        return ! bits.isOverrun();
+    }
+
+    /** Encodes prediction residuals with the adaptive Golomb-Rice coder. */
+    inline void compress (BitWriter& bits, const int32* in, int numSamples, uint32 maxBits, const AdaptiveGolombParams& params)
+    {
+        auto mb = params.mb0;
+        uint32 zmode = 0;
+        int c = 0;
+
+        while (c < numSamples)
+        {
+            const auto k = std::min (lg3a (mb >> qbShift), params.kb);
+            const auto m = (1u << k) - 1;
+
+            const auto del = in[c++];
+            const auto magnitude = static_cast<uint32> (del < 0 ? -(int64) del : (int64) del);
+            const auto n = (magnitude << 1) - (del < 0 ? 1u : 0u) - zmode;
+
+            writeSymbol (bits, m, k, n, maxBits);
+
+            mb = params.pb * (n + zmode) + mb - ((params.pb * mb) >> qbShift);
+
+            if (n > maxMeanClamp)
+                mb = meanClampValue;
+
+            zmode = 0;
+
+            if (((mb << mmulShift) < qb) && c < numSamples)
+            {
+                zmode = 1;
+                uint32 run = 0;
+
+                while (c < numSamples && in[c] == 0)
+                {
+                    ++c;
+
+                    if (++run >= maxRunLength)
+                    {
+                        zmode = 0;
+                        break;
+                    }
+                }
+
+                const auto kz = getRunParameter (mb);
+                writeRunLength (bits, ((1u << kz) - 1) & params.wb, kz, run);
+                mb = 0;
+            }
+        }
+    }
+
+    //==============================================================================
+    inline void initialiseCoefficients (int16* coefs, uint32 denShift, int numCoefs) noexcept
+    {
+        const auto den = 1 << denShift;
+
+        std::fill_n (coefs, numCoefs, (int16) 0);
+        coefs[0] = (int16) ((38 * den) >> 4);
+        coefs[1] = (int16) ((-29 * den) >> 4);
+        coefs[2] = (int16) ((-2 * den) >> 4);
+    }
+
+    /** Undoes the adaptive prediction. The residuals and output may be the same array. */
+    inline void unpredict (const int32* residuals, int32* out, int num, int16* coefs,
+                           int numActive, uint32 chanBits, uint32 denShift) noexcept
+    {
+        const auto chanShift = 32 - chanBits;
+        const auto denHalf = denShift > 0 ? (1 << (denShift - 1)) : 0;
+
+        if (num <= 0)
+            return;
+
+        out[0] = residuals[0];
+
+        if (numActive == 0)
+        {
+            if (residuals != out)
+                std::copy (residuals + 1, residuals + num, out + 1);
+
+            return;
+        }
+
+        if (numActive == 31)
+        {
+            auto prev = out[0];
+
+            for (int j = 1; j < num; ++j)
+            {
+                prev = signExtend (residuals[j] + prev, chanShift);
+                out[j] = prev;
+            }
+
+            return;
+        }
+
+        for (int j = 1; j <= std::min (numActive, num - 1); ++j)
+            out[j] = signExtend (residuals[j] + out[j - 1], chanShift);
+
+        const auto lim = numActive + 1;
+
+        for (int j = lim; j < num; ++j)
+        {
+            const auto* pout = out + j - 1;
+            const auto top = out[j - lim];
+            int32 sum = 0;
+
+            for (int k = 0; k < numActive; ++k)
+                sum += coefs[k] * (pout[-k] - top);
+
+            auto del = residuals[j];
+            auto del0 = del;
+            const auto sg = signOf (del);
+            del += top + ((sum + denHalf) >> denShift);
+            out[j] = signExtend (del, chanShift);
+
+            if (sg > 0)
+            {
+                for (int k = numActive - 1; k >= 0; --k)
+                {
+                    const auto dd = top - pout[-k];
+                    const auto sgn = signOf (dd);
+                    coefs[k] = (int16) (coefs[k] - sgn);
+                    del0 -= (numActive - k) * ((sgn * dd) >> denShift);
+
+                    if (del0 <= 0)
+                        break;
+                }
+            }
+            else if (sg < 0)
+            {
+                for (int k = numActive - 1; k >= 0; --k)
+                {
+                    const auto dd = top - pout[-k];
+                    const auto sgn = signOf (dd);
+                    coefs[k] = (int16) (coefs[k] + sgn);
+                    del0 -= (numActive - k) * ((-sgn * dd) >> denShift);
+
+                    if (del0 >= 0)
+                        break;
+                }
+            }
+        }
+    }
+
+    /** Applies the adaptive prediction, mirroring unpredict() exactly. */
+    inline void predict (const int32* in, int32* residuals, int num, int16* coefs,
+                         int numActive, uint32 chanBits, uint32 denShift) noexcept
+    {
+        const auto chanShift = 32 - chanBits;
+        const auto denHalf = denShift > 0 ? (1 << (denShift - 1)) : 0;
+
+        if (num <= 0)
+            return;
+
+        residuals[0] = in[0];
+
+        for (int j = 1; j <= std::min (numActive, num - 1); ++j)
+            residuals[j] = signExtend (in[j] - in[j - 1], chanShift);
+
+        const auto lim = numActive + 1;
+
+        for (int j = lim; j < num; ++j)
+        {
+            const auto* pin = in + j - 1;
+            const auto top = in[j - lim];
+            int32 sum = 0;
+
+            for (int k = 0; k < numActive; ++k)
+                sum += coefs[k] * (pin[-k] - top);
+
+            const auto del = signExtend (in[j] - top - ((sum + denHalf) >> denShift), chanShift);
+            residuals[j] = del;
+
+            auto del0 = del;
+            const auto sg = signOf (del);
+
+            if (sg > 0)
+            {
+                for (int k = numActive - 1; k >= 0; --k)
+                {
+                    const auto dd = top - pin[-k];
+                    const auto sgn = signOf (dd);
+                    coefs[k] = (int16) (coefs[k] - sgn);
+                    del0 -= (numActive - k) * ((sgn * dd) >> denShift);
+
+                    if (del0 <= 0)
+                        break;
+                }
+            }
+            else if (sg < 0)
+            {
+                for (int k = numActive - 1; k >= 0; --k)
+                {
+                    const auto dd = top - pin[-k];
+                    const auto sgn = signOf (dd);
+                    coefs[k] = (int16) (coefs[k] + sgn);
+                    del0 -= (numActive - k) * ((-sgn * dd) >> denShift);
+
+                    if (del0 >= 0)
+                        break;
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    /** Decodes ALAC packets into right-justified integer samples. */
+    class Decoder final
+    {
+    public:
+        explicit Decoder (const ALACSpecificConfig& c) :
+            config (c)
+        {
+            const auto frames = (size_t) config.frameLength;
+            mixU.resize (frames);
+            mixV.resize (frames);
+            predictor.resize (frames);
+            shiftBuffer.resize (frames * 2);
+        }
+
+        /** Decodes a packet, with one destination array per channel (in ALAC channel order).
+
+            @returns the number of frames decoded, or -1 if the packet is invalid.
+        */
+        int decode (const uint8* data, size_t numBytes, int32* const* destination)
+        {
+            BitReader bits (data, numBytes);
+            int channelIndex = 0, numFrames = 0;
+
+            for (;;)
+            {
+                if (bits.isOverrun())
+                    return -1;
+
+                switch (static_cast<Element> (bits.read (3)))
+                {
+                    case Element::singleChannel:
+                    case Element::lowFrequency:
+                        bits.skip (4); // Element instance tag
+
+                        if (channelIndex >= (int) config.numChannels
+                            || ! decodeSingle (bits, destination[channelIndex], numFrames))
+                            return -1;
+
+                        ++channelIndex;
+                    break;
+
+                    case Element::channelPair:
+                        bits.skip (4);
+
+                        if (channelIndex + 2 > (int) config.numChannels
+                            || ! decodePair (bits, destination[channelIndex], destination[channelIndex + 1], numFrames))
+                            return -1;
+
+                        channelIndex += 2;
+                    break;
+
+                    case Element::data:
+                    {
+                        bits.skip (4);
+                        const auto isAligned = bits.read (1) != 0;
+                        auto count = bits.read (8);
+
+                        if (count == 255)
+                            count += bits.read (8);
+
+                        if (isAligned)
+                            bits.byteAlign();
+
+                        bits.skip ((uint64) count * 8);
+                    }
+                    break;
+
+                    case Element::fill:
+                    {
+                        auto count = bits.read (4);
+
+                        if (count == 15)
+                            count += bits.read (8) - 1;
+
+                        bits.skip ((uint64) count * 8);
+                    }
+                    break;
+
+                    case Element::end:
+                        return channelIndex == (int) config.numChannels && ! bits.isOverrun() ? numFrames : -1;
+
+                    case Element::coupling:
+                    case Element::programConfig:
+                    default:
+                        return -1;
+                };
+            }
+        }
+
+    private:
+        const ALACSpecificConfig config;
+        std::vector<int32> mixU, mixV, predictor, shiftBuffer;
+
+        struct ElementHeader final
+        {
+            uint32 bytesShifted = 0;
+            bool isEscaped = false;
+            int numSamples = 0;
+        };
+
+        bool readElementHeader (BitReader& bits, ElementHeader& header, int& numFrames) const noexcept
+        {
+            bits.skip (12);
+
+            const auto headerBits = bits.read (4);
+            const auto isPartial = (headerBits >> 3) != 0;
+            header.bytesShifted = (headerBits >> 1) & 3;
+            header.isEscaped = (headerBits & 1) != 0;
+            header.numSamples = isPartial ? (int) bits.read (32) : (int) config.frameLength;
+
+            if (header.bytesShifted == 3
+                || header.bytesShifted * 8 >= config.bitDepth
+                || header.numSamples <= 0
+                || header.numSamples > (int) config.frameLength
+                || (numFrames != 0 && numFrames != header.numSamples))
+                return false;
+
+            numFrames = header.numSamples;
+            return true;
+        }
+
+        static void readPredictorHeader (BitReader& bits, uint32& mode, uint32& denShift, uint32& pbFactor,
+                                         int& numCoefs, int16* coefs) noexcept
+        {
+            const auto modeBits = bits.read (8);
+            mode = modeBits >> 4;
+            denShift = modeBits & 15;
+
+            const auto pbBits = bits.read (8);
+            pbFactor = pbBits >> 5;
+            numCoefs = (int) (pbBits & 31);
+
+            for (int i = 0; i < numCoefs; ++i)
+                coefs[i] = (int16) bits.read (16);
+        }
+
+        bool decodeChannel (BitReader& bits, int32* out, int numSamples, uint32 chanBits,
+                            uint32 mode, uint32 denShift, uint32 pbFactor, int numCoefs, int16* coefs) noexcept
+        {
+            if (! decompress (bits, predictor.data(), numSamples, chanBits, AdaptiveGolombParams (config, pbFactor)))
+                return false;
+
+            if (mode != 0)
+                unpredict (predictor.data(), predictor.data(), numSamples, nullptr, 31, chanBits, 0);
+
+            unpredict (predictor.data(), out, numSamples, coefs, numCoefs, chanBits, denShift);
+            return true;
+        }
+
+        bool decodeSingle (BitReader& bits, int32* destination, int& numFrames) noexcept
+        {
+            ElementHeader header;
+            if (! readElementHeader (bits, header, numFrames))
+                return false;
+
+            const auto numSamples = header.numSamples;
+            const auto shift = header.bytesShifted * 8;
+
+            if (header.isEscaped)
+            {
+                const auto chanBits = (uint32) config.bitDepth;
+
+                for (int i = 0; i < numSamples; ++i)
+                    destination[i] = signExtend ((int32) bits.read (chanBits), 32 - chanBits);
+
+                return true;
+            }
+
+            const auto chanBits = (uint32) config.bitDepth - shift;
+            uint32 mode, denShift, pbFactor;
+            int numCoefs;
+            int16 coefs[32];
+            readPredictorHeader (bits, mode, denShift, pbFactor, numCoefs, coefs);
+
+            // NB: The low bytes that were shifted out are stored ahead of the compressed data.
+            auto shiftBits = bits;
+            bits.skip ((uint64) shift * (uint64) numSamples);
+
+            if (! decodeChannel (bits, mixU.data(), numSamples, chanBits, mode, denShift, pbFactor, numCoefs, coefs))
+                return false;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto low = shift > 0 ? shiftBits.read (shift) : 0u;
+                destination[i] = static_cast<int32> ((static_cast<uint32> (mixU[(size_t) i]) << shift) | low);
+            }
+
+            return true;
+        }
+
+        bool decodePair (BitReader& bits, int32* left, int32* right, int& numFrames) noexcept
+        {
+            ElementHeader header;
+            if (! readElementHeader (bits, header, numFrames))
+                return false;
+
+            const auto numSamples = header.numSamples;
+            const auto shift = header.bytesShifted * 8;
+            int32 mixBits = 0, mixRes = 0;
+
+            if (header.isEscaped)
+            {
+                const auto chanBits = (uint32) config.bitDepth;
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    left[i] = signExtend ((int32) bits.read (chanBits), 32 - chanBits);
+                    right[i] = signExtend ((int32) bits.read (chanBits), 32 - chanBits);
+                }
+
+                return true;
+            }
+
+            const auto chanBits = (uint32) config.bitDepth - shift + 1;
+            mixBits = (int32) bits.read (8);
+            mixRes = (int32) (int8) bits.read (8);
+
+            uint32 modeU, denShiftU, pbFactorU, modeV, denShiftV, pbFactorV;
+            int numU, numV;
+            int16 coefsU[32], coefsV[32];
+            readPredictorHeader (bits, modeU, denShiftU, pbFactorU, numU, coefsU);
+            readPredictorHeader (bits, modeV, denShiftV, pbFactorV, numV, coefsV);
+
+            auto shiftBits = bits;
+            bits.skip ((uint64) shift * 2 * (uint64) numSamples);
+
+            if (! decodeChannel (bits, mixU.data(), numSamples, chanBits, modeU, denShiftU, pbFactorU, numU, coefsU)
+                || ! decodeChannel (bits, mixV.data(), numSamples, chanBits, modeV, denShiftV, pbFactorV, numV, coefsV))
+                return false;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto u = mixU[(size_t) i];
+                const auto v = mixV[(size_t) i];
+                auto l = u;
+                auto r = v;
+
+                if (mixRes != 0)
+                {
+                    l = u + v - ((mixRes * v) >> mixBits);
+                    r = l - v;
+                }
+
+                if (shift > 0)
+                {
+                    l = static_cast<int32> ((static_cast<uint32> (l) << shift) | shiftBits.read (shift));
+                    r = static_cast<int32> ((static_cast<uint32> (r) << shift) | shiftBits.read (shift));
+                }
+
+                left[i] = l;
+                right[i] = r;
+            }
+
+            return true;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (Decoder)
+    };
+
+    //==============================================================================
+    /** Encodes right-justified integer samples into ALAC packets. */
+    class Encoder final
+    {
+    public:
+        explicit Encoder (const ALACSpecificConfig& c) :
+            config (c)
+        {
+            const auto frames = (size_t) config.frameLength;
+
+            for (auto* v : { &mixU, &mixV, &shiftedL, &shiftedR, &predictorU, &predictorV, &shiftL, &shiftR })
+                v->resize (frames);
+        }
+
+        /** Encodes a packet of up to frameLength samples, with one source array per channel (in ALAC channel order). */
+        void encode (const int32* const* source, int numSamples, BitWriter& bits)
+        {
+            jassert (numSamples > 0 && numSamples <= (int) config.frameLength);
+
+            bits.reset();
+
+            const auto layoutIndex = (size_t) config.numChannels - 1;
+            int channel = 0;
+            uint32 singleTag = 0, pairTag = 0;
+
+            for (int e = 0; e < numElementsPerLayout[layoutIndex]; ++e)
+            {
+                if (elementLayouts[layoutIndex][e] == Element::channelPair)
+                {
+                    encodePair (bits, source[channel], source[channel + 1], numSamples, pairTag++);
+                    channel += 2;
+                }
+                else
+                {
+                    encodeSingle (bits, source[channel], numSamples, singleTag++);
+                    ++channel;
+                }
+            }
+
+            bits.write ((uint32) Element::end, 3);
+            bits.byteAlign();
+        }
+
+    private:
+        const ALACSpecificConfig config;
+        std::vector<int32> mixU, mixV, shiftedL, shiftedR, predictorU, predictorV, shiftL, shiftR;
+
+        [[nodiscard]] uint32 getBytesShifted() const noexcept
+        {
+            return config.bitDepth == 32 ? 2u : (config.bitDepth >= 24 ? 1u : 0u);
+        }
+
+        void writeElementHeader (BitWriter& bits, Element element, uint32 tag, int numSamples,
+                                 uint32 bytesShifted, bool isEscaped) const
+        {
+            const auto isPartial = numSamples != (int) config.frameLength;
+
+            bits.write ((uint32) element, 3);
+            bits.write (tag, 4);
+            bits.write (0, 12);
+            bits.write ((isPartial ? 8u : 0u) | (bytesShifted << 1) | (isEscaped ? 1u : 0u), 4);
+
+            if (isPartial)
+                bits.write ((uint32) numSamples, 32);
+        }
+
+        /** Runs the predictor over the signal once to adapt the coefficients,
+            which then become the initial coefficients that get stored.
+        */
+        static void trainCoefficients (const int32* in, int32* scratch, int numSamples, int16* coefs, uint32 chanBits)
+        {
+            initialiseCoefficients (coefs, defaultDenShift, defaultNumCoefs);
+            predict (in, scratch, numSamples, coefs, defaultNumCoefs, chanBits, defaultDenShift);
+        }
+
+        void writePredictorHeader (BitWriter& bits, const int16* coefs) const
+        {
+            bits.write (defaultDenShift, 8); // NB: Mode 0
+            bits.write ((defaultPBFactor << 5) | defaultNumCoefs, 8);
+
+            for (int i = 0; i < defaultNumCoefs; ++i)
+                bits.write ((uint16) coefs[i], 16);
+        }
+
+        void encodeChannel (BitWriter& bits, const int32* in, int32* residuals, const int16* initialCoefs,
+                            int numSamples, uint32 chanBits) const
+        {
+            int16 coefs[defaultNumCoefs];
+            std::copy_n (initialCoefs, defaultNumCoefs, coefs);
+            predict (in, residuals, numSamples, coefs, defaultNumCoefs, chanBits, defaultDenShift);
+            compress (bits, residuals, numSamples, chanBits, AdaptiveGolombParams (config, defaultPBFactor));
+        }
+
+        void encodeSingle (BitWriter& bits, const int32* samples, int numSamples, uint32 tag)
+        {
+            const auto startBits = bits.getNumBits();
+            const auto bytesShifted = getBytesShifted();
+            const auto shift = bytesShifted * 8;
+            const auto mask = (1u << shift) - 1;
+            const auto chanBits = (uint32) config.bitDepth - shift;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                shiftL[(size_t) i] = (int32) ((uint32) samples[i] & mask);
+                mixU[(size_t) i] = samples[i] >> shift;
+            }
+
+            int16 coefs[defaultNumCoefs];
+            trainCoefficients (mixU.data(), predictorU.data(), numSamples, coefs, chanBits);
+
+            writeElementHeader (bits, Element::singleChannel, tag, numSamples, bytesShifted, false);
+            writePredictorHeader (bits, coefs);
+
+            for (int i = 0; i < (shift > 0 ? numSamples : 0); ++i)
+                bits.write ((uint32) shiftL[(size_t) i], shift);
+
+            encodeChannel (bits, mixU.data(), predictorU.data(), coefs, numSamples, chanBits);
+
+            // Fall back to storing the samples as-is if compressing didn't help:
+            const auto escapedSize = (uint64) (23 + (numSamples != (int) config.frameLength ? 32 : 0))
+                                   + (uint64) config.bitDepth * (uint64) numSamples;
+
+            if (bits.getNumBits() - startBits > escapedSize)
+            {
+                bits.rewind (startBits);
+                writeElementHeader (bits, Element::singleChannel, tag, numSamples, 0, true);
+
+                for (int i = 0; i < numSamples; ++i)
+                    bits.write ((uint32) samples[i], config.bitDepth);
+            }
+        }
+
+        void mix (int numSamples, int32 mixRes) noexcept
+        {
+            if (mixRes != 0)
+            {
+                const auto m2 = (1 << defaultMixBits) - mixRes;
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const auto l = shiftedL[(size_t) i];
+                    const auto r = shiftedR[(size_t) i];
+                    mixU[(size_t) i] = (mixRes * l + m2 * r) >> defaultMixBits;
+                    mixV[(size_t) i] = l - r;
+                }
+            }
+            else
+            {
+                std::copy_n (shiftedL.begin(), numSamples, mixU.begin());
+                std::copy_n (shiftedR.begin(), numSamples, mixV.begin());
+            }
+        }
+
+        void encodePair (BitWriter& bits, const int32* left, const int32* right, int numSamples, uint32 tag)
+        {
+            const auto startBits = bits.getNumBits();
+            const auto bytesShifted = getBytesShifted();
+            const auto shift = bytesShifted * 8;
+            const auto mask = (1u << shift) - 1;
+            const auto chanBits = (uint32) config.bitDepth - shift + 1;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                shiftL[(size_t) i] = (int32) ((uint32) left[i] & mask);
+                shiftR[(size_t) i] = (int32) ((uint32) right[i] & mask);
+                shiftedL[(size_t) i] = left[i] >> shift;
+                shiftedR[(size_t) i] = right[i] >> shift;
+            }
+
+            // Pick the stereo matrixing that leaves the smallest residuals:
+            int32 bestMixRes = 0;
+            uint64 bestCost = std::numeric_limits<uint64>::max();
+            int16 coefsU[defaultNumCoefs], coefsV[defaultNumCoefs];
+
+            for (int32 mixRes = 0; mixRes <= maxMixRes; ++mixRes)
+            {
+                mix (numSamples, mixRes);
+                trainCoefficients (mixU.data(), predictorU.data(), numSamples, coefsU, chanBits);
+                trainCoefficients (mixV.data(), predictorV.data(), numSamples, coefsV, chanBits);
+
+                uint64 cost = 0;
+                for (int i = 0; i < numSamples; ++i)
+                    cost += (uint64) std::abs ((int64) predictorU[(size_t) i]) + (uint64) std::abs ((int64) predictorV[(size_t) i]);
+
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestMixRes = mixRes;
+                }
+            }
+
+            mix (numSamples, bestMixRes);
+            trainCoefficients (mixU.data(), predictorU.data(), numSamples, coefsU, chanBits);
+            trainCoefficients (mixV.data(), predictorV.data(), numSamples, coefsV, chanBits);
+
+            writeElementHeader (bits, Element::channelPair, tag, numSamples, bytesShifted, false);
+            bits.write ((uint32) (bestMixRes != 0 ? defaultMixBits : 0), 8);
+            bits.write ((uint32) (uint8) bestMixRes, 8);
+            writePredictorHeader (bits, coefsU);
+            writePredictorHeader (bits, coefsV);
+
+            for (int i = 0; i < (shift > 0 ? numSamples : 0); ++i)
+            {
+                bits.write ((uint32) shiftL[(size_t) i], shift);
+                bits.write ((uint32) shiftR[(size_t) i], shift);
+            }
+
+            encodeChannel (bits, mixU.data(), predictorU.data(), coefsU, numSamples, chanBits);
+            encodeChannel (bits, mixV.data(), predictorV.data(), coefsV, numSamples, chanBits);
+
+            const auto escapedSize = (uint64) (23 + (numSamples != (int) config.frameLength ? 32 : 0))
+                                   + (uint64) config.bitDepth * 2 * (uint64) numSamples;
+
+            if (bits.getNumBits() - startBits > escapedSize)
+            {
+                bits.rewind (startBits);
+                writeElementHeader (bits, Element::channelPair, tag, numSamples, 0, true);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    bits.write ((uint32) left[i], config.bitDepth);
+                    bits.write ((uint32) right[i], config.bitDepth);
+                }
+            }
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (Encoder)
+    };
+
+    //==============================================================================
+    /** Where to find a packet, and which samples it holds. */
+    struct Packet final
+    {
+        int64 fileOffset = 0,
+              startSample = 0;
+        uint32 numBytes = 0,
+               numFrames = 0;
+    };
+
+    /** Finds the packet holding the given sample, by binary search. */
+    inline size_t findPacket (const std::vector<Packet>& packets, int64 sample) noexcept
+    {
+        auto iter = std::upper_bound (packets.begin(), packets.end(), sample,
+                                      [] (int64 s, const Packet& p) { return s < p.startSample; });
+
+        return iter == packets.begin() ? 0 : (size_t) std::distance (packets.begin(), iter) - 1;
+    }
+
+    struct AtomHeader final
+    {
+        int64 start = 0, contentStart = 0, end = 0;
+        uint32 type = 0;
+    };
+
+    inline bool readAtomHeader (InputStream& in, int64 limit, AtomHeader& atom)
+    {
+        atom.start = in.getPosition();
+
+        if (atom.start + 8 > limit)
+            return false;
+
+        auto size = (int64) (uint32) in.readIntBigEndian();
+        atom.type = (uint32) in.readIntBigEndian();
+        int64 headerSize = 8;
+
+        if (size == 1)
+        {
+            size = in.readInt64BigEndian();
+            headerSize = 16;
+        }
+        else if (size == 0)
+        {
+            size = limit - atom.start; // Extends to the end of its parent.
+        }
+
+        if (size < headerSize || atom.start + size > limit)
+            return false;
+
+        atom.contentStart = atom.start + headerSize;
+        atom.end = atom.start + size;
+        return true;
+    }
+
+    /** Finds the first atom of the given type within a range, leaving the stream at its contents. */
+    inline bool findAtom (InputStream& in, int64 start, int64 end, uint32 type, AtomHeader& result)
+    {
+        for (auto pos = start; pos < end; pos = result.end)
+        {
+            if (! in.setPosition (pos) || ! readAtomHeader (in, end, result))
+                return false;
+
+            if (result.type == type)
+                return in.setPosition (result.contentStart);
+        }
+
+        return false;
+    }
+
+    inline bool findAtomPath (InputStream& in, const AtomHeader& parent, std::initializer_list<const char*> path, AtomHeader& result)
+    {
+        auto current = parent;
+
+        for (auto* type : path)
+        {
+            if (! findAtom (in, current.contentStart, current.end, makeType (type), result))
+                return false;
+
+            current = result;
+        }
+
+        return true;
+    }
+
+    inline bool parseSpecificConfig (const uint8* d, ALACSpecificConfig& config)
+    {
+        config.frameLength          = ByteOrder::bigEndianInt (d);
+        config.compatibleVersion    = d[4];
+        config.bitDepth             = d[5];
+        config.pb                   = d[6];
+        config.mb                   = d[7];
+        config.kb                   = d[8];
+        config.numChannels          = d[9];
+        config.maxRun               = ByteOrder::bigEndianShort (d + 10);
+        config.maxFrameBytes        = ByteOrder::bigEndianInt (d + 12);
+        config.avgBitRate           = ByteOrder::bigEndianInt (d + 16);
+        config.sampleRate           = ByteOrder::bigEndianInt (d + 20);
+
+        return config.frameLength > 0 && config.frameLength <= 65536
+            && config.compatibleVersion <= CompatibleVersion
+            && (config.bitDepth == 16 || config.bitDepth == 20 || config.bitDepth == 24 || config.bitDepth == 32)
+            && config.numChannels > 0 && config.numChannels <= maxChannels
+            && config.kb > 0 && config.kb <= 16
+            && config.sampleRate > 0;
+    }
+
+    /** Finds the ALACSpecificConfig in a sample description,
+        which might also be wrapped in a QuickTime 'wave' atom.
+
+        The channel layout follows the config, and is left zeroed if there isn't one.
+    */
+    inline bool parseSampleDescription (InputStream& in, const AtomHeader& stsd,
+                                        ALACSpecificConfig& config, ALACAudioChannelLayout& layout)
+    {
+        const auto size = stsd.end - stsd.contentStart;
+        if (size < 16 || size > 65536)
+            return false;
+
+        MemoryBlock block;
+        in.setPosition (stsd.contentStart);
+        if (in.readIntoMemoryBlock (block, (ssize_t) size) != (size_t) size)
+            return false;
+
+        const auto* d = static_cast<const uint8*> (block.getData());
+
+        // NB: Skipping the version, flags and entry count, then checking the entry's type.
+        if (ByteOrder::bigEndianInt (d + 12) != (uint32) FormatAppleLossless)
+            return false;
+
+        constexpr size_t soundDescriptionSize = 16 + 28;
+        constexpr size_t configAtomSize = 12 + 24;
+        constexpr size_t layoutAtomSize = 12 + channelAtomSize;
+
+        for (auto i = soundDescriptionSize; i + configAtomSize <= (size_t) size; ++i)
+        {
+            if (ByteOrder::bigEndianInt (d + i + 4) != (uint32) FormatAppleLossless
+                || ByteOrder::bigEndianInt (d + i) < configAtomSize)
+                continue;
+
+            layout = {};
+
+            const auto l = i + (size_t) ByteOrder::bigEndianInt (d + i);
+
+            if (l + layoutAtomSize <= (size_t) size
+                && ByteOrder::bigEndianInt (d + l + 4) == (uint32) AudioChannelLayoutAID
+                && ByteOrder::bigEndianInt (d + l) >= layoutAtomSize)
+            {
+                layout.channelLayoutTag             = ByteOrder::bigEndianInt (d + l + 12);
+                layout.channelBitmap                = ByteOrder::bigEndianInt (d + l + 16);
+                layout.numberChannelDescriptions    = ByteOrder::bigEndianInt (d + l + 20);
+            }
+
+            return parseSpecificConfig (d + i + 12, config);
+        }
+
+        return false;
+    }
+
+    inline bool readTable (InputStream& in, const AtomHeader& atom, int numFieldsPerEntry, int bytesPerField,
+                           std::vector<uint64>& fields, int numHeaderFields = 1)
+    {
+        in.setPosition (atom.contentStart + 4); // Skips the version and flags.
+
+        uint32 header[2] = {};
+        for (int i = 0; i < numHeaderFields; ++i)
+            header[i] = (uint32) in.readIntBigEndian();
+
+        const auto count = (uint64) header[numHeaderFields - 1];
+        const auto numAvailable = (uint64) std::max ((int64) 0, atom.end - in.getPosition()) / (uint64) (numFieldsPerEntry * bytesPerField);
+
+        if (numHeaderFields > 1 && header[0] != 0)
+        {
+            // Every entry has the same value (ie: a uniform sample size):
+            fields.assign ((size_t) count, header[0]);
+            return true;
+        }
+
+        if (count > numAvailable)
+            return false;
+
+        fields.resize ((size_t) (count * (uint64) numFieldsPerEntry));
+
+        for (auto& f : fields)
+            f = bytesPerField == 8 ? (uint64) in.readInt64BigEndian() : (uint64) (uint32) in.readIntBigEndian();
+
+        return in.getPosition() <= atom.end;
+    }
+
+    /** Parses the MP4 container, where the packet locations come from the stsz and stco tables. */
+    inline bool parseContainer (InputStream& in, ALACSpecificConfig& config,
+                                ALACAudioChannelLayout& layout, std::vector<Packet>& packets)
     {
-        uint32_t channelLayoutTag = 0,
-                 channelBitmap = 0,
-                 numberChannelDescriptions = 0;
-    };
+        const auto totalLength = in.getTotalLength() >= 0 ? in.getTotalLength() : std::numeric_limits<int64>::max();
 
-    struct AudioFormatDescription final
+        AtomHeader moov;
+
+        if (! findAtom (in, 0, totalLength, makeType ("moov"), moov))
+            return false;
+
+        for (auto pos = moov.contentStart; pos < moov.end;)
+        {
+            AtomHeader trak, stbl, stsd, stts, stsc, stsz, stco;
+
+            if (! in.setPosition (pos) || ! readAtomHeader (in, moov.end, trak))
+                return false;
+
+            pos = trak.end;
+
+            if (trak.type != makeType ("trak")
+                || ! findAtomPath (in, trak, { "mdia", "minf", "stbl" }, stbl)
+                || ! findAtom (in, stbl.contentStart, stbl.end, makeType ("stsd"), stsd)
+                || ! parseSampleDescription (in, stsd, config, layout))
+                continue;
+
+            const auto hasChunkOffsets32 = findAtom (in, stbl.contentStart, stbl.end, makeType ("stco"), stco);
+            if (! hasChunkOffsets32 && ! findAtom (in, stbl.contentStart, stbl.end, makeType ("co64"), stco))
+                return false;
+
+            std::vector<uint64> timeToSample, sampleToChunk, sampleSizes, chunkOffsets;
+
+            if (! findAtom (in, stbl.contentStart, stbl.end, makeType ("stts"), stts)
+                || ! findAtom (in, stbl.contentStart, stbl.end, makeType ("stsc"), stsc)
+                || ! findAtom (in, stbl.contentStart, stbl.end, makeType ("stsz"), stsz)
+                || ! readTable (in, stts, 2, 4, timeToSample)
+                || ! readTable (in, stsc, 3, 4, sampleToChunk)
+                || ! readTable (in, stsz, 1, 4, sampleSizes, 2)
+                || ! readTable (in, stco, 1, hasChunkOffsets32 ? 4 : 8, chunkOffsets)
+                || sampleToChunk.empty())
+                return false;
+
+            packets.clear();
+            packets.resize (sampleSizes.size());
+
+            // Locate every packet from the chunk offsets and the number of packets per chunk:
+            size_t packetIndex = 0, entry = 0;
+
+            for (size_t chunk = 0; chunk < chunkOffsets.size() && packetIndex < packets.size(); ++chunk)
+            {
+                while (entry + 3 < sampleToChunk.size() && sampleToChunk[entry + 3] <= chunk + 1)
+                    entry += 3;
+
+                auto offset = chunkOffsets[chunk];
+
+                for (uint64 i = 0; i < sampleToChunk[entry + 1] && packetIndex < packets.size(); ++i)
+                {
+                    auto& packet = packets[packetIndex];
+                    packet.fileOffset = (int64) offset;
+                    packet.numBytes = (uint32) sampleSizes[packetIndex];
+                    offset += packet.numBytes;
+                    ++packetIndex;
+                }
+            }
+
+            if (packetIndex != packets.size())
+                return false;
+
+            // Find out how many samples each packet holds:
+            int64 startSample = 0;
+            packetIndex = 0;
+
+            for (size_t i = 0; i + 1 < timeToSample.size(); i += 2)
+            {
+                for (uint64 j = 0; j < timeToSample[i] && packetIndex < packets.size(); ++j)
+                {
+                    auto& packet = packets[packetIndex++];
+                    packet.startSample = startSample;
+                    packet.numFrames = (uint32) timeToSample[i + 1];
+
+                    if (packet.numFrames > config.frameLength)
+                        return false;
+
+                    startSample += packet.numFrames;
+                }
+            }
+
+            return packetIndex == packets.size();
+        }
+
+        return false;
+    }
+
+    //==============================================================================
+    /** Writes an atom, patching its size in once its contents are written. */
+    template<typename Function>
+    void writeAtom (MemoryOutputStream& out, const char* type, Function&& writeContents)
     {
-        double sampleRate = 0.0;
-        uint32_t formatID = 0,
-                 formatFlags = 0,
-                 bytesPerPacket = 0,
-                 framesPerPacket = 0,
-                 bytesPerFrame = 0,
-                 channelsPerFrame = 0,
-                 bitsPerChannel = 0,
-                 reserved = 0;
-    };
+        const auto start = out.getPosition();
+        out.writeIntBigEndian (0);
+        out.write (type, 4);
 
-    /** @note this struct is wrapped in an 'alac' atom in the sample description extension area
-        @note in QT movies, it will be further wrapped in a 'wave' atom surrounded by 'frma' and 'term' atoms
-    */
-    struct ALACSpecificConfig final
+        writeContents();
+
+        const auto end = out.getPosition();
+        out.setPosition (start);
+        out.writeIntBigEndian ((int) (end - start));
+        out.setPosition (end);
+    }
+
+    inline void writeFullAtomHeader (MemoryOutputStream& out, uint32 versionAndFlags = 0)
     {
-        uint32_t frameLength = 0;
-        uint8_t compatibleVersion = 0,
-                bitDepth = 0,
-                pb = 0,
-                mb = 0,
-                kb = 0,
-                numChannels = 0;
-        uint16_t maxRun = 0;
-        uint32_t maxFrameBytes = 0,
-                 avgBitRate = 0,
-                 sampleRate = 0;
-    };
+        out.writeIntBigEndian ((int) versionAndFlags);
+    }
+
+    inline void writeMatrix (MemoryOutputStream& out)
+    {
+        for (auto v : { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 })
+            out.writeIntBigEndian (v);
+    }
+
+    inline MemoryBlock createFileTypeAtom()
+    {
+        MemoryOutputStream out;
+
+        writeAtom (out, "ftyp", [&]
+        {
+            out.write ("M4A ", 4);
+            out.writeIntBigEndian (0);
+            out.write ("M4A mp42isom", 12);
+            out.writeIntBigEndian (0);
+        });
+
+        return out.getMemoryBlock();
+    }
+
+    inline MemoryBlock createMovieAtom (const ALACSpecificConfig& config, const ALACAudioChannelLayout& layout,
+                                        const std::vector<Packet>& packets, int64 lengthInSamples)
+    {
+        MemoryOutputStream out;
+        const auto duration = (int) (uint32) jmin ((int64) 0xffffffff, lengthInSamples);
+        const auto needs64BitOffsets = ! packets.empty() && packets.back().fileOffset > (int64) 0xffffffff;
+
+        writeAtom (out, "moov", [&]
+        {
+            writeAtom (out, "mvhd", [&]
+            {
+                writeFullAtomHeader (out);
+                out.writeIntBigEndian (0); // Creation time
+                out.writeIntBigEndian (0); // Modification time
+                out.writeIntBigEndian ((int) config.sampleRate);
+                out.writeIntBigEndian (duration);
+                out.writeIntBigEndian (0x00010000); // Rate
+                out.writeShortBigEndian (0x0100);   // Volume
+                out.writeRepeatedByte (0, 10);
+                writeMatrix (out);
+                out.writeRepeatedByte (0, 24);
+                out.writeIntBigEndian (2);          // Next track ID
+            });
+
+            writeAtom (out, "trak", [&]
+            {
+                writeAtom (out, "tkhd", [&]
+                {
+                    writeFullAtomHeader (out, 7); // Enabled, in movie, in preview
+                    out.writeIntBigEndian (0);
+                    out.writeIntBigEndian (0);
+                    out.writeIntBigEndian (1);    // Track ID
+                    out.writeIntBigEndian (0);
+                    out.writeIntBigEndian (duration);
+                    out.writeRepeatedByte (0, 8);
+                    out.writeShortBigEndian (0);  // Layer
+                    out.writeShortBigEndian (0);  // Alternate group
+                    out.writeShortBigEndian (0x0100);
+                    out.writeShortBigEndian (0);
+                    writeMatrix (out);
+                    out.writeIntBigEndian (0);    // Width
+                    out.writeIntBigEndian (0);    // Height
+                });
+
+                writeAtom (out, "mdia", [&]
+                {
+                    writeAtom (out, "mdhd", [&]
+                    {
+                        writeFullAtomHeader (out);
+                        out.writeIntBigEndian (0);
+                        out.writeIntBigEndian (0);
+                        out.writeIntBigEndian ((int) config.sampleRate);
+                        out.writeIntBigEndian (duration);
+                        out.writeShortBigEndian ((short) 0x55c4); // "und"
+                        out.writeShortBigEndian (0);
+                    });
+
+                    writeAtom (out, "hdlr", [&]
+                    {
+                        writeFullAtomHeader (out);
+                        out.writeIntBigEndian (0);
+                        out.write ("soun", 4);
+                        out.writeRepeatedByte (0, 12);
+                        out.write ("SoundHandler", 13);
+                    });
+
+                    writeAtom (out, "minf", [&]
+                    {
+                        writeAtom (out, "smhd", [&]
+                        {
+                            writeFullAtomHeader (out);
+                            out.writeIntBigEndian (0);
+                        });
+
+                        writeAtom (out, "dinf", [&]
+                        {
+                            writeAtom (out, "dref", [&]
+                            {
+                                writeFullAtomHeader (out);
+                                out.writeIntBigEndian (1);
+                                writeAtom (out, "url ", [&] { writeFullAtomHeader (out, 1); });
+                            });
+                        });
+
+                        writeAtom (out, "stbl", [&]
+                        {
+                            writeAtom (out, "stsd", [&]
+                            {
+                                writeFullAtomHeader (out);
+                                out.writeIntBigEndian (1);
+
+                                writeAtom (out, "alac", [&]
+                                {
+                                    out.writeRepeatedByte (0, 6);
+                                    out.writeShortBigEndian (1); // Data reference index
+                                    out.writeShortBigEndian (0); // Version
+                                    out.writeShortBigEndian (0); // Revision
+                                    out.writeIntBigEndian (0);   // Vendor
+                                    out.writeShortBigEndian ((short) config.numChannels);
+                                    out.writeShortBigEndian ((short) config.bitDepth);
+                                    out.writeShortBigEndian (0); // Compression ID
+                                    out.writeShortBigEndian (0); // Packet size
+                                    out.writeIntBigEndian (config.sampleRate < 65536 ? (int) (config.sampleRate << 16) : 0);
+
+                                    writeAtom (out, "alac", [&]
+                                    {
+                                        writeFullAtomHeader (out);
+                                        out.writeIntBigEndian ((int) config.frameLength);
+                                        out.writeByte ((char) config.compatibleVersion);
+                                        out.writeByte ((char) config.bitDepth);
+                                        out.writeByte ((char) config.pb);
+                                        out.writeByte ((char) config.mb);
+                                        out.writeByte ((char) config.kb);
+                                        out.writeByte ((char) config.numChannels);
+                                        out.writeShortBigEndian ((short) config.maxRun);
+                                        out.writeIntBigEndian ((int) config.maxFrameBytes);
+                                        out.writeIntBigEndian ((int) config.avgBitRate);
+                                        out.writeIntBigEndian ((int) config.sampleRate);
+                                    });
+
+                                    writeAtom (out, "chan", [&]
+                                    {
+                                        writeFullAtomHeader (out);
+                                        out.writeIntBigEndian ((int) layout.channelLayoutTag);
+                                        out.writeIntBigEndian ((int) layout.channelBitmap);
+                                        out.writeIntBigEndian ((int) layout.numberChannelDescriptions);
+                                    });
+                                });
+                            });
+
+                            writeAtom (out, "stts", [&]
+                            {
+                                // NB: Every packet is full length except possibly the last one.
+                                const auto numPackets = (uint32) packets.size();
+                                const auto hasShortLast = numPackets > 0 && packets.back().numFrames != config.frameLength;
+                                const auto numFull = hasShortLast ? numPackets - 1 : numPackets;
+
+                                writeFullAtomHeader (out);
+                                out.writeIntBigEndian ((numFull > 0 ? 1 : 0) + (hasShortLast ? 1 : 0));
+
+                                if (numFull > 0)
+                                {
+                                    out.writeIntBigEndian ((int) numFull);
+                                    out.writeIntBigEndian ((int) config.frameLength);
+                                }
+
+                                if (hasShortLast)
+                                {
+                                    out.writeIntBigEndian (1);
+                                    out.writeIntBigEndian ((int) packets.back().numFrames);
+                                }
+                            });
 
-    /** */
-    struct M4AHeader final
+                            writeAtom (out, "stsc", [&]
+                            {
+                                writeFullAtomHeader (out);
+                                out.writeIntBigEndian (1);
+                                out.writeIntBigEndian (1); // First chunk
+                                out.writeIntBigEndian (1); // One packet per chunk
+                                out.writeIntBigEndian (1); // Sample description index
+                            });
+
+                            writeAtom (out, "stsz", [&]
+                            {
+                                writeFullAtomHeader (out);
+                                out.writeIntBigEndian (0);
+                                out.writeIntBigEndian ((int) packets.size());
+
+                                for (const auto& packet : packets)
+                                    out.writeIntBigEndian ((int) packet.numBytes);
+                            });
+
+                            writeAtom (out, needs64BitOffsets ? "co64" : "stco", [&]
+                            {
+                                writeFullAtomHeader (out);
+                                out.writeIntBigEndian ((int) packets.size());
+
+                                for (const auto& packet : packets)
+                                {
+                                    if (needs64BitOffsets)
+                                        out.writeInt64BigEndian (packet.fileOffset);
+                                    else
+                                        out.writeIntBigEndian ((int) (uint32) packet.fileOffset);
+                                }
+                            });
+                        });
+                    });
+                });
+            });
+        });
+
+        return out.getMemoryBlock();
+    }
+    //==============================================================================
+    /** Decodes packets on demand for the readers, keeping the last decoded packet around
+        so that consecutive reads of a packet (eg: small blocks, or getSample() calls)
+        only decode it once.
+    */
+    class PacketCache final
     {
-        M4AHeader() = default;
+    public:
+        PacketCache() = default;
+
+        /** @param sources  The ALAC channel that each of the read channels comes from.
+                            See getSourceChannels().
+        */
+        void reset (const ALACSpecificConfig& c, std::vector<Packet> p, std::vector<int> sources)
+        {
+            jassert (sources.size() == (size_t) c.numChannels);
+
+            config = c;
+            packets = std::move (p);
+            sourceChannels = std::move (sources);
+            decoder = std::make_unique<Decoder> (config);
+
+            channels.resize (config.numChannels);
+            channelPointers.resize (config.numChannels);
+
+            for (size_t i = 0; i < channels.size(); ++i)
+            {
+                channels[i].resize (config.frameLength);
+                channelPointers[i] = channels[i].data();
+            }
+
+            decodedPacketIndex = std::numeric_limits<size_t>::max();
+            numDecodedFrames = 0;
+        }
+
+        [[nodiscard]] const ALACSpecificConfig& getConfig() const noexcept  { return config; }
+        [[nodiscard]] const std::vector<Packet>& getPackets() const noexcept { return packets; }
+        [[nodiscard]] const std::vector<int>& getSourceChannels() const noexcept { return sourceChannels; }
 
-        bool parse (InputStream& stream)
+        [[nodiscard]] int64 getLengthInSamples() const noexcept
         {
-            stream.readInt ();
+            return packets.empty() ? 0 : packets.back().startSample + (int64) packets.back().numFrames;
+        }
+
+        /** Makes sure the packet holding the sample is decoded.
+
+            @param getPacketData    Called as (const Packet&) -> const uint8*,
+                                    and may return nullptr if the data is unavailable.
+
+            @returns the packet, or nullptr if it couldn't be decoded.
+        */
+        template<typename GetPacketData>
+        const Packet* decodePacketHolding (int64 sample, GetPacketData&& getPacketData)
+        {
+            if (decoder == nullptr || packets.empty())
+                return nullptr;
+
+            const auto packetIndex = findPacket (packets, sample);
+            const auto& packet = packets[packetIndex];
+
+            if (packetIndex != decodedPacketIndex)
+            {
+                decodedPacketIndex = std::numeric_limits<size_t>::max();
+
+                const auto* data = getPacketData (packet);
+                if (data == nullptr)
+                    return nullptr;
+
+                numDecodedFrames = decoder->decode (data, packet.numBytes, channelPointers.data());
+                if (numDecodedFrames < 0)
+                    return nullptr;
+
+                decodedPacketIndex = packetIndex;
+            }
+
+            return sample - packet.startSample < numDecodedFrames ? &packet : nullptr;
+        }
+
+        /** Reads left-justified samples, as per AudioFormatReader::readSamples(). */
+        template<typename GetPacketData>
+        bool read (int* const* destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                   int64 startSampleInFile, int numSamples, GetPacketData&& getPacketData)
+        {
+            const auto shift = 32 - (uint32) config.bitDepth;
+
+            while (numSamples > 0)
+            {
+                const auto* packet = decodePacketHolding (startSampleInFile, getPacketData);
+
+                if (packet == nullptr)
+                {
+                    for (int i = 0; i < numDestChannels; ++i)
+                        if (auto* dest = destSamples[i])
+                            zeromem (dest + startOffsetInDestBuffer, sizeof (int) * (size_t) numSamples);
+
+                    return false;
+                }
+
+                const auto offsetInPacket = (int) (startSampleInFile - packet->startSample);
+                const auto numThisTime = jmin (numSamples, numDecodedFrames - offsetInPacket);
+
+                for (int i = 0; i < numDestChannels; ++i)
+                {
+                    if (destSamples[i] == nullptr)
+                        continue;
+
+                    auto* dest = destSamples[i] + startOffsetInDestBuffer;
+
+                    if (isPositiveAndBelow (i, (int) channels.size()))
+                    {
+                        const auto* source = channels[(size_t) sourceChannels[(size_t) i]].data() + offsetInPacket;
+
+                        for (int s = 0; s < numThisTime; ++s)
+                            dest[s] = static_cast<int> (static_cast<uint32> (source[s]) << shift);
+                    }
+                    else
+                    {
+                        zeromem (dest, sizeof (int) * (size_t) numThisTime);
+                    }
+                }
+
+                startOffsetInDestBuffer += numThisTime;
+                startSampleInFile += numThisTime;
+                numSamples -= numThisTime;
+            }
 
             return true;
         }
 
-        using FTypeCode = std::array<size_t, 4>;
+        /** @returns a sample of the last decoded packet, as a float. */
+        [[nodiscard]] float getSample (int channel, int64 sampleInFile) const noexcept
+        {
+            const auto& packet = packets[decodedPacketIndex];
+            const auto scale = 1.0f / (float) (1u << (config.bitDepth - 1));
+            return (float) channels[(size_t) sourceChannels[(size_t) channel]][(size_t) (sampleInFile - packet.startSample)] * scale;
+        }
+
+    private:
+        ALACSpecificConfig config;
+        std::vector<Packet> packets;
+        std::vector<int> sourceChannels;
+        std::unique_ptr<Decoder> decoder;
+        std::vector<std::vector<int32>> channels;
+        std::vector<int32*> channelPointers;
+        size_t decodedPacketIndex = std::numeric_limits<size_t>::max();
+        int numDecodedFrames = 0;
 
-        int numBytes = 0,
-            totalSizeBytes = 0,
-            type = 0, // ftyp = 66 74 79 70
-            subType = 0,
-            subSizeBytes = 0
-            ;
+        JUCE_DECLARE_NON_COPYABLE (PacketCache)
     };
 }
 
@@ -134,69 +1948,134 @@ public:
     ALACAudioFormatReader (InputStream* in) :
         AudioFormatReader (in, alac::formatName)
     {
+        alac::ALACSpecificConfig config;
+        alac::ALACAudioChannelLayout layout;
+        std::vector<alac::Packet> packets;
+
+        if (input == nullptr || ! alac::parseContainer (*input, config, layout, packets))
+            return;
+
+        cache.reset (config, std::move (packets), alac::getSourceChannels (layout, config.numChannels));
+
+        // NB: Anything but the default order is passed on as is, as the speakers aren't known.
+        channelSet = alac::isDefaultOrder (layout, config.numChannels)
+                        ? alac::getDefaultChannelSet (config.numChannels)
+                        : AudioChannelSet::discreteChannels (config.numChannels);
+
+        sampleRate = (double) config.sampleRate;
+        bitsPerSample = config.bitDepth;
+        numChannels = config.numChannels;
+        usesFloatingPointData = false;
+        lengthInSamples = cache.getLengthInSamples();
     }
 
     //==============================================================================
+    AudioChannelSet getChannelLayout() override { return channelSet; }
+
     bool readSamples (int* const* destSamples, int numDestChannels, int startOffsetInDestBuffer,
                       int64 startSampleInFile, int numSamples) override
     {
         clearSamplesBeyondAvailableLength (destSamples, numDestChannels, startOffsetInDestBuffer,
                                            startSampleInFile, numSamples, lengthInSamples);
 
-        if (numSamples <= 0)
-            return true;
+        return cache.read (destSamples, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples,
+                           [this] (const alac::Packet& packet) -> const uint8*
+                           {
+                               packetData.setSize (packet.numBytes, false);
 
-        if (! input->setPosition (dataChunkStart + startSampleInFile * bytesPerFrame))
-            return true;
+                               if (! input->setPosition (packet.fileOffset)
+                                   || input->read (packetData.getData(), (int) packet.numBytes) != (int) packet.numBytes)
+                                   return nullptr;
 
-        while (numSamples > 0)
-        {
-            tempBuffer.fillWith (0);
+                               return static_cast<const uint8*> (packetData.getData());
+                           });
+    }
 
-            const auto numThisTime = jmin (tempBufSize / bytesPerFrame, numSamples);
-            input->readIntoMemoryBlock (tempBuffer, (ssize_t) (numThisTime * bytesPerFrame));
+private:
+    alac::PacketCache cache;
+    AudioChannelSet channelSet;
+    MemoryBlock packetData;
 
-            if (littleEndian)
-                copySampleData<AudioData::LittleEndian> (bitsPerSample, usesFloatingPointData,
-                                                         destSamples, startOffsetInDestBuffer, numDestChannels,
-                                                         tempBuffer.getData(), (int) numChannels, numThisTime);
-            else
-                copySampleData<AudioData::BigEndian> (bitsPerSample, usesFloatingPointData,
-                                                      destSamples, startOffsetInDestBuffer, numDestChannels,
-                                                      tempBuffer.getData(), (int) numChannels, numThisTime);
+    friend class ALACMappedFileReader;
 
-            startOffsetInDestBuffer += numThisTime;
-            numSamples -= numThisTime;
-        }
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ALACAudioFormatReader)
+};
 
-        return true;
-    }
+//==============================================================================
+/** Decodes straight out of a mapped file, so the packets are never copied.
 
-    template<typename Endianness>
-    static void copySampleData (unsigned int numBitsPerSample, bool floatingPointData,
-                                int* const* destSamples, int startOffsetInDestBuffer, int numDestChannels,
-                                const void* sourceData, int numberOfChannels, int numSamples) noexcept
+    This is a plain reader rather than a MemoryMappedAudioFormatReader:
+    the latter's sample pointers and file positions assume uncompressed frames
+    of a fixed size, which a compressed format doesn't have.
+*/
+class ALACMappedFileReader final : public AudioFormatReader
+{
+public:
+    ALACMappedFileReader (const File& file, const ALACAudioFormatReader& details) :
+        AudioFormatReader (nullptr, details.getFormatName()),
+        channelSet (details.channelSet)
     {
-        switch (numBitsPerSample)
+        const auto& source = details.cache;
+        const auto& packets = source.getPackets();
+
+        if (packets.empty())
+            return;
+
+        // NB: The packets are normally stored in order, but nothing says they have to be.
+        auto start = std::numeric_limits<int64>::max();
+        int64 end = 0;
+
+        for (const auto& packet : packets)
         {
-            case 16:    ReadHelper<AudioData::Int32, AudioData::Int16, Endianness>::read (destSamples, startOffsetInDestBuffer, numDestChannels, sourceData, numberOfChannels, numSamples); break;
-            case 24:    ReadHelper<AudioData::Int32, AudioData::Int24, Endianness>::read (destSamples, startOffsetInDestBuffer, numDestChannels, sourceData, numberOfChannels, numSamples); break;
-            case 32:    if (floatingPointData) ReadHelper<AudioData::Float32, AudioData::Float32, Endianness>::read (destSamples, startOffsetInDestBuffer, numDestChannels, sourceData, numberOfChannels, numSamples);
-                        else                   ReadHelper<AudioData::Int32,   AudioData::Int32,   Endianness>::read (destSamples, startOffsetInDestBuffer, numDestChannels, sourceData, numberOfChannels, numSamples);
-                        break;
-            default:    jassertfalse; break;
+            start = jmin (start, packet.fileOffset);
+            end = jmax (end, packet.fileOffset + (int64) packet.numBytes);
+        }
+
+        // NB: Mapping the lot is cheap, as the pages are only read in once they're decoded.
+        map = std::make_unique<MemoryMappedFile> (file, Range<int64> (start, end), MemoryMappedFile::readOnly);
+
+        if (map->getData() == nullptr || map->getRange().getStart() > start || map->getRange().getEnd() < end)
+        {
+            map.reset();
+            return;
         }
+
+        cache.reset (source.getConfig(), packets, source.getSourceChannels());
+
+        sampleRate = details.sampleRate;
+        bitsPerSample = details.bitsPerSample;
+        numChannels = details.numChannels;
+        usesFloatingPointData = details.usesFloatingPointData;
+        lengthInSamples = details.lengthInSamples;
+        metadataValues = details.metadataValues;
     }
 
-    int bytesPerFrame = 0;
-    int64 dataChunkStart = 0;
-    bool littleEndian = true;
+    //==============================================================================
+    AudioChannelSet getChannelLayout() override { return channelSet; }
+
+    bool readSamples (int* const* destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                      int64 startSampleInFile, int numSamples) override
+    {
+        clearSamplesBeyondAvailableLength (destSamples, numDestChannels, startOffsetInDestBuffer,
+                                           startSampleInFile, numSamples, lengthInSamples);
+
+        if (numSamples <= 0)
+            return true;
+
+        return cache.read (destSamples, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples,
+                           [this] (const alac::Packet& packet) -> const uint8*
+                           {
+                               const auto range = map->getRange();
+                               return addBytesToPointer (static_cast<const uint8*> (map->getData()), packet.fileOffset - range.getStart());
+                           });
+    }
 
 private:
-    const int tempBufSize = 480 * 3 * 4; // (keep this a multiple of 3)
-    MemoryBlock tempBuffer { (size_t) tempBufSize };
+    std::unique_ptr<MemoryMappedFile> map;
+    alac::PacketCache cache;
+    const AudioChannelSet channelSet;
 
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ALACAudioFormatReader)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ALACMappedFileReader)
 };
 
 //==============================================================================
@@ -204,15 +2083,82 @@ class ALACAudioFormatWriter final : public AudioFormatWriter
 {
 public:
     ALACAudioFormatWriter (OutputStream* out, double rate,
-                           int numChans, int bits,
+                           const AudioChannelSet& layout, int bits,
                            const std::unordered_map<String, String>& metadataMap) :
-        AudioFormatWriter (out, TRANS (alac::formatName), rate, (uint32) numChans, (uint32) bits)
+        AudioFormatWriter (out, TRANS (alac::formatName), rate, layout, (uint32) bits)
     {
         ignoreUnused (metadataMap); // TODO
+
+        const auto numChans = layout.size();
+
+        // NB: Layouts with the speakers of the default ALAC layout are reordered to it, and anything else is stored in order.
+        sourceChannels = alac::findJUCEChannelIndices (layout, numChans);
+        channelLayout = alac::createChannelLayout (numChans, ! sourceChannels.empty());
+
+        if (sourceChannels.empty())
+        {
+            sourceChannels.resize ((size_t) numChans);
+            std::iota (sourceChannels.begin(), sourceChannels.end(), 0);
+        }
+
+        config.frameLength = alac::DefaultFrameSize;
+        config.compatibleVersion = alac::CompatibleVersion;
+        config.bitDepth = (uint8_t) bits;
+        config.pb = alac::defaultPB;
+        config.mb = alac::defaultMB;
+        config.kb = alac::defaultKB;
+        config.numChannels = (uint8_t) numChans;
+        config.maxRun = alac::defaultMaxRun;
+        config.sampleRate = (uint32_t) roundToInt (rate);
+
+        encoder = std::make_unique<alac::Encoder> (config);
+
+        pendingChannels.resize ((size_t) numChans);
+        pendingPointers.resize ((size_t) numChans);
+
+        for (size_t i = 0; i < pendingChannels.size(); ++i)
+        {
+            pendingChannels[i].resize (config.frameLength);
+            pendingPointers[i] = pendingChannels[i].data();
+        }
+
+        const auto fileType = alac::createFileTypeAtom();
+        output->write (fileType.getData(), fileType.getSize());
+
+        // NB: The size of the media data is patched in once known, hence the 64-bit header.
+        mediaDataStart = output->getPosition();
+        output->writeIntBigEndian (1);
+        output->write ("mdat", 4);
+        output->writeInt64BigEndian (0);
     }
 
     ~ALACAudioFormatWriter() override
     {
+        if (output == nullptr)
+            return;
+
+        if (numPendingSamples > 0)
+            writePacket();
+
+        const auto mediaDataEnd = output->getPosition();
+
+        if (output->setPosition (mediaDataStart + 8))
+        {
+            output->writeInt64BigEndian (mediaDataEnd - mediaDataStart);
+            output->setPosition (mediaDataEnd);
+        }
+        else
+        {
+            // The file needs a seekable stream to be finished correctly!
+            jassertfalse;
+        }
+
+        const auto duration = (double) numSamplesWritten / (double) config.sampleRate;
+        config.avgBitRate = duration > 0.0 ? (uint32_t) ((double) (mediaDataEnd - mediaDataStart) * 8.0 / duration) : 0;
+
+        const auto movie = alac::createMovieAtom (config, channelLayout, packets, numSamplesWritten);
+        output->write (movie.getData(), movie.getSize());
+        output->flush();
     }
 
     //==============================================================================
@@ -221,10 +2167,70 @@ public:
         jassertquiet (numSamples >= 0);
         jassertquiet (data != nullptr && *data != nullptr); // the input must contain at least one channel!
 
+        const auto shift = 32 - (int) config.bitDepth;
+
+        // NB: The channels are taken out of order, so only the ones ahead of the null terminator are safe to use.
+        int numSourceChannels = 0;
+        while (numSourceChannels < (int) numChannels && data[numSourceChannels] != nullptr)
+            ++numSourceChannels;
+
+        for (int offset = 0; offset < numSamples;)
+        {
+            const auto numThisTime = jmin (numSamples - offset, (int) config.frameLength - numPendingSamples);
+
+            for (size_t c = 0; c < pendingChannels.size(); ++c)
+            {
+                auto* dest = pendingChannels[c].data() + numPendingSamples;
+                const auto sourceChannel = sourceChannels[c];
+
+                // NB: The incoming samples are left-justified, whereas the codec works on the actual bit depth.
+                if (const auto* source = sourceChannel < numSourceChannels ? data[sourceChannel] : nullptr)
+                    for (int i = 0; i < numThisTime; ++i)
+                        dest[i] = source[offset + i] >> shift;
+                else
+                    std::fill_n (dest, numThisTime, 0);
+            }
+
+            offset += numThisTime;
+            numPendingSamples += numThisTime;
+
+            if (numPendingSamples == (int) config.frameLength && ! writePacket())
+                return false;
+        }
+
         return true;
     }
 
 private:
+    alac::ALACSpecificConfig config;
+    alac::ALACAudioChannelLayout channelLayout;
+    std::vector<int> sourceChannels;
+    std::unique_ptr<alac::Encoder> encoder;
+    alac::BitWriter bitWriter;
+    std::vector<std::vector<int32>> pendingChannels;
+    std::vector<const int32*> pendingPointers;
+    std::vector<alac::Packet> packets;
+    int numPendingSamples = 0;
+    int64 mediaDataStart = 0, numSamplesWritten = 0;
+
+    bool writePacket()
+    {
+        encoder->encode (pendingPointers.data(), numPendingSamples, bitWriter);
+
+        alac::Packet packet;
+        packet.fileOffset = output->getPosition();
+        packet.startSample = numSamplesWritten;
+        packet.numBytes = (uint32) bitWriter.getNumBytes();
+        packet.numFrames = (uint32) numPendingSamples;
+        packets.push_back (packet);
+
+        config.maxFrameBytes = jmax (config.maxFrameBytes, (uint32_t) packet.numBytes);
+        numSamplesWritten += numPendingSamples;
+        numPendingSamples = 0;
+
+        return output->write (bitWriter.getData(), bitWriter.getNumBytes());
+    }
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ALACAudioFormatWriter)
 };
 
@@ -261,6 +2267,21 @@ AudioFormatReader* ALACAudioFormat::createReaderFor (InputStream* sourceStream,
     return nullptr;
 }
 
+std::unique_ptr<AudioFormatReader> ALACAudioFormat::createMappedFileReader (const File& file)
+{
+    const ALACAudioFormatReader details (file.createInputStream().release());
+
+    if (details.lengthInSamples <= 0)
+        return {};
+
+    auto reader = std::make_unique<ALACMappedFileReader> (file, details);
+
+    if (reader->lengthInSamples <= 0)
+        return {};
+
+    return reader;
+}
+
 std::unique_ptr<AudioFormatWriter> ALACAudioFormat::createWriterFor (std::unique_ptr<OutputStream>& out,
                                                                      const AudioFormatWriterOptions& options)
 
@@ -269,11 +2290,108 @@ std::unique_ptr<AudioFormatWriter> ALACAudioFormat::createWriterFor (std::unique
         && getPossibleSampleRates().contains ((int) options.getSampleRate())
         && getPossibleBitDepths().contains (options.getBitsPerSample())
         && options.getNumChannels() > 0
-        && isPositiveAndBelow (options.getNumChannels(), (int) alac::maxChannels))
+        && options.getNumChannels() <= (int) alac::maxChannels)
     {
-        return std::make_unique<ALACAudioFormatWriter> (out.release(), options.getSampleRate(), options.getNumChannels(),
+        return std::make_unique<ALACAudioFormatWriter> (out.release(), options.getSampleRate(), options.getChannelLayout(),
                                                         options.getBitsPerSample(), options.getMetadataValues());
     }
 
     return nullptr;
 }
+
+//==============================================================================
+bool ALACAudioFormat::decodeConcurrently (InputStream& source, juce::AudioBuffer<float>& destination,
+                                          ThreadPool& pool, double* sampleRate)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    alac::ALACSpecificConfig config;
+    alac::ALACAudioChannelLayout layout;
+    std::vector<alac::Packet> packets;
+
+    if (! alac::parseContainer (source, config, layout, packets) || packets.empty())
+        return false;
+
+    // NB: The packets are read in one go so that the jobs only ever touch memory.
+    const auto firstOffset = packets.front().fileOffset;
+    const auto& last = packets.back();
+    const auto numBytes = last.fileOffset + (int64) last.numBytes - firstOffset;
+
+    for (const auto& packet : packets)
+        if (packet.fileOffset < firstOffset || packet.fileOffset + (int64) packet.numBytes > firstOffset + numBytes)
+            return false; // The packets aren't stored contiguously...
+
+    MemoryBlock data;
+    if (numBytes <= 0
+        || ! source.setPosition (firstOffset)
+        || source.readIntoMemoryBlock (data, (ssize_t) numBytes) != (size_t) numBytes)
+        return false;
+
+    const auto numChannels = (int) config.numChannels;
+    const auto sourceChannels = alac::getSourceChannels (layout, numChannels);
+    const auto lengthInSamples = last.startSample + (int64) last.numFrames;
+
+    if (lengthInSamples > std::numeric_limits<int>::max())
+        return false;
+
+    destination.setSize (numChannels, (int) lengthInSamples, false, false, true);
+
+    const auto numJobs = (size_t) jlimit (1, (int) packets.size(), pool.getNumThreads() * 4);
+    const auto packetsPerJob = (packets.size() + numJobs - 1) / numJobs;
+
+    std::atomic<int> numRemaining { (int) numJobs };
+    std::atomic<bool> failed { false };
+    WaitableEvent finished;
+
+    for (size_t job = 0; job < numJobs; ++job)
+    {
+        const auto start = job * packetsPerJob;
+        const auto end = std::min (start + packetsPerJob, packets.size());
+
+        pool.addJob ([&, start, end]
+        {
+            alac::Decoder decoder (config);
+            const auto scale = 1.0f / (float) (1u << (config.bitDepth - 1));
+
+            std::vector<std::vector<int32>> channels ((size_t) numChannels, std::vector<int32> (config.frameLength));
+            std::vector<int32*> pointers;
+
+            for (auto& c : channels)
+                pointers.push_back (c.data());
+
+            for (auto i = start; i < end && ! failed.load (std::memory_order_relaxed); ++i)
+            {
+                const auto& packet = packets[i];
+                const auto* packetData = addBytesToPointer (static_cast<const uint8*> (data.getData()), packet.fileOffset - firstOffset);
+                const auto numFrames = decoder.decode (packetData, packet.numBytes, pointers.data());
+
+                if (numFrames < 0 || packet.startSample + numFrames > lengthInSamples)
+                {
+                    failed = true;
+                    break;
+                }
+
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    auto* dest = destination.getWritePointer (c, (int) packet.startSample);
+
+                    for (int s = 0; s < numFrames; ++s)
+                        dest[s] = (float) channels[(size_t) sourceChannels[(size_t) c]][(size_t) s] * scale;
+                }
+            }
+
+            if (--numRemaining == 0)
+                finished.signal();
+        });
+    }
+
+    finished.wait();
+
+    if (failed)
+        return false;
+
+    if (sampleRate != nullptr)
+        *sampleRate = (double) config.sampleRate;
+
+    return true;
+}
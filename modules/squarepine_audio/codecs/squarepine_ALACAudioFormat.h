@@ -1,5 +1,11 @@
 /** Reads and writes the ALAC audio format.
 
+    ALAC stores its surround channels centre first (eg: C L R Ls Rs LFE for 5.1),
+    so they're reordered to and from the JUCE layout with the same speakers
+    (see AudioFormatReader::getChannelLayout()). Files whose 'chan' atom holds
+    any other layout are read in their stored order as discrete channels,
+    and a writer given a layout ALAC has no equivalent for stores it as is.
+
     @see AudioFormat
 
     @tags{Audio}
@@ -26,6 +32,37 @@ public:
     /** @internal */
     std::unique_ptr<AudioFormatWriter> createWriterFor (std::unique_ptr<OutputStream>&, const AudioFormatWriterOptions&) override;
 
+    //==============================================================================
+    /** Creates a reader that decodes the packets straight out of a mapped file,
+        instead of reading each of them into a buffer first.
+
+        This suits skimming many files (eg: previews, or drawing thumbnails).
+        As the samples are compressed, there's nothing in the file that a
+        MemoryMappedAudioFormatReader could point at, hence this returns a
+        plain reader and createMemoryMappedReader() isn't supported.
+
+        @returns the reader, or nullptr if the file couldn't be parsed or mapped.
+    */
+    std::unique_ptr<AudioFormatReader> createMappedFileReader (const File& file);
+
+    //==============================================================================
+    /** Decodes a whole ALAC file into a buffer, spreading the packets over the pool's threads.
+
+        Every packet is independently decodable, so this is a lot faster than
+        pulling the file through a reader when loading a file in one go
+        (eg: for a sampler, or offline analysis).
+
+        @param source       The stream to read the file from.
+        @param destination  Resized to the number of channels and samples in the file,
+                            which are in the same order as a reader would give them.
+        @param pool         The pool to run the decoding jobs on.
+        @param sampleRate   If not null, this is set to the file's sample rate.
+
+        @returns true if the whole file was decoded.
+    */
+    static bool decodeConcurrently (InputStream& source, juce::AudioBuffer<float>& destination,
+                                    ThreadPool& pool, double* sampleRate = nullptr);
+
 private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ALACAudioFormat)
 };
@@ -653,6 +653,14 @@ public:
         loadedOk = decompress (system, rexData.getData(), rexData.getSize());
     }
 
+    /** Decodes the file from memory that's already available (eg: a mapped file). */
+    Reader (REXSystem& system, const void* rexData, size_t rexDataSize, const String& name) :
+        AudioFormatReader (nullptr, name),
+        buffer (2, 1024)
+    {
+        loadedOk = decompress (system, rexData, rexDataSize);
+    }
+
     bool readSamples (int* const* destChannels, int numDestChannels,
                       int startOffsetInDestBuffer, int64 startSampleInFile,
                       int numSamples) override
@@ -908,4 +916,28 @@ AudioFormatReader* REXAudioFormat::createReaderFor (InputStream* sourceStream, c
     return nullptr;
 }
 
+std::unique_ptr<AudioFormatReader> REXAudioFormat::createMappedFileReader (const File& file)
+{
+    if (! canHandleFile (file))
+        return {};
+
+    reloadREXSystemIfNeeded();
+
+    if (! isREXSystemLoaded())
+        return {};
+
+    const MemoryMappedFile mappedFile (file, MemoryMappedFile::readOnly);
+
+    if (mappedFile.getData() == nullptr)
+        return {};
+
+    // NB: The library copies out what it needs, so the file can be unmapped straight after.
+    auto reader = std::make_unique<Reader> (*rexSystem, mappedFile.getData(), mappedFile.getSize(), getFormatName());
+
+    if (! reader->loadedOk)
+        return {};
+
+    return reader;
+}
+
 #endif // SQUAREPINE_USE_REX_AUDIO_FORMAT
@@ -76,6 +76,18 @@ public:
     /** @internal */
     std::unique_ptr<AudioFormatWriter> createWriterFor (std::unique_ptr<OutputStream>&, const AudioFormatWriterOptions&) override { return {}; }
 
+    //==============================================================================
+    /** Creates a reader that hands a mapped view of the file to the REX library,
+        rather than copying the whole file into memory first.
+
+        The library decodes the entire file up-front either way, so there are no
+        raw samples in the file to point at, which is why this isn't offered
+        through createMemoryMappedReader().
+
+        @returns the reader, or nullptr if the file couldn't be mapped or decoded.
+    */
+    std::unique_ptr<AudioFormatReader> createMappedFileReader (const File& file);
+
 private:
     //==============================================================================
     class Reader;
@@ -1,3 +1,73 @@
+/** A region of a FIFO's storage that can be read from or written to in place,
+    without copying anything.
+
+    The region is split in two blocks when it wraps around the end of the storage,
+    where the second block is empty otherwise.
+
+    The read or write is completed when the region goes out of scope.
+
+    @see AudioBufferFIFO, MultiReaderAudioBufferFIFO
+*/
+template<typename FloatType>
+class AudioFIFORegion final
+{
+public:
+    /** Called once the region is done with, with the number of samples to complete. */
+    using Finisher = void (*) (void* owner, int numSamples);
+
+    /** Constructor, which is meant to be used by the FIFOs. */
+    AudioFIFORegion (void* owner_, Finisher finisher_, int numChannels_,
+                     FloatType* const* block1_, int size1_,
+                     FloatType* const* block2_, int size2_) noexcept :
+        owner (owner_),
+        finisher (finisher_),
+        block1 (block1_),
+        block2 (block2_),
+        numChannels (numChannels_),
+        size1 (size1_),
+        size2 (size2_)
+    {
+    }
+
+    /** Destructor, which completes the read or write. */
+    ~AudioFIFORegion()
+    {
+        if (finisher != nullptr)
+            finisher (owner, getNumSamples());
+    }
+
+    //==============================================================================
+    /** @returns the total number of samples in the region, which may be less than requested. */
+    [[nodiscard]] int getNumSamples() const noexcept    { return size1 + size2; }
+
+    /** @returns the number of channels in the region. */
+    [[nodiscard]] int getNumChannels() const noexcept   { return numChannels; }
+
+    /** @returns the block at the start of the region. */
+    [[nodiscard]] AudioBufferView<FloatType> getFirstBlock() const noexcept     { return { block1, numChannels, size1 }; }
+
+    /** @returns the block that wrapped around the end of the storage, which is usually empty. */
+    [[nodiscard]] AudioBufferView<FloatType> getSecondBlock() const noexcept    { return { block2, numChannels, size2 }; }
+
+    /** Calls the function for each non-empty block, as `void (AudioBufferView<FloatType>, int offsetInRegion)`. */
+    template<typename Function>
+    void forEachBlock (Function&& function) const
+    {
+        if (size1 > 0)  function (getFirstBlock(), 0);
+        if (size2 > 0)  function (getSecondBlock(), size1);
+    }
+
+private:
+    void* owner = nullptr;
+    Finisher finisher = nullptr;
+    FloatType* const* block1 = nullptr;
+    FloatType* const* block2 = nullptr;
+    int numChannels = 0, size1 = 0, size2 = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (AudioFIFORegion)
+};
+
+//==============================================================================
 /** The AudioBufferFIFO implements an actual sample buffer using AbstractFIFO.
 
     You can add samples from the various kind of formats,
@@ -26,11 +96,49 @@ public:
     {
         buffer.setSize (channels, newBufferSize, false, true, true);
         setTotalSize (newBufferSize);
+
+        for (auto& pointers : regionPointers)
+            pointers.assign ((size_t) channels, nullptr);
+    }
+
+    //==============================================================================
+    /** Prepares a region of the FIFO to be written to in place.
+
+        The write is completed, for the full size of the region,
+        when the returned object goes out of scope.
+        Only one write may be in progress at a time.
+    */
+    [[nodiscard]] AudioFIFORegion<FloatType> write (int numSamples)
+    {
+        int start1, size1, start2, size2;
+        prepareToWrite (std::max (0, numSamples), start1, size1, start2, size2);
+
+        return { this, [] (void* f, int n) { static_cast<AudioBufferFIFO*> (f)->finishedWrite (n); },
+                 getNumChannels(),
+                 getRegionPointers (0, start1), size1,
+                 getRegionPointers (1, start2), size2 };
+    }
+
+    /** Prepares a region of the FIFO to be read from in place.
+
+        The read is completed, for the full size of the region,
+        when the returned object goes out of scope.
+        Only one read may be in progress at a time.
+    */
+    [[nodiscard]] AudioFIFORegion<FloatType> read (int numSamples)
+    {
+        int start1, size1, start2, size2;
+        prepareToRead (std::max (0, numSamples), start1, size1, start2, size2);
+
+        return { this, [] (void* f, int n) { static_cast<AudioBufferFIFO*> (f)->finishedRead (n); },
+                 getNumChannels(),
+                 getRegionPointers (2, start1), size1,
+                 getRegionPointers (3, start2), size2 };
     }
 
     //==============================================================================
     /** Push samples into the FIFO from raw float arrays. */
-    void push (const FloatType** samples, int numSamples)
+    void push (const FloatType* const* samples, int numSamples)
     {
         numSamples = std::min (getFreeSpace(), numSamples);
         if (numSamples <= 0)
@@ -79,7 +187,7 @@ public:
 
     //==============================================================================
     /** Read samples from the FIFO into raw float arrays. */
-    void readTo (FloatType** samples, int numSamples)
+    void readTo (FloatType* const* samples, int numSamples)
     {
         numSamples = std::min (getNumReady(), numSamples);
         if (numSamples <= 0)
@@ -119,7 +227,7 @@ public:
 
     //==============================================================================
     /** Read samples from the FIFO and add it to raw float arrays. */
-    void readToAdding (FloatType** samples, int numSamples, FloatType gain = FloatType (1))
+    void readToAdding (FloatType* const* samples, int numSamples, FloatType gain = FloatType (1))
     {
         numSamples = std::min (getNumReady(), numSamples);
         if (numSamples <= 0)
@@ -150,9 +258,9 @@ public:
                        int numSamples = -1,
                        FloatType gain = FloatType (1))
     {
-        readFromFifoAdding (samples.getArrayOfWritePointers(),
-                            numSamples < 0 ? samples.getNumSamples() : numSamples,
-                            gain);
+        readToAdding (samples.getArrayOfWritePointers(),
+                      numSamples < 0 ? samples.getNumSamples() : numSamples,
+                      gain);
     }
 
     /** Read samples from the FIFO into AudioSourceChannelInfo buffers to be used in AudioSources getNextAudioBlock */
@@ -161,7 +269,7 @@ public:
                        FloatType gain = FloatType (1))
     {
         if (auto* buff = info.buffer)
-            readFromFifoAdding (*buff, numSamples, gain);
+            readToAdding (*buff, numSamples, gain);
     }
 
     //==============================================================================
@@ -189,7 +297,441 @@ private:
     /** The actual audio buffer */
     juce::AudioBuffer<FloatType> buffer;
 
+    /** The channel pointers handed out by write() (first 2) and read() (last 2). */
+    std::array<std::vector<FloatType*>, 4> regionPointers;
+
+    FloatType* const* getRegionPointers (int index, int start) noexcept
+    {
+        auto& pointers = regionPointers[(size_t) index];
+
+        for (int channel = 0; channel < getNumChannels(); ++channel)
+            pointers[(size_t) channel] = buffer.getWritePointer (channel) + start;
+
+        return pointers.data();
+    }
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioBufferFIFO)
 };
 
+
+//==============================================================================
+/** A FIFO like AudioBufferFIFO, but which stores the samples interleaved
+    (ie: one frame of all channels after the other).
+
+    This keeps each frame within the same cache lines, which makes moving
+    small blocks of many channels cheaper than with separate channel storage,
+    and which lets interleaved devices or streams be fed without any conversion.
+
+    @see AudioBufferFIFO
+*/
+template<typename FloatType>
+class InterleavedAudioBufferFIFO final : public AbstractFifo
+{
+public:
+    /** Creates a FIFO with a buffer of given number of channels and frames. */
+    InterleavedAudioBufferFIFO (int channels = 2, int bufferSize = 8192) :
+        AbstractFifo (bufferSize)
+    {
+        setSize (channels, bufferSize);
+    }
+
+    //==============================================================================
+    /** @returns the number of channels of each frame. */
+    [[nodiscard]] int getNumChannels() const noexcept { return numChannels; }
+
+    /** Resize the buffer with new number of channels and new number of frames. */
+    void setSize (int channels, int newBufferSize)
+    {
+        numChannels = std::max (1, channels);
+        storage.assign ((size_t) numChannels * (size_t) std::max (1, newBufferSize), FloatType());
+        setTotalSize (newBufferSize);
+    }
+
+    //==============================================================================
+    /** A region of interleaved frames that can be accessed in place,
+        where the read or write is completed when this goes out of scope.
+    */
+    class Region final
+    {
+    public:
+        /** @returns the total number of frames in the region. */
+        [[nodiscard]] int getNumFrames() const noexcept         { return size1 + size2; }
+        /** @returns the first block of interleaved frames. */
+        [[nodiscard]] FloatType* getFirstBlock() const noexcept { return block1; }
+        /** @returns the number of frames in the first block. */
+        [[nodiscard]] int getFirstBlockSize() const noexcept    { return size1; }
+        /** @returns the block that wrapped around the end of the storage, if any. */
+        [[nodiscard]] FloatType* getSecondBlock() const noexcept { return block2; }
+        /** @returns the number of frames in the second block. */
+        [[nodiscard]] int getSecondBlockSize() const noexcept   { return size2; }
+
+        /** Destructor, which completes the read or write. */
+        ~Region()
+        {
+            if (isReading)
+                fifo.finishedRead (getNumFrames());
+            else
+                fifo.finishedWrite (getNumFrames());
+        }
+
+    private:
+        friend class InterleavedAudioBufferFIFO;
+
+        Region (InterleavedAudioBufferFIFO& f, bool reading, int numFrames) :
+            fifo (f),
+            isReading (reading)
+        {
+            int start1, start2;
+
+            if (isReading)
+                fifo.prepareToRead (std::max (0, numFrames), start1, size1, start2, size2);
+            else
+                fifo.prepareToWrite (std::max (0, numFrames), start1, size1, start2, size2);
+
+            block1 = fifo.getFrame (start1);
+            block2 = fifo.getFrame (start2);
+        }
+
+        InterleavedAudioBufferFIFO& fifo;
+        const bool isReading;
+        FloatType* block1 = nullptr;
+        FloatType* block2 = nullptr;
+        int size1 = 0, size2 = 0;
+
+        JUCE_DECLARE_NON_COPYABLE (Region)
+    };
+
+    /** Prepares a region of the FIFO to be written to in place. */
+    [[nodiscard]] Region write (int numFrames)  { return Region (*this, false, numFrames); }
+
+    /** Prepares a region of the FIFO to be read from in place. */
+    [[nodiscard]] Region read (int numFrames)   { return Region (*this, true, numFrames); }
+
+    //==============================================================================
+    /** Push frames into the FIFO from separate channels. */
+    void push (const FloatType* const* samples, int numSamples)
+    {
+        const auto region = write (std::min (getFreeSpace(), numSamples));
+
+        interleave (samples, 0, region.getFirstBlock(), region.getFirstBlockSize());
+        interleave (samples, region.getFirstBlockSize(), region.getSecondBlock(), region.getSecondBlockSize());
+    }
+
+    /** Push frames into the FIFO from an AudioBuffer. */
+    void push (const juce::AudioBuffer<FloatType>& samples, int numSamples = -1)
+    {
+        jassert (samples.getNumChannels() >= numChannels);
+
+        push (samples.getArrayOfReadPointers(), numSamples < 0 ? samples.getNumSamples() : numSamples);
+    }
+
+    /** Push frames that are already interleaved, with the same number of channels as the FIFO. */
+    void pushInterleaved (const FloatType* frames, int numFrames)
+    {
+        const auto region = write (std::min (getFreeSpace(), numFrames));
+        const auto size1 = (size_t) region.getFirstBlockSize() * (size_t) numChannels;
+
+        std::copy_n (frames, size1, region.getFirstBlock());
+        std::copy_n (frames + size1, (size_t) region.getSecondBlockSize() * (size_t) numChannels, region.getSecondBlock());
+    }
+
+    //==============================================================================
+    /** Read frames from the FIFO into separate channels. */
+    void readTo (FloatType* const* samples, int numSamples)
+    {
+        const auto region = read (std::min (getNumReady(), numSamples));
+
+        deinterleave (region.getFirstBlock(), region.getFirstBlockSize(), samples, 0);
+        deinterleave (region.getSecondBlock(), region.getSecondBlockSize(), samples, region.getFirstBlockSize());
+    }
+
+    /** Read frames from the FIFO into an AudioBuffer. */
+    void readTo (juce::AudioBuffer<FloatType>& samples, int numSamples = -1)
+    {
+        jassert (samples.getNumChannels() >= numChannels);
+
+        readTo (samples.getArrayOfWritePointers(), numSamples < 0 ? samples.getNumSamples() : numSamples);
+    }
+
+    /** Read interleaved frames from the FIFO, with the same number of channels as the FIFO. */
+    void readToInterleaved (FloatType* frames, int numFrames)
+    {
+        const auto region = read (std::min (getNumReady(), numFrames));
+        const auto size1 = (size_t) region.getFirstBlockSize() * (size_t) numChannels;
+
+        std::copy_n (region.getFirstBlock(), size1, frames);
+        std::copy_n (region.getSecondBlock(), (size_t) region.getSecondBlockSize() * (size_t) numChannels, frames + size1);
+    }
+
+    //==============================================================================
+    /** Pop (consume/remove) frames from the FIFO, ignoring them. */
+    void pop (int numFrames)
+    {
+        const auto region = read (std::min (getNumReady(), numFrames));
+        ignoreUnused (region);
+    }
+
+    /** Clears all frames and sets the FIFO state to empty. */
+    void clear()
+    {
+        std::fill (storage.begin(), storage.end(), FloatType());
+        reset();
+    }
+
+private:
+    //==============================================================================
+    std::vector<FloatType> storage;
+    int numChannels = 1;
+
+    FloatType* getFrame (int index) noexcept { return storage.data() + (size_t) index * (size_t) numChannels; }
+
+    void interleave (const FloatType* const* source, int sourceOffset, FloatType* dest, int numFrames) const noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* s = source[channel] + sourceOffset;
+            auto* d = dest + channel;
+
+            for (int i = 0; i < numFrames; ++i)
+                d[(size_t) i * (size_t) numChannels] = s[i];
+        }
+    }
+
+    void deinterleave (const FloatType* source, int numFrames, FloatType* const* dest, int destOffset) const noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* s = source + channel;
+            auto* d = dest[channel] + destOffset;
+
+            for (int i = 0; i < numFrames; ++i)
+                d[i] = s[(size_t) i * (size_t) numChannels];
+        }
+    }
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InterleavedAudioBufferFIFO)
+};
+
+//==============================================================================
+/** A FIFO with a single writer and several independent readers,
+    where each reader sees every sample (eg: one capture feeding a recorder,
+    a meter and a network sender at once).
+
+    Every operation is wait-free: the writer only ever loads the readers' positions,
+    and each reader only ever loads the writer's position.
+
+    The writer can only overwrite what every active reader has read,
+    so a reader that stops reading should be removed
+    to avoid holding the others back.
+
+    @see AudioBufferFIFO
+*/
+template<typename FloatType>
+class MultiReaderAudioBufferFIFO final
+{
+public:
+    /** Creates a FIFO with a buffer of given number of channels and samples,
+        and room for up to the given number of readers.
+    */
+    MultiReaderAudioBufferFIFO (int channels = 2, int bufferSize = 8192, int maxNumReaders = 4) :
+        readers ((size_t) std::max (1, maxNumReaders))
+    {
+        jassert (bufferSize > 0);
+
+        buffer.setSize (std::max (1, channels), std::max (1, bufferSize), false, true, false);
+        buffer.clear();
+
+        for (auto& pointers : writePointers)
+            pointers.assign ((size_t) buffer.getNumChannels(), nullptr);
+
+        for (auto& reader : readers)
+            for (auto& pointers : reader.pointers)
+                pointers.assign ((size_t) buffer.getNumChannels(), nullptr);
+    }
+
+    //==============================================================================
+    /** @returns the number of channels of the underlying buffer. */
+    [[nodiscard]] int getNumChannels() const noexcept   { return buffer.getNumChannels(); }
+
+    /** @returns the number of samples the FIFO can hold. */
+    [[nodiscard]] int getTotalSize() const noexcept     { return buffer.getNumSamples(); }
+
+    //==============================================================================
+    /** Adds a reader, which will see anything written from now on.
+
+        @returns the index of the reader, or -1 if there's no room for more readers.
+    */
+    int addReader() noexcept
+    {
+        for (int i = 0; i < (int) readers.size(); ++i)
+        {
+            auto& reader = readers[(size_t) i];
+
+            if (! reader.active.load (std::memory_order_acquire))
+            {
+                reader.position.store (writePosition.load (std::memory_order_acquire), std::memory_order_relaxed);
+                reader.active.store (true, std::memory_order_release);
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    /** Removes a reader, so that it no longer holds the writer back. */
+    void removeReader (int readerIndex) noexcept
+    {
+        if (isPositiveAndBelow (readerIndex, (int) readers.size()))
+            readers[(size_t) readerIndex].active.store (false, std::memory_order_release);
+    }
+
+    //==============================================================================
+    /** @returns the number of samples that can be written without overwriting
+        anything an active reader hasn't read yet.
+    */
+    [[nodiscard]] int getFreeSpace() const noexcept
+    {
+        const auto written = writePosition.load (std::memory_order_relaxed);
+        auto oldest = written;
+
+        for (const auto& reader : readers)
+            if (reader.active.load (std::memory_order_acquire))
+                oldest = std::min (oldest, reader.position.load (std::memory_order_acquire));
+
+        return getTotalSize() - (int) (written - oldest);
+    }
+
+    /** @returns the number of samples that the given reader can read. */
+    [[nodiscard]] int getNumReady (int readerIndex) const noexcept
+    {
+        jassert (isPositiveAndBelow (readerIndex, (int) readers.size()));
+
+        return (int) (writePosition.load (std::memory_order_acquire)
+                      - readers[(size_t) readerIndex].position.load (std::memory_order_relaxed));
+    }
+
+    //==============================================================================
+    /** Prepares a region of the FIFO to be written to in place.
+        The write is completed when the returned object goes out of scope.
+    */
+    [[nodiscard]] AudioFIFORegion<FloatType> write (int numSamples) noexcept
+    {
+        const auto start = writePosition.load (std::memory_order_relaxed);
+        numSamples = jlimit (0, getFreeSpace(), numSamples);
+
+        return makeRegion (start, numSamples, writePointers, this,
+                           [] (void* f, int n)
+                           {
+                               auto& fifo = *static_cast<MultiReaderAudioBufferFIFO*> (f);
+                               fifo.writePosition.fetch_add (n, std::memory_order_release);
+                           });
+    }
+
+    /** Prepares a region of the FIFO to be read from in place, for the given reader.
+        The read is completed when the returned object goes out of scope.
+    */
+    [[nodiscard]] AudioFIFORegion<FloatType> read (int readerIndex, int numSamples) noexcept
+    {
+        jassert (isPositiveAndBelow (readerIndex, (int) readers.size()));
+
+        auto& reader = readers[(size_t) readerIndex];
+        const auto start = reader.position.load (std::memory_order_relaxed);
+        numSamples = jlimit (0, getNumReady (readerIndex), numSamples);
+
+        return makeRegion (start, numSamples, reader.pointers, &reader,
+                           [] (void* r, int n)
+                           {
+                               static_cast<Reader*> (r)->position.fetch_add (n, std::memory_order_release);
+                           });
+    }
+
+    //==============================================================================
+    /** Push samples into the FIFO from raw float arrays. */
+    void push (const FloatType* const* samples, int numSamples) noexcept
+    {
+        const auto region = write (numSamples);
+
+        region.forEachBlock ([&] (AudioBufferView<FloatType> block, int offset)
+        {
+            for (int channel = 0; channel < block.getNumChannels(); ++channel)
+                FloatVectorOperations::copy (block.getChannel (channel).data(), samples[channel] + offset, block.getNumSamples());
+        });
+    }
+
+    /** Push samples into the FIFO from an AudioBuffer. */
+    void push (const juce::AudioBuffer<FloatType>& samples, int numSamples = -1) noexcept
+    {
+        jassert (samples.getNumChannels() >= getNumChannels());
+
+        push (samples.getArrayOfReadPointers(), numSamples < 0 ? samples.getNumSamples() : numSamples);
+    }
+
+    /** Read samples for the given reader into raw float arrays. */
+    void readTo (int readerIndex, FloatType* const* samples, int numSamples) noexcept
+    {
+        const auto region = read (readerIndex, numSamples);
+
+        region.forEachBlock ([&] (AudioBufferView<FloatType> block, int offset)
+        {
+            for (int channel = 0; channel < block.getNumChannels(); ++channel)
+                FloatVectorOperations::copy (samples[channel] + offset, block.getChannel (channel).data(), block.getNumSamples());
+        });
+    }
+
+    /** Read samples for the given reader into an AudioBuffer. */
+    void readTo (int readerIndex, juce::AudioBuffer<FloatType>& samples, int numSamples = -1) noexcept
+    {
+        jassert (samples.getNumChannels() >= getNumChannels());
+
+        readTo (readerIndex, samples.getArrayOfWritePointers(), numSamples < 0 ? samples.getNumSamples() : numSamples);
+    }
+
+    /** Skips samples for the given reader. */
+    void pop (int readerIndex, int numSamples) noexcept
+    {
+        const auto region = read (readerIndex, numSamples);
+        ignoreUnused (region);
+    }
+
+private:
+    //==============================================================================
+    using RegionPointers = std::array<std::vector<FloatType*>, 2>;
+
+    struct Reader final
+    {
+        std::atomic<int64> position { 0 };
+        std::atomic<bool> active { false };
+        RegionPointers pointers;
+    };
+
+    juce::AudioBuffer<FloatType> buffer;
+    std::vector<Reader> readers;
+    RegionPointers writePointers;
+    std::atomic<int64> writePosition { 0 };
+
+    //==============================================================================
+    AudioFIFORegion<FloatType> makeRegion (int64 start, int numSamples, RegionPointers& pointers,
+                                           void* owner, typename AudioFIFORegion<FloatType>::Finisher finisher) noexcept
+    {
+        const auto size = getTotalSize();
+        const auto index1 = (int) (start % size);
+        const auto size1 = std::min (numSamples, size - index1);
+        const auto size2 = numSamples - size1;
+
+        for (int channel = 0; channel < getNumChannels(); ++channel)
+        {
+            auto* data = buffer.getWritePointer (channel);
+            pointers[0][(size_t) channel] = data + index1;
+            pointers[1][(size_t) channel] = data;
+        }
+
+        return { owner, finisher, getNumChannels(),
+                 pointers[0].data(), size1,
+                 pointers[1].data(), size2 };
+    }
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultiReaderAudioBufferFIFO)
+};
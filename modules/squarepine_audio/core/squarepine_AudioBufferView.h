@@ -66,6 +66,11 @@ public:
         return *this;
     }
 
+    /** @returns the number of samples in the channel. */
+    [[nodiscard]] int getNumSamples() const noexcept { return numSamples; }
+    /** @returns a pointer to the first sample of the channel. */
+    [[nodiscard]] FloatType* data() const noexcept  { return channel; }
+
     /** */
     FloatType& operator() (int index)               { return channel[index]; }
     /** */
@@ -169,6 +174,19 @@ public:
         return *this;
     }
 
+    /** @returns the number of channels in the view. */
+    [[nodiscard]] int getNumChannels() const noexcept       { return numChannels; }
+    /** @returns the number of samples in each channel. */
+    [[nodiscard]] int getNumSamples() const noexcept        { return numSamples; }
+    /** @returns the array of channel pointers. */
+    [[nodiscard]] ChannelPtrs getArrayOfChannels() const noexcept { return channels; }
+    /** @returns a view of one of the channels. */
+    [[nodiscard]] AudioChannelView<FloatType> getChannel (int chan) const noexcept
+    {
+        jassert (isPositiveAndBelow (chan, numChannels));
+        return AudioChannelView<FloatType> (channels[chan], numSamples);
+    }
+
     /** */
     FloatType& operator() (int chan, int samp)              { return channels[chan][samp]; }
     /** */
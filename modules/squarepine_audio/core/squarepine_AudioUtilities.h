@@ -107,6 +107,24 @@ inline void addFrom (juce::AudioBuffer<FloatType>& destination,
     }
 }
 
+template<typename FloatType>
+inline void copyFrom (juce::AudioBuffer<FloatType>& destination,
+                      const juce::AudioBuffer<FloatType>& source,
+                      int numChannels, int numSamples)
+{
+    // NB: This first bit is for copying mono to stereo.
+    if (numChannels == 1 && destination.getNumChannels() == 2)
+    {
+        destination.copyFrom (0, 0, source, 0, 0, numSamples);
+        destination.copyFrom (1, 0, source, 0, 0, numSamples);
+    }
+    else
+    {
+        for (auto i = numChannels; --i >= 0;)
+            destination.copyFrom (i, 0, source, i, 0, numSamples);
+    }
+}
+
 template<typename FloatType>
 inline void addFrom (juce::AudioBuffer<FloatType>& destination,
                      juce::AudioBuffer<FloatType>& source,
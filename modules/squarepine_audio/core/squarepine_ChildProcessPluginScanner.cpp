@@ -4,185 +4,656 @@ namespace scanner
     #define DECLARE_ID(x) \
         static const auto x##Id = #x;
 
+    DECLARE_ID (requestId)
     DECLARE_ID (fileOrIdentifier)
     DECLARE_ID (formatName)
-    DECLARE_ID (tempFile)
+    DECLARE_ID (succeeded)
+    DECLARE_ID (key)
+    DECLARE_ID (modificationTime)
+    DECLARE_ID (contentHash)
 
     #undef DECLARE_ID
+
+    inline MemoryBlock toMemoryBlock (const XmlElement& xml)
+    {
+        const auto text = xml.toString (XmlElement::TextFormat().singleLine().withoutHeader());
+        return MemoryBlock (text.toRawUTF8(), text.getNumBytesAsUTF8());
+    }
 }
 
-bool ChildProcessPluginScanner::findPluginTypesFor (AudioPluginFormat& format,
-                                                    OwnedArray<PluginDescription>& result,
-                                                    const String& fileOrIdentifier)
+//==============================================================================
+/** The coordinator's end of a worker: launches the process and hands it one plugin at a time. */
+class ChildProcessPluginScanner::WorkerProcess final : private ChildProcessCoordinator
 {
-    StringArray args;
-    args.add (File::getSpecialLocation (File::currentExecutableFile).getFullPathName());
+public:
+    WorkerProcess() = default;
 
-    auto* object = new DynamicObject();
-    auto addArg = [&] (const Identifier& id, const String& s)
+    ~WorkerProcess() override
     {
-        object->setProperty (id, URL::addEscapeChars (s, true));
-    };
+        killWorkerProcess();
+    }
+
+    /** Blocks whilst the worker scans a plugin, (re)launching the worker first if needed. */
+    ScanOutcome scan (const String& formatName, const String& fileOrIdentifier, int timeoutMs,
+                      const std::function<bool()>& shouldCancel, OwnedArray<PluginDescription>& found)
+    {
+        if (! running.load() && ! launch())
+            return ScanOutcome::failed;
+
+        {
+            const ScopedLock sl (replyLock);
+            reply.reset();
+        }
+
+        replyReceived.reset();
+
+        XmlElement request ("ScanRequest");
+        request.setAttribute (scanner::requestIdId, ++lastRequestId);
+        request.setAttribute (scanner::formatNameId, formatName);
+        request.setAttribute (scanner::fileOrIdentifierId, fileOrIdentifier);
+
+        if (! sendMessageToWorker (scanner::toMemoryBlock (request)))
+        {
+            stop();
+            return ScanOutcome::crashed;
+        }
+
+        const auto startTime = Time::getMillisecondCounter();
+
+        while (! replyReceived.wait (50))
+        {
+            if (shouldCancel())
+            {
+                stop();
+                return ScanOutcome::cancelled;
+            }
+
+            if (timeoutMs > 0 && (int) (Time::getMillisecondCounter() - startTime) > timeoutMs)
+            {
+                stop();
+                return ScanOutcome::timedOut;
+            }
+        }
 
-    TemporaryFile tempFile;
-    auto tempResultsFile = tempFile.getFile();
+        const ScopedLock sl (replyLock);
 
-    addArg (scanner::fileOrIdentifierId, fileOrIdentifier);
-    addArg (scanner::formatNameId, format.getName());
-    addArg (scanner::tempFileId, tempResultsFile.getFullPathName());
+        if (reply == nullptr)
+            return ScanOutcome::crashed; // The connection was lost.
+
+        handleResultXml (*reply, found);
+        return reply->getBoolAttribute (scanner::succeededId) ? ScanOutcome::scanned : ScanOutcome::failed;
+    }
+
+private:
+    CriticalSection replyLock;
+    WaitableEvent replyReceived;
+    std::unique_ptr<XmlElement> reply;
+    std::atomic<int> lastRequestId { 0 };
+    std::atomic<bool> running { false };
+
+    bool launch()
+    {
+        // NB: The worker's output isn't captured, since a chatty plugin could otherwise fill the pipe and block it.
+        running = launchWorkerProcess (File::getSpecialLocation (File::currentExecutableFile),
+                                       workerCommandLineUID, 0, 0);
+        return running.load();
+    }
+
+    void stop()
+    {
+        running = false;
+        killWorkerProcess();
+    }
 
-    args.add (Base64::toBase64 (JSON::toString (object)));
+    void handleMessageFromWorker (const MemoryBlock& mb) override
+    {
+        auto xml = parseXML (mb.toString());
+
+        // Anything else is a late reply to a request that has since been given up on.
+        if (xml == nullptr || xml->getIntAttribute (scanner::requestIdId) != lastRequestId.load())
+            return;
+
+        {
+            const ScopedLock sl (replyLock);
+            reply = std::move (xml);
+        }
+
+        replyReceived.signal();
+    }
+
+    void handleConnectionLost() override
+    {
+        running = false;
+        replyReceived.signal();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerProcess)
+};
+
+//==============================================================================
+/** The worker's end: scans whatever it's asked to on its message thread, seeing that most formats require it. */
+class ChildProcessPluginScanner::WorkerService final : private ChildProcessWorker,
+                                                       private AsyncUpdater,
+                                                       public DeletedAtShutdown
+{
+public:
+    explicit WorkerService (OwnedArray<AudioPluginFormat>& customFormats)
+    {
+        addHeadlessDefaultFormatsToManager (formatManager);
+
+        for (auto i = customFormats.size(); --i >= 0;)
+            formatManager.addFormat (rawToUniquePtr (customFormats.removeAndReturn (i)));
+    }
+
+    ~WorkerService() override
+    {
+        cancelPendingUpdate();
+    }
+
+    bool initialise (const String& commandLine)
+    {
+        return initialiseFromCommandLine (commandLine, workerCommandLineUID);
+    }
+
+private:
+    AudioPluginFormatManager formatManager;
+    CriticalSection requestLock;
+    std::unique_ptr<XmlElement> pendingRequest;
+
+    void handleMessageFromCoordinator (const MemoryBlock& mb) override
+    {
+        if (auto xml = parseXML (mb.toString()))
+        {
+            {
+                const ScopedLock sl (requestLock);
+                pendingRequest = std::move (xml);
+            }
+
+            triggerAsyncUpdate();
+        }
+    }
 
-    Logger::writeToLog (args.joinIntoString (" "));
+    void handleConnectionLost() override
+    {
+        MessageManager::callAsync ([] { JUCEApplicationBase::quit(); });
+    }
 
+    void handleAsyncUpdate() override
     {
-        ChildProcess child;
-        if (child.start (args))
+        std::unique_ptr<XmlElement> request;
+
         {
-            waitForChildProcessOutput (child);
+            const ScopedLock sl (requestLock);
+            std::swap (request, pendingRequest);
+        }
+
+        if (request == nullptr)
+            return;
+
+        const auto formatName = request->getStringAttribute (scanner::formatNameId);
+        const auto fileOrIdentifier = request->getStringAttribute (scanner::fileOrIdentifierId);
+
+        XmlElement result ("PluginsFound");
+        result.setAttribute (scanner::requestIdId, request->getIntAttribute (scanner::requestIdId));
+
+        auto succeeded = false;
 
-            // For some reason this stops some plugins from hanging, 
-            // letting them write their results file.
-            if (tempResultsFile.getSize() == 0)
-                child.readAllProcessOutput();
+        for (auto* format : formatManager.getFormats())
+        {
+            if (format->getName() == formatName)
+            {
+                OwnedArray<PluginDescription> found;
+                format->findAllTypesForFile (found, fileOrIdentifier);
+
+                for (auto* pd : found)
+                    result.addChildElement (pd->createXml().release());
+
+                succeeded = true;
+                break;
+            }
         }
+
+        result.setAttribute (scanner::succeededId, succeeded);
+        sendMessageToCoordinator (scanner::toMemoryBlock (result));
     }
 
-    return handleResultsFile (tempResultsFile, result);
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerService)
+};
+
+//==============================================================================
+ChildProcessPluginScanner::ChildProcessPluginScanner() :
+    numWorkers (jmax (1, SystemStats::getNumCpus() / 2))
+{
+}
+
+ChildProcessPluginScanner::~ChildProcessPluginScanner()
+{
+    saveCache();
+
+    const ScopedLock sl (poolLock);
+    idleWorkers.clear();
+    workers.clear();
 }
 
-String ChildProcessPluginScanner::getCommandLineArg (const String& commandLine)
+//==============================================================================
+bool ChildProcessPluginScanner::startWorker (const String& commandLine, OwnedArray<AudioPluginFormat> customFormats)
 {
-    if (commandLine.isEmpty())
-        return {};
+    if (! canScan (commandLine))
+        return false;
 
-    const auto toks = StringArray::fromTokens (commandLine, " ", "\"");
+   #if JUCE_MAC
+    setupSignalHandling();
+   #endif
 
-    MemoryOutputStream textStream;
-    int index = 0;
+    // NB: This is owned by DeletedAtShutdown, and quits the app once the coordinator goes away.
+    auto worker = std::make_unique<WorkerService> (customFormats);
 
-    if (toks.size() > 1)
-        ++index;
+    if (! worker->initialise (commandLine))
+        return false;
 
-    if (! Base64::convertFromBase64 (textStream, toks[index]))
-        return {};
+    worker.release();
+    return true;
+}
 
-    return textStream.toString();
+bool ChildProcessPluginScanner::canScan (const String& commandLine)
+{
+    return commandLine.contains (workerCommandLineUID);
 }
 
-bool ChildProcessPluginScanner::performScan (const String& commandLine, OwnedArray<AudioPluginFormat> customFormats)
+//==============================================================================
+void ChildProcessPluginScanner::setNumWorkers (int newNumWorkers)
 {
-    const auto jsonData = getCommandLineArg (commandLine);
-    if (jsonData.isEmpty())
-        return false;
+    std::vector<std::unique_ptr<WorkerProcess>> surplus;
 
-    const auto v = JSON::fromString (jsonData);
-    if (auto* object = v.getDynamicObject())
     {
-        auto parse = [&] (const Identifier& id)
+        const ScopedLock sl (poolLock);
+        numWorkers = jmax (1, newNumWorkers);
+
+        // Only the idle workers can go right away; the busy ones go once they're released.
+        while ((int) workers.size() > numWorkers && ! idleWorkers.empty())
         {
-            return URL::removeEscapeChars (object->getProperty (id).toString());
-        };
+            auto* w = idleWorkers.back();
+            idleWorkers.pop_back();
 
-        performScanInChildProcess (parse (scanner::fileOrIdentifierId),
-                                   parse (scanner::formatNameId),
-                                   File (parse (scanner::tempFileId)),
-                                   customFormats);
-        return true;
+            auto iter = std::find_if (workers.begin(), workers.end(), [w] (const auto& p) { return p.get() == w; });
+            surplus.push_back (std::move (*iter));
+            workers.erase (iter);
+        }
     }
+}
 
-    return false;
+int ChildProcessPluginScanner::getNumWorkers() const
+{
+    const ScopedLock sl (poolLock);
+    return numWorkers;
 }
 
-bool ChildProcessPluginScanner::canScan (const String& commandLine)
+bool ChildProcessPluginScanner::shouldCancel() const
 {
-    return getCommandLineArg (commandLine).isNotEmpty();
+    return shouldExit() || Thread::currentThreadShouldExit();
 }
 
-void ChildProcessPluginScanner::waitForChildProcessOutput (ChildProcess& child)
+ChildProcessPluginScanner::WorkerProcess* ChildProcessPluginScanner::acquireWorker()
 {
-    int total = 30000;
+    for (;;)
+    {
+        {
+            const ScopedLock sl (poolLock);
+
+            if (! idleWorkers.empty())
+            {
+                auto* w = idleWorkers.back();
+                idleWorkers.pop_back();
+                return w;
+            }
+
+            if ((int) workers.size() < numWorkers)
+                return workers.emplace_back (std::make_unique<WorkerProcess>()).get();
+        }
+
+        if (shouldCancel())
+            return nullptr;
+
+        workerReleased.wait (50);
+    }
+}
+
+void ChildProcessPluginScanner::releaseWorker (WorkerProcess* worker)
+{
+    std::unique_ptr<WorkerProcess> surplus;
 
-    while (total > 0)
     {
-        if (! MessageManager::getInstance()->isThisTheMessageThread())
+        const ScopedLock sl (poolLock);
+
+        if ((int) workers.size() > numWorkers)
         {
-            auto* t = Thread::getCurrentThread();
-            if (t == nullptr || t->threadShouldExit())
-                break;
+            auto iter = std::find_if (workers.begin(), workers.end(), [worker] (const auto& p) { return p.get() == worker; });
+            surplus = std::move (*iter);
+            workers.erase (iter);
         }
+        else
+        {
+            idleWorkers.push_back (worker);
+        }
+    }
+
+    workerReleased.signal();
+}
+
+//==============================================================================
+bool ChildProcessPluginScanner::findPluginTypesFor (AudioPluginFormat& format,
+                                                    OwnedArray<PluginDescription>& result,
+                                                    const String& fileOrIdentifier)
+{
+    {
+        const ScopedLock sl (statisticsLock);
+        ++statistics.numRequested;
+    }
+
+    return scanFile (format, fileOrIdentifier, result);
+}
+
+void ChildProcessPluginScanner::scanFinished()
+{
+    saveCache();
+}
+
+void ChildProcessPluginScanner::scanFiles (AudioPluginFormat& format, const StringArray& filesOrIdentifiers,
+                                           OwnedArray<PluginDescription>& results, StringArray* failed)
+{
+    {
+        const ScopedLock sl (statisticsLock);
+        statistics.numRequested += filesOrIdentifiers.size();
+    }
+
+    if (filesOrIdentifiers.isEmpty())
+        return;
+
+    // NB: These are declared before the pool, so that they outlive any job still winding down.
+    CriticalSection resultsLock;
+    WaitableEvent allScanned;
+    std::atomic<int> numRemaining { filesOrIdentifiers.size() };
+
+    ThreadPool pool (getNumWorkers());
+
+    for (const auto& fileOrIdentifier : filesOrIdentifiers)
+    {
+        pool.addJob ([&, fileOrIdentifier]
+        {
+            OwnedArray<PluginDescription> found;
+            const auto succeeded = scanFile (format, fileOrIdentifier, found);
+
+            {
+                const ScopedLock sl (resultsLock);
+                results.addCopiesOf (found);
 
-        child.waitForProcessToFinish (50);
+                if (! succeeded && failed != nullptr)
+                    failed->add (fileOrIdentifier);
+            }
 
-        Thread::sleep (1);
-        total -= 50;
+            if (--numRemaining == 0)
+                allScanned.signal();
+        });
     }
+
+    // NB: Cancelling is picked up by the jobs themselves, so there's no need to interrupt them here.
+    allScanned.wait();
 }
 
-bool ChildProcessPluginScanner::handleResultsFile (const File& resultsFile, OwnedArray<PluginDescription>& result)
+bool ChildProcessPluginScanner::scanFile (AudioPluginFormat& format, const String& fileOrIdentifier,
+                                          OwnedArray<PluginDescription>& result)
 {
-    const auto xml = XmlDocument::parse (resultsFile);
-    resultsFile.deleteFile(); // No longer needed, so clean it up
+    const auto startTime = Time::getMillisecondCounterHiRes();
+    const auto formatName = format.getName();
+    const auto key = formatName + ":" + fileOrIdentifier;
+
+    const auto file = File::isAbsolutePath (fileOrIdentifier) ? File (fileOrIdentifier) : File();
+    const auto isCacheable = file != File() && file.exists();
 
-    if (xml != nullptr)
+    Fingerprint fingerprint;
+
+    if (isCacheable && findInCache (key, file, fingerprint, result))
     {
-        handleResultXml (*xml, result);
+        recordScan (fileOrIdentifier, ScanOutcome::cached, (Time::getMillisecondCounterHiRes() - startTime) / 1000.0);
         return true;
     }
 
-    return false;
+    OwnedArray<PluginDescription> found;
+    auto outcome = ScanOutcome::cancelled;
+
+    if (auto* worker = acquireWorker())
+    {
+        outcome = worker->scan (formatName, fileOrIdentifier, scanTimeoutMs.load(),
+                                [this] { return shouldCancel(); }, found);
+        releaseWorker (worker);
+    }
+
+    // NB: Files without any plugins in them are cached too, so they aren't retried until they change.
+    if (isCacheable && outcome == ScanOutcome::scanned)
+        addToCache (key, file, std::move (fingerprint), found);
+
+    result.addCopiesOf (found);
+    recordScan (fileOrIdentifier, outcome, (Time::getMillisecondCounterHiRes() - startTime) / 1000.0);
+
+    // NB: A cancelled scan isn't the plugin's fault, so it mustn't get blacklisted.
+    return outcome == ScanOutcome::scanned || outcome == ScanOutcome::cancelled;
 }
 
-void ChildProcessPluginScanner::handleResultXml (const XmlElement& xml, OwnedArray<PluginDescription>& found)
+//==============================================================================
+ChildProcessPluginScanner::Statistics ChildProcessPluginScanner::getStatistics() const
 {
-    if (xml.hasTagName ("PluginsFound"))
-        for (auto* e : xml.getChildIterator())
-            if (PluginDescription desc; desc.loadFromXml (*e))
-                found.add (new PluginDescription (desc));
+    const ScopedLock sl (statisticsLock);
+    return statistics;
 }
 
-void ChildProcessPluginScanner::performScanInChildProcess (const String& fileOrIdentifier, 
-                                                           const String& formatName, 
-                                                           File resultsFile,
-                                                           OwnedArray<AudioPluginFormat>& customFormats)
+void ChildProcessPluginScanner::resetStatistics()
 {
-   #if JUCE_MAC
-    setupSignalHandling();
-   #endif
+    const ScopedLock sl (statisticsLock);
+    statistics = {};
+}
+
+void ChildProcessPluginScanner::recordScan (const String& fileOrIdentifier, ScanOutcome outcome, double seconds)
+{
+    {
+        const ScopedLock sl (statisticsLock);
+        ++statistics.numCompleted;
+
+        switch (outcome)
+        {
+            case ScanOutcome::scanned:  break;
+            case ScanOutcome::cached:   ++statistics.numFromCache; break;
+            case ScanOutcome::failed:   ++statistics.numFailed; break;
+            case ScanOutcome::crashed:  ++statistics.numFailed; ++statistics.numCrashed; break;
+            case ScanOutcome::timedOut: ++statistics.numFailed; ++statistics.numTimedOut; break;
+            case ScanOutcome::cancelled: break;
+
+            default:
+                jassertfalse;
+            break;
+        };
+
+        if (outcome != ScanOutcome::cached)
+        {
+            statistics.totalScanSeconds += seconds;
+
+            if (seconds > statistics.longestScanSeconds)
+            {
+                statistics.longestScanSeconds = seconds;
+                statistics.slowestFileOrIdentifier = fileOrIdentifier;
+            }
+        }
+    }
+
+    if (onFileScanned != nullptr)
+        onFileScanned (fileOrIdentifier, outcome, seconds);
+}
+
+//==============================================================================
+void ChildProcessPluginScanner::setCacheFile (const File& newCacheFile)
+{
+    saveCache();
+
+    {
+        const ScopedLock sl (cacheLock);
+        cacheFile = newCacheFile;
+        cache.clear();
+        cacheNeedsSaving = false;
+    }
+
+    loadCache();
+}
+
+File ChildProcessPluginScanner::getCacheFile() const
+{
+    const ScopedLock sl (cacheLock);
+    return cacheFile;
+}
+
+void ChildProcessPluginScanner::clearCache()
+{
+    const ScopedLock sl (cacheLock);
+    cache.clear();
+    cacheNeedsSaving = true;
+}
+
+void ChildProcessPluginScanner::loadCache()
+{
+    const auto xml = parseXML (getCacheFile());
+
+    if (xml == nullptr || ! xml->hasTagName ("PluginScanCache"))
+        return;
 
-    resultsFile.deleteFile();
-    resultsFile.create();
-    FileOutputStream outStream (resultsFile);
-    if (outStream.failedToOpen())
+    const ScopedLock sl (cacheLock);
+
+    for (auto* e : xml->getChildIterator())
     {
-        JUCEApplication::getInstance()->setApplicationReturnValue (EXIT_FAILURE);
+        CacheEntry entry;
+        entry.fingerprint.modificationTime = e->getStringAttribute (scanner::modificationTimeId).getLargeIntValue();
+        entry.fingerprint.contentHash = e->getStringAttribute (scanner::contentHashId);
+
+        for (auto* d : e->getChildIterator())
+            if (PluginDescription desc; desc.loadFromXml (*d))
+                entry.descriptions.add (desc);
+
+        cache[e->getStringAttribute (scanner::keyId)] = std::move (entry);
+    }
+}
+
+void ChildProcessPluginScanner::saveCache()
+{
+    const ScopedLock sl (cacheLock);
+
+    if (! cacheNeedsSaving || cacheFile == File())
         return;
+
+    XmlElement xml ("PluginScanCache");
+
+    for (const auto& [key, entry] : cache)
+    {
+        auto* e = xml.createNewChildElement ("Entry");
+        e->setAttribute (scanner::keyId, key);
+        e->setAttribute (scanner::modificationTimeId, String (entry.fingerprint.modificationTime));
+        e->setAttribute (scanner::contentHashId, entry.fingerprint.contentHash);
+
+        for (const auto& desc : entry.descriptions)
+            e->addChildElement (desc.createXml().release());
     }
 
-    AudioPluginFormatManager pluginFormatManager;
-	addHeadlessDefaultFormatsToManager (pluginFormatManager);
+    if (xml.writeTo (cacheFile))
+        cacheNeedsSaving = false;
+}
+
+bool ChildProcessPluginScanner::findInCache (const String& key, const File& file, Fingerprint& fingerprint,
+                                             OwnedArray<PluginDescription>& result)
+{
+    fingerprint.modificationTime = getModificationTime (file);
 
-    for (auto i = customFormats.size(); --i >= 0;)
-        pluginFormatManager.addFormat (rawToUniquePtr (customFormats.removeAndReturn (i)));
+    CacheEntry entry;
 
-    for (auto i = 0; i < pluginFormatManager.getNumFormats(); ++i)
     {
-        auto format = pluginFormatManager.getFormat (i);
+        const ScopedLock sl (cacheLock);
 
-        if (format->getName() == formatName)
-        {
-            OwnedArray<PluginDescription> found;
-            format->findAllTypesForFile (found, fileOrIdentifier);
+        const auto iter = cache.find (key);
+        if (iter == cache.end())
+            return false;
 
-            XmlElement result ("PluginsFound");
+        entry = iter->second;
+    }
 
-            for (auto pd : found)
-                result.addChildElement (pd->createXml().release());
+    if (entry.fingerprint.modificationTime != fingerprint.modificationTime)
+    {
+        // The plugin may only have been touched (eg: reinstalled), rather than changed,
+        // so the contents are only hashed when the modification time alone can't tell:
+        fingerprint.contentHash = calculateContentHash (file);
 
-            outStream << result.toString();
-            outStream.flush();
-        }
+        if (fingerprint.contentHash != entry.fingerprint.contentHash)
+            return false;
+
+        const ScopedLock sl (cacheLock);
+        cache[key].fingerprint = fingerprint;
+        cacheNeedsSaving = true;
     }
+
+    for (const auto& desc : entry.descriptions)
+        result.add (new PluginDescription (desc));
+
+    return true;
+}
+
+void ChildProcessPluginScanner::addToCache (const String& key, const File& file, Fingerprint fingerprint,
+                                            const OwnedArray<PluginDescription>& found)
+{
+    if (fingerprint.contentHash.isEmpty())
+        fingerprint.contentHash = calculateContentHash (file);
+
+    CacheEntry entry;
+    entry.fingerprint = std::move (fingerprint);
+
+    for (auto* desc : found)
+        entry.descriptions.add (*desc);
+
+    const ScopedLock sl (cacheLock);
+    cache[key] = std::move (entry);
+    cacheNeedsSaving = true;
+}
+
+int64 ChildProcessPluginScanner::getModificationTime (const File& file)
+{
+    auto latest = file.getLastModificationTime().toMilliseconds();
+
+    // A bundle's own timestamp needn't change when what's inside it does:
+    if (file.isDirectory())
+        for (const auto& child : file.findChildFiles (File::findFiles, true))
+            latest = jmax (latest, child.getLastModificationTime().toMilliseconds());
+
+    return latest;
+}
+
+String ChildProcessPluginScanner::calculateContentHash (const File& file)
+{
+    if (! file.isDirectory())
+        return MD5 (file).toHexString();
+
+    auto children = file.findChildFiles (File::findFiles, true);
+    children.sort();
+
+    MemoryOutputStream hashes;
+
+    for (const auto& child : children)
+    {
+        hashes << child.getRelativePathFrom (file);
+        hashes.write (MD5 (child).getRawChecksumData().getData(), 16);
+    }
+
+    return MD5 (hashes.getMemoryBlock()).toHexString();
+}
+
+void ChildProcessPluginScanner::handleResultXml (const XmlElement& xml, OwnedArray<PluginDescription>& found)
+{
+    if (xml.hasTagName ("PluginsFound"))
+        for (auto* e : xml.getChildIterator())
+            if (PluginDescription desc; desc.loadFromXml (*e))
+                found.add (new PluginDescription (desc));
 }
 
 #if ! JUCE_WINDOWS
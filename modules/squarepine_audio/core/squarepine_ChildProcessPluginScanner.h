@@ -1,36 +1,194 @@
-/** */
+/** A KnownPluginList::CustomScanner that scans plugins out of process,
+    so that a plugin that crashes or hangs whilst being scanned can't take the app down with it.
+
+    Rather than launching a process per plugin, the scans are handed to a pool
+    of long-lived worker processes over ChildProcessCoordinator's pipe.
+    A worker that crashes or stops responding is killed and restarted for the next scan,
+    and the plugin it was scanning is reported as having failed (so KnownPluginList blacklists it).
+
+    The results can be cached on disk, keyed by each plugin's modification time and contents,
+    so that rescanning only touches the plugins that have changed.
+
+    For the workers to run, the app must hand its command line to startWorker()
+    when it starts up, and carry on running its message loop if that returns true:
+    @code
+        void initialise (const String& commandLine) override
+        {
+            if (ChildProcessPluginScanner::startWorker (commandLine))
+                return; // This is a scanner worker, so don't bother with anything else, nor quit.
+
+            // ...
+        }
+    @endcode
+*/
 class ChildProcessPluginScanner final : public KnownPluginList::CustomScanner
 {
 public:
-    /** */
-    ChildProcessPluginScanner() = default;
+    /** Constructor. */
+    ChildProcessPluginScanner();
+
+    /** Destructor, which saves the cache, if there is one, and shuts the workers down. */
+    ~ChildProcessPluginScanner() override;
 
     //==============================================================================
-    /** */
-    static bool performScan (const String& commandLine, OwnedArray<AudioPluginFormat> customFormats = {});
+    /** Turns this process into a scanner worker, if the command line is one from a ChildProcessPluginScanner.
+
+        NB: This replaces performScan(), which scanned a single plugin and returned once done,
+            so the app could quit straight after. A worker carries on running instead,
+            so the app must not quit when this returns true.
 
-    /** */
+        @returns true if this process is now a worker, in which case the app must keep
+                 its message loop running. The worker quits the app once the scanner
+                 that launched it goes away.
+    */
+    static bool startWorker (const String& commandLine, OwnedArray<AudioPluginFormat> customFormats = {});
+
+    /** @returns true if the command line is one from a ChildProcessPluginScanner. */
     [[nodiscard]] static bool canScan (const String& commandLine);
 
+    //==============================================================================
+    /** Changes the most worker processes to run at once.
+
+        The workers are launched as they're needed, and any above the new limit are shut down
+        as soon as they finish whatever they're scanning. The default is half the number of CPU cores.
+    */
+    void setNumWorkers (int newNumWorkers);
+
+    /** @returns the most worker processes to run at once. */
+    [[nodiscard]] int getNumWorkers() const;
+
+    /** Changes how long a plugin may take to scan before its worker is presumed to have hung,
+        in milliseconds. Zero or less means to wait forever. The default is a minute.
+    */
+    void setScanTimeout (int newTimeoutMs) noexcept     { scanTimeoutMs = newTimeoutMs; }
+
+    /** @returns how long a plugin may take to scan before its worker is presumed to have hung. */
+    [[nodiscard]] int getScanTimeout() const noexcept   { return scanTimeoutMs.load(); }
+
+    //==============================================================================
+    /** Scans a batch of plugins, spreading them over all of the workers.
+
+        This blocks until they've all been scanned, or the scan is cancelled.
+
+        @param format               The format to scan the plugins as.
+        @param filesOrIdentifiers   The plugins to scan.
+        @param results              Where to add the descriptions of the plugins found.
+        @param failed               If not null, where to add the plugins that failed to scan.
+    */
+    void scanFiles (AudioPluginFormat& format, const StringArray& filesOrIdentifiers,
+                    OwnedArray<PluginDescription>& results, StringArray* failed = nullptr);
+
+    //==============================================================================
+    /** Changes the file the scan results are cached in, and loads whatever it contains.
+
+        Only plugins that are files (or bundles) are cached, seeing that
+        there's no way of telling whether any others have changed.
+    */
+    void setCacheFile (const File& newCacheFile);
+
+    /** @returns the file the scan results are cached in. */
+    [[nodiscard]] File getCacheFile() const;
+
+    /** Writes the cache to its file, if it has changed. */
+    void saveCache();
+
+    /** Forgets all of the cached results. */
+    void clearCache();
+
+    //==============================================================================
+    /** How the scan of a plugin turned out. */
+    enum class ScanOutcome
+    {
+        scanned,    // Scanned by a worker.
+        cached,     // Unchanged since it was last scanned, so the cached results were used.
+        failed,     // The worker doesn't know the format, or couldn't be launched.
+        crashed,    // The worker crashed whilst scanning it.
+        timedOut,   // The worker took too long to scan it, so was presumed to have hung.
+        cancelled   // The scan was cancelled before this finished.
+    };
+
+    /** Some statistics about the plugins scanned so far. */
+    struct Statistics final
+    {
+        int numRequested = 0, numCompleted = 0, numFromCache = 0,
+            numFailed = 0, numCrashed = 0, numTimedOut = 0;
+
+        double totalScanSeconds = 0.0, longestScanSeconds = 0.0;
+        String slowestFileOrIdentifier;
+
+        /** @returns how far along the scans are, from 0 to 1. */
+        [[nodiscard]] double getProgress() const noexcept
+        {
+            return numRequested > 0 ? jlimit (0.0, 1.0, (double) numCompleted / (double) numRequested) : 0.0;
+        }
+    };
+
+    /** @returns the statistics about the plugins scanned so far. */
+    [[nodiscard]] Statistics getStatistics() const;
+
+    /** Resets the statistics. */
+    void resetStatistics();
+
+    /** Called once each plugin has been scanned, with how it went and how long it took.
+
+        NB: This is called from whichever thread did the scanning, which may be several at once.
+    */
+    std::function<void (const String& fileOrIdentifier, ScanOutcome, double seconds)> onFileScanned;
+
     //==============================================================================
     /** @internal */
     [[nodiscard]] bool findPluginTypesFor (AudioPluginFormat&, OwnedArray<PluginDescription>&, const String&) override;
+    /** @internal */
+    void scanFinished() override;
 
 private:
     //==============================================================================
-    static String getCommandLineArg (const String& commandLine);
-    void waitForChildProcessOutput (ChildProcess&);
-    bool handleResultsFile (const File& resultsFile, OwnedArray<PluginDescription>& result);
-    void handleResultXml (const XmlElement& xml, OwnedArray<PluginDescription>& found);
+    class WorkerProcess;
+    class WorkerService;
+
+    struct Fingerprint final
+    {
+        int64 modificationTime = 0;
+        String contentHash;
+    };
+
+    struct CacheEntry final
+    {
+        Fingerprint fingerprint;
+        Array<PluginDescription> descriptions;
+    };
+
+    static constexpr auto workerCommandLineUID = "squarepinePluginScanWorker";
+
+    mutable CriticalSection poolLock;
+    WaitableEvent workerReleased;
+    std::vector<std::unique_ptr<WorkerProcess>> workers;
+    std::vector<WorkerProcess*> idleWorkers;
+    int numWorkers = 1;
+    std::atomic<int> scanTimeoutMs { 60000 };
+
+    mutable CriticalSection cacheLock;
+    std::map<String, CacheEntry> cache;
+    File cacheFile;
+    bool cacheNeedsSaving = false;
+
+    mutable CriticalSection statisticsLock;
+    Statistics statistics;
+
+    //==============================================================================
+    bool scanFile (AudioPluginFormat&, const String& fileOrIdentifier, OwnedArray<PluginDescription>&);
+    [[nodiscard]] bool shouldCancel() const;
+    WorkerProcess* acquireWorker();
+    void releaseWorker (WorkerProcess*);
+    void recordScan (const String& fileOrIdentifier, ScanOutcome, double seconds);
 
-    [[nodiscard]] static String createCommandArgument (AudioPluginFormat&,
-                                                       const String& fileOrIdentifier,
-                                                       const File& tempResultsFile);
+    bool findInCache (const String& key, const File&, Fingerprint&, OwnedArray<PluginDescription>&);
+    void addToCache (const String& key, const File&, Fingerprint, const OwnedArray<PluginDescription>&);
+    void loadCache();
 
-    static void performScanInChildProcess (const String& fileOrIdentifier, 
-                                           const String& formatName, 
-                                           File resultsFile,
-                                           OwnedArray<AudioPluginFormat>& customFormats);
+    static int64 getModificationTime (const File&);
+    static String calculateContentHash (const File&);
+    static void handleResultXml (const XmlElement& xml, OwnedArray<PluginDescription>& found);
 
     //==============================================================================
    #if ! JUCE_WINDOWS
@@ -7,6 +7,7 @@ EffectProcessor::EffectProcessor (AudioPluginPtr api, const PluginDescription& p
     setName ({});
     setMixLevel (1.0f);
     setBypassed (false);
+    setProcessedInParallel (false);
 
     if (plugin != nullptr)
     {
@@ -25,6 +26,9 @@ EffectProcessor::EffectProcessor (AudioPluginPtr api, const PluginDescription& p
 EffectProcessor::~EffectProcessor()
 {
     state.removeListener (this);
+
+    if (plugin != nullptr)
+        plugin->removeListener (this);
 }
 
 //==============================================================================
@@ -50,6 +54,9 @@ bool EffectProcessor::isBypassed() const                                { return
 void EffectProcessor::setBypassed (bool b, UndoManager* um)             { state.setProperty (bypassedId, b, um); }
 Value EffectProcessor::getBypassValueObject (UndoManager* um, bool b)   { return state.getPropertyAsValue (bypassedId, um, b); }
 
+bool EffectProcessor::isProcessedInParallel() const                     { return static_cast<bool> (state[parallelId]); }
+void EffectProcessor::setProcessedInParallel (bool b, UndoManager* um)  { state.setProperty (parallelId, b, um); }
+
 void EffectProcessor::valueTreePropertyChanged (ValueTree&, const Identifier& id)
 {
     if (id == mixId)
@@ -74,10 +81,79 @@ bool EffectProcessor::reloadFromStateIfValid()
     if (isMissing())
         return false;
 
-    const auto& lastState = state[lastStateId];
-    if (auto* data = lastState.getBinaryData())
-        plugin->setStateInformation (data->getData(), (int) data->getSize());
+    const auto* lastData = state[lastStateId].getBinaryData();
+    const auto usesEncodedState = (lastData == nullptr || lastData->isEmpty()) && ! encodedState.isEmpty();
+
+    const auto lastState = getLastState();
+    if (! lastState.isEmpty())
+        plugin->setStateInformation (lastState.getData(), (int) lastState.getSize());
+
+    // NB: If the plugin was restored from the encoded state, that state is still current.
+    if (usesEncodedState)
+        stateChanged = false;
 
     setLastState ({});
     return true;
 }
+
+MemoryBlock EffectProcessor::getLastState() const
+{
+    if (auto* data = state[lastStateId].getBinaryData())
+        if (! data->isEmpty())
+            return *data;
+
+    return encodedState.decode();
+}
+
+//==============================================================================
+void EffectProcessor::audioProcessorParameterChanged (AudioProcessor*, int, float)
+{
+    stateChanged.store (true, std::memory_order_relaxed);
+}
+
+void EffectProcessor::audioProcessorChanged (AudioProcessor*, const ChangeDetails& details)
+{
+    if (details.parameterInfoChanged || details.programChanged || details.nonParameterStateChanged)
+        stateChanged.store (true, std::memory_order_relaxed);
+}
+
+//==============================================================================
+EffectProcessor::EncodedState EffectProcessor::EncodedState::encode (const MemoryBlock& source, bool shouldCompress)
+{
+    EncodedState result;
+    result.decodedSize = (int64) source.getSize();
+
+    // NB: Tiny states don't shrink enough to be worth the trouble.
+    if (shouldCompress && source.getSize() > 64)
+    {
+        MemoryOutputStream mos (source.getSize() / 2);
+
+        {
+            GZIPCompressorOutputStream gzip (mos, 1);
+            gzip.write (source.getData(), source.getSize());
+        }
+
+        if (mos.getDataSize() < source.getSize())
+        {
+            result.data = mos.getMemoryBlock();
+            result.compressed = true;
+            return result;
+        }
+    }
+
+    result.data = source;
+    return result;
+}
+
+MemoryBlock EffectProcessor::EncodedState::decode() const
+{
+    if (! compressed)
+        return data;
+
+    MemoryInputStream mis (data, false);
+    GZIPDecompressorInputStream gzip (mis);
+
+    MemoryOutputStream mos ((size_t) jmax ((int64) 0, decodedSize));
+    mos.writeFromInputStream (gzip, -1);
+    return mos.getMemoryBlock();
+}
@@ -7,7 +7,8 @@
     @see EffectProcessorChain
 */
 class EffectProcessor final : public ReferenceCountedObject,
-                              public ValueTree::Listener
+                              public ValueTree::Listener,
+                              private AudioProcessorListener
 {
 public:
     //==============================================================================
@@ -40,6 +41,13 @@ public:
     /** @returns true if the contained plugin is null, which is interpreted as likely missing. */
     [[nodiscard]] bool isMissing() const noexcept       { return plugin == nullptr; }
 
+    /** @returns true if the plugin is still being loaded asynchronously,
+        in which case the effect passes its signal through until it's ready.
+
+        @see EffectProcessorChain::addAsync
+    */
+    [[nodiscard]] bool isLoading() const noexcept       { return loading; }
+
     /** @returns true if the plugin is not missing nor bypassed,
         and can generally be run as part of a process chain.
     */
@@ -67,6 +75,14 @@ public:
     /** @returns */
     [[nodiscard]] Value getMixValueObject (UndoManager*, bool shouldUpdateSynchronously = false);
 
+    /** @returns true if this effect is processed in parallel with the effect before it.
+
+        @see EffectProcessorChain::setProcessedInParallel
+    */
+    [[nodiscard]] bool isProcessedInParallel() const;
+    /** */
+    void setProcessedInParallel (bool, UndoManager* undoManager = nullptr);
+
     //==============================================================================
     /** @returns true if the plugin was able to be restored from its last known state. */
     bool reloadFromStateIfValid();
@@ -75,6 +91,26 @@ public:
     /** @internal */
     void valueTreePropertyChanged (ValueTree&, const Identifier&) override;
 
+    //==============================================================================
+    /** A plugin state as saved in an EffectProcessorChain's binary format,
+        which is optionally compressed.
+    */
+    struct EncodedState final
+    {
+        /** Encodes a plugin state, only keeping it compressed if that makes it smaller. */
+        [[nodiscard]] static EncodedState encode (const MemoryBlock& source, bool shouldCompress);
+
+        /** @returns the plugin state, decompressing it if need be. */
+        [[nodiscard]] MemoryBlock decode() const;
+
+        /** @returns true if there's no state. */
+        [[nodiscard]] bool isEmpty() const noexcept { return data.isEmpty(); }
+
+        MemoryBlock data;
+        bool compressed = false;
+        int64 decodedSize = 0;
+    };
+
 private:
     //==============================================================================
     friend class EffectProcessorChain;
@@ -85,8 +121,44 @@ private:
     LinearSmoothedValue<float> mixLevel { 1.0f };   // The normalised mix level.
     juce::Rectangle<int> windowBounds;              // The window bounds.
     AudioPluginPtr plugin;                          // The plugin instance.
+    bool loading = false;                           // Whether the plugin is being loaded asynchronously.
     const PluginDescription description;            // The plugin instance's description.
 
+    // NB: The encoded state is only touched when the chain saves or restores its state,
+    //     whereas the plugin can report its changes from any thread.
+    EncodedState encodedState;                      // The plugin's state as of the last save or restore.
+    std::atomic<bool> stateChanged { true };        // Whether the plugin has changed since its state was encoded.
+
+    /** The delay lines used by the chain to compensate for the plugin's latency. */
+    struct DelayLines final
+    {
+        /** Delays the dry signal by the plugin's latency. */
+        template<typename FloatType>
+        [[nodiscard]] DelayCompensator<FloatType>& getDry() noexcept
+        {
+            if constexpr (std::is_same_v<FloatType, float>)
+                return floatDry;
+            else
+                return doubleDry;
+        }
+
+        /** Delays the effect's output to line up with any latent parallel branches. */
+        template<typename FloatType>
+        [[nodiscard]] DelayCompensator<FloatType>& getAlignment() noexcept
+        {
+            if constexpr (std::is_same_v<FloatType, float>)
+                return floatAlignment;
+            else
+                return doubleAlignment;
+        }
+
+        DelayCompensator<float> floatDry, floatAlignment;
+        DelayCompensator<double> doubleDry, doubleAlignment;
+    };
+
+    // NB: This is shared with the chain's processing plans so it can be swapped out safely when resized.
+    std::shared_ptr<DelayLines> delayLines;
+
     //==============================================================================
     /** */
     CREATE_INLINE_CLASS_IDENTIFIER (name)
@@ -95,6 +167,8 @@ private:
     /** */
     CREATE_INLINE_CLASS_IDENTIFIER (bypassed)
     /** */
+    CREATE_INLINE_CLASS_IDENTIFIER (parallel)
+    /** */
     CREATE_INLINE_CLASS_IDENTIFIER (defaultState)
     /** */
     CREATE_INLINE_CLASS_IDENTIFIER (lastState)
@@ -102,6 +176,13 @@ private:
     void setDefaultState (const MemoryBlock&);
     void setLastState (const MemoryBlock&);
 
+    /** @returns the state the plugin should be restored with, decoding it if need be. */
+    [[nodiscard]] MemoryBlock getLastState() const;
+
+    //==============================================================================
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override;
+    void audioProcessorChanged (AudioProcessor*, const ChangeDetails&) override;
+
     //==============================================================================
     EffectProcessor() = delete;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EffectProcessor)
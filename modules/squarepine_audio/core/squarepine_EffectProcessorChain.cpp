@@ -10,8 +10,137 @@ namespace
         proc.prepareToPlay (parent.getSampleRate(), parent.getBlockSize());
         proc.setNonRealtime (parent.isNonRealtime());
     }
+
+    /** Crossfades the processed signal with the dry one, in place and in a single pass.
+
+        The mix level is ramped per sample if it's currently changing, where
+        all channels share the same ramp.
+    */
+    template<typename FloatType>
+    void applyDryWetMix (juce::AudioBuffer<FloatType>& wet,
+                         const juce::AudioBuffer<FloatType>& dry,
+                         LinearSmoothedValue<float>& mixLevel,
+                         std::vector<FloatType>& mixRamp,
+                         int numChannels, int numSamples)
+    {
+        if (mixLevel.isSmoothing())
+        {
+            jassert ((int) mixRamp.size() >= numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+                mixRamp[(size_t) i] = static_cast<FloatType> (mixLevel.getNextValue());
+
+            const auto* ramp = mixRamp.data();
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                auto* w = wet.getWritePointer (c);
+                const auto* d = dry.getReadPointer (c);
+
+                for (int i = 0; i < numSamples; ++i)
+                    w[i] = d[i] + ramp[i] * (w[i] - d[i]);
+            }
+        }
+        else
+        {
+            const auto mix = static_cast<FloatType> (mixLevel.getTargetValue());
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                auto* w = wet.getWritePointer (c);
+                const auto* d = dry.getReadPointer (c);
+
+                for (int i = 0; i < numSamples; ++i)
+                    w[i] = d[i] + mix * (w[i] - d[i]);
+            }
+        }
+    }
 }
 
+//==============================================================================
+/** Periodically frees the plans that the audio thread has handed back. */
+class EffectProcessorChain::PlanReclaimer final : private Timer
+{
+public:
+    PlanReclaimer (EffectProcessorChain& c) :
+        chain (c)
+    {
+        startTimer (250);
+    }
+
+    ~PlanReclaimer() override
+    {
+        stopTimer();
+    }
+
+private:
+    EffectProcessorChain& chain;
+
+    void timerCallback() override { chain.reclaimRetiredPlans(); }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlanReclaimer)
+};
+
+//==============================================================================
+/** Decodes the states of asynchronously created plugins in the background,
+    and prepares and restores them there too if their formats allow it.
+
+    NB: The jobs and callbacks only ever hold onto this weakly, and never touch the chain
+        from a background thread, so the chain can be deleted whilst plugins are loading.
+*/
+class EffectProcessorChain::AsyncLoader final : public std::enable_shared_from_this<AsyncLoader>
+{
+public:
+    AsyncLoader (EffectProcessorChain& c) :
+        chain (c)
+    {
+    }
+
+    ~AsyncLoader()
+    {
+        pool.removeAllJobs (true, 10000);
+    }
+
+    /** The details the plugins are prepared with, as of when they started loading. */
+    struct Settings final
+    {
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        AudioProcessor::ProcessingPrecision precision = AudioProcessor::singlePrecision;
+        bool nonRealtime = false;
+        AudioPlayHead* playHead = nullptr;
+    };
+
+    /** Prepares the plugin and restores its last state, on whichever thread its format allows.
+
+        @returns the plugin's default state, as it was before restoring the last one.
+    */
+    static MemoryBlock prepareAndRestore (AudioProcessor& plugin, const Settings& settings, const MemoryBlock& lastState)
+    {
+        plugin.enableAllBuses();
+        plugin.setPlayHead (settings.playHead);
+        plugin.setProcessingPrecision (settings.precision);
+        plugin.setRateAndBufferSizeDetails (settings.sampleRate, settings.blockSize);
+        plugin.prepareToPlay (settings.sampleRate, settings.blockSize);
+        plugin.setNonRealtime (settings.nonRealtime);
+
+        MemoryBlock defaultState;
+        plugin.getStateInformation (defaultState);
+
+        if (! lastState.isEmpty())
+            plugin.setStateInformation (lastState.getData(), (int) lastState.getSize());
+
+        return defaultState;
+    }
+
+    EffectProcessorChain& chain;
+    ThreadPool pool { jlimit (1, 4, SystemStats::getNumCpus() / 2) };
+    int numPending = 0; // NB: Only ever accessed on the message thread.
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AsyncLoader)
+};
+
 //==============================================================================
 EffectProcessorChain::EffectProcessorChain (EffectProcessorFactory::Ptr epf) :
     factory (epf)
@@ -20,6 +149,303 @@ EffectProcessorChain::EffectProcessorChain (EffectProcessorFactory::Ptr epf) :
 
     jassert (factory != nullptr);
     effects.ensureStorageAllocated (8);
+
+    planReclaimer = std::make_unique<PlanReclaimer> (*this);
+}
+
+EffectProcessorChain::~EffectProcessorChain()
+{
+    SQUAREPINE_CRASH_TRACER
+
+    asyncLoader.reset();
+    cancelPendingUpdate();
+
+    for (auto effect : effects)
+        detachFrom (effect);
+
+    planReclaimer.reset();
+    reclaimRetiredPlans();
+
+    delete pendingPlan.exchange (nullptr);
+    delete std::exchange (activePlan, nullptr);
+}
+
+//==============================================================================
+void EffectProcessorChain::rebuildProcessingPlan()
+{
+    SQUAREPINE_CRASH_TRACER
+
+    auto plan = std::make_unique<ProcessingPlan>();
+    plan->effects = effects;
+    plan->plugins.reserve ((size_t) effects.size());
+    plan->delayLines.reserve ((size_t) effects.size());
+    plan->steps.reserve ((size_t) effects.size());
+    plan->floatBypassDelay = floatBypassDelay;
+    plan->doubleBypassDelay = doubleBypassDelay;
+    plan->workerPool = workerPool;
+
+    int maxGroupSize = 1;
+
+    for (int i = 0; i < effects.size(); ++i)
+    {
+        if (auto effect = effects.getUnchecked (i))
+        {
+            const auto stepIndex = (int) plan->steps.size();
+
+            plan->plugins.push_back (effect->plugin);
+            plan->delayLines.push_back (effect->delayLines);
+            plan->steps.push_back ({ effect.get(), effect->plugin.get(), effectLevels[i], effect->delayLines.get(), effect->loading });
+
+            if (! plan->groups.empty() && effect->isProcessedInParallel())
+                plan->groups.back().setEnd (stepIndex + 1);
+            else
+                plan->groups.push_back ({ stepIndex, stepIndex + 1 });
+
+            maxGroupSize = std::max (maxGroupSize, plan->groups.back().getLength());
+        }
+    }
+
+    // Only allocate scratch space for the branches if there are any parallel groups:
+    if (maxGroupSize > 1)
+    {
+        plan->maxBranchChannels = jmax (getNumProcessingChannels(), floatBuffers.numChannels, doubleBuffers.numChannels);
+        plan->maxBranchSamples = jmax (getBlockSize(), floatBuffers.numSamples, doubleBuffers.numSamples);
+
+        auto allocateBranches = [&] (auto& branches)
+        {
+            branches.resize ((size_t) maxGroupSize);
+
+            for (auto& branch : branches)
+            {
+                branch.working.setSize (plan->maxBranchChannels, plan->maxBranchSamples);
+                branch.dry.setSize (plan->maxBranchChannels, plan->maxBranchSamples);
+                branch.mixRamp.resize ((size_t) plan->maxBranchSamples);
+
+                // NB: Enough for a short message on every sample of a block, so copying the MIDI in doesn't allocate.
+                branch.midi.ensureSize ((size_t) jmax (2048, plan->maxBranchSamples * 16));
+            }
+        };
+
+        if (getProcessingPrecision() == AudioProcessor::doublePrecision)
+            allocateBranches (plan->doubleBranches);
+        else
+            allocateBranches (plan->floatBranches);
+
+        plan->mergedMidi.ensureSize ((size_t) jmax (2048, plan->maxBranchSamples * 16) * (size_t) maxGroupSize);
+        plan->midiCursors.reserve ((size_t) maxGroupSize);
+        plan->midiAtSample.reserve (maxMidiEventsPerSample);
+    }
+
+    // If the audio thread never picked up the last pending plan, nobody else can be using it:
+    delete pendingPlan.exchange (plan.release(), std::memory_order_acq_rel);
+
+    reclaimRetiredPlans();
+}
+
+void EffectProcessorChain::reclaimRetiredPlans()
+{
+    int start1, size1, start2, size2;
+    retiredPlanFifo.prepareToRead (retiredPlanFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+        delete std::exchange (retiredPlans[(size_t) (start1 + i)], nullptr);
+
+    for (int i = 0; i < size2; ++i)
+        delete std::exchange (retiredPlans[(size_t) (start2 + i)], nullptr);
+
+    retiredPlanFifo.finishedRead (size1 + size2);
+}
+
+EffectProcessorChain::ProcessingPlan* EffectProcessorChain::acquireProcessingPlan() noexcept
+{
+    // NB: Only swap plans if the old one can be handed back to the message thread,
+    //     otherwise just carry on with the current one until there's room.
+    if (pendingPlan.load (std::memory_order_relaxed) == nullptr
+        || retiredPlanFifo.getFreeSpace() <= 0)
+        return activePlan;
+
+    if (auto* newPlan = pendingPlan.exchange (nullptr, std::memory_order_acq_rel))
+    {
+        if (activePlan != nullptr)
+        {
+            int start1, size1, start2, size2;
+            retiredPlanFifo.prepareToWrite (1, start1, size1, start2, size2);
+            retiredPlans[(size_t) (size1 > 0 ? start1 : start2)] = activePlan;
+            retiredPlanFifo.finishedWrite (1);
+        }
+
+        activePlan = newPlan;
+    }
+
+    return activePlan;
+}
+
+//==============================================================================
+namespace
+{
+    /** Leaves some headroom so that small changes in latency don't require reallocating. */
+    inline int getDelayCapacity (int latencySamples)
+    {
+        return latencySamples > 0 ? nextPowerOfTwo (latencySamples) : 0;
+    }
+
+    template<typename FloatType>
+    void prepareDelay (std::shared_ptr<DelayCompensator<FloatType>>& delay,
+                       int numChannels, int latencySamples, bool forceReallocation)
+    {
+        if (! forceReallocation
+            && delay != nullptr
+            && latencySamples <= delay->getMaximumDelay()
+            && numChannels <= delay->getNumChannels())
+            return;
+
+        // NB: A new delay line is created instead of resizing the existing one
+        //     because the audio thread might still be using it.
+        auto newDelay = std::make_shared<DelayCompensator<FloatType>>();
+        newDelay->prepare (numChannels, getDelayCapacity (latencySamples));
+        delay = std::move (newDelay);
+    }
+
+    template<typename FloatType>
+    bool canFit (const DelayCompensator<FloatType>& delay, int numChannels, int latencySamples)
+    {
+        return latencySamples <= delay.getMaximumDelay()
+            && numChannels <= delay.getNumChannels();
+    }
+
+    template<typename FloatType>
+    void processChainsConcurrently (RealtimeWorkerPool& pool,
+                                    const Array<EffectProcessorChain*>& chains,
+                                    const Array<juce::AudioBuffer<FloatType>*>& buffers,
+                                    const Array<MidiBuffer*>& midiBuffers)
+    {
+        jassert (chains.size() == buffers.size() && chains.size() == midiBuffers.size());
+
+        pool.run (jmin (chains.size(), buffers.size(), midiBuffers.size()), [&] (int i)
+        {
+            if (auto* chain = chains.getUnchecked (i))
+            {
+                // Rendering many chains at once is meant for offline processing!
+                jassert (chain->isNonRealtime());
+
+                chain->processBlock (*buffers.getUnchecked (i), *midiBuffers.getUnchecked (i));
+            }
+        });
+    }
+}
+
+int EffectProcessorChain::getNumProcessingChannels() const
+{
+    return jmax (getTotalNumInputChannels(), getTotalNumOutputChannels(), requiredChannels.load());
+}
+
+std::vector<Range<int>> EffectProcessorChain::getProcessingGroups() const
+{
+    std::vector<Range<int>> groups;
+
+    for (int i = 0; i < effects.size(); ++i)
+    {
+        auto effect = effects.getUnchecked (i);
+
+        if (! groups.empty() && effect != nullptr && effect->isProcessedInParallel())
+            groups.back().setEnd (i + 1);
+        else
+            groups.push_back ({ i, i + 1 });
+    }
+
+    return groups;
+}
+
+void EffectProcessorChain::updateDelayCompensation (bool forceReallocation)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    for (const auto& group : getProcessingGroups())
+    {
+        int groupLatency = 0;
+
+        for (int i = group.getStart(); i < group.getEnd(); ++i)
+            if (auto effect = effects.getUnchecked (i))
+                if (auto plugin = effect->plugin)
+                    groupLatency = std::max (groupLatency, plugin->getLatencySamples());
+
+        for (int i = group.getStart(); i < group.getEnd(); ++i)
+        {
+            if (auto effect = effects.getUnchecked (i))
+            {
+                const auto latency = effect->plugin != nullptr ? effect->plugin->getLatencySamples() : 0;
+                prepareDelayCompensation (*effect, group.getLength() > 1 ? groupLatency - latency : 0, forceReallocation);
+            }
+        }
+    }
+}
+
+void EffectProcessorChain::prepareDelayCompensation (EffectProcessor& effect, int alignmentLatency, bool forceReallocation)
+{
+    const auto numChans = getNumProcessingChannels();
+    const auto latency = effect.plugin != nullptr ? effect.plugin->getLatencySamples() : 0;
+
+    if (auto* lines = effect.delayLines.get())
+        if (! forceReallocation
+            && canFit (lines->floatDry, numChans, latency)
+            && canFit (lines->floatAlignment, numChans, alignmentLatency))
+            return;
+
+    // NB: New delay lines are created instead of resizing the existing ones
+    //     because the audio thread might still be using them.
+    auto lines = std::make_shared<EffectProcessor::DelayLines>();
+    lines->floatDry.prepare (numChans, getDelayCapacity (latency));
+    lines->doubleDry.prepare (numChans, getDelayCapacity (latency));
+    lines->floatAlignment.prepare (numChans, getDelayCapacity (alignmentLatency));
+    lines->doubleAlignment.prepare (numChans, getDelayCapacity (alignmentLatency));
+    effect.delayLines = std::move (lines);
+}
+
+void EffectProcessorChain::prepareBypassCompensation (bool forceReallocation)
+{
+    const auto numChans = getNumProcessingChannels();
+
+    prepareDelay (floatBypassDelay, numChans, getLatencySamples(), forceReallocation);
+    prepareDelay (doubleBypassDelay, numChans, getLatencySamples(), forceReallocation);
+}
+
+void EffectProcessorChain::attachTo (EffectProcessor::Ptr effect)
+{
+    if (effect != nullptr)
+    {
+        if (auto plugin = effect->plugin)
+        {
+            plugin->addListener (this);
+            plugin->addListener (effect.get()); // For tracking changes to the plugin's state.
+        }
+    }
+}
+
+void EffectProcessorChain::detachFrom (EffectProcessor::Ptr effect)
+{
+    if (effect != nullptr)
+    {
+        if (auto plugin = effect->plugin)
+        {
+            plugin->removeListener (this);
+            plugin->removeListener (effect.get());
+        }
+    }
+}
+
+void EffectProcessorChain::audioProcessorChanged (AudioProcessor*, const ChangeDetails& details)
+{
+    // NB: This can be called from any thread, the audio thread included.
+    if (details.latencyChanged)
+        triggerAsyncUpdate();
+}
+
+void EffectProcessorChain::handleAsyncUpdate()
+{
+    SQUAREPINE_CRASH_TRACER
+
+    updateLatency();
+    rebuildProcessingPlan();
 }
 
 //==============================================================================
@@ -27,7 +453,6 @@ template<typename Type>
 EffectProcessor::Ptr EffectProcessorChain::insertInternal (int destinationIndex, const Type& valueOrRef, InsertionStyle insertionStyle)
 {
     SQUAREPINE_CRASH_TRACER
-    const ScopedBypass sb (*this);
 
     if (factory == nullptr)
     {
@@ -43,6 +468,9 @@ EffectProcessor::Ptr EffectProcessorChain::insertInternal (int destinationIndex,
         const auto description = factory->createPluginDescription (valueOrRef);
         auto effect = make_refptr<EffectProcessor> (std::move (pluginInstance), description);
 
+        if (getSampleRate() > 0.0)
+            effect->mixLevel.reset (getSampleRate(), mixRampLengthSeconds);
+
         auto logMessage = String ("EffectProcessorChain: ACTION effect XYZ (\"PLUG\", \"ID\").")
                             .replace ("XYZ", effect->getName())
                             .replace ("PLUG", effect->getPluginName())
@@ -61,6 +489,7 @@ EffectProcessor::Ptr EffectProcessorChain::insertInternal (int destinationIndex,
         }
         else
         {
+            detachFrom (effects[destinationIndex]);
             effects.set (destinationIndex, effect);
             logMessage = logMessage.replace ("ACTION", "setting (index " + String (destinationIndex) + ")");
         }
@@ -71,7 +500,9 @@ EffectProcessor::Ptr EffectProcessorChain::insertInternal (int destinationIndex,
             if (auto* proc = effectLevels.add (new LevelsProcessor()))
                 prepareInternal (*this, *proc);
 
+        attachTo (effect);
         updateLatency();
+        rebuildProcessingPlan();
         updateHostDisplay();
         return effect;
     }
@@ -88,12 +519,245 @@ EffectProcessor::Ptr EffectProcessorChain::replace (int dest, int s)
 EffectProcessor::Ptr EffectProcessorChain::replace (int dest, const String& s)  { return insertInternal (dest, s, InsertionStyle::replace); }
 int EffectProcessorChain::getNumEffects() const                                 { return effects.size(); }
 
+//==============================================================================
+EffectProcessor::Ptr EffectProcessorChain::insertPlaceholder (int destinationIndex, const PluginDescription& description,
+                                                              InsertionStyle insertionStyle)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    jassert (insertionStyle != InsertionStyle::replace); // Replacements are swapped in once loaded instead.
+
+    auto effect = make_refptr<EffectProcessor> (nullptr, description);
+    effect->loading = true;
+    effect->setName (description.name);
+
+    if (getSampleRate() > 0.0)
+        effect->mixLevel.reset (getSampleRate(), mixRampLengthSeconds);
+
+    if (insertionStyle == InsertionStyle::append
+        || ! isPositiveAndBelow (destinationIndex, getNumEffects()))
+        effects.add (effect);
+    else
+        effects.insert (destinationIndex, effect);
+
+    while (effectLevels.size() < effects.size())
+        if (auto* proc = effectLevels.add (new LevelsProcessor()))
+            prepareInternal (*this, *proc);
+
+    updateLatency();
+    rebuildProcessingPlan();
+    updateHostDisplay();
+    return effect;
+}
+
+void EffectProcessorChain::startLoading (EffectProcessor::Ptr effect, EffectProcessor::Ptr effectToReplace, bool keepIfFailed)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    if (asyncLoader == nullptr)
+        asyncLoader = std::make_shared<AsyncLoader> (*this);
+
+    effect->loading = true;
+    ++asyncLoader->numPending;
+
+    Logger::writeToLog ("EffectProcessorChain: loading effect asynchronously (\"" + effect->description.createIdentifierString() + "\").");
+
+    AsyncLoader::Settings settings;
+    settings.sampleRate = getSampleRate();
+    settings.blockSize = getBlockSize();
+    settings.precision = getProcessingPrecision();
+    settings.nonRealtime = isNonRealtime();
+    settings.playHead = getPlayHead();
+
+    // NB: States restored from the binary format are only decoded in the background.
+    auto stateToRestore = effect->encodedState;
+    if (auto* data = effect->state[EffectProcessor::lastStateId].getBinaryData())
+        if (! data->isEmpty())
+            stateToRestore = EffectProcessor::EncodedState::encode (*data, false);
+
+    const auto prepareInBackground = formatsPreparedInBackground.contains (effect->description.pluginFormatName);
+    std::weak_ptr<AsyncLoader> weakLoader = asyncLoader;
+
+    factory->createPluginAsync (effect->description,
+        [weakLoader, effect, effectToReplace, keepIfFailed, settings, stateToRestore, prepareInBackground] (AudioPluginPtr plugin, const String& error)
+        {
+            auto loader = weakLoader.lock();
+            if (loader == nullptr)
+                return;
+
+            if (plugin == nullptr)
+            {
+                loader->chain.finishLoading (effect, effectToReplace, nullptr, {}, 0.0, 0, keepIfFailed,
+                                             error.isNotEmpty() ? error : String (NEEDS_TRANS ("The plugin couldn't be created.")));
+                return;
+            }
+
+            // NB: Decoding the state is always safe to do in the background, but preparing and restoring it
+            //     is only done there for the formats known to allow it; the rest expect the message thread.
+            loader->pool.addJob ([weakLoader, effect, effectToReplace, keepIfFailed, settings, stateToRestore, plugin, prepareInBackground]() mutable
+            {
+                auto lastState = stateToRestore.decode();
+
+                MemoryBlock defaultState;
+                if (prepareInBackground)
+                    defaultState = AsyncLoader::prepareAndRestore (*plugin, settings, lastState);
+
+                // NB: Everything is moved along so that the effects are only ever released on the message thread.
+                MessageManager::callAsync ([weakLoader = std::move (weakLoader), effect = std::move (effect),
+                                            effectToReplace = std::move (effectToReplace), plugin = std::move (plugin),
+                                            defaultState = std::move (defaultState), lastState = std::move (lastState),
+                                            keepIfFailed, settings, prepareInBackground]() mutable
+                {
+                    auto l = weakLoader.lock();
+                    if (l == nullptr)
+                        return;
+
+                    if (! prepareInBackground)
+                        defaultState = AsyncLoader::prepareAndRestore (*plugin, settings, lastState);
+
+                    l->chain.finishLoading (effect, effectToReplace, plugin, defaultState,
+                                            settings.sampleRate, settings.blockSize, keepIfFailed, {});
+                });
+            });
+        });
+}
+
+void EffectProcessorChain::finishLoading (EffectProcessor::Ptr effect, EffectProcessor::Ptr effectToReplace, AudioPluginPtr plugin,
+                                          const MemoryBlock& defaultState, double preparedSampleRate, int preparedBlockSize,
+                                          bool keepIfFailed, const String& error)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    if (asyncLoader != nullptr)
+        --asyncLoader->numPending;
+
+    effect->loading = false;
+
+    auto notify = [&] (const String& message)
+    {
+        if (onEffectLoaded != nullptr)
+            onEffectLoaded (effect, message);
+    };
+
+    if (plugin == nullptr)
+    {
+        Logger::writeToLog ("EffectProcessorChain: failed loading effect asynchronously --- " + error);
+
+        if (effectToReplace == nullptr && contains (effect))
+        {
+            if (keepIfFailed)
+                rebuildProcessingPlan();
+            else
+                remove (indexOf (effect));
+        }
+
+        notify (error);
+        return;
+    }
+
+    const auto destinationIndex = indexOf (effectToReplace != nullptr ? effectToReplace : effect);
+
+    if (destinationIndex < 0)
+    {
+        Logger::writeToLog ("EffectProcessorChain: discarding asynchronously loaded effect, its place in the chain is gone.");
+        notify (NEEDS_TRANS ("The effect was removed before its plugin finished loading."));
+        return;
+    }
+
+    // The chain may have been prepared differently whilst the plugin was loading:
+    if (preparedSampleRate != getSampleRate() || preparedBlockSize != getBlockSize())
+        prepareInternal (*this, *plugin);
+
+    // If the plugin was restored from the encoded state, that state is still current:
+    const auto* lastData = effect->state[EffectProcessor::lastStateId].getBinaryData();
+    if ((lastData == nullptr || lastData->isEmpty()) && ! effect->encodedState.isEmpty())
+        effect->stateChanged = false;
+
+    effect->plugin = std::move (plugin);
+    effect->setDefaultState (defaultState);
+    effect->setLastState ({});
+
+    if (effect->getName().isEmpty())
+        effect->setName (effect->getPluginName());
+
+    if (effectToReplace != nullptr)
+    {
+        detachFrom (effectToReplace);
+        effects.set (destinationIndex, effect);
+    }
+
+    Logger::writeToLog (String ("EffectProcessorChain: loaded effect XYZ (\"PLUG\") at index INDEX.")
+                            .replace ("XYZ", effect->getName())
+                            .replace ("PLUG", effect->getPluginName())
+                            .replace ("INDEX", String (destinationIndex)));
+
+    attachTo (effect);
+    updateLatency();
+    rebuildProcessingPlan();
+    updateHostDisplay();
+    notify ({});
+}
+
+template<typename Type>
+EffectProcessor::Ptr EffectProcessorChain::insertAsyncInternal (int destinationIndex, const Type& valueOrRef, InsertionStyle insertionStyle)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    if (factory == nullptr)
+    {
+        Logger::writeToLog ("EffectProcessorChain: factory not found!");
+        jassertfalse;
+        return {};
+    }
+
+    const auto description = factory->createPluginDescription (valueOrRef);
+    if (description.fileOrIdentifier.isEmpty())
+    {
+        Logger::writeToLog ("EffectProcessorChain: plugin not found!");
+        jassertfalse;
+        return {};
+    }
+
+    if (insertionStyle == InsertionStyle::replace)
+    {
+        // NB: The existing effect carries on processing until its replacement is ready.
+        if (auto effectToReplace = effects[destinationIndex])
+        {
+            auto effect = make_refptr<EffectProcessor> (nullptr, description);
+            effect->setName (description.name);
+
+            if (getSampleRate() > 0.0)
+                effect->mixLevel.reset (getSampleRate(), mixRampLengthSeconds);
+
+            startLoading (effect, effectToReplace, false);
+            return effect;
+        }
+
+        insertionStyle = InsertionStyle::append;
+    }
+
+    auto effect = insertPlaceholder (destinationIndex, description, insertionStyle);
+    startLoading (effect, nullptr, false);
+    return effect;
+}
+
+EffectProcessor::Ptr EffectProcessorChain::addAsync (int s)                         { return insertAsyncInternal (-1, s, InsertionStyle::append); }
+EffectProcessor::Ptr EffectProcessorChain::addAsync (const String& s)               { return insertAsyncInternal (-1, s, InsertionStyle::append); }
+EffectProcessor::Ptr EffectProcessorChain::insertAsync (int dest, int s)            { return insertAsyncInternal (dest, s); }
+EffectProcessor::Ptr EffectProcessorChain::insertAsync (int dest, const String& s)  { return insertAsyncInternal (dest, s); }
+EffectProcessor::Ptr EffectProcessorChain::replaceAsync (int dest, int s)           { return insertAsyncInternal (dest, s, InsertionStyle::replace); }
+EffectProcessor::Ptr EffectProcessorChain::replaceAsync (int dest, const String& s) { return insertAsyncInternal (dest, s, InsertionStyle::replace); }
+int EffectProcessorChain::getNumEffectsLoading() const noexcept                     { return asyncLoader != nullptr ? asyncLoader->numPending : 0; }
+
 void EffectProcessorChain::move (int pluginIndex, int destinationIndex)
 {
     SQUAREPINE_CRASH_TRACER
-    const ScopedBypass sb (*this);
 
-    effects.swap (pluginIndex, destinationIndex);
+    effects.move (pluginIndex, destinationIndex);
+
+    // NB: Moving an effect can regroup the parallel branches, which changes the latency.
+    updateLatency();
+    rebuildProcessingPlan();
 
     Logger::writeToLog (String ("EffectProcessorChain: moving index ABC to XYZ.")
                             .replace ("ABC", String (pluginIndex))
@@ -103,9 +767,10 @@ void EffectProcessorChain::move (int pluginIndex, int destinationIndex)
 void EffectProcessorChain::swap (int index1, int index2)
 {
     SQUAREPINE_CRASH_TRACER
-    const ScopedBypass sb (*this);
 
     effects.swap (index1, index2);
+    updateLatency();
+    rebuildProcessingPlan();
 
     Logger::writeToLog (String ("EffectProcessorChain: swapping index ABC with XYZ.")
                             .replace ("ABC", String (index1))
@@ -115,13 +780,17 @@ void EffectProcessorChain::swap (int index1, int index2)
 bool EffectProcessorChain::remove (int index)
 {
     SQUAREPINE_CRASH_TRACER
-    const ScopedBypass sb (*this);
 
     const auto startSize = getNumEffects();
+    const auto effect = effects[index];
     effects.remove (index);
 
     if (startSize != getNumEffects())
     {
+        detachFrom (effect);
+        updateLatency();
+        rebuildProcessingPlan();
+
         Logger::writeToLog (String ("EffectProcessorChain: removed index XYZ.")
                                 .replace ("XYZ", String (index)));
         return true;
@@ -138,13 +807,16 @@ bool EffectProcessorChain::contains (EffectProcessor::Ptr effect) const
 bool EffectProcessorChain::clear()
 {
     SQUAREPINE_CRASH_TRACER
-    const ScopedBypass sb (*this);
 
     const bool changed = ! effects.isEmpty();
     if (changed)
     {
+        for (auto effect : effects)
+            detachFrom (effect);
+
         effects.clear();
         updateLatency();
+        rebuildProcessingPlan();
     }
 
     if (changed)
@@ -203,6 +875,11 @@ std::optional<float> EffectProcessorChain::getMixLevel (int index) const
     return getEffectProperty<float> (index, [&] (EffectProcessor::Ptr e) { return e->getMixLevel(); });
 }
 
+std::optional<bool> EffectProcessorChain::isProcessedInParallel (int index) const
+{
+    return getEffectProperty<bool> (index, [&] (EffectProcessor::Ptr e) { return e->isProcessedInParallel(); });
+}
+
 std::optional<juce::Rectangle<int>> EffectProcessorChain::getLastWindowBounds (int index) const
 {
     return getEffectProperty<juce::Rectangle<int>> (index, [&] (EffectProcessor::Ptr e) { return e->windowBounds; });
@@ -225,13 +902,43 @@ bool EffectProcessorChain::loadIfMissing (int index)
             const InternalProcessor::ScopedBypass sb (*this);
 
             effect->plugin = factory->createPlugin (effect->description);
-            return effect->reloadFromStateIfValid();
+
+            if (auto plugin = effect->plugin)
+                prepareInternal (*this, *plugin);
+
+            const auto result = effect->reloadFromStateIfValid();
+            attachTo (effect);
+            updateLatency();
+            rebuildProcessingPlan();
+            return result;
         }
     }
 
     return false;
 }
 
+bool EffectProcessorChain::loadIfMissingAsync (int index)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    if (auto effect = effects[index])
+    {
+        if (effect->isMissing() && ! effect->isLoading())
+        {
+            startLoading (effect, nullptr, true);
+            rebuildProcessingPlan();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::optional<bool> EffectProcessorChain::isLoading (int index) const
+{
+    return getEffectProperty<bool> (index, [&] (EffectProcessor::Ptr e) { return e->isLoading(); });
+}
+
 void EffectProcessorChain::getChannelLevels (int index, Array<float>& destData)
 {
     SQUAREPINE_CRASH_TRACER
@@ -248,6 +955,14 @@ void EffectProcessorChain::getChannelLevels (int index, Array<double>& destData)
         lp->getChannelLevels (destData);
 }
 
+const MeterSnapshotTransport* EffectProcessorChain::getSnapshotTransport (int index) const
+{
+    if (auto* lp = effectLevels[index])
+        return &lp->getSnapshotTransport();
+
+    return nullptr;
+}
+
 void EffectProcessorChain::setMeteringMode (int index, MeteringMode mm)
 {
     SQUAREPINE_CRASH_TRACER
@@ -263,119 +978,385 @@ std::optional<MeteringMode> EffectProcessorChain::getMeteringMode (int index) co
     if (auto* lp = effectLevels[index])
         return lp->getMeteringMode();
 
-    return {};
+    return {};
+}
+
+//==============================================================================
+bool EffectProcessorChain::setEffectProperty (int index, std::function<void (EffectProcessor::Ptr)> func)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    jassert (func != nullptr);
+
+    if (auto effect = getEffectProcessor (index))
+    {
+        func (effect);
+        return true;
+    }
+
+    return false;
+}
+
+bool EffectProcessorChain::setEffectName (int index, const String& name)
+{
+    return setEffectProperty (index, [name] (EffectProcessor::Ptr e) { e->setName (name); });
+}
+
+bool EffectProcessorChain::setBypass (int index, bool bypass)
+{
+    return setEffectProperty (index, [bypass] (EffectProcessor::Ptr e) { e->setBypassed (bypass); });
+}
+
+bool EffectProcessorChain::setMixLevel (int index, float mixLevel)
+{
+    return setEffectProperty (index, [mixLevel] (EffectProcessor::Ptr e) { e->setMixLevel (mixLevel); });
+}
+
+bool EffectProcessorChain::setProcessedInParallel (int index, bool shouldBeParallel)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    if (isProcessedInParallel (index) == std::optional<bool> (shouldBeParallel))
+        return false;
+
+    if (! setEffectProperty (index, [shouldBeParallel] (EffectProcessor::Ptr e) { e->setProcessedInParallel (shouldBeParallel); }))
+        return false;
+
+    updateLatency();
+    rebuildProcessingPlan();
+    updateHostDisplay();
+    return true;
+}
+
+void EffectProcessorChain::setWorkerPool (std::shared_ptr<RealtimeWorkerPool> newPool)
+{
+    if (workerPool != newPool)
+    {
+        workerPool = std::move (newPool);
+        rebuildProcessingPlan();
+    }
+}
+
+//==============================================================================
+int EffectProcessorChain::getNumRequiredChannels() const
+{
+    SQUAREPINE_CRASH_TRACER
+
+    int newRequiredChannels = 0;
+
+    for (auto effect : effects)
+    {
+        newRequiredChannels = jmax (newRequiredChannels,
+                                    effect->description.numInputChannels,
+                                    effect->description.numOutputChannels);
+
+        if (auto plugin = effect->plugin)
+        {
+            for (const auto b : { true, false })
+            {
+                const int numBs = plugin->getBusCount (b);
+
+                for (int i = 0; i < numBs; ++i)
+                    newRequiredChannels = std::max (newRequiredChannels,
+                                                    plugin->getChannelCountOfBus (b, i));
+            }
+        }
+    }
+
+    return newRequiredChannels;
+}
+
+void EffectProcessorChain::updateLatency()
+{
+    SQUAREPINE_CRASH_TRACER
+
+    requiredChannels = getNumRequiredChannels();
+
+    int newLatency = 0;
+
+    // NB: This is additive because the groups are processed in serial,
+    //     whereas the branches of a parallel group are lined up with the slowest one.
+    for (const auto& group : getProcessingGroups())
+    {
+        int groupLatency = 0;
+
+        for (int i = group.getStart(); i < group.getEnd(); ++i)
+            if (auto effect = effects.getUnchecked (i))
+                if (auto plugin = effect->plugin)
+                    groupLatency = std::max (groupLatency, plugin->getLatencySamples());
+
+        newLatency += groupLatency;
+    }
+
+    setLatencySamples (newLatency);
+    updateDelayCompensation (false);
+    prepareBypassCompensation (false);
+}
+
+void EffectProcessorChain::prepareToPlay (double sampleRate, int estimatedSamplesPerBlock)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    Logger::writeToLog (String ("EffectProcessorChain: preparing to play (sr: RATE, block: SIZE).")
+                            .replace ("RATE", String (sampleRate))
+                            .replace ("SIZE", String (estimatedSamplesPerBlock)));
+
+    setRateAndBufferSizeDetails (sampleRate, estimatedSamplesPerBlock);
+
+    const auto numChans = getNumProcessingChannels();
+
+    floatBuffers.prepare (numChans, estimatedSamplesPerBlock);
+    doubleBuffers.prepare (numChans, estimatedSamplesPerBlock);
+
+    // NB: The levels processors are kept around (and merely re-prepared)
+    //     because the processing plans refer to them directly.
+    while (effectLevels.size() < effects.size())
+        effectLevels.add (new LevelsProcessor());
+
+    for (auto* proc : effectLevels)
+        prepareInternal (*this, *proc);
+
+    for (auto effect : effects)
+    {
+        if (effect != nullptr)
+        {
+            effect->mixLevel.reset (sampleRate, mixRampLengthSeconds);
+
+            if (auto plugin = effect->plugin)
+                prepareInternal (*this, *plugin);
+        }
+    }
+
+    // The plugins may only know their latency once prepared:
+    updateLatency();
+    updateDelayCompensation (true);
+    prepareBypassCompensation (true);
+    rebuildProcessingPlan();
+}
+
+//==============================================================================
+int EffectProcessorChain::getStepLatency (const ProcessingPlan::Step& step) noexcept
+{
+    if (step.plugin != nullptr && step.delays != nullptr && ! step.plugin->isSuspended())
+        return step.plugin->getLatencySamples();
+
+    return 0;
+}
+
+template<typename FloatType>
+void EffectProcessorChain::processStep (const ProcessingPlan::Step& step,
+                                        juce::AudioBuffer<FloatType>& working,
+                                        juce::AudioBuffer<FloatType>& dry,
+                                        std::vector<FloatType>& mixRamp,
+                                        MidiBuffer& midiMessages,
+                                        const int numChannels,
+                                        const int numSamples,
+                                        const int alignmentLatency)
+{
+    auto& effect = *step.effect;
+    auto* plugin = step.plugin;
+    auto& mixLevel = effect.mixLevel;
+    const auto canProcess = plugin != nullptr && ! plugin->isSuspended();
+    const auto latency = getStepLatency (step);
+
+    if (effect.bypassed.load (std::memory_order_relaxed))
+    {
+        // NB: Not every plugin delays its signal when bypassed,
+        //     so the signal is delayed here instead to keep the timing stable.
+        if (latency > 0)
+            step.delays->template getDry<FloatType>().process (working, working, numChannels, numSamples, latency);
+        else if (canProcess)
+            plugin->processBlockBypassed (working, midiMessages);
+
+        mixLevel.skip (numSamples);
+    }
+    else if (! mixLevel.isSmoothing() && mixLevel.getTargetValue() >= 1.0f)
+    {
+        // Keeps the delay line's history current in case the mix or bypass changes:
+        if (latency > 0)
+            step.delays->template getDry<FloatType>().push (working, numChannels, numSamples);
+
+        if (canProcess)
+            plugin->processBlock (working, midiMessages);
+        else if (! step.isLoading)
+            working.clear();
+    }
+    else
+    {
+        if (latency > 0)
+        {
+            step.delays->template getDry<FloatType>().process (working, dry, numChannels, numSamples, latency);
+        }
+        else
+        {
+            for (int i = 0; i < numChannels; ++i)
+                dry.copyFrom (i, 0, working, i, 0, numSamples);
+        }
+
+        if (canProcess)
+            plugin->processBlock (working, midiMessages);
+        else if (! step.isLoading)
+            working.clear();
+
+        applyDryWetMix (working, dry, mixLevel, mixRamp, numChannels, numSamples);
+    }
+
+    if (alignmentLatency > 0 && step.delays != nullptr)
+        step.delays->template getAlignment<FloatType>().process (working, working, numChannels, numSamples, alignmentLatency);
+
+    if (step.levels != nullptr)
+        step.levels->processBlock (working, midiMessages);
 }
 
-//==============================================================================
-bool EffectProcessorChain::setEffectProperty (int index, std::function<void (EffectProcessor::Ptr)> func)
+template<typename FloatType>
+void EffectProcessorChain::processParallelGroup (ProcessingPlan& plan,
+                                                 Range<int> group,
+                                                 juce::AudioBuffer<FloatType>& working,
+                                                 BufferPackage<FloatType>& bufferPackage,
+                                                 MidiBuffer& midiMessages,
+                                                 const int numChannels,
+                                                 const int numSamples)
 {
-    SQUAREPINE_CRASH_TRACER
-
-    jassert (func != nullptr);
+    auto& branches = plan.template getBranches<FloatType>();
+    const auto numBranches = group.getLength();
 
-    if (auto effect = getEffectProcessor (index))
+    if ((int) branches.size() < numBranches
+        || numChannels > plan.maxBranchChannels
+        || numSamples > plan.maxBranchSamples)
     {
-        func (effect);
-        return true;
+        // The chain wasn't prepared for this block! Falling back to serial processing...
+        jassertfalse;
+
+        for (int i = group.getStart(); i < group.getEnd(); ++i)
+            processStep (plan.steps[(size_t) i], working, bufferPackage.dryBuffer, bufferPackage.mixRamp,
+                         midiMessages, numChannels, numSamples, 0);
+
+        return;
     }
 
-    return false;
-}
+    int groupLatency = 0;
 
-bool EffectProcessorChain::setEffectName (int index, const String& name)
-{
-    return setEffectProperty (index, [name] (EffectProcessor::Ptr e) { e->setName (name); });
-}
+    // Split: every branch gets its own copy of the signal and MIDI.
+    for (int b = 0; b < numBranches; ++b)
+    {
+        auto& branch = branches[(size_t) b];
+        branch.latency = getStepLatency (plan.steps[(size_t) (group.getStart() + b)]);
+        groupLatency = std::max (groupLatency, branch.latency);
 
-bool EffectProcessorChain::setBypass (int index, bool bypass)
-{
-    return setEffectProperty (index, [bypass] (EffectProcessor::Ptr e) { e->setBypassed (bypass); });
-}
+        for (int c = 0; c < numChannels; ++c)
+            branch.working.copyFrom (c, 0, working, c, 0, numSamples);
 
-bool EffectProcessorChain::setMixLevel (int index, float mixLevel)
-{
-    return setEffectProperty (index, [mixLevel] (EffectProcessor::Ptr e) { e->setMixLevel (mixLevel); });
-}
+        branch.midi.clear();
+        branch.midi.addEvents (midiMessages, 0, numSamples, 0);
+    }
 
-//==============================================================================
-int EffectProcessorChain::getNumRequiredChannels() const
-{
-    SQUAREPINE_CRASH_TRACER
+    auto processBranch = [&] (int b)
+    {
+        const ScopedNoDenormals snd;
 
-    int newRequiredChannels = 0;
+        auto& branch = branches[(size_t) b];
+        juce::AudioBuffer<FloatType> branchWorking (branch.working.getArrayOfWritePointers(), numChannels, numSamples);
 
-    for (auto effect : effects)
+        processStep (plan.steps[(size_t) (group.getStart() + b)], branchWorking, branch.dry, branch.mixRamp,
+                     branch.midi, numChannels, numSamples, groupLatency - branch.latency);
+    };
+
+    if (auto* pool = plan.workerPool.get())
     {
-        newRequiredChannels = jmax (newRequiredChannels,
-                                    effect->description.numInputChannels,
-                                    effect->description.numOutputChannels);
+        pool->run (numBranches, processBranch);
+    }
+    else
+    {
+        for (int b = 0; b < numBranches; ++b)
+            processBranch (b);
+    }
 
-        if (auto plugin = effect->plugin)
-        {
-            for (const auto b : { true, false })
-            {
-                const int numBs = plugin->getBusCount (b);
+    // Join: sum the branches back together.
+    for (int c = 0; c < numChannels; ++c)
+    {
+        working.copyFrom (c, 0, branches.front().working, c, 0, numSamples);
 
-                for (int i = 0; i < numBs; ++i)
-                    newRequiredChannels = std::max (newRequiredChannels,
-                                                    plugin->getChannelCountOfBus (b, i));
-            }
-        }
+        for (int b = 1; b < numBranches; ++b)
+            working.addFrom (c, 0, branches[(size_t) b].working, c, 0, numSamples);
     }
 
-    return newRequiredChannels;
+    // Likewise for the MIDI, where anything that several branches passed through is only kept once:
+    mergeBranchMidi (plan, branches, numBranches, midiMessages);
 }
 
-void EffectProcessorChain::updateLatency()
+template<typename FloatType>
+void EffectProcessorChain::mergeBranchMidi (ProcessingPlan& plan,
+                                            const std::vector<ProcessingPlan::Branch<FloatType>>& branches,
+                                            const int numBranches,
+                                            MidiBuffer& midiMessages)
 {
-    SQUAREPINE_CRASH_TRACER
+    // NB: Each branch is already sorted, so this is a single merge that always takes
+    //     the earliest event, preferring the first branch when several share a sample.
+    //     Only the events kept at the current sample are compared against, to find duplicates.
+    auto& merged = plan.mergedMidi;
+    auto& cursors = plan.midiCursors;
+    auto& atSample = plan.midiAtSample;
 
-    requiredChannels = getNumRequiredChannels();
+    merged.clear();
+    cursors.clear();
+    atSample.clear();
 
-    int newLatency = 0;
+    for (int b = 0; b < numBranches; ++b)
+        cursors.push_back (branches[(size_t) b].midi.cbegin());
 
-    // NB: This is additive because we're processing in serial!
-    for (auto effect : effects)
-        if (auto plugin = effect->plugin)
-            newLatency += plugin->getLatencySamples();
+    for (int currentSample = std::numeric_limits<int>::min();;)
+    {
+        int next = -1;
 
-    setLatencySamples (newLatency);
-}
+        for (int b = 0; b < numBranches; ++b)
+        {
+            if (cursors[(size_t) b] == branches[(size_t) b].midi.cend())
+                continue;
 
-void EffectProcessorChain::prepareToPlay (double sampleRate, int estimatedSamplesPerBlock)
-{
-    SQUAREPINE_CRASH_TRACER
+            if (next < 0 || (*cursors[(size_t) b]).samplePosition < (*cursors[(size_t) next]).samplePosition)
+                next = b;
+        }
 
-    Logger::writeToLog (String ("EffectProcessorChain: preparing to play (sr: RATE, block: SIZE).")
-                            .replace ("RATE", String (sampleRate))
-                            .replace ("SIZE", String (estimatedSamplesPerBlock)));
+        if (next < 0)
+            break;
 
-    setRateAndBufferSizeDetails (sampleRate, estimatedSamplesPerBlock);
+        const auto metadata = *cursors[(size_t) next];
+        ++cursors[(size_t) next];
 
-    const auto numChans = jmax (getTotalNumInputChannels(), getTotalNumOutputChannels(), requiredChannels.load());
+        if (metadata.samplePosition != currentSample)
+        {
+            currentSample = metadata.samplePosition;
+            atSample.clear();
+        }
 
-    effectLevels.clearQuick (true);
+        // Another branch passing the same event through doesn't make it a new one:
+        const auto isDuplicate = std::any_of (atSample.cbegin(), atSample.cend(), [&] (const auto& kept)
+        {
+            return kept.second != next
+                && kept.first.numBytes == metadata.numBytes
+                && std::memcmp (kept.first.data, metadata.data, (size_t) metadata.numBytes) == 0;
+        });
 
-    floatBuffers.prepare (numChans, estimatedSamplesPerBlock);
-    doubleBuffers.prepare (numChans, estimatedSamplesPerBlock);
+        if (isDuplicate)
+            continue;
 
-    for (int i = 0; i < effects.size(); ++i)
-    {
-        if (i >= effectLevels.size())
-            if (auto* proc = effectLevels.add (new LevelsProcessor()))
-                prepareInternal (*this, *proc);
+        merged.addEvent (metadata.data, metadata.numBytes, metadata.samplePosition);
 
-        if (auto effect = effects.getUnchecked (i))
-            if (auto plugin = effect->plugin)
-                prepareInternal (*this, *plugin);
+        // NB: Past the reserved amount, events at the same sample are kept without being compared against.
+        if (atSample.size() < atSample.capacity())
+            atSample.emplace_back (metadata, next);
     }
+
+    // NB: The callers' buffer takes the reserved storage, and the merged one keeps theirs for next time.
+    //     Callers normally pass the same buffer on every block, so after the first merge both are large enough.
+    midiMessages.swapWith (merged);
 }
 
-//==============================================================================
 template<typename FloatType>
 void EffectProcessorChain::processInternal (juce::AudioBuffer<FloatType>& source,
                                             MidiBuffer& midiMessages,
                                             BufferPackage<FloatType>& bufferPackage,
+                                            ProcessingPlan& plan,
                                             const int numChannels,
                                             const int maxNumChannels,
                                             const int numSamples)
@@ -384,53 +1365,30 @@ void EffectProcessorChain::processInternal (juce::AudioBuffer<FloatType>& source
 
     bufferPackage.prepare (maxNumChannels, numSamples);
 
-    addFrom (bufferPackage.mixingBuffer, source, numChannels, numSamples);
-
-    // Making this copy in case effects are changed around somehow (CRUD, etc):
-    auto plugs = effects;
+    // NB: Referring to the prepared storage avoids handing the effects a buffer
+    //     that's longer than the block, and doesn't allocate for typical channel counts.
+    juce::AudioBuffer<FloatType> working (bufferPackage.mixingBuffer.getArrayOfWritePointers(), maxNumChannels, numSamples);
 
-    for (auto effect : plugs)
-    {
-        if (effect == nullptr)
-            continue;
+    copyFrom (working, source, numChannels, numSamples);
 
-        // Process the effect:
-        bufferPackage.effectBuffer.clear();
-        addFrom (bufferPackage.effectBuffer, bufferPackage.mixingBuffer, numChannels, numSamples);
+    // Any extra channels required by the effects start off silent:
+    for (int i = (numChannels == 1 && maxNumChannels == 2) ? 2 : numChannels; i < maxNumChannels; ++i)
+        working.clear (i, 0, numSamples);
 
-        if (effect->plugin == nullptr || effect->plugin->isSuspended())
-        {
-            bufferPackage.effectBuffer.clear();
-        }
+    // In full buffer passes, each effect costs nothing extra when fully wet or bypassed
+    // (ie: the effect runs in place), and 2 passes when partially mixed
+    // (ie: one to keep the dry signal, one for the fused crossfade).
+    // This used to be 6 passes per effect, regardless.
+    for (const auto& group : plan.groups)
+    {
+        if (group.getLength() > 1)
+            processParallelGroup (plan, group, working, bufferPackage, midiMessages, maxNumChannels, numSamples);
         else
-        {
-            if (effect->canBeProcessed())
-                effect->plugin->processBlock (bufferPackage.effectBuffer, midiMessages);
-            else
-                effect->plugin->processBlockBypassed (bufferPackage.effectBuffer, midiMessages);
-        }
-
-        // Add the effect-saturated samples at the specified mix level:
-        const auto mixLevel = static_cast<FloatType> (effect->mixLevel.getNextValue());
-        // jassert (approximatelyEqual (effect->mixLevel.getTargetValue(), 1.0f));
-
-        bufferPackage.lastBuffer.clear();
-        addFrom (bufferPackage.lastBuffer, bufferPackage.effectBuffer, numChannels, numSamples, mixLevel);
-
-        // Add the original samples, at a percentage of the original gain, if the effect level isn't 100%:
-        if (mixLevel < static_cast<FloatType> (1))
-            addFrom (bufferPackage.lastBuffer, bufferPackage.mixingBuffer, numChannels, numSamples, mixLevel);
-
-        // Copy the result:
-        bufferPackage.mixingBuffer.clear();
-        addFrom (bufferPackage.mixingBuffer, bufferPackage.lastBuffer, numChannels, numSamples);
-
-        effectLevels.getUnchecked (effects.indexOf (effect))
-            ->processBlock (bufferPackage.mixingBuffer, midiMessages);
+            processStep (plan.steps[(size_t) group.getStart()], working, bufferPackage.dryBuffer, bufferPackage.mixRamp,
+                         midiMessages, maxNumChannels, numSamples, 0);
     }
 
-    source.clear();
-    addFrom (source, bufferPackage.mixingBuffer, numChannels, numSamples);
+    copyFrom (source, working, numChannels, numSamples);
 }
 
 template<typename FloatType>
@@ -442,28 +1400,54 @@ void EffectProcessorChain::process (juce::AudioBuffer<FloatType>& buffer,
 
     const ScopedNoDenormals snd;
 
+    auto* plan = acquireProcessingPlan();
     const auto numChannels = std::min (buffer.getNumChannels(), requiredChannels.load());
     const auto numSamples = buffer.getNumSamples();
+    const auto latency = getLatencySamples();
+    auto* bypassDelay = plan != nullptr ? plan->template getBypassDelay<FloatType>() : nullptr;
 
     if (isBypassed()
         || isSuspended()
-        || effects.isEmpty()
+        || plan == nullptr
+        || plan->steps.empty()
         || numChannels <= 0
         || numSamples <= 0)
     {
-        // @todo Latency compensation. juce::dsp::DelayLine?
+        // Delay the signal as the effects would have, so that bypassing doesn't shift the timing:
+        if (bypassDelay != nullptr && latency > 0)
+            bypassDelay->process (buffer, buffer, buffer.getNumChannels(), numSamples, latency);
+
         return;
     }
 
+    if (bypassDelay != nullptr && latency > 0)
+        bypassDelay->push (buffer, buffer.getNumChannels(), numSamples);
+
     const auto maxNumChannels = std::max (buffer.getNumChannels(), requiredChannels.load());
 
-    processInternal (buffer, midiMessages, package,
+    processInternal (buffer, midiMessages, package, *plan,
                      numChannels, maxNumChannels, numSamples);
 }
 
 void EffectProcessorChain::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer& midiMessages)  { process<float> (buffer, midiMessages, floatBuffers); }
 void EffectProcessorChain::processBlock (juce::AudioBuffer<double>& buffer, MidiBuffer& midiMessages) { process<double> (buffer, midiMessages, doubleBuffers); }
 
+void EffectProcessorChain::processConcurrently (RealtimeWorkerPool& pool,
+                                                const Array<EffectProcessorChain*>& chains,
+                                                const Array<juce::AudioBuffer<float>*>& buffers,
+                                                const Array<MidiBuffer*>& midiBuffers)
+{
+    processChainsConcurrently (pool, chains, buffers, midiBuffers);
+}
+
+void EffectProcessorChain::processConcurrently (RealtimeWorkerPool& pool,
+                                                const Array<EffectProcessorChain*>& chains,
+                                                const Array<juce::AudioBuffer<double>*>& buffers,
+                                                const Array<MidiBuffer*>& midiBuffers)
+{
+    processChainsConcurrently (pool, chains, buffers, midiBuffers);
+}
+
 //==============================================================================
 double EffectProcessorChain::getTailLengthSeconds() const
 {
@@ -493,7 +1477,12 @@ void EffectProcessorChain::setNonRealtime (bool isNonRealtime) noexcept
                 plugin->setNonRealtime (isNonRealtime);
 }
 
-void EffectProcessorChain::releaseResources()           { loopThroughEffectsAndCall<&AudioProcessor::releaseResources>(); }
+void EffectProcessorChain::releaseResources()
+{
+    loopThroughEffectsAndCall<&AudioProcessor::releaseResources>();
+    reclaimRetiredPlans();
+}
+
 void EffectProcessorChain::reset()                      { loopThroughEffectsAndCall<&AudioProcessor::reset>(); }
 void EffectProcessorChain::numChannelsChanged()         { loopThroughEffectsAndCall<&AudioProcessor::numChannelsChanged>(); }
 void EffectProcessorChain::numBusesChanged()            { loopThroughEffectsAndCall<&AudioProcessor::numBusesChanged>(); }
@@ -506,12 +1495,70 @@ namespace chainIds
     CREATE_INLINE_IDENTIFIER (bypassed)             // Type: bool
     CREATE_INLINE_IDENTIFIER (name)                 // Type: string
     CREATE_INLINE_IDENTIFIER (mixLevel)             // Type: double
+    CREATE_INLINE_IDENTIFIER (parallel)             // Type: bool
     CREATE_INLINE_IDENTIFIER (meteringMode)         // Type: int
     CREATE_INLINE_IDENTIFIER (windowBounds)         // Type: string, from Rectangle::toString
     CREATE_INLINE_IDENTIFIER (pluginDescription)    // Type: string, Base64
     CREATE_INLINE_IDENTIFIER (state)                // Type: string, Base64
 }
 
+namespace chainBinary
+{
+    constexpr uint32 magicNumber    = 0x43455053;   // "SPEC", little endian.
+    constexpr int currentVersion    = 1;
+}
+
+/** @returns the metering mode stored in a state, falling back to peak metering if the value is out of range. */
+static MeteringMode getMeteringModeFromState (int value)
+{
+    if (isPositiveAndNotGreaterThan (value, static_cast<int> (MeteringMode::truePeak)))
+        return static_cast<MeteringMode> (value);
+
+    Logger::writeToLog ("EffectProcessorChain: corrupt metering mode (" + String (value) + "), falling back to peak metering...");
+    jassertfalse;
+    return MeteringMode::peak;
+}
+
+//==============================================================================
+void EffectProcessorChain::setStateCompressionEnabled (bool shouldCompress)
+{
+    if (compressStates != shouldCompress)
+    {
+        compressStates = shouldCompress;
+        invalidateCachedStates();
+    }
+}
+
+void EffectProcessorChain::invalidateCachedStates()
+{
+    for (auto effect : effects)
+        if (effect != nullptr)
+            effect->stateChanged = true;
+}
+
+const EffectProcessor::EncodedState& EffectProcessorChain::getEncodedState (EffectProcessor& effect)
+{
+    if (auto plugin = effect.plugin)
+    {
+        // NB: The flag is cleared first so that any changes made whilst fetching the state are caught next time.
+        if (effect.stateChanged.exchange (false) || effect.encodedState.isEmpty())
+        {
+            MemoryBlock data;
+            plugin->getStateInformation (data);
+            effect.encodedState = EffectProcessor::EncodedState::encode (data, compressStates);
+        }
+    }
+    else if (auto* data = effect.state[EffectProcessor::lastStateId].getBinaryData())
+    {
+        // Keeps the state of effects that are missing or still loading:
+        if (! data->isEmpty() && effect.encodedState.isEmpty())
+            effect.encodedState = EffectProcessor::EncodedState::encode (*data, compressStates);
+    }
+
+    return effect.encodedState;
+}
+
+//==============================================================================
 void EffectProcessorChain::getStateInformation (MemoryBlock& destData)
 {
     SQUAREPINE_CRASH_TRACER
@@ -520,6 +1567,74 @@ void EffectProcessorChain::getStateInformation (MemoryBlock& destData)
 
     const ScopedSuspend ss (*this);
 
+    if (stateFormat == StateFormat::json)
+        writeStateAsJSON (destData);
+    else
+        writeStateAsBinary (destData);
+}
+
+void EffectProcessorChain::writeStateAsBinary (MemoryBlock& destData)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    /** The layout, where every number is little endian:
+
+        - uint32 magic number, int version
+        - bool chain bypass, int number of effects
+        - Per effect:
+            - int metadata size, followed by the metadata:
+                - string plugin description XML, string name
+                - bool bypass, float mix level, bool parallel
+                - string window bounds, int metering mode
+            - bool compressed, int64 decoded state size
+            - int encoded state size, followed by the encoded plugin state
+
+        NB: The sizes are there so that a newer version can append fields
+            to the metadata, and so that the states can be read without being decoded.
+    */
+    MemoryOutputStream mos (destData, false);
+    mos.writeInt ((int) chainBinary::magicNumber);
+    mos.writeInt (chainBinary::currentVersion);
+    mos.writeBool (isBypassed());
+    mos.writeInt (effects.size());
+
+    MemoryOutputStream metadata (1024);
+
+    for (auto effect : effects)
+    {
+        metadata.reset();
+
+        const auto descriptionXml = [&]()
+        {
+            if (auto xml = effect->description.createXml())
+                return xml->toString (XmlElement::TextFormat().withoutHeader().singleLine());
+
+            return String();
+        }();
+
+        metadata.writeString (descriptionXml);
+        metadata.writeString (effect->getName());
+        metadata.writeBool (effect->isBypassed());
+        metadata.writeFloat (effect->getMixLevel());
+        metadata.writeBool (effect->isProcessedInParallel());
+        metadata.writeString (effect->windowBounds.toString());
+        metadata.writeInt (static_cast<int> (getMeteringMode (indexOf (effect)).value_or (MeteringMode::peak)));
+
+        mos.writeInt ((int) metadata.getDataSize());
+        mos.write (metadata.getData(), metadata.getDataSize());
+
+        const auto& encodedState = getEncodedState (*effect);
+        mos.writeBool (encodedState.compressed);
+        mos.writeInt64 (encodedState.decodedSize);
+        mos.writeInt ((int) encodedState.data.getSize());
+        mos.write (encodedState.data.getData(), encodedState.data.getSize());
+    }
+}
+
+void EffectProcessorChain::writeStateAsJSON (MemoryBlock& destData)
+{
+    SQUAREPINE_CRASH_TRACER
+
     DynamicObject obj;
     obj.setProperty (chainIds::bypassedId, isBypassed());
 
@@ -563,6 +1678,7 @@ var EffectProcessorChain::toJSON (EffectProcessor::Ptr effect) const
     obj->setProperty (chainIds::nameId,         effect->getName());
     obj->setProperty (chainIds::bypassedId,     effect->isBypassed());
     obj->setProperty (chainIds::mixLevelId,     effect->getMixLevel());
+    obj->setProperty (chainIds::parallelId,     effect->isProcessedInParallel());
     obj->setProperty (chainIds::windowBoundsId, effect->windowBounds.toString());
 
     if (auto meteringMode = getMeteringMode (indexOf (effect)); meteringMode.has_value())
@@ -579,6 +1695,14 @@ var EffectProcessorChain::toJSON (EffectProcessor::Ptr effect) const
         if (! data.isEmpty())
             obj->setProperty (chainIds::stateId, Base64::toBase64 (data.getData(), data.getSize()));
     }
+    else
+    {
+        // NB: Keeps the state of effects that are missing or still loading.
+        const auto data = effect->getLastState();
+
+        if (! data.isEmpty())
+            obj->setProperty (chainIds::stateId, Base64::toBase64 (data.getData(), data.getSize()));
+    }
 
     return obj;
 }
@@ -606,6 +1730,66 @@ void EffectProcessorChain::setStateInformation (const void* const data, const in
     releaseResources();
     clear();
 
+    const auto isBinary = sizeInBytes >= (int) sizeof (uint32)
+                          && ByteOrder::littleEndianInt (data) == chainBinary::magicNumber;
+
+    if (isBinary)
+        readStateFromBinary (data, sizeInBytes);
+    else
+        readStateFromJSON (data, sizeInBytes);
+
+    updateLatency();
+    rebuildProcessingPlan();
+    updateHostDisplay();
+}
+
+void EffectProcessorChain::readStateFromBinary (const void* const data, const int sizeInBytes)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    MemoryInputStream mis (data, (size_t) sizeInBytes, false);
+    mis.skipNextBytes (sizeof (uint32));
+
+    if (const auto version = mis.readInt(); version > chainBinary::currentVersion)
+    {
+        Logger::writeToLog ("EffectProcessorChain: state is from a newer version (" + String (version) + "), attempting to read it anyway...");
+        jassertfalse;
+    }
+
+    const auto shouldBypass = mis.readBool();
+    Logger::writeToLog ("EffectProcessorChain: setting state bypassing to \"" + toLowerCase (booleanToString (shouldBypass)) + "\".");
+    setBypassed (shouldBypass);
+
+    const auto numEffects = mis.readInt();
+
+    for (int i = 0; i < numEffects && ! mis.isExhausted(); ++i)
+    {
+        MemoryBlock metadata;
+        const auto metadataSize = mis.readInt();
+
+        if (metadataSize < 0 || mis.readIntoMemoryBlock (metadata, metadataSize) != (size_t) metadataSize)
+            break;
+
+        EffectProcessor::EncodedState encodedState;
+        encodedState.compressed = mis.readBool();
+        encodedState.decodedSize = mis.readInt64();
+
+        const auto stateSize = mis.readInt();
+
+        if (stateSize < 0 || mis.readIntoMemoryBlock (encodedState.data, stateSize) != (size_t) stateSize)
+            break;
+
+        appendEffectFromBinary (metadata, std::move (encodedState));
+    }
+
+    if (getNumEffects() != numEffects)
+        Logger::writeToLog ("EffectProcessorChain: restored " + String (getNumEffects()) + " of " + String (numEffects) + " effects.");
+}
+
+void EffectProcessorChain::readStateFromJSON (const void* const data, const int sizeInBytes)
+{
+    SQUAREPINE_CRASH_TRACER
+
     var stateVar;
 
     {
@@ -628,10 +1812,80 @@ void EffectProcessorChain::setStateInformation (const void* const data, const in
         if (auto effectsVar = stateVar[chainIds::effectsId].getArray())
             for (const auto& effectState : *effectsVar)
                 appendEffectFromJSON (effectState);
+}
 
+//==============================================================================
+EffectProcessor::Ptr EffectProcessorChain::appendEffect (const PluginDescription& description)
+{
+    SQUAREPINE_CRASH_TRACER
 
-    updateLatency();
-    updateHostDisplay();
+    if (restoreStateAsynchronously)
+        return insertPlaceholder (-1, description, InsertionStyle::append);
+
+    auto newEffect = insertInternal (-1, description, InsertionStyle::append);
+
+    // It's fine if this is null because the user's system might simply
+    // not have the plugin available. This can happen when sharing projects
+    // across systems, the user could have updated the plugin which
+    // could have potentially changed the PluginDescription, etc...
+    if (newEffect != nullptr)
+    {
+        if (auto plugin = newEffect->plugin)
+        {
+            MemoryBlock data;
+            plugin->getStateInformation (data);
+            newEffect->setDefaultState (data);
+            Logger::writeToLog ("EffectProcessorChain: found default state for effect.");
+        }
+    }
+
+    return newEffect;
+}
+
+void EffectProcessorChain::finishAppendingEffect (EffectProcessor::Ptr newEffect)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    newEffect->reloadFromStateIfValid();
+
+    // NB: The state was stashed beforehand so the plugin can be restored in the background.
+    if (restoreStateAsynchronously)
+        startLoading (newEffect, nullptr, false);
+}
+
+bool EffectProcessorChain::appendEffectFromBinary (const MemoryBlock& metadata, EffectProcessor::EncodedState encodedState)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    MemoryInputStream mis (metadata, false);
+
+    PluginDescription description;
+    const auto xml = parseXML (mis.readString());
+
+    if (xml == nullptr || ! description.loadFromXml (*xml))
+    {
+        Logger::writeToLog ("EffectProcessorChain: error parsing PluginDescription...");
+        jassertfalse;
+        return false;
+    }
+
+    auto newEffect = appendEffect (description);
+    if (newEffect == nullptr)
+        return false;
+
+    newEffect->setName (mis.readString());
+    newEffect->setBypassed (mis.readBool());
+    newEffect->setMixLevel (mis.readFloat());
+    newEffect->setProcessedInParallel (mis.readBool());
+    newEffect->windowBounds = Rectangle<int>::fromString (mis.readString());
+    setMeteringMode (indexOf (newEffect), getMeteringModeFromState (mis.readInt()));
+
+    // NB: The state is kept encoded until the plugin needs it, and is saved as-is again until the plugin changes.
+    newEffect->encodedState = std::move (encodedState);
+    newEffect->stateChanged = true;
+
+    finishAppendingEffect (newEffect);
+    return true;
 }
 
 bool EffectProcessorChain::appendEffectFromJSON (const var& stateVar)
@@ -664,20 +1918,8 @@ bool EffectProcessorChain::appendEffectFromJSON (const var& stateVar)
         return false;
     }
 
-    if (auto newEffect = insertInternal (-1, description, InsertionStyle::append))
+    if (auto newEffect = appendEffect (description))
     {
-        // It's fine if this is null because the user's system might simply
-        // not have the plugin available. This can happen when sharing projects
-        // across systems, the user could have updated the plugin which
-        // could have potentially changed the PluginDescription, etc...
-        if (auto plugin = newEffect->plugin)
-        {
-            MemoryBlock data;
-            plugin->getStateInformation (data);
-            newEffect->setDefaultState (data);
-            Logger::writeToLog ("EffectProcessorChain: found default state for effect.");
-        }
-
         newEffect->setName (stateVar[chainIds::nameId].toString());
 
         if (stateVar.hasProperty (chainIds::mixLevelId))
@@ -690,6 +1932,10 @@ bool EffectProcessorChain::appendEffectFromJSON (const var& stateVar)
         else
             Logger::writeToLog ("EffectProcessorChain: missing bypass property...");
 
+        // NB: Older states won't have this, which is fine as they were entirely serial.
+        if (stateVar.hasProperty (chainIds::parallelId))
+            newEffect->setProcessedInParallel (static_cast<bool> (stateVar[chainIds::parallelId]));
+
         if (stateVar.hasProperty (chainIds::windowBoundsId))
             newEffect->windowBounds = Rectangle<int>::fromString (stateVar[chainIds::windowBoundsId].toString());
         else
@@ -699,8 +1945,7 @@ bool EffectProcessorChain::appendEffectFromJSON (const var& stateVar)
         {
             if (stateVar.hasProperty (chainIds::meteringModeId))
             {
-                const auto meteringModeInt = static_cast<int> (stateVar[chainIds::meteringModeId]);
-                return static_cast<MeteringMode> (meteringModeInt);
+                return getMeteringModeFromState (static_cast<int> (stateVar[chainIds::meteringModeId]));
             }
 
             return MeteringMode::peak;
@@ -726,8 +1971,7 @@ bool EffectProcessorChain::appendEffectFromJSON (const var& stateVar)
             jassertfalse;
         }
 
-        newEffect->reloadFromStateIfValid();
-
+        finishAppendingEffect (newEffect);
         return true;
     }
 
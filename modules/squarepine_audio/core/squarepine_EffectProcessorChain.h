@@ -1,7 +1,9 @@
 /** Contains an array of effect plugins that are processed in series.
 
     Unlike juce::AudioProcessorGraph, which can process connections in parallel,
-    this boils down the process serially.
+    this boils down the process serially. That being said, adjacent effects
+    can be grouped into parallel branches (see setProcessedInParallel),
+    which can be processed concurrently on a RealtimeWorkerPool.
     The main problem this class solves is to contain and simplify
     creating various plugin instances for them to be processed in series,
     with the option of controlling the mix level and bypass of each plugin independently.
@@ -13,6 +15,16 @@
     the latency may change, among other things. Use a juce::AudioProcessorListener
     to be notified of any such changes.
 
+    Any changes to the list of effects are published to the audio thread
+    as an immutable processing plan, which gets swapped in atomically at the
+    start of the next block. This means that adding, inserting, moving and removing
+    effects never locks or allocates on the audio thread, and that effects which
+    were removed are released on the message thread once the audio thread has let go of them.
+
+    Latency is compensated for: the dry signal of a partially mixed effect is delayed
+    to line up with the effect's output, and bypassed effects (or the chain itself, when bypassed)
+    delay the signal by the same amount the effect would have, so toggling bypass never shifts timing.
+
     EffectProcessorFactory is the main class that helps control creation of effect
     based AudioProcessor objects. This is absolutely necessary so as to be able to
     save and recall an EffectProcessorChain's state!
@@ -27,7 +39,9 @@
 
     @see EffectProcessor, EffectProcessorFactory
 */
-class EffectProcessorChain final : public InternalProcessor
+class EffectProcessorChain final : public InternalProcessor,
+                                   private AudioProcessorListener,
+                                   private AsyncUpdater
 {
 public:
     //==============================================================================
@@ -49,6 +63,9 @@ public:
     */
     EffectProcessorChain (EffectProcessorFactory::Ptr);
 
+    /** Destructor. */
+    ~EffectProcessorChain() override;
+
     //==============================================================================
     /** @returns the factory that this chain uses to create plugin instances. */
     [[nodiscard]] EffectProcessorFactory::Ptr getFactory() const { return factory; }
@@ -136,6 +153,157 @@ public:
     */
     EffectProcessor::Ptr replace (int destinationIndex, const String& fileOrIdentifier);
 
+    //==============================================================================
+    /** Adds a new effect at the end of the chain, loading its plugin in the background.
+
+        The effect is added right away, and simply passes its signal through
+        until the plugin has been created, prepared and swapped in, so none of
+        the other effects are interrupted. If the plugin fails to load, the effect is removed.
+
+        As for threading, the plugin is created however the factory's format creates
+        plugins asynchronously, and its saved state is decoded on a background thread.
+        Most plugin formats expect to be prepared and have their states restored
+        on the message thread though, so that's where it's done, unless its format
+        has been allowed on a background thread with setFormatsPreparedInBackground().
+        The effect is always swapped in, and released, on the message thread.
+
+        @param pluginIndex Plugin index within the KnownPluginList.
+
+        @returns the new effect, which will be nullptr if the index wasn't found.
+
+        @see onEffectLoaded, isLoading
+    */
+    EffectProcessor::Ptr addAsync (int pluginIndex);
+
+    /** Adds a new effect at the end of the chain, loading its plugin in the background.
+
+        @param fileOrIdentifier Plugin file or identifier within the KnownPluginList.
+
+        @see addAsync
+    */
+    EffectProcessor::Ptr addAsync (const String& fileOrIdentifier);
+
+    /** Inserts a new effect, loading its plugin in the background.
+
+        @param destinationIndex Destination in the index of the array of plugins.
+        @param pluginIndex      Plugin index within the KnownPluginList.
+
+        @see addAsync
+    */
+    EffectProcessor::Ptr insertAsync (int destinationIndex, int pluginIndex);
+
+    /** Inserts a new effect, loading its plugin in the background.
+
+        @param destinationIndex Destination in the index of the array of plugins.
+        @param fileOrIdentifier File or identifier that can be referenced within the KnownPluginList.
+
+        @see addAsync
+    */
+    EffectProcessor::Ptr insertAsync (int destinationIndex, const String& fileOrIdentifier);
+
+    /** Replaces an effect with a new one whose plugin is loaded in the background.
+
+        The existing effect keeps processing until the new one is ready,
+        at which point the new one takes its place. If the existing effect has been
+        removed in the meantime, or the plugin fails to load, the new one is discarded.
+
+        @param destinationIndex Index of the effect to replace.
+        @param pluginIndex      Plugin index within the KnownPluginList.
+
+        @returns the effect that will take the existing one's place,
+        which will be nullptr if the plugin wasn't found. If there's
+        no effect at the destination index, the new one is appended instead.
+
+        @see onEffectLoaded
+    */
+    EffectProcessor::Ptr replaceAsync (int destinationIndex, int pluginIndex);
+
+    /** Replaces an effect with a new one whose plugin is loaded in the background.
+
+        @param destinationIndex Index of the effect to replace.
+        @param fileOrIdentifier File or identifier that can be referenced within the KnownPluginList.
+
+        @see replaceAsync
+    */
+    EffectProcessor::Ptr replaceAsync (int destinationIndex, const String& fileOrIdentifier);
+
+    /** Called on the message thread once an effect's plugin has been loaded asynchronously,
+        with an error message if it failed to load.
+    */
+    std::function<void (EffectProcessor::Ptr, const String& error)> onEffectLoaded;
+
+    /** @returns the number of effects whose plugins are still being loaded. */
+    [[nodiscard]] int getNumEffectsLoading() const noexcept;
+
+    /** Sets whether setStateInformation() should load the effects' plugins asynchronously.
+
+        When enabled, the effects are restored right away with their plugins loading in the background,
+        many at once, and each one starts processing as soon as its plugin is ready.
+        Effects whose plugins fail to load are removed, as they would be when restoring synchronously.
+    */
+    void setRestoringStateAsynchronously (bool shouldRestoreAsynchronously) noexcept  { restoreStateAsynchronously = shouldRestoreAsynchronously; }
+
+    /** @returns true if setStateInformation() loads the effects' plugins asynchronously. */
+    [[nodiscard]] bool isRestoringStateAsynchronously() const noexcept                 { return restoreStateAsynchronously; }
+
+    /** Sets which plugin formats, by name, are safe to prepare and restore the states of on a background thread
+        when their plugins are loaded asynchronously. Plugins of any other format are prepared on the message thread.
+
+        This is empty by default, because the likes of VST3 and AudioUnit plugins
+        expect those calls on the message thread, and may crash or deadlock otherwise.
+        Only add a format if all of its plugins are known to cope, like your own internal ones.
+
+        @see PluginDescription::pluginFormatName, addAsync
+    */
+    void setFormatsPreparedInBackground (const StringArray& formatNames)               { formatsPreparedInBackground = formatNames; }
+
+    /** @returns the names of the plugin formats which are prepared on a background thread when loaded asynchronously. */
+    [[nodiscard]] const StringArray& getFormatsPreparedInBackground() const noexcept   { return formatsPreparedInBackground; }
+
+    //==============================================================================
+    /** The formats getStateInformation() can save the chain's state in.
+
+        setStateInformation() accepts either one, regardless of this setting.
+    */
+    enum class StateFormat
+    {
+        /** A compact, chunked binary format.
+
+            Each effect's plugin state is stored as-is rather than Base64 encoded,
+            and is only fetched from the plugin again if the plugin has reported
+            a change since the last save. Restoring the state only decodes
+            a plugin's state when the plugin is actually loaded.
+        */
+        binary,
+
+        /** The human-readable JSON format, for importing and exporting chains. */
+        json
+    };
+
+    /** Changes the format getStateInformation() saves in. The default is StateFormat::binary. */
+    void setStateFormat (StateFormat newFormat) noexcept    { stateFormat = newFormat; }
+
+    /** @returns the format getStateInformation() saves in. */
+    [[nodiscard]] StateFormat getStateFormat() const noexcept { return stateFormat; }
+
+    /** Sets whether the plugin states are compressed when saving in the binary format.
+
+        This can considerably shrink the plugins that save uncompressed data
+        (eg: XML or raw parameter arrays) at the cost of some time when saving.
+        States that don't get any smaller are stored uncompressed.
+    */
+    void setStateCompressionEnabled (bool shouldCompress);
+
+    /** @returns true if the plugin states are compressed when saving in the binary format. */
+    [[nodiscard]] bool isStateCompressionEnabled() const noexcept { return compressStates; }
+
+    /** Forces every plugin's state to be fetched again the next time the chain's state is saved.
+
+        The binary format relies on plugins reporting their changes,
+        so call this for any plugins known not to do so reliably.
+    */
+    void invalidateCachedStates();
+
     //==============================================================================
     /** Move a plugin to a specified index.
 
@@ -193,6 +361,63 @@ public:
     */
     bool setMixLevel (int index, float mixLevel);
 
+    /** Sets whether a contained effect is processed in parallel with the effect before it.
+
+        A run of effects flagged like this forms a parallel group with the effect
+        that precedes the run, where each effect is a branch of the group.
+        Every branch is fed the same signal, and the outputs of the branches
+        are summed once they are all done. Branches with differing latencies
+        are delayed so that they line up at the sum.
+
+        Each branch gets its own copy of the MIDI too, and the MIDI the branches output
+        is merged once they're done, where any message that several branches passed through
+        is only kept once.
+
+        The branches are processed concurrently when a worker pool is provided
+        (see setWorkerPool), and one after the other otherwise.
+
+        @param index            Index within the array of effects.
+        @param shouldBeParallel Set to true to process the effect in parallel with the one before it.
+
+        @returns true if the action changed anything.
+    */
+    bool setProcessedInParallel (int index, bool shouldBeParallel);
+
+    //==============================================================================
+    /** Sets the pool used to process the branches of parallel groups.
+
+        The same pool can be shared between many chains, or be used
+        to render many chains at once with processConcurrently().
+        Passing in nullptr processes any branches on the audio thread.
+    */
+    void setWorkerPool (std::shared_ptr<RealtimeWorkerPool>);
+
+    /** @returns the pool used to process the branches of parallel groups, if any. */
+    [[nodiscard]] std::shared_ptr<RealtimeWorkerPool> getWorkerPool() const { return workerPool; }
+
+    /** Renders several independent chains at once, sharing them out across the pool.
+
+        This is meant for offline rendering, where each chain is expected to have been
+        set to non-realtime processing beforehand (see setNonRealtime).
+        Each chain is processed with the buffers at the same index.
+
+        Any parallel groups within the chains that use the same pool are simply
+        processed on whichever thread is rendering the chain.
+    */
+    static void processConcurrently (RealtimeWorkerPool&,
+                                     const Array<EffectProcessorChain*>& chains,
+                                     const Array<juce::AudioBuffer<float>*>& buffers,
+                                     const Array<MidiBuffer*>& midiBuffers);
+
+    /** Renders several independent chains at once, sharing them out across the pool.
+
+        @see processConcurrently
+    */
+    static void processConcurrently (RealtimeWorkerPool&,
+                                     const Array<EffectProcessorChain*>& chains,
+                                     const Array<juce::AudioBuffer<double>*>& buffers,
+                                     const Array<MidiBuffer*>& midiBuffers);
+
     //==============================================================================
     /** Obtain the name of a plugin that exists within the array of effects.
 
@@ -234,6 +459,13 @@ public:
     */
     [[nodiscard]] std::optional<bool> isBypassed (int index) const;
 
+    /** @returns true if the effect at the specified index is processed in parallel
+        with the effect before it, {} otherwise.
+
+        @see setProcessedInParallel
+    */
+    [[nodiscard]] std::optional<bool> isProcessedInParallel (int index) const;
+
     /** @returns the mix level of the effect at the specified index (normalised, 0.0f to 1.0f).
         This will return {} if the index is out of range.
     */
@@ -261,6 +493,12 @@ public:
     */
     void getChannelLevels (int index, Array<double>& destData);
 
+    /** @returns the transport that the levels of the effect at the provided index
+        are published to, which can be polled without locking or allocating (eg: by a Meter).
+        This stays valid for as long as the chain is alive.
+    */
+    [[nodiscard]] const MeterSnapshotTransport* getSnapshotTransport (int index) const;
+
     /** Changes the mode of analysis for the audio levels for the
         particular effect at the provided index.
 
@@ -285,9 +523,26 @@ public:
 
         @note This will bypass the entire effect chain until the action of
               attempting to load a plugin is complete!
+
+        @see loadIfMissingAsync
     */
     bool loadIfMissing (int index);
 
+    /** Attempt loading an effect's plugin instance in the background if it is known to be missing.
+
+        Unlike loadIfMissing(), the rest of the chain carries on processing whilst
+        the plugin loads, and the effect passes its signal through until it's ready.
+        If the plugin fails to load, the effect is left as missing.
+
+        @returns true if the plugin has started loading.
+
+        @see onEffectLoaded
+    */
+    bool loadIfMissingAsync (int index);
+
+    /** @returns true if the effect's plugin is still being loaded asynchronously, {} otherwise. */
+    [[nodiscard]] std::optional<bool> isLoading (int index) const;
+
     //==============================================================================
     using InternalProcessor::isBypassed;
 
@@ -333,29 +588,93 @@ private:
     {
         using Buffer = juce::AudioBuffer<FloatType>;
 
-        void clear() noexcept
-        {
-            for (auto& buff : buffers)
-                buff->clear();
-        }
-
+        /** Only ever grows the buffers, so this is a no-op once prepared for the largest block. */
         void prepare (int numChans, int numSamps)
         {
+            if (numChans <= numChannels && numSamps <= numSamples)
+                return;
+
             numChannels = std::max (numChannels, numChans);
             numSamples = std::max (numSamples, numSamps);
 
-            for (auto& buff : buffers)
+            for (auto* buff : { &mixingBuffer, &dryBuffer })
             {
                 buff->setSize (numChannels, numSamples, false, false, true);
                 buff->clear();
             }
+
+            mixRamp.resize ((size_t) numSamples);
         }
 
         int numChannels = 0, numSamples = 0;
-        Buffer mixingBuffer, effectBuffer, lastBuffer;
-        std::array<Buffer*, 3> buffers = { &mixingBuffer, &effectBuffer, &lastBuffer };
+        Buffer mixingBuffer, dryBuffer;     // The running signal, and a copy of it for partial mixes.
+        std::vector<FloatType> mixRamp;     // Per-sample mix levels, for when a mix level is changing.
+    };
+
+    //==============================================================================
+    /** An immutable snapshot of the chain, with everything the audio thread
+        needs already resolved so that it never has to search or copy the effects.
+    */
+    struct ProcessingPlan final
+    {
+        struct Step final
+        {
+            EffectProcessor* effect = nullptr;
+            AudioPluginInstance* plugin = nullptr;
+            LevelsProcessor* levels = nullptr;
+            EffectProcessor::DelayLines* delays = nullptr;
+            bool isLoading = false;     // Loading effects pass their signal through.
+        };
+
+        /** The scratch space needed for each branch of a parallel group. */
+        template<typename FloatType>
+        struct Branch final
+        {
+            juce::AudioBuffer<FloatType> working, dry;
+            std::vector<FloatType> mixRamp;
+            MidiBuffer midi;
+            int latency = 0;
+        };
+
+        template<typename FloatType>
+        [[nodiscard]] DelayCompensator<FloatType>* getBypassDelay() const noexcept
+        {
+            if constexpr (std::is_same_v<FloatType, float>)
+                return floatBypassDelay.get();
+            else
+                return doubleBypassDelay.get();
+        }
+
+        template<typename FloatType>
+        [[nodiscard]] std::vector<Branch<FloatType>>& getBranches() noexcept
+        {
+            if constexpr (std::is_same_v<FloatType, float>)
+                return floatBranches;
+            else
+                return doubleBranches;
+        }
+
+        ContainerType effects;                  // Keeps the effects alive for as long as the plan is.
+        std::vector<AudioPluginPtr> plugins;    // Keeps the plugins alive, even if an effect's plugin gets replaced.
+        std::vector<std::shared_ptr<EffectProcessor::DelayLines>> delayLines; // Likewise, as these get replaced when resized.
+        std::shared_ptr<DelayCompensator<float>> floatBypassDelay;
+        std::shared_ptr<DelayCompensator<double>> doubleBypassDelay;
+        std::shared_ptr<RealtimeWorkerPool> workerPool;
+        std::vector<Step> steps;
+        std::vector<Range<int>> groups;         // Ranges of steps, where any range longer than 1 is a parallel group.
+        std::vector<Branch<float>> floatBranches;
+        std::vector<Branch<double>> doubleBranches;
+        int maxBranchChannels = 0, maxBranchSamples = 0;
+
+        // NB: Where the branches' MIDI is merged, which then trades places with the chain's MIDI.
+        MidiBuffer mergedMidi;
+        std::vector<MidiBufferIterator> midiCursors;                // One per branch, for the merge.
+        std::vector<std::pair<MidiMessageMetadata, int>> midiAtSample; // The events kept at the current sample, and their branches.
     };
 
+    class PlanReclaimer;
+    class AsyncLoader;
+
     //==============================================================================
     EffectProcessorFactory::Ptr factory;
     std::atomic<int> requiredChannels { 0 };
@@ -364,6 +683,23 @@ private:
     ContainerType effects;
     OwnedArray<LevelsProcessor> effectLevels;
 
+    static constexpr double mixRampLengthSeconds = 0.05;
+    static constexpr int maxRetiredPlans = 32;
+    static constexpr size_t maxMidiEventsPerSample = 256;
+    std::atomic<ProcessingPlan*> pendingPlan { nullptr };   // Published by the message thread.
+    ProcessingPlan* activePlan = nullptr;                   // Only touched by the audio thread.
+    AbstractFifo retiredPlanFifo { maxRetiredPlans };
+    std::array<ProcessingPlan*, maxRetiredPlans> retiredPlans {};
+    std::unique_ptr<PlanReclaimer> planReclaimer;
+    std::shared_ptr<DelayCompensator<float>> floatBypassDelay;
+    std::shared_ptr<DelayCompensator<double>> doubleBypassDelay;
+    std::shared_ptr<RealtimeWorkerPool> workerPool;
+    std::shared_ptr<AsyncLoader> asyncLoader;
+    bool restoreStateAsynchronously = false;
+    StringArray formatsPreparedInBackground;
+    StateFormat stateFormat = StateFormat::binary;
+    bool compressStates = false;
+
     //==============================================================================
     enum class InsertionStyle
     {
@@ -373,9 +709,27 @@ private:
     };
 
     void updateLatency();
+    [[nodiscard]] int getNumProcessingChannels() const;
+    [[nodiscard]] std::vector<Range<int>> getProcessingGroups() const;
+    void updateDelayCompensation (bool forceReallocation);
+    void prepareDelayCompensation (EffectProcessor&, int alignmentLatency, bool forceReallocation);
+    void prepareBypassCompensation (bool forceReallocation);
+    void attachTo (EffectProcessor::Ptr);
+    void detachFrom (EffectProcessor::Ptr);
+    void rebuildProcessingPlan();
+    void reclaimRetiredPlans();
+    [[nodiscard]] ProcessingPlan* acquireProcessingPlan() noexcept;
     [[nodiscard]] int getNumRequiredChannels() const;
     [[nodiscard]] var toJSON (EffectProcessor::Ptr) const;
     bool appendEffectFromJSON (const var&);
+    void writeStateAsJSON (MemoryBlock&);
+    void writeStateAsBinary (MemoryBlock&);
+    void readStateFromJSON (const void*, int);
+    void readStateFromBinary (const void*, int);
+    bool appendEffectFromBinary (const MemoryBlock& metadata, EffectProcessor::EncodedState);
+    [[nodiscard]] EffectProcessor::Ptr appendEffect (const PluginDescription&);
+    void finishAppendingEffect (EffectProcessor::Ptr);
+    [[nodiscard]] const EffectProcessor::EncodedState& getEncodedState (EffectProcessor&);
     [[nodiscard]] bool setEffectProperty (int index, std::function<void (EffectProcessor::Ptr)>);
 
     template<typename FloatType>
@@ -383,12 +737,39 @@ private:
 
     template<typename FloatType>
     void processInternal (juce::AudioBuffer<FloatType>& source, MidiBuffer&,
-                          BufferPackage<FloatType>&,
+                          BufferPackage<FloatType>&, ProcessingPlan&,
                           int sourceNumChannels, int maxNumChannels, int numSamples);
 
+    [[nodiscard]] static int getStepLatency (const ProcessingPlan::Step&) noexcept;
+
+    template<typename FloatType>
+    static void processStep (const ProcessingPlan::Step&,
+                             juce::AudioBuffer<FloatType>& working, juce::AudioBuffer<FloatType>& dry,
+                             std::vector<FloatType>& mixRamp, MidiBuffer&,
+                             int numChannels, int numSamples, int alignmentLatency);
+
+    template<typename FloatType>
+    static void processParallelGroup (ProcessingPlan&, Range<int> group,
+                                      juce::AudioBuffer<FloatType>& working,
+                                      BufferPackage<FloatType>&, MidiBuffer&,
+                                      int numChannels, int numSamples);
+
+    template<typename FloatType>
+    static void mergeBranchMidi (ProcessingPlan&, const std::vector<ProcessingPlan::Branch<FloatType>>&,
+                                 int numBranches, MidiBuffer&);
+
     template<typename Type>
     [[nodiscard]] EffectProcessor::Ptr insertInternal (int destinationIndex, const Type& valueOrRef, InsertionStyle insertionStyle = InsertionStyle::insert);
 
+    template<typename Type>
+    EffectProcessor::Ptr insertAsyncInternal (int destinationIndex, const Type& valueOrRef, InsertionStyle insertionStyle = InsertionStyle::insert);
+
+    EffectProcessor::Ptr insertPlaceholder (int destinationIndex, const PluginDescription&, InsertionStyle);
+    void startLoading (EffectProcessor::Ptr, EffectProcessor::Ptr effectToReplace, bool keepIfFailed);
+    void finishLoading (EffectProcessor::Ptr, EffectProcessor::Ptr effectToReplace, AudioPluginPtr,
+                        const MemoryBlock& defaultState, double preparedSampleRate, int preparedBlockSize,
+                        bool keepIfFailed, const String& error);
+
     template<typename Type>
     std::optional<Type> getEffectProperty (int index, std::function<Type (EffectProcessor::Ptr)> func) const
     {
@@ -412,6 +793,14 @@ private:
                     (plugin->*function)();
     }
 
+    //==============================================================================
+    /** @internal */
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override { }
+    /** @internal */
+    void audioProcessorChanged (AudioProcessor*, const ChangeDetails&) override;
+    /** @internal */
+    void handleAsyncUpdate() override;
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EffectProcessorChain)
 };
@@ -60,10 +60,18 @@ void EffectProcessorFactory::createPluginAsync (const PluginDescription& descrip
     SQUAREPINE_CRASH_TRACER
 
     if (description.isInstrument)
+    {
+        if (callback != nullptr)
+            callback (nullptr, NEEDS_TRANS ("Instruments can't be used as effects."));
+
         return;
+    }
+
+    Logger::writeToLog ("EffectProcessorFactory: creating plugin asynchronously " + description.createIdentifierString());
 
-   audioPluginFormatManager.createPluginInstanceAsync (description, 44100.0, 256,
-            [&] (std::unique_ptr<AudioPluginInstance> api, const String& s)
+    // NB: The callback is copied in since this returns long before the plugin is created.
+    audioPluginFormatManager.createPluginInstanceAsync (description, 44100.0, 256,
+            [callback] (std::unique_ptr<AudioPluginInstance> api, const String& s)
             {
                 if (callback != nullptr)
                     callback (std::move (api), s);
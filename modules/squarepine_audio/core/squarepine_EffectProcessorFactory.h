@@ -51,7 +51,7 @@ public:
     [[nodiscard]] AudioPluginPtr createPlugin (const PluginDescription&) const;
 
     //==============================================================================
-    /** */
+    /** Called on the message thread with the new plugin, or with nullptr and an error message. */
     using PluginCreationCallback = std::function<void (AudioPluginPtr, const String&)>;
 
     /** */
@@ -0,0 +1,159 @@
+/** Hands the latest measured levels of a number of channels from an audio thread
+    to any reader thread (eg: the message thread), without locking or allocating.
+
+    The writer publishes a whole snapshot at a time, and readers only ever see
+    complete snapshots: if a snapshot was being written while it was read,
+    the read is simply reported as having failed so the reader can keep
+    its previous values until the next poll.
+
+    There must only be a single writer, but there may be any number of readers.
+    All of the storage is fixed, so the audio thread never touches an Array
+    or the heap.
+
+    @see LevelsProcessor, Meter
+*/
+class MeterSnapshotTransport final
+{
+public:
+    /** Constructor. */
+    MeterSnapshotTransport() = default;
+
+    //==============================================================================
+    /** The largest number of channels a snapshot can hold. */
+    static constexpr int maxNumChannels = 64;
+
+    /** The measured levels of a single channel, as absolute gain values. */
+    struct ChannelLevels final
+    {
+        float peak = 0.0f,
+              rms = 0.0f,
+              truePeak = 0.0f;
+    };
+
+    /** The lowest loudness that's reported, in LUFS. */
+    static constexpr float minimumLoudness = -100.0f;
+
+    /** The loudness of all of the channels together, in LUFS. */
+    struct Loudness final
+    {
+        float momentary = minimumLoudness,
+              shortTerm = minimumLoudness,
+              integrated = minimumLoudness;
+    };
+
+    /** A consistent copy of the published levels. */
+    struct Snapshot final
+    {
+        std::array<ChannelLevels, maxNumChannels> channels;
+        int numChannels = 0;
+        Loudness loudness;
+        uint32 sequenceNumber = 0;  // Increments with every published snapshot.
+    };
+
+    //==============================================================================
+    /** Publishes a new snapshot. This is meant to be called from the audio thread.
+
+        Any channels beyond maxNumChannels are ignored.
+    */
+    void publish (const ChannelLevels* levels, int numChannels, const Loudness& loudness = {}) noexcept
+    {
+        jassert (levels != nullptr || numChannels <= 0);
+
+        numChannels = jlimit (0, maxNumChannels, numChannels);
+
+        // NB: An odd sequence means the snapshot is being written.
+        const auto sequence = writeSequence.load (std::memory_order_relaxed);
+        writeSequence.store (sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        for (int i = 0; i < numChannels; ++i)
+        {
+            auto& dest = channels[(size_t) i];
+            dest.peak.store (levels[i].peak, std::memory_order_relaxed);
+            dest.rms.store (levels[i].rms, std::memory_order_relaxed);
+            dest.truePeak.store (levels[i].truePeak, std::memory_order_relaxed);
+        }
+
+        momentary.store (loudness.momentary, std::memory_order_relaxed);
+        shortTerm.store (loudness.shortTerm, std::memory_order_relaxed);
+        integrated.store (loudness.integrated, std::memory_order_relaxed);
+        numPublishedChannels.store (numChannels, std::memory_order_relaxed);
+        writeSequence.store (sequence + 2, std::memory_order_release);
+    }
+
+    /** Publishes a snapshot where every channel is silent. */
+    void publishSilence (int numChannels) noexcept
+    {
+        const std::array<ChannelLevels, maxNumChannels> silence {};
+        publish (silence.data(), numChannels);
+    }
+
+    //==============================================================================
+    /** Copies the latest snapshot into the destination.
+
+        @returns false if no consistent snapshot could be read, in which case
+                 the destination is left untouched. This only happens if
+                 the writer keeps publishing while trying to read.
+    */
+    bool read (Snapshot& destination) const noexcept
+    {
+        for (int attempt = 0; attempt < maxReadAttempts; ++attempt)
+        {
+            const auto before = writeSequence.load (std::memory_order_acquire);
+
+            if ((before & 1) != 0)
+                continue;
+
+            const auto numChannels = numPublishedChannels.load (std::memory_order_relaxed);
+            std::array<ChannelLevels, maxNumChannels> temp;
+
+            for (int i = 0; i < numChannels; ++i)
+            {
+                const auto& source = channels[(size_t) i];
+                temp[(size_t) i] = { source.peak.load (std::memory_order_relaxed),
+                                     source.rms.load (std::memory_order_relaxed),
+                                     source.truePeak.load (std::memory_order_relaxed) };
+            }
+
+            const Loudness loudness { momentary.load (std::memory_order_relaxed),
+                                      shortTerm.load (std::memory_order_relaxed),
+                                      integrated.load (std::memory_order_relaxed) };
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            if (writeSequence.load (std::memory_order_relaxed) == before)
+            {
+                std::copy_n (temp.begin(), numChannels, destination.channels.begin());
+                destination.numChannels = numChannels;
+                destination.loudness = loudness;
+                destination.sequenceNumber = before / 2;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /** @returns the number of snapshots published so far.
+        Readers can compare this against their last Snapshot::sequenceNumber
+        to skip any work when nothing has changed.
+    */
+    [[nodiscard]] uint32 getSequenceNumber() const noexcept { return writeSequence.load (std::memory_order_acquire) / 2; }
+
+private:
+    //==============================================================================
+    static constexpr int maxReadAttempts = 8;
+
+    struct AtomicChannelLevels final
+    {
+        std::atomic<float> peak { 0.0f }, rms { 0.0f }, truePeak { 0.0f };
+    };
+
+    std::array<AtomicChannelLevels, maxNumChannels> channels;
+    std::atomic<float> momentary { minimumLoudness }, shortTerm { minimumLoudness }, integrated { minimumLoudness };
+    std::atomic<int> numPublishedChannels { 0 };
+    std::atomic<uint32> writeSequence { 0 };
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterSnapshotTransport)
+};
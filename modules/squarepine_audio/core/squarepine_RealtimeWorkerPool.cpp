@@ -0,0 +1,126 @@
+//==============================================================================
+class RealtimeWorkerPool::Worker final : public Thread
+{
+public:
+    Worker (RealtimeWorkerPool& p, int index) :
+        Thread ("RealtimeWorker" + String (index)),
+        pool (p)
+    {
+        startThread (Priority::highest);
+    }
+
+    ~Worker() override
+    {
+        signalThreadShouldExit();
+        wakeUp.signal();
+        stopThread (1000);
+    }
+
+    void wakeIfSleeping() noexcept
+    {
+        if (sleeping.load (std::memory_order_acquire))
+            wakeUp.signal();
+    }
+
+private:
+    static constexpr int numSpinsBeforeSleeping = 20000;
+
+    RealtimeWorkerPool& pool;
+    WaitableEvent wakeUp;
+    std::atomic<bool> sleeping { false };
+
+    void run() override
+    {
+        auto lastGenerationSeen = pool.getCurrentGeneration();
+        int numSpins = 0;
+
+        while (! threadShouldExit())
+        {
+            const auto generation = pool.getCurrentGeneration();
+
+            if (generation != lastGenerationSeen)
+            {
+                lastGenerationSeen = generation;
+                pool.performTasks (generation);
+                numSpins = 0;
+                continue;
+            }
+
+            if (++numSpins < numSpinsBeforeSleeping)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            sleeping.store (true, std::memory_order_release);
+
+            // NB: Checking again after announcing the nap avoids missing a wake-up
+            //     from a batch that was published in the meantime.
+            if (pool.getCurrentGeneration() == lastGenerationSeen)
+                wakeUp.wait (100);
+
+            sleeping.store (false, std::memory_order_release);
+            numSpins = 0;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+//==============================================================================
+RealtimeWorkerPool::RealtimeWorkerPool (int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add (new Worker (*this, i));
+}
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    workers.clear();
+}
+
+//==============================================================================
+uint32 RealtimeWorkerPool::getCurrentGeneration() const noexcept
+{
+    return static_cast<uint32> ((taskCounter.load (std::memory_order_acquire) >> generationShift) & generationMask);
+}
+
+bool RealtimeWorkerPool::claimTask (uint32 generation, int& index) noexcept
+{
+    auto current = taskCounter.load (std::memory_order_acquire);
+
+    for (;;)
+    {
+        if (static_cast<uint32> ((current >> generationShift) & generationMask) != generation)
+            return false;
+
+        const auto next = current & taskMask;
+        if (next >= ((current >> limitShift) & taskMask))
+            return false;
+
+        if (taskCounter.compare_exchange_weak (current, current + 1,
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_acquire))
+        {
+            index = static_cast<int> (next);
+            return true;
+        }
+    }
+}
+
+void RealtimeWorkerPool::performTasks (uint32 generation) noexcept
+{
+    int index = 0;
+
+    while (claimTask (generation, index))
+    {
+        invoker (context, index);
+        numTasksRemaining.fetch_sub (1, std::memory_order_acq_rel);
+    }
+}
+
+void RealtimeWorkerPool::wakeSleepingWorkers() noexcept
+{
+    for (auto* worker : workers)
+        worker->wakeIfSleeping();
+}
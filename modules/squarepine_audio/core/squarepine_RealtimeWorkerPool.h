@@ -0,0 +1,112 @@
+/** A small pool of worker threads that can share out a batch of tasks
+    from the audio thread, without locking or allocating while doing so.
+
+    Unlike juce::ThreadPool, no jobs are created or queued: the calling thread
+    publishes a batch of task indices, helps process them, and then waits for
+    any stragglers before returning.
+
+    Idle workers spin briefly before going to sleep, so back-to-back audio blocks
+    normally find them awake. Waking up a sleeping worker is the only point where
+    an OS call is made, and that only happens after a worker has been idle for a while.
+
+    Only one batch can be in flight at a time. Calling run() while a batch is already
+    running (eg: from within a task, or from another thread) simply processes
+    the tasks in place on the calling thread, which makes nesting safe.
+
+    @see EffectProcessorChain
+*/
+class RealtimeWorkerPool final
+{
+public:
+    /** Creates a pool with the given number of worker threads.
+
+        The thread calling run() always takes part in the work, so a pool of
+        N workers can process N + 1 tasks at once.
+    */
+    explicit RealtimeWorkerPool (int numWorkers = std::max (0, SystemStats::getNumCpus() - 1));
+
+    /** Destructor, which stops all of the workers. */
+    ~RealtimeWorkerPool();
+
+    //==============================================================================
+    /** @returns the number of worker threads, excluding the calling thread. */
+    [[nodiscard]] int getNumWorkers() const noexcept { return workers.size(); }
+
+    /** Calls the callable for each task index in [0, numTasks),
+        sharing the work between the workers and the calling thread.
+
+        This blocks until all of the tasks are done.
+
+        @param numTasks The number of tasks in the batch.
+        @param callable Something that can be called as `void (int taskIndex)`.
+                        It must be safe to call it from multiple threads at once.
+    */
+    template<typename Callable>
+    void run (int numTasks, Callable&& callable)
+    {
+        if (numTasks <= 0)
+            return;
+
+        if (workers.isEmpty()
+            || numTasks == 1
+            || busy.exchange (true, std::memory_order_acquire))
+        {
+            for (int i = 0; i < numTasks; ++i)
+                callable (i);
+
+            return;
+        }
+
+        using CallableType = std::remove_reference_t<Callable>;
+
+        context = const_cast<void*> (static_cast<const void*> (std::addressof (callable)));
+        invoker = [] (void* c, int index) { (*static_cast<CallableType*> (c)) (index); };
+
+        jassert (numTasks <= (int) taskMask);
+
+        const auto generation = (lastGeneration + 1) & generationMask;
+        lastGeneration = generation;
+
+        numTasksRemaining.store (numTasks, std::memory_order_relaxed);
+        taskCounter.store ((static_cast<uint64> (generation) << generationShift)
+                           | (static_cast<uint64> (numTasks) << limitShift),
+                           std::memory_order_release);
+
+        wakeSleepingWorkers();
+        performTasks (generation);
+
+        while (numTasksRemaining.load (std::memory_order_acquire) > 0)
+            std::this_thread::yield();
+
+        busy.store (false, std::memory_order_release);
+    }
+
+private:
+    //==============================================================================
+    class Worker;
+
+    OwnedArray<Worker> workers;
+    std::atomic<bool> busy { false };
+
+    // The task counter packs the batch's generation, its number of tasks, and the next task index.
+    // Claiming a task requires the generation to still match, so a late worker
+    // can never pick up a task from a batch it didn't wake up for.
+    static constexpr int generationShift = 48, limitShift = 24;
+    static constexpr uint64 generationMask = 0xffff, taskMask = 0xffffff;
+
+    std::atomic<uint64> taskCounter { 0 };
+    std::atomic<int> numTasksRemaining { 0 };
+    uint64 lastGeneration = 0;
+
+    void* context = nullptr;
+    void (*invoker) (void*, int) = nullptr;
+
+    //==============================================================================
+    [[nodiscard]] uint32 getCurrentGeneration() const noexcept;
+    [[nodiscard]] bool claimTask (uint32 generation, int& index) noexcept;
+    void performTasks (uint32 generation) noexcept;
+    void wakeSleepingWorkers() noexcept;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeWorkerPool)
+};
@@ -0,0 +1,340 @@
+/** Writes the rendered audio out in the background, one buffer at a time.
+
+    The render loop fills one buffer whilst this writes the other,
+    and only ever waits if it has filled its buffer before the writing is done.
+*/
+class OfflineRenderer::WriterThread final : private Thread
+{
+public:
+    WriterThread (AudioFormatWriter& w, int numChannels, int bufferSize) :
+        Thread ("Offline Render Writer"),
+        writer (w)
+    {
+        for (auto& b : buffers)
+            b.setSize (numChannels, bufferSize);
+
+        startThread();
+    }
+
+    ~WriterThread() override
+    {
+        signalThreadShouldExit();
+        bufferReady.signal();
+        stopThread (10000);
+    }
+
+    /** @returns the buffer the render loop should be filling. */
+    [[nodiscard]] juce::AudioBuffer<float>& getFillBuffer() noexcept { return buffers[(size_t) fillIndex]; }
+
+    /** Hands the filled buffer over to be written, and swaps to the other one.
+
+        @returns the time spent waiting for the previous buffer to be written.
+    */
+    double submit (int numSamples)
+    {
+        const auto waitTime = waitUntilWritten();
+
+        numSamplesToWrite = numSamples;
+        pendingIndex.store (fillIndex, std::memory_order_release);
+        bufferReady.signal();
+
+        fillIndex ^= 1;
+        return waitTime;
+    }
+
+    /** Waits for any pending buffer to be written.
+
+        @returns the time spent waiting.
+    */
+    double waitUntilWritten()
+    {
+        const auto start = Time::getHighResolutionTicks();
+
+        while (pendingIndex.load (std::memory_order_acquire) >= 0 && isThreadRunning())
+            bufferWritten.wait (50);
+
+        return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+    }
+
+    /** @returns true if the writer has failed to write something. */
+    [[nodiscard]] bool hasFailed() const noexcept { return failed.load(); }
+
+private:
+    AudioFormatWriter& writer;
+    std::array<juce::AudioBuffer<float>, 2> buffers;
+    int fillIndex = 0, numSamplesToWrite = 0;
+    std::atomic<int> pendingIndex { -1 };
+    std::atomic<bool> failed { false };
+    WaitableEvent bufferReady, bufferWritten;
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            bufferReady.wait (50);
+
+            const auto index = pendingIndex.load (std::memory_order_acquire);
+            if (index < 0)
+                continue;
+
+            if (! writer.writeFromAudioSampleBuffer (buffers[(size_t) index], 0, numSamplesToWrite))
+                failed = true;
+
+            pendingIndex.store (-1, std::memory_order_release);
+            bufferWritten.signal();
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WriterThread)
+};
+
+//==============================================================================
+/** Reports the render position to the processor, which is always playing. */
+class OfflineRenderer::PlayHead final : public AudioPlayHead
+{
+public:
+    PlayHead (double sr) :
+        sampleRate (sr)
+    {
+    }
+
+    Optional<PositionInfo> getPosition() const override
+    {
+        PositionInfo info;
+        info.setTimeInSamples (position);
+        info.setTimeInSeconds ((double) position / sampleRate);
+        info.setIsPlaying (true);
+        return info;
+    }
+
+    const double sampleRate;
+    int64 position = 0;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlayHead)
+};
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer (const Options& o) :
+    options (o)
+{
+    jassert (options.sampleRate > 0.0);
+    jassert (options.blockSize > 0);
+    jassert (options.numInputChannels >= 0);
+    jassert (options.numOutputChannels > 0);
+    jassert (options.lengthInSamples >= 0);
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+}
+
+//==============================================================================
+OfflineRenderer::Statistics OfflineRenderer::render (AudioIODeviceCallback& callback, AudioFormatWriter* writer)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    // NB: The device is never started; it's only there for the callback to query.
+    DummyAudioIODevice device (false, options.numOutputChannels, options.sampleRate, options.blockSize);
+    device.open (std::max (options.numInputChannels, options.numOutputChannels), options.sampleRate, options.blockSize);
+
+    callback.audioDeviceAboutToStart (&device);
+
+    const auto stats = renderBlocks (writer, [&] (juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                                                  int numSamples, int64)
+    {
+        callback.audioDeviceIOCallbackWithContext (input.getArrayOfReadPointers(), input.getNumChannels(),
+                                                   output.getArrayOfWritePointers(), output.getNumChannels(),
+                                                   numSamples, {});
+    });
+
+    callback.audioDeviceStopped();
+    device.close();
+    return stats;
+}
+
+OfflineRenderer::Statistics OfflineRenderer::render (AudioProcessor& processor, AudioFormatWriter* writer)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    PlayHead playHead (options.sampleRate);
+    const auto wasNonRealtime = processor.isNonRealtime();
+
+    processor.setPlayHead (&playHead);
+    processor.setNonRealtime (true);
+    processor.setRateAndBufferSizeDetails (options.sampleRate, options.blockSize);
+    processor.prepareToPlay (options.sampleRate, options.blockSize);
+
+    const auto numChannels = jmax (processor.getTotalNumInputChannels(),
+                                   processor.getTotalNumOutputChannels(),
+                                   options.numOutputChannels);
+
+    juce::AudioBuffer<float> buffer (numChannels, options.blockSize);
+    MidiBuffer midi;
+
+    const auto stats = renderBlocks (writer, [&] (juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                                                  int numSamples, int64 position)
+    {
+        playHead.position = position;
+
+        juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            if (c < input.getNumChannels())
+                block.copyFrom (c, 0, input, c, 0, numSamples);
+            else
+                block.clear (c, 0, numSamples);
+        }
+
+        midi.clear();
+        processor.processBlock (block, midi);
+
+        for (int c = 0; c < output.getNumChannels(); ++c)
+            output.copyFrom (c, 0, block, c, 0, numSamples);
+    });
+
+    processor.releaseResources();
+    processor.setNonRealtime (wasNonRealtime);
+    processor.setPlayHead (nullptr);
+    return stats;
+}
+
+//==============================================================================
+OfflineRenderer::Statistics OfflineRenderer::renderBlocks (AudioFormatWriter* writer, const BlockFunction& processBlock)
+{
+    SQUAREPINE_CRASH_TRACER
+
+    cancelled = false;
+
+    Statistics stats;
+    stats.blockBudgetSeconds = samplesToSeconds (options.blockSize, options.sampleRate) * options.budgetFraction;
+
+    if (writer != nullptr && (int) writer->getNumChannels() > options.numOutputChannels)
+    {
+        stats.error = NEEDS_TRANS ("The writer has more channels than are being rendered.");
+        jassertfalse;
+        return stats;
+    }
+
+    const auto writeBufferSize = jmax (options.blockSize, options.writeBufferSize);
+    std::unique_ptr<WriterThread> writerThread;
+    if (writer != nullptr)
+        writerThread = std::make_unique<WriterThread> (*writer, options.numOutputChannels, writeBufferSize);
+
+    juce::AudioBuffer<float> input (options.numInputChannels, options.blockSize);
+    juce::AudioBuffer<float> output (options.numOutputChannels, options.blockSize);
+
+    // NB: Everything is allocated upfront to keep it out of the timings.
+    std::vector<double> blockTimes;
+    blockTimes.reserve ((size_t) (options.lengthInSamples / options.blockSize + 1));
+
+    int numSamplesPending = 0;
+    const auto startTicks = Time::getHighResolutionTicks();
+
+    for (int64 position = 0; position < options.lengthInSamples; position += options.blockSize)
+    {
+        if (cancelled.load (std::memory_order_relaxed))
+        {
+            stats.wasCancelled = true;
+            break;
+        }
+
+        const auto numSamples = (int) std::min ((int64) options.blockSize, options.lengthInSamples - position);
+
+        input.clear();
+
+        if (options.input != nullptr && input.getNumChannels() > 0)
+            options.input->read (&input, 0, numSamples, position, true, true);
+
+        output.clear();
+
+        const auto blockStart = Time::getHighResolutionTicks();
+        processBlock (input, output, numSamples, position);
+        const auto blockTime = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - blockStart);
+
+        blockTimes.push_back (blockTime);
+        stats.processingSeconds += blockTime;
+
+        if (blockTime > stats.blockBudgetSeconds)
+            ++stats.numOverruns;
+
+        if (writerThread != nullptr)
+        {
+            auto& fillBuffer = writerThread->getFillBuffer();
+
+            for (int c = 0; c < fillBuffer.getNumChannels(); ++c)
+                fillBuffer.copyFrom (c, numSamplesPending, output, c, 0, numSamples);
+
+            numSamplesPending += numSamples;
+
+            if (numSamplesPending + options.blockSize > writeBufferSize)
+            {
+                stats.writeWaitSeconds += writerThread->submit (numSamplesPending);
+                numSamplesPending = 0;
+            }
+        }
+
+        stats.numSamplesRendered += numSamples;
+        ++stats.numBlocks;
+    }
+
+    if (writerThread != nullptr)
+    {
+        if (numSamplesPending > 0)
+            stats.writeWaitSeconds += writerThread->submit (numSamplesPending);
+
+        stats.writeWaitSeconds += writerThread->waitUntilWritten();
+
+        if (writerThread->hasFailed())
+            stats.error = NEEDS_TRANS ("Failed writing the rendered audio.");
+
+        writerThread.reset();
+        writer->flush();
+    }
+
+    stats.elapsedSeconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+
+    if (stats.elapsedSeconds > 0.0)
+        stats.realtimeFactor = samplesToSeconds (stats.numSamplesRendered, options.sampleRate) / stats.elapsedSeconds;
+
+    if (! blockTimes.empty())
+    {
+        auto percentile = [&] (double p)
+        {
+            const auto index = (size_t) roundToInt (p * (double) (blockTimes.size() - 1));
+            std::nth_element (blockTimes.begin(), blockTimes.begin() + (std::ptrdiff_t) index, blockTimes.end());
+            return blockTimes[index];
+        };
+
+        stats.medianBlockSeconds = percentile (0.5);
+        stats.p90BlockSeconds = percentile (0.9);
+        stats.p99BlockSeconds = percentile (0.99);
+        stats.maxBlockSeconds = *std::max_element (blockTimes.begin(), blockTimes.end());
+    }
+
+    return stats;
+}
+
+//==============================================================================
+String OfflineRenderer::Statistics::toString() const
+{
+    auto toMicroseconds = [] (double seconds) { return String (seconds * 1.0e6, 1) + " us"; };
+
+    String s;
+    s << "Rendered " << numSamplesRendered << " samples in " << numBlocks << " blocks"
+      << (wasCancelled ? " (cancelled)" : "") << newLine
+      << "Elapsed: " << String (elapsedSeconds, 3) << " s, processing: " << String (processingSeconds, 3)
+      << " s, waiting on the writer: " << String (writeWaitSeconds, 3) << " s" << newLine
+      << "Realtime factor: " << String (realtimeFactor, 2) << "x" << newLine
+      << "Block times: median " << toMicroseconds (medianBlockSeconds)
+      << ", p90 " << toMicroseconds (p90BlockSeconds)
+      << ", p99 " << toMicroseconds (p99BlockSeconds)
+      << ", max " << toMicroseconds (maxBlockSeconds) << newLine
+      << "Overruns: " << numOverruns << " (budget " << toMicroseconds (blockBudgetSeconds) << " per block)";
+
+    if (error.isNotEmpty())
+        s << newLine << "Error: " << error;
+
+    return s;
+}
@@ -0,0 +1,126 @@
+/** Renders an AudioIODeviceCallback or an AudioProcessor as fast as the CPU allows,
+    without any sound hardware or wall-clock pacing.
+
+    The rendered audio can be written out through an AudioFormatWriter, which runs
+    on a background thread with a pair of buffers: one is filled by the render loop
+    whilst the other one is being written, so the disk rarely holds the render up.
+
+    Every block is timed, and the timings are summarised in the returned Statistics,
+    which makes this handy as a reproducible benchmark harness for processors:
+    @code
+        OfflineRenderer::Options options;
+        options.sampleRate = 48000.0;
+        options.blockSize = 256;
+        options.lengthInSamples = 48000 * 60;
+
+        OfflineRenderer renderer (options);
+        const auto stats = renderer.render (myProcessor);
+        DBG (stats.toString());
+    @endcode
+
+    @see DummyAudioIODevice
+*/
+class OfflineRenderer final
+{
+public:
+    //==============================================================================
+    /** The details of a render. */
+    struct Options final
+    {
+        double sampleRate = 44100.0;        // The rate to render at.
+        int blockSize = 512;                // The number of samples per block.
+        int numInputChannels = 2;           // The number of channels fed into the callback or processor.
+        int numOutputChannels = 2;          // The number of channels rendered.
+        int64 lengthInSamples = 44100;      // How much to render.
+
+        /** An optional source to feed into the callback or processor.
+            Silence is fed in past its end, or if there isn't one.
+        */
+        AudioFormatReader* input = nullptr;
+
+        /** The number of samples each of the writer's two buffers holds. */
+        int writeBufferSize = 32768;
+
+        /** The fraction of a block's duration that processing it may take
+            before it's counted as an overrun, ie: what would be an xrun on a real device.
+        */
+        double budgetFraction = 1.0;
+    };
+
+    /** The results of a render. */
+    struct Statistics final
+    {
+        int64 numSamplesRendered = 0;       // The number of samples rendered, per channel.
+        int numBlocks = 0;                  // The number of blocks processed.
+        double elapsedSeconds = 0.0;        // The total wall-clock time the render took.
+        double processingSeconds = 0.0;     // The time spent processing blocks.
+        double writeWaitSeconds = 0.0;      // The time spent waiting for the writer to catch up.
+        double realtimeFactor = 0.0;        // The rendered audio's duration over the elapsed time.
+
+        double blockBudgetSeconds = 0.0;    // The time a block had before being counted as an overrun.
+        double medianBlockSeconds = 0.0;    // The 50th percentile of the block processing times.
+        double p90BlockSeconds = 0.0;       // The 90th percentile of the block processing times.
+        double p99BlockSeconds = 0.0;       // The 99th percentile of the block processing times.
+        double maxBlockSeconds = 0.0;       // The slowest block.
+        int numOverruns = 0;                // The number of blocks that went over budget.
+
+        bool wasCancelled = false;          // Whether cancel() was called mid-render.
+        String error;                       // Whatever went wrong, if anything.
+
+        /** @returns a human-readable summary. */
+        [[nodiscard]] String toString() const;
+    };
+
+    //==============================================================================
+    /** Constructor. */
+    OfflineRenderer (const Options&);
+
+    /** Destructor. */
+    ~OfflineRenderer();
+
+    //==============================================================================
+    /** Renders a device callback, which is started with a DummyAudioIODevice
+        configured as per the options, and stopped once done.
+
+        This blocks until the render is complete.
+
+        @param writer Where to write the output to, which may be nullptr.
+                      Its number of channels mustn't exceed the options' number of output channels.
+    */
+    Statistics render (AudioIODeviceCallback&, AudioFormatWriter* writer = nullptr);
+
+    /** Renders a processor, which is prepared in non-realtime mode,
+        given a play head that's always playing, and released once done.
+
+        This blocks until the render is complete.
+
+        @param writer Where to write the output to, which may be nullptr.
+                      Its number of channels mustn't exceed the options' number of output channels.
+    */
+    Statistics render (AudioProcessor&, AudioFormatWriter* writer = nullptr);
+
+    /** Stops the render in progress as soon as possible. This can be called from any thread. */
+    void cancel() noexcept { cancelled = true; }
+
+    //==============================================================================
+    /** @returns the options the renderer was created with. */
+    [[nodiscard]] const Options& getOptions() const noexcept { return options; }
+
+private:
+    //==============================================================================
+    class WriterThread;
+    class PlayHead;
+
+    const Options options;
+    std::atomic<bool> cancelled { false };
+
+    //==============================================================================
+    using BlockFunction = std::function<void (juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                                              int numSamples, int64 position)>;
+
+    Statistics renderBlocks (AudioFormatWriter*, const BlockFunction&);
+
+    //==============================================================================
+    OfflineRenderer() = delete;
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
@@ -0,0 +1,129 @@
+/** A fixed-capacity, multichannel delay line meant to keep
+    a signal aligned with the output of a latent processor.
+
+    All of the memory is allocated in prepare(), so processing
+    never allocates. Any delay that is larger than the prepared
+    capacity is clamped to it.
+*/
+template<typename FloatType>
+class DelayCompensator final
+{
+public:
+    /** Constructor. */
+    DelayCompensator() = default;
+
+    //==============================================================================
+    /** Allocates enough room for the number of channels and delay (in samples),
+        and clears out any history.
+    */
+    void prepare (int numChannels, int maximumDelayInSamples)
+    {
+        buffer.setSize (std::max (1, numChannels), std::max (0, maximumDelayInSamples) + 1, false, true, false);
+        buffer.clear();
+        writePosition = 0;
+    }
+
+    /** Clears out any history, without reallocating. */
+    void reset() noexcept
+    {
+        buffer.clear();
+        writePosition = 0;
+    }
+
+    //==============================================================================
+    /** @returns the number of channels this was prepared for. */
+    [[nodiscard]] int getNumChannels() const noexcept   { return buffer.getNumChannels(); }
+
+    /** @returns the largest delay, in samples, that this was prepared for. */
+    [[nodiscard]] int getMaximumDelay() const noexcept  { return buffer.getNumSamples() - 1; }
+
+    //==============================================================================
+    /** Writes the source into the delay line and reads the delayed signal into the destination.
+
+        The source and destination may be the same buffer.
+        Channels beyond the prepared channel count are passed through as-is.
+    */
+    void process (const juce::AudioBuffer<FloatType>& source,
+                  juce::AudioBuffer<FloatType>& destination,
+                  int numChannels, int numSamples, int delayInSamples) noexcept
+    {
+        const auto size = buffer.getNumSamples();
+        const auto delay = jlimit (0, getMaximumDelay(), delayInSamples);
+        const auto numDelayedChannels = std::min (numChannels, buffer.getNumChannels());
+        auto newWritePosition = writePosition;
+
+        for (int c = 0; c < numDelayedChannels; ++c)
+        {
+            const auto* in = source.getReadPointer (c);
+            auto* out = destination.getWritePointer (c);
+            auto* ring = buffer.getWritePointer (c);
+            auto pos = writePosition;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                ring[pos] = in[i];
+
+                auto readPos = pos - delay;
+                if (readPos < 0)
+                    readPos += size;
+
+                out[i] = ring[readPos];
+
+                if (++pos >= size)
+                    pos = 0;
+            }
+
+            newWritePosition = pos;
+        }
+
+        if (&source != &destination)
+            for (int c = numDelayedChannels; c < numChannels; ++c)
+                destination.copyFrom (c, 0, source, c, 0, numSamples);
+
+        writePosition = newWritePosition;
+    }
+
+    /** Writes the source into the delay line without reading anything back.
+
+        Use this to keep the history up to date while the delayed signal isn't needed.
+    */
+    void push (const juce::AudioBuffer<FloatType>& source, int numChannels, int numSamples) noexcept
+    {
+        const auto size = buffer.getNumSamples();
+        const auto numDelayedChannels = std::min (numChannels, buffer.getNumChannels());
+        auto newWritePosition = writePosition;
+
+        for (int c = 0; c < numDelayedChannels; ++c)
+        {
+            const auto* in = source.getReadPointer (c);
+            auto* ring = buffer.getWritePointer (c);
+            auto pos = writePosition;
+            auto remaining = numSamples;
+
+            while (remaining > 0)
+            {
+                const auto numToCopy = std::min (remaining, size - pos);
+                FloatVectorOperations::copy (ring + pos, in, numToCopy);
+
+                in += numToCopy;
+                remaining -= numToCopy;
+                pos += numToCopy;
+
+                if (pos >= size)
+                    pos = 0;
+            }
+
+            newWritePosition = pos;
+        }
+
+        writePosition = newWritePosition;
+    }
+
+private:
+    //==============================================================================
+    juce::AudioBuffer<FloatType> buffer { 1, 1 };
+    int writePosition = 0;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayCompensator)
+};
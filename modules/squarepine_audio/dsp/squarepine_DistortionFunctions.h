@@ -62,6 +62,119 @@ public:
         return cabs (inputSample);
     }
 
+    /**
+
+        @param inputSample
+        @param drive        The gain applied before saturating.
+
+        @returns a distorted sample.
+    */
+    [[nodiscard]] static FloatType tanhClip (FloatType inputSample, FloatType drive = one)
+    {
+        return std::tanh (inputSample * drive);
+    }
+
+    /**
+
+        @param inputSample
+
+        @returns the sample clipped to -1 to 1.
+    */
+    [[nodiscard]] static constexpr FloatType hardClip (FloatType inputSample)
+    {
+        return std::clamp (inputSample, -one, one);
+    }
+
+    //==============================================================================
+    /** The antiderivatives of the above, for antiderivative anti-aliasing (ADAA).
+
+        A nonlinearity f with an antiderivative F can be evaluated as
+        (F (x[n]) - F (x[n - 1])) / (x[n] - x[n - 1]), which is f averaged over
+        the line between the two samples rather than f at a single point.
+        This suppresses much of the aliasing, at the cost of half a sample of delay.
+
+        @see antiderivativeAntialiased, NonlinearStage
+    */
+    [[nodiscard]] static FloatType sigmoidAntiderivative (FloatType inputSample,
+                                                          FloatType drive = one,
+                                                          FloatType range = static_cast<FloatType> (100))
+    {
+        const auto k = std::clamp (drive, zero, one) * std::clamp (range, zero, static_cast<FloatType> (1000));
+
+        if (k <= zero)
+            return zero;
+
+        const auto v = inputSample * k;
+
+        return (two / MathConstants<FloatType>::pi)
+               * (inputSample * std::atan (v) - std::log1p (v * v) / (two * k));
+    }
+
+    /** @see sigmoidAntiderivative */
+    [[nodiscard]] static FloatType tanhClipAntiderivative (FloatType inputSample, FloatType drive = one)
+    {
+        if (drive <= zero)
+            return zero;
+
+        // NB: This is log (cosh (v)), rearranged so as to not overflow.
+        const auto v = cabs (inputSample * drive);
+        return (v + std::log1p (std::exp (-two * v)) - std::log (two)) / drive;
+    }
+
+    /** @see sigmoidAntiderivative */
+    [[nodiscard]] static constexpr FloatType hardClipAntiderivative (FloatType inputSample)
+    {
+        const auto s = cabs (inputSample);
+        return s <= one ? inputSample * inputSample / two : s - one / two;
+    }
+
+    /** @see sigmoidAntiderivative */
+    [[nodiscard]] static constexpr FloatType halfWaveRectificationAntiderivative (FloatType inputSample)
+    {
+        return inputSample > zero ? inputSample * inputSample / two : zero;
+    }
+
+    /** @see sigmoidAntiderivative */
+    [[nodiscard]] static constexpr FloatType fullWaveRectificationAntiderivative (FloatType inputSample)
+    {
+        return inputSample * cabs (inputSample) / two;
+    }
+
+    /** Evaluates a function using first-order antiderivative anti-aliasing.
+
+        @param inputSample              The new sample.
+        @param previousSample           The previous sample, which gets updated.
+        @param previousAntiderivative   The antiderivative of the previous sample, which gets updated.
+        @param function                 The nonlinearity, used when the samples are too close together.
+        @param antiderivative           The nonlinearity's antiderivative.
+
+        @returns a distorted sample.
+    */
+    template<typename Function, typename Antiderivative, typename... Args>
+    [[nodiscard]] static FloatType antiderivativeAntialiased (FloatType inputSample,
+                                                              FloatType& previousSample,
+                                                              FloatType& previousAntiderivative,
+                                                              Function&& function,
+                                                              Antiderivative&& antiderivative,
+                                                              Args... args)
+    {
+        const auto currentAntiderivative = antiderivative (inputSample, args...);
+        const auto delta = inputSample - previousSample;
+
+        const auto result = cabs (delta) > adaaTolerance
+                            ? (currentAntiderivative - previousAntiderivative) / delta
+                            : function ((inputSample + previousSample) / two, args...);
+
+        previousSample = inputSample;
+        previousAntiderivative = currentAntiderivative;
+        return result;
+    }
+
+    /** Below this difference between samples, ADAA falls back to the plain function
+        because the division becomes ill-conditioned.
+    */
+    static inline constexpr auto adaaTolerance = static_cast<FloatType> (sizeof (FloatType) > 4 ? 1.0e-7 : 1.0e-3);
+
     //==============================================================================
     /** */
     template <typename... Args>
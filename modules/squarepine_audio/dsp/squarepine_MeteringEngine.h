@@ -0,0 +1,550 @@
+/** Measures the levels and loudness of a multichannel signal.
+
+    Every block is measured in a single fused pass over each channel, which provides:
+    - the sample peak,
+    - a sliding-window RMS level, with a configurable integration time,
+    - the 4x oversampled true-peak level, as per ITU-R BS.1770-4 Annex 2.
+
+    The K-weighting filters then run across the channels at once, with each channel
+    in a lane of a dsp::SIMDRegister, which provides the K-weighted momentary (400 ms),
+    short-term (3 s) and gated integrated loudness, as per ITU-R BS.1770-4 and EBU R 128.
+
+    The first two channels can also be measured as mid and side instead of left and right.
+    The loudness and true-peak measurements always use the original channels.
+
+    All of the memory is allocated in prepare(), so processing never allocates.
+
+    @see LevelsProcessor, MeterSnapshotTransport
+*/
+class MeteringEngine final
+{
+public:
+    /** Constructor. */
+    MeteringEngine() = default;
+
+    //==============================================================================
+    /** The longest RMS integration time that can be used. */
+    static constexpr double maxRMSWindowSeconds = 3.0;
+
+    /** The lowest loudness that's reported, in LUFS. */
+    static constexpr float minimumLoudness = MeterSnapshotTransport::minimumLoudness;
+
+    //==============================================================================
+    /** Allocates everything needed for processing, and resets all measurements.
+
+        @param sampleRate   The sample rate of the incoming audio.
+        @param numChannels  The number of channels to measure.
+        @param layout       The channel layout, which is used to weigh the channels
+                            when measuring the loudness (eg: the LFE channel is ignored,
+                            and surround channels are weighted by +1.5 dB).
+    */
+    void prepare (double sampleRate, int numChannels, const AudioChannelSet& layout = {})
+    {
+        jassert (sampleRate > 0.0);
+
+        numChannels = jlimit (0, MeterSnapshotTransport::maxNumChannels, numChannels);
+
+        channels.clear();
+        channels.resize ((size_t) numChannels);
+        kWeightingStates.clear();
+        kWeightingStates.resize (((size_t) numChannels + numKWeightingLanes - 1) / numKWeightingLanes);
+        levels.fill ({});
+
+        const auto maxWindowChunks = (int) std::ceil (maxRMSWindowSeconds * sampleRate / (double) rmsChunkSize);
+        const auto useLayout = layout.size() == numChannels;
+
+        for (int i = 0; i < numChannels; ++i)
+        {
+            auto& channel = channels[(size_t) i];
+            channel.rmsChunks.assign ((size_t) maxWindowChunks + 1, 0.0);
+            channel.loudnessWeight = useLayout ? getLoudnessWeight (layout.getTypeOfChannel (i)) : 1.0;
+        }
+
+        midSideScratch.setSize (2, 0, false, true, true);
+
+        rate = sampleRate;
+        samplesPerSubBlock = std::max (1, roundToInt (sampleRate * subBlockSeconds));
+        numSubBlockSamplesDone = 0;
+        updateKWeighting();
+
+        for (size_t i = 0; i < histogramEnergies.size(); ++i)
+            histogramEnergies[i] = loudnessToEnergy (histogramFloor + ((double) i + 0.5) * histogramStep);
+
+        appliedWindowSeconds = -1.0;
+        resetLoudness();
+    }
+
+    /** Makes sure the mid/side measurements don't allocate for blocks of up to this size. */
+    void ensureBlockSize (int maxNumSamples)
+    {
+        midSideScratch.setSize (2, std::max (maxNumSamples, midSideScratch.getNumSamples()), false, true, true);
+    }
+
+    //==============================================================================
+    /** Changes the RMS integration time. This can be called from any thread. */
+    void setRMSWindowSeconds (double seconds) noexcept
+    {
+        rmsWindowSeconds.store (jlimit (0.001, maxRMSWindowSeconds, seconds), std::memory_order_relaxed);
+    }
+
+    /** @returns the RMS integration time. */
+    [[nodiscard]] double getRMSWindowSeconds() const noexcept { return rmsWindowSeconds.load (std::memory_order_relaxed); }
+
+    /** Restarts the integrated loudness measurement. This can be called from any thread. */
+    void resetIntegratedLoudness() noexcept { integratedResetRequested.store (true, std::memory_order_relaxed); }
+
+    //==============================================================================
+    /** Measures a block of audio.
+
+        @param buffer           The audio to measure.
+        @param numSamples       The number of samples to measure.
+        @param measureMidSide   If true, the levels of the first two channels
+                                are measured as mid and side.
+    */
+    template<typename FloatType>
+    void process (const juce::AudioBuffer<FloatType>& buffer, int numSamples, bool measureMidSide) noexcept
+    {
+        const auto numChannels = std::min (buffer.getNumChannels(), (int) channels.size());
+
+        if (integratedResetRequested.exchange (false, std::memory_order_relaxed))
+            resetIntegrated();
+
+        applyRMSWindow();
+
+        measureMidSide = measureMidSide
+                      && numChannels >= 2
+                      && midSideScratch.getNumSamples() >= numSamples;
+
+        // Levels are kept for the whole block, the loudness energy per gating sub-block:
+        for (int c = 0; c < numChannels; ++c)
+            levels[(size_t) c] = {};
+
+        if (measureMidSide)
+        {
+            const auto* l = buffer.getReadPointer (0);
+            const auto* r = buffer.getReadPointer (1);
+            auto* mid = midSideScratch.getWritePointer (0);
+            auto* side = midSideScratch.getWritePointer (1);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto left = static_cast<float> (l[i]);
+                const auto right = static_cast<float> (r[i]);
+                mid[i] = 0.5f * (left + right);
+                side[i] = 0.5f * (left - right);
+            }
+        }
+
+        for (int start = 0; start < numSamples;)
+        {
+            const auto numToProcess = std::min (numSamples - start, samplesPerSubBlock - numSubBlockSamplesDone);
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                const auto* levelSource = measureMidSide && c < 2 ? midSideScratch.getReadPointer (c) + start : nullptr;
+
+                processChannel (channels[(size_t) c], levels[(size_t) c],
+                                buffer.getReadPointer (c) + start, levelSource, numToProcess);
+            }
+
+            applyKWeighting (buffer, start, numToProcess, numChannels);
+
+            start += numToProcess;
+            numSubBlockSamplesDone += numToProcess;
+
+            if (numSubBlockSamplesDone >= samplesPerSubBlock)
+                finishSubBlock (numChannels);
+        }
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            const auto& channel = channels[(size_t) c];
+            levels[(size_t) c].rms = static_cast<float> (std::sqrt (std::max (0.0, channel.rmsWindowSum) / (double) (rmsWindowChunks * rmsChunkSize)));
+        }
+    }
+
+    //==============================================================================
+    /** @returns the number of channels this was prepared for. */
+    [[nodiscard]] int getNumChannels() const noexcept { return (int) channels.size(); }
+
+    /** @returns the levels measured in the last block, one per channel. */
+    [[nodiscard]] const MeterSnapshotTransport::ChannelLevels* getChannelLevels() const noexcept { return levels.data(); }
+
+    /** @returns the loudness as of the last block. */
+    [[nodiscard]] const MeterSnapshotTransport::Loudness& getLoudness() const noexcept { return loudness; }
+
+private:
+    //==============================================================================
+    static constexpr int rmsChunkSize = 64;
+    static constexpr double subBlockSeconds = 0.1;                 // Gating blocks overlap by 75%.
+    static constexpr int numMomentarySubBlocks = 4;                // 400 ms
+    static constexpr int numShortTermSubBlocks = 30;               // 3 s
+    static constexpr double absoluteGate = -70.0, relativeGate = -10.0;
+    static constexpr double histogramFloor = absoluteGate, histogramStep = 0.1;
+
+    static constexpr int truePeakNumTaps = 12;
+
+    /** The 4x oversampling filter from ITU-R BS.1770-4, Annex 2, split into its 4 phases. */
+    static constexpr float truePeakCoefficients[4][truePeakNumTaps] =
+    {
+        { 0.0017089843750f, 0.0109863281250f, -0.0196533203125f, 0.0332031250000f, -0.0594482421875f, 0.1373291015625f,
+          0.9721679687500f, -0.1022949218750f, 0.0476074218750f, -0.0266113281250f, 0.0148925781250f, -0.0083007812500f },
+        { -0.0291748046875f, 0.0292968750000f, -0.0517578125000f, 0.0891113281250f, -0.1665039062500f, 0.4650878906250f,
+          0.7797851562500f, -0.2003173828125f, 0.1015625000000f, -0.0582275390625f, 0.0330810546875f, -0.0189208984375f },
+        { -0.0189208984375f, 0.0330810546875f, -0.0582275390625f, 0.1015625000000f, -0.2003173828125f, 0.7797851562500f,
+          0.4650878906250f, -0.1665039062500f, 0.0891113281250f, -0.0517578125000f, 0.0292968750000f, -0.0291748046875f },
+        { -0.0083007812500f, 0.0148925781250f, -0.0266113281250f, 0.0476074218750f, -0.1022949218750f, 0.9721679687500f,
+          0.1373291015625f, -0.0594482421875f, 0.0332031250000f, -0.0196533203125f, 0.0109863281250f, 0.0017089843750f }
+    };
+
+    struct Biquad final
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    using KWeightingRegister = dsp::SIMDRegister<double>;
+    static constexpr size_t numKWeightingLanes = KWeightingRegister::SIMDNumElements;
+
+    /** The K-weighting, as 2 transposed direct form II biquads, for as many channels as there are lanes. */
+    struct KWeightingState final
+    {
+        KWeightingRegister shelfS1 = KWeightingRegister::expand (0.0),
+                           shelfS2 = KWeightingRegister::expand (0.0),
+                           highPassS1 = KWeightingRegister::expand (0.0),
+                           highPassS2 = KWeightingRegister::expand (0.0);
+    };
+
+    struct ChannelState final
+    {
+        double subBlockEnergy = 0.0;
+        double loudnessWeight = 1.0;
+
+        // NB: The history is stored twice so that the filter can always read it contiguously.
+        std::array<float, truePeakNumTaps * 2> truePeakHistory {};
+        int truePeakPosition = 0;
+
+        std::vector<double> rmsChunks;
+        double rmsWindowSum = 0.0, rmsPartialSum = 0.0;
+        int rmsChunkPosition = 0, rmsPartialCount = 0;
+    };
+
+    std::vector<ChannelState> channels;
+    std::vector<KWeightingState> kWeightingStates;
+    std::array<MeterSnapshotTransport::ChannelLevels, MeterSnapshotTransport::maxNumChannels> levels;
+    MeterSnapshotTransport::Loudness loudness;
+    juce::AudioBuffer<float> midSideScratch;
+
+    double rate = 48000.0;
+    Biquad shelf, highPass;
+
+    std::atomic<double> rmsWindowSeconds { 0.3 };
+    double appliedWindowSeconds = -1.0;
+    int rmsWindowChunks = 1;
+
+    std::atomic<bool> integratedResetRequested { false };
+    int samplesPerSubBlock = 4800, numSubBlockSamplesDone = 0;
+    std::array<double, numShortTermSubBlocks> subBlockEnergies {};
+    int subBlockPosition = 0, numSubBlocksDone = 0;
+
+    std::array<uint32, 1000> histogram {};
+    std::array<double, 1000> histogramEnergies {};
+
+    //==============================================================================
+    static double getLoudnessWeight (AudioChannelSet::ChannelType type) noexcept
+    {
+        switch (type)
+        {
+            case AudioChannelSet::LFE:
+            case AudioChannelSet::LFE2:
+                return 0.0;
+
+            case AudioChannelSet::leftSurround:
+            case AudioChannelSet::rightSurround:
+            case AudioChannelSet::leftSurroundSide:
+            case AudioChannelSet::rightSurroundSide:
+            case AudioChannelSet::leftSurroundRear:
+            case AudioChannelSet::rightSurroundRear:
+                return 1.41;
+
+            default:
+                return 1.0;
+        };
+    }
+
+    static double loudnessToEnergy (double lufs) noexcept   { return std::pow (10.0, (lufs + 0.691) / 10.0); }
+
+    static float energyToLoudness (double energy) noexcept
+    {
+        if (energy <= 0.0)
+            return minimumLoudness;
+
+        return std::max (minimumLoudness, static_cast<float> (-0.691 + 10.0 * std::log10 (energy)));
+    }
+
+    /** Designs the K-weighting filters for the current sample rate,
+        rather than using the 48 kHz coefficients from the recommendation.
+    */
+    void updateKWeighting() noexcept
+    {
+        {
+            constexpr double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+
+            const auto k = std::tan (MathConstants<double>::pi * f0 / rate);
+            const auto vh = std::pow (10.0, gainDb / 20.0);
+            const auto vb = std::pow (vh, 0.4996667741545416);
+            const auto a0 = 1.0 + k / q + k * k;
+
+            shelf.b0 = (vh + vb * k / q + k * k) / a0;
+            shelf.b1 = 2.0 * (k * k - vh) / a0;
+            shelf.b2 = (vh - vb * k / q + k * k) / a0;
+            shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+            shelf.a2 = (1.0 - k / q + k * k) / a0;
+        }
+
+        {
+            constexpr double f0 = 38.13547087602444, q = 0.5003270373238773;
+
+            const auto k = std::tan (MathConstants<double>::pi * f0 / rate);
+            const auto a0 = 1.0 + k / q + k * k;
+
+            highPass.b0 = 1.0;
+            highPass.b1 = -2.0;
+            highPass.b2 = 1.0;
+            highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+            highPass.a2 = (1.0 - k / q + k * k) / a0;
+        }
+    }
+
+    void resetIntegrated() noexcept
+    {
+        histogram.fill (0);
+        loudness.integrated = minimumLoudness;
+    }
+
+    void resetLoudness() noexcept
+    {
+        subBlockEnergies.fill (0.0);
+        subBlockPosition = 0;
+        numSubBlocksDone = 0;
+        loudness = {};
+        resetIntegrated();
+    }
+
+    /** Adopts a new RMS integration time, if it was changed. */
+    void applyRMSWindow() noexcept
+    {
+        const auto seconds = rmsWindowSeconds.load (std::memory_order_relaxed);
+
+        if (seconds == appliedWindowSeconds || channels.empty())
+            return;
+
+        appliedWindowSeconds = seconds;
+
+        const auto capacity = (int) channels.front().rmsChunks.size() - 1;
+        rmsWindowChunks = jlimit (1, std::max (1, capacity), roundToInt (seconds * rate / (double) rmsChunkSize));
+
+        // The running sums need to cover the new window:
+        for (auto& channel : channels)
+        {
+            const auto size = (int) channel.rmsChunks.size();
+            channel.rmsWindowSum = 0.0;
+
+            for (int i = 1; i <= rmsWindowChunks; ++i)
+                channel.rmsWindowSum += channel.rmsChunks[(size_t) ((channel.rmsChunkPosition - i + size) % size)];
+        }
+    }
+
+    /** The fused per-channel pass: the levels, the RMS window and the true-peak. */
+    template<typename FloatType>
+    void processChannel (ChannelState& channel,
+                         MeterSnapshotTransport::ChannelLevels& channelLevels,
+                         const FloatType* source,
+                         const float* levelSource,
+                         int numSamples) noexcept
+    {
+        auto peak = channelLevels.peak;
+        auto truePeak = channelLevels.truePeak;
+        const auto size = (int) channel.rmsChunks.size();
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto x = static_cast<float> (source[i]);
+            const auto levelSample = levelSource != nullptr ? levelSource[i] : x;
+
+            // Sample peak and RMS:
+            peak = std::max (peak, std::abs (levelSample));
+            channel.rmsPartialSum += (double) levelSample * (double) levelSample;
+
+            if (++channel.rmsPartialCount >= rmsChunkSize)
+            {
+                const auto oldest = (channel.rmsChunkPosition - rmsWindowChunks + size) % size;
+                channel.rmsWindowSum += channel.rmsPartialSum - channel.rmsChunks[(size_t) oldest];
+                channel.rmsChunks[(size_t) channel.rmsChunkPosition] = channel.rmsPartialSum;
+                channel.rmsChunkPosition = (channel.rmsChunkPosition + 1) % size;
+                channel.rmsPartialSum = 0.0;
+                channel.rmsPartialCount = 0;
+            }
+
+            // True-peak:
+            auto& history = channel.truePeakHistory;
+            history[(size_t) channel.truePeakPosition] = x;
+            history[(size_t) (channel.truePeakPosition + truePeakNumTaps)] = x;
+
+            if (++channel.truePeakPosition >= truePeakNumTaps)
+                channel.truePeakPosition = 0;
+
+            const auto* taps = history.data() + channel.truePeakPosition; // Oldest to newest.
+
+            for (const auto& phase : truePeakCoefficients)
+            {
+                auto y = 0.0f;
+
+                for (int t = 0; t < truePeakNumTaps; ++t)
+                    y += phase[truePeakNumTaps - 1 - t] * taps[t];
+
+                truePeak = std::max (truePeak, std::abs (y));
+            }
+        }
+
+        channelLevels.peak = peak;
+        channelLevels.truePeak = truePeak;
+    }
+
+    /** Runs the K-weighting filters and adds up the K-weighted energy of each channel.
+
+        The filters are recursive in time, not across the channels,
+        so each group of channels shares a register with a lane per channel.
+    */
+    template<typename FloatType>
+    void applyKWeighting (const juce::AudioBuffer<FloatType>& buffer, int start, int numSamples, int numChannels) noexcept
+    {
+        const auto sb0 = KWeightingRegister::expand (shelf.b0), sb1 = KWeightingRegister::expand (shelf.b1),
+                   sb2 = KWeightingRegister::expand (shelf.b2), sa1 = KWeightingRegister::expand (shelf.a1),
+                   sa2 = KWeightingRegister::expand (shelf.a2);
+
+        const auto hb0 = KWeightingRegister::expand (highPass.b0), hb1 = KWeightingRegister::expand (highPass.b1),
+                   hb2 = KWeightingRegister::expand (highPass.b2), ha1 = KWeightingRegister::expand (highPass.a1),
+                   ha2 = KWeightingRegister::expand (highPass.a2);
+
+        for (int first = 0; first < numChannels; first += (int) numKWeightingLanes)
+        {
+            auto& state = kWeightingStates[(size_t) first / numKWeightingLanes];
+            const auto numLanesUsed = std::min ((int) numKWeightingLanes, numChannels - first);
+
+            std::array<const FloatType*, numKWeightingLanes> sources {};
+            for (int lane = 0; lane < numLanesUsed; ++lane)
+                sources[(size_t) lane] = buffer.getReadPointer (first + lane) + start;
+
+            auto s1 = state.shelfS1, s2 = state.shelfS2;
+            auto h1 = state.highPassS1, h2 = state.highPassS2;
+            auto energy = KWeightingRegister::expand (0.0);
+
+            // NB: The unused lanes stay silent, so they never affect the used ones.
+            alignas (KWeightingRegister::SIMDRegisterSize) double inputs[numKWeightingLanes] = {};
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                for (int lane = 0; lane < numLanesUsed; ++lane)
+                    inputs[lane] = (double) static_cast<float> (sources[(size_t) lane][i]);
+
+                const auto in = KWeightingRegister::fromRawArray (inputs);
+
+                const auto shelved = sb0 * in + s1;
+                s1 = sb1 * in - sa1 * shelved + s2;
+                s2 = sb2 * in - sa2 * shelved;
+
+                const auto weighted = hb0 * shelved + h1;
+                h1 = hb1 * shelved - ha1 * weighted + h2;
+                h2 = hb2 * shelved - ha2 * weighted;
+
+                energy += weighted * weighted;
+            }
+
+            state.shelfS1 = s1;
+            state.shelfS2 = s2;
+            state.highPassS1 = h1;
+            state.highPassS2 = h2;
+
+            for (int lane = 0; lane < numLanesUsed; ++lane)
+                channels[(size_t) (first + lane)].subBlockEnergy += energy.get ((size_t) lane);
+        }
+    }
+
+    void finishSubBlock (int numChannels) noexcept
+    {
+        auto energy = 0.0;
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            auto& channel = channels[(size_t) c];
+            energy += channel.loudnessWeight * channel.subBlockEnergy;
+            channel.subBlockEnergy = 0.0;
+        }
+
+        subBlockEnergies[(size_t) subBlockPosition] = energy / (double) samplesPerSubBlock;
+        subBlockPosition = (subBlockPosition + 1) % numShortTermSubBlocks;
+        numSubBlockSamplesDone = 0;
+        ++numSubBlocksDone;
+
+        const auto getMeanEnergy = [&] (int numSubBlocks)
+        {
+            auto sum = 0.0;
+
+            for (int i = 1; i <= numSubBlocks; ++i)
+                sum += subBlockEnergies[(size_t) ((subBlockPosition - i + numShortTermSubBlocks) % numShortTermSubBlocks)];
+
+            return sum / (double) numSubBlocks;
+        };
+
+        if (numSubBlocksDone < numMomentarySubBlocks)
+            return;
+
+        const auto momentaryEnergy = getMeanEnergy (numMomentarySubBlocks);
+        loudness.momentary = energyToLoudness (momentaryEnergy);
+
+        if (numSubBlocksDone >= numShortTermSubBlocks)
+            loudness.shortTerm = energyToLoudness (getMeanEnergy (numShortTermSubBlocks));
+
+        // Each momentary block is a gating block for the integrated loudness:
+        const auto momentary = -0.691 + 10.0 * std::log10 (std::max (momentaryEnergy, 1.0e-20));
+
+        if (momentary > absoluteGate)
+        {
+            const auto bin = jlimit (0, (int) histogram.size() - 1, (int) ((momentary - histogramFloor) / histogramStep));
+            ++histogram[(size_t) bin];
+            updateIntegratedLoudness();
+        }
+    }
+
+    void updateIntegratedLoudness() noexcept
+    {
+        auto sum = 0.0;
+        uint64 count = 0;
+
+        for (size_t i = 0; i < histogram.size(); ++i)
+        {
+            sum += (double) histogram[i] * histogramEnergies[i];
+            count += histogram[i];
+        }
+
+        if (count == 0)
+            return;
+
+        const auto gate = -0.691 + 10.0 * std::log10 (sum / (double) count) + relativeGate;
+        const auto firstBin = jlimit (0, (int) histogram.size(), (int) std::ceil ((gate - histogramFloor) / histogramStep));
+
+        sum = 0.0;
+        count = 0;
+
+        for (auto i = (size_t) firstBin; i < histogram.size(); ++i)
+        {
+            sum += (double) histogram[i] * histogramEnergies[i];
+            count += histogram[i];
+        }
+
+        loudness.integrated = count > 0 ? energyToLoudness (sum / (double) count) : minimumLoudness;
+    }
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeteringEngine)
+};
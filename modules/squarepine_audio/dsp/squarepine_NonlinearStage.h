@@ -0,0 +1,273 @@
+/** A shared stage for running nonlinear processing at an oversampled rate,
+    so that the harmonics it creates above the host's Nyquist frequency
+    are filtered out rather than aliased back down.
+
+    The audio is upsampled with polyphase half-band filters, processed, then
+    filtered and downsampled again. Either one of the built-in waveshapers is applied,
+    optionally with antiderivative anti-aliasing (ADAA), or a custom kernel is.
+
+    The built-in shapers run over each channel's contiguous oversampled block
+    in tight, branch-free loops, so the compiler can vectorise the ones that
+    don't call into transcendental functions (ie: the clipper and the rectifiers).
+
+    @see DistortionFunctions
+*/
+template<typename FloatType>
+class NonlinearStage final
+{
+public:
+    //==============================================================================
+    /** The built-in waveshapers, which map to the DistortionFunctions of the same names. */
+    enum class Shape
+    {
+        tanhClip,
+        sigmoid,
+        hardClip,
+        halfWaveRectification,
+        fullWaveRectification
+    };
+
+    //==============================================================================
+    /** Constructor. */
+    NonlinearStage() = default;
+
+    //==============================================================================
+    /** Changes the oversampling factor, which must be 1, 2, 4 or 8.
+
+        This takes effect the next time the stage is prepared.
+    */
+    void setOversamplingFactor (int newFactor)
+    {
+        jassert (newFactor == 1 || newFactor == 2 || newFactor == 4 || newFactor == 8);
+        oversamplingOrder = (size_t) jlimit (0, 3, (int) std::log2 (std::max (1, newFactor)));
+    }
+
+    /** @returns the oversampling factor given to setOversamplingFactor(),
+        which may not have been prepared yet.
+    */
+    [[nodiscard]] int getRequestedOversamplingFactor() const noexcept { return 1 << (int) oversamplingOrder; }
+
+    /** @returns the oversampling factor the stage is processing at, as of the last time it was prepared.
+
+        Before being prepared, this is the requested factor.
+    */
+    [[nodiscard]] int getOversamplingFactor() const noexcept
+    {
+        return oversampling != nullptr ? (int) oversampling->getOversamplingFactor()
+                                       : getRequestedOversamplingFactor();
+    }
+
+    /** Changes the built-in waveshaper. */
+    void setShape (Shape newShape) noexcept                 { shape = newShape; }
+
+    /** Changes the drive of the built-in waveshaper, which is where it applies. */
+    void setDrive (FloatType newDrive) noexcept             { drive = newDrive; }
+
+    /** Changes the range of the sigmoid waveshaper. */
+    void setRange (FloatType newRange) noexcept             { range = newRange; }
+
+    /** Enables or disables antiderivative anti-aliasing for the built-in waveshapers.
+
+        This adds half a sample of delay at the oversampled rate,
+        so prepare the stage again afterwards to update the latency.
+    */
+    void setAntiderivativeAntialiasing (bool shouldUseADAA) noexcept { useADAA = shouldUseADAA; }
+
+    //==============================================================================
+    /** Allocates everything needed for processing up to the given block size. */
+    void prepare (int numChannels, int maxBlockSize)
+    {
+        numChannels = std::max (1, numChannels);
+        maximumBlockSize = std::max (1, maxBlockSize);
+
+        oversampling = std::make_unique<dsp::Oversampling<FloatType>> ((size_t) numChannels, oversamplingOrder,
+                                                                        dsp::Oversampling<FloatType>::filterHalfBandPolyphaseIIR,
+                                                                        true, true);
+        oversampling->initProcessing ((size_t) maximumBlockSize);
+
+        antiderivatives.assign ((size_t) (maximumBlockSize * getOversamplingFactor()), FloatType());
+        previousSamples.assign ((size_t) numChannels, FloatType());
+        previousAntiderivatives.assign ((size_t) numChannels, FloatType());
+        preparedADAA = useADAA;
+
+        reset();
+    }
+
+    /** Clears the filters and the ADAA state. */
+    void reset() noexcept
+    {
+        if (oversampling != nullptr)
+            oversampling->reset();
+
+        std::fill (previousSamples.begin(), previousSamples.end(), FloatType());
+        std::fill (previousAntiderivatives.begin(), previousAntiderivatives.end(), FloatType());
+    }
+
+    /** @returns the latency of the stage, in samples at the host's rate. */
+    [[nodiscard]] int getLatencyInSamples() const noexcept
+    {
+        if (oversampling == nullptr)
+            return 0;
+
+        auto latency = (double) oversampling->getLatencyInSamples();
+
+        if (preparedADAA)
+            latency += 0.5 / (double) getOversamplingFactor();
+
+        return roundToInt (latency);
+    }
+
+    //==============================================================================
+    /** Applies the built-in waveshaper to a buffer. */
+    void process (juce::AudioBuffer<FloatType>& buffer)
+    {
+        process (buffer, [this] (FloatType* samples, int numSamples, int channel)
+        {
+            applyShape (samples, numSamples, channel);
+        });
+    }
+
+    /** Runs a custom kernel on a buffer, at the oversampled rate.
+
+        @param kernel   Called for each channel as (FloatType* samples, int numSamples, int channel),
+                        to process the samples in place.
+    */
+    template<typename Kernel>
+    void process (juce::AudioBuffer<FloatType>& buffer, Kernel&& kernel)
+    {
+        jassert (oversampling != nullptr); // Forgot to call prepare()?
+
+        const auto numChans = std::min (buffer.getNumChannels(), (int) previousSamples.size());
+        const auto numSamples = buffer.getNumSamples();
+
+        if (oversampling == nullptr || numChans <= 0 || numSamples <= 0)
+            return;
+
+        // NB: Blocks larger than prepared for are split up rather than reallocated.
+        for (int start = 0; start < numSamples; start += maximumBlockSize)
+        {
+            const auto numThisTime = std::min (maximumBlockSize, numSamples - start);
+
+            dsp::AudioBlock<FloatType> block (buffer.getArrayOfWritePointers(), (size_t) numChans,
+                                              (size_t) start, (size_t) numThisTime);
+
+            auto oversampledBlock = oversampling->processSamplesUp (block);
+
+            for (int c = 0; c < numChans; ++c)
+                kernel (oversampledBlock.getChannelPointer ((size_t) c), (int) oversampledBlock.getNumSamples(), c);
+
+            oversampling->processSamplesDown (block);
+        }
+    }
+
+private:
+    //==============================================================================
+    using Functions = DistortionFunctions<FloatType>;
+
+    std::unique_ptr<dsp::Oversampling<FloatType>> oversampling;
+    size_t oversamplingOrder = 1;
+    int maximumBlockSize = 0;
+
+    Shape shape = Shape::tanhClip;
+    FloatType drive = static_cast<FloatType> (1),
+              range = static_cast<FloatType> (100);
+    bool useADAA = false, preparedADAA = false;
+
+    std::vector<FloatType> antiderivatives, previousSamples, previousAntiderivatives;
+
+    //==============================================================================
+    void applyShape (FloatType* samples, int numSamples, int channel) noexcept
+    {
+        const auto d = drive;
+        const auto r = range;
+
+        switch (shape)
+        {
+            case Shape::tanhClip:
+                applyShape (samples, numSamples, channel,
+                            [d] (FloatType x) { return Functions::tanhClip (x, d); },
+                            [d] (FloatType x) { return Functions::tanhClipAntiderivative (x, d); });
+            break;
+
+            case Shape::sigmoid:
+                applyShape (samples, numSamples, channel,
+                            [d, r] (FloatType x) { return Functions::sigmoid (x, d, r); },
+                            [d, r] (FloatType x) { return Functions::sigmoidAntiderivative (x, d, r); });
+            break;
+
+            case Shape::hardClip:
+            {
+                const auto gain = std::max (d, static_cast<FloatType> (1.0e-6));
+
+                applyShape (samples, numSamples, channel,
+                            [gain] (FloatType x) { return Functions::hardClip (x * gain); },
+                            [gain] (FloatType x) { return Functions::hardClipAntiderivative (x * gain) / gain; });
+            }
+            break;
+
+            case Shape::halfWaveRectification:
+                applyShape (samples, numSamples, channel,
+                            [] (FloatType x) { return Functions::halfWaveRectification (x); },
+                            [] (FloatType x) { return Functions::halfWaveRectificationAntiderivative (x); });
+            break;
+
+            case Shape::fullWaveRectification:
+                applyShape (samples, numSamples, channel,
+                            [] (FloatType x) { return Functions::fullWaveRectification (x); },
+                            [] (FloatType x) { return Functions::fullWaveRectificationAntiderivative (x); });
+            break;
+
+            default:
+                jassertfalse;
+            break;
+        };
+    }
+
+    template<typename Function, typename Antiderivative>
+    void applyShape (FloatType* samples, int numSamples, int channel,
+                     Function&& function, Antiderivative&& antiderivative) noexcept
+    {
+        if (! preparedADAA)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                samples[i] = function (samples[i]);
+
+            return;
+        }
+
+        jassert (numSamples <= (int) antiderivatives.size());
+        numSamples = std::min (numSamples, (int) antiderivatives.size());
+
+        if (numSamples <= 0)
+            return;
+
+        auto* ad = antiderivatives.data();
+        auto& previousSample = previousSamples[(size_t) channel];
+        auto& previousAntiderivative = previousAntiderivatives[(size_t) channel];
+
+        // The antiderivatives have no dependencies between samples, so they're done in one go:
+        for (int i = 0; i < numSamples; ++i)
+            ad[i] = antiderivative (samples[i]);
+
+        const auto lastSample = samples[numSamples - 1];
+        const auto lastAntiderivative = ad[numSamples - 1];
+
+        // Going backwards means each sample's predecessor hasn't been overwritten yet:
+        for (int i = numSamples; --i >= 0;)
+        {
+            const auto x0 = i > 0 ? samples[i - 1] : previousSample;
+            const auto ad0 = i > 0 ? ad[i - 1] : previousAntiderivative;
+            const auto delta = samples[i] - x0;
+
+            samples[i] = std::abs (delta) > Functions::adaaTolerance
+                            ? (ad[i] - ad0) / delta
+                            : function ((samples[i] + x0) / static_cast<FloatType> (2));
+        }
+
+        previousSample = lastSample;
+        previousAntiderivative = lastAntiderivative;
+    }
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NonlinearStage)
+};
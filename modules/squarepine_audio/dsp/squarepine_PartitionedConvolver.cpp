@@ -0,0 +1,546 @@
+namespace
+{
+    int divideRoundingUp (int numerator, int denominator) noexcept
+    {
+        return (numerator + denominator - 1) / denominator;
+    }
+
+    /** The FFT engines don't all agree on how the inverse transform is scaled,
+        so this finds out by round-tripping an impulse.
+    */
+    float getInverseTransformScale (const dsp::FFT& fft)
+    {
+        std::vector<float> data ((size_t) fft.getSize() * 2, 0.0f);
+        data.front() = 1.0f;
+
+        fft.performRealOnlyForwardTransform (data.data(), true);
+        fft.performRealOnlyInverseTransform (data.data());
+
+        jassert (data.front() > 0.0f);
+        return data.front() > 0.0f ? 1.0f / data.front() : 1.0f;
+    }
+
+    /** dest += a * b, for arrays of complex numbers. */
+    void multiplyAccumulate (std::complex<float>* dest, const std::complex<float>* a,
+                             const std::complex<float>* b, int numBins) noexcept
+    {
+        // NB: Working on the interleaved floats directly lets the compiler vectorise this,
+        //     which it won't do for std::complex's multiplication (seeing that it handles NaNs and infinities).
+        auto* d = reinterpret_cast<float*> (dest);
+        const auto* x = reinterpret_cast<const float*> (a);
+        const auto* y = reinterpret_cast<const float*> (b);
+
+        for (int i = 0; i < numBins * 2; i += 2)
+        {
+            const auto xr = x[i], xi = x[i + 1];
+            const auto yr = y[i], yi = y[i + 1];
+
+            d[i]     += xr * yr - xi * yi;
+            d[i + 1] += xr * yi + xi * yr;
+        }
+    }
+
+    String createCacheKey (const juce::AudioBuffer<float>& audio, int headPartitionSize)
+    {
+        const auto numSamples = audio.getNumSamples();
+
+        auto key = String (audio.getNumChannels()) + ":" + String (numSamples) + ":" + String (headPartitionSize);
+
+        for (int c = 0; c < audio.getNumChannels(); ++c)
+            key << ":" << MD5 (audio.getReadPointer (c), sizeof (float) * (size_t) numSamples).toHexString();
+
+        return key;
+    }
+}
+
+//==============================================================================
+std::shared_ptr<const PartitionedImpulseResponse> PartitionedImpulseResponse::create (const juce::AudioBuffer<float>& impulseResponse,
+                                                                                      int headPartitionSize)
+{
+    jassert (isPowerOfTwo (headPartitionSize));
+    headPartitionSize = nextPowerOfTwo (std::max (1, headPartitionSize));
+
+    static CriticalSection cacheLock;
+    static std::map<String, std::weak_ptr<const PartitionedImpulseResponse>> cache;
+
+    const auto key = createCacheKey (impulseResponse, headPartitionSize);
+
+    {
+        const ScopedLock sl (cacheLock);
+
+        if (auto existing = cache[key].lock())
+            return existing;
+    }
+
+    // NB: The lock isn't held whilst partitioning, seeing that long responses take a while.
+    std::shared_ptr<const PartitionedImpulseResponse> result (new PartitionedImpulseResponse (impulseResponse, headPartitionSize));
+
+    const ScopedLock sl (cacheLock);
+
+    for (auto iter = cache.begin(); iter != cache.end();)
+    {
+        if (iter->second.expired() && iter->first != key)
+            iter = cache.erase (iter);
+        else
+            ++iter;
+    }
+
+    auto& entry = cache[key];
+
+    if (auto existing = entry.lock())
+        return existing; // Someone else beat us to it.
+
+    entry = result;
+    return result;
+}
+
+std::vector<PartitionedImpulseResponse::Stage> PartitionedImpulseResponse::createLayout (int length, int headPartitionSize)
+{
+    length = std::max (1, length);
+    headPartitionSize = std::max (1, headPartitionSize);
+
+    const auto tailPartitionSize = jlimit (headPartitionSize, std::max (headPartitionSize, maxTailPartitionSize),
+                                           headPartitionSize * tailPartitionMultiple);
+
+    if (tailPartitionSize <= headPartitionSize)
+        return { { headPartitionSize, 0, divideRoundingUp (length, headPartitionSize) } };
+
+    // NB: The head covers an extra tail partition, which is what gives the tail its time to render.
+    const auto headLength = std::min (length, tailPartitionSize * 2 - headPartitionSize);
+
+    std::vector<Stage> layout;
+    layout.push_back ({ headPartitionSize, 0, divideRoundingUp (headLength, headPartitionSize) });
+
+    if (length > headLength)
+        layout.push_back ({ tailPartitionSize, headLength, divideRoundingUp (length - headLength, tailPartitionSize) });
+
+    return layout;
+}
+
+PartitionedImpulseResponse::PartitionedImpulseResponse (const juce::AudioBuffer<float>& impulseResponse, int headSize) :
+    numChannels (std::max (1, impulseResponse.getNumChannels())),
+    length (std::max (1, impulseResponse.getNumSamples())),
+    headPartitionSize (headSize),
+    stages (createLayout (length, headSize))
+{
+    for (const auto& stage : stages)
+    {
+        const auto partitionSize = stage.partitionSize;
+        const auto numBins = partitionSize + 1;
+
+        const dsp::FFT fft (roundToInt (std::log2 (partitionSize * 2)));
+        const auto scale = getInverseTransformScale (fft);
+
+        std::vector<float> buffer ((size_t) partitionSize * 4);
+        auto& stageSpectra = spectra.emplace_back ((size_t) (numChannels * stage.numPartitions * numBins));
+        auto* dest = stageSpectra.data();
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            for (int p = 0; p < stage.numPartitions; ++p)
+            {
+                std::fill (buffer.begin(), buffer.end(), 0.0f);
+
+                // The second half stays zero, as overlap-save needs:
+                const auto start = stage.offset + p * partitionSize;
+                const auto numToCopy = jlimit (0, partitionSize, impulseResponse.getNumSamples() - start);
+
+                if (c < impulseResponse.getNumChannels() && numToCopy > 0)
+                    FloatVectorOperations::copy (buffer.data(), impulseResponse.getReadPointer (c, start), numToCopy);
+
+                fft.performRealOnlyForwardTransform (buffer.data(), true);
+
+                // The inverse transform's scaling is folded in here, so the convolver needn't bother:
+                const auto* bins = reinterpret_cast<const std::complex<float>*> (buffer.data());
+
+                for (int b = 0; b < numBins; ++b)
+                    *dest++ = bins[b] * scale;
+            }
+        }
+    }
+}
+
+const std::complex<float>* PartitionedImpulseResponse::getPartition (int stageIndex, int channel, int partitionIndex) const noexcept
+{
+    const auto& stage = stages[(size_t) stageIndex];
+    const auto numBins = stage.partitionSize + 1;
+
+    return spectra[(size_t) stageIndex].data()
+            + ((size_t) (channel * stage.numPartitions + partitionIndex) * (size_t) numBins);
+}
+
+//==============================================================================
+void PartitionedConvolver::Weights::add (int index, float gain) noexcept
+{
+    jassert (size < maxNumWeights);
+
+    if (size < maxNumWeights)
+    {
+        indices[(size_t) size] = index;
+        gains[(size_t) size] = gain;
+        ++size;
+    }
+}
+
+bool PartitionedConvolver::Weights::operator== (const Weights& other) const noexcept
+{
+    if (size != other.size)
+        return false;
+
+    for (size_t i = 0; i < (size_t) size; ++i)
+        if (indices[i] != other.indices[i] || ! exactlyEqual (gains[i], other.gains[i]))
+            return false;
+
+    return true;
+}
+
+//==============================================================================
+void PartitionedConvolver::prepare (int newNumChannels, std::vector<std::shared_ptr<const PartitionedImpulseResponse>> newImpulseResponses)
+{
+    numChannels = std::max (1, newNumChannels);
+    impulseResponses = std::move (newImpulseResponses);
+
+    impulseResponses.erase (std::remove (impulseResponses.begin(), impulseResponses.end(), nullptr), impulseResponses.end());
+
+    headPartitionSize = 0;
+    int maxLength = 1;
+
+    for (const auto& ir : impulseResponses)
+    {
+        // All of the responses must be partitioned for the same block size!
+        jassert (headPartitionSize == 0 || headPartitionSize == ir->getHeadPartitionSize());
+
+        headPartitionSize = ir->getHeadPartitionSize();
+        maxLength = std::max (maxLength, ir->getLength());
+    }
+
+    stages.clear();
+    targetWeights = {};
+
+    if (impulseResponses.empty())
+    {
+        outputs.clear();
+        outputSize = 0;
+        return;
+    }
+
+    // Every response's stages line up with these, they just may have fewer of them:
+    int maxPartitionSize = headPartitionSize;
+
+    for (const auto& layout : PartitionedImpulseResponse::createLayout (maxLength, headPartitionSize))
+    {
+        auto& stage = stages.emplace_back();
+        stage.partitionSize = layout.partitionSize;
+        stage.numBins = layout.partitionSize + 1;
+        stage.numPartitions = layout.numPartitions;
+        stage.fft = std::make_unique<dsp::FFT> (roundToInt (std::log2 (layout.partitionSize * 2)));
+        stage.transformCost = stage.fft->getSize() > 0 ? roundToInt (std::log2 (stage.fft->getSize())) : 1; // ie: N log N against N.
+        stage.inputs.resize ((size_t) (numChannels * layout.partitionSize * 2));
+        stage.renderInputs.resize (stage.inputs.size());
+        stage.delayLine.resize ((size_t) (numChannels * stage.numPartitions * stage.numBins));
+        stage.accumulators.resize ((size_t) (maxNumWeights * 2 * stage.numBins));
+
+        maxPartitionSize = std::max (maxPartitionSize, layout.partitionSize);
+    }
+
+    // A tail stage's output starts a partition ahead of the read position, and runs for another:
+    outputSize = nextPowerOfTwo (maxPartitionSize * 2);
+    outputs.resize ((size_t) (numChannels * outputSize));
+
+    fftBuffer.resize ((size_t) maxPartitionSize * 4);
+    previousOutput.resize ((size_t) maxPartitionSize);
+
+    reset();
+}
+
+void PartitionedConvolver::reset() noexcept
+{
+    for (auto& stage : stages)
+    {
+        std::fill (stage.inputs.begin(), stage.inputs.end(), 0.0f);
+        std::fill (stage.delayLine.begin(), stage.delayLine.end(), std::complex<float>());
+        stage.numFilled = 0;
+        stage.delayLineHead = 0;
+        stage.weights = targetWeights;
+        stage.render = {};
+        stage.render.channel = numChannels; // ie: Nothing to render.
+    }
+
+    std::fill (outputs.begin(), outputs.end(), 0.0f);
+    outputPosition = 0;
+}
+
+//==============================================================================
+void PartitionedConvolver::process (float* const* channels, int numChannelsToProcess, int numSamples) noexcept
+{
+    numChannelsToProcess = std::min (numChannelsToProcess, numChannels);
+
+    if (stages.empty())
+    {
+        for (int c = 0; c < numChannelsToProcess; ++c)
+            FloatVectorOperations::clear (channels[c], numSamples);
+
+        return;
+    }
+
+    const auto mask = outputSize - 1;
+    const auto& head = stages.front();
+
+    // NB: The tail partitions are multiples of the head's, so filling the head
+    //     up one partition at a time always lands on the tail's boundaries too.
+    for (int done = 0; done < numSamples;)
+    {
+        const auto numThisTime = std::min (numSamples - done, head.partitionSize - head.numFilled);
+
+        for (auto& stage : stages)
+        {
+            for (int c = 0; c < numChannels; ++c)
+            {
+                auto* dest = stage.inputs.data() + (c * stage.partitionSize * 2) + stage.partitionSize + stage.numFilled;
+
+                if (c < numChannelsToProcess)
+                    FloatVectorOperations::copy (dest, channels[c] + done, numThisTime);
+                else
+                    FloatVectorOperations::clear (dest, numThisTime);
+            }
+
+            stage.numFilled += numThisTime;
+        }
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            auto* ring = outputs.data() + (c * outputSize);
+            auto* dest = c < numChannelsToProcess ? channels[c] + done : nullptr;
+
+            for (int i = 0; i < numThisTime; ++i)
+            {
+                auto& pending = ring[(outputPosition + i) & mask];
+
+                if (dest != nullptr)
+                    dest[i] = pending;
+
+                pending = 0.0f;
+            }
+        }
+
+        outputPosition = (outputPosition + numThisTime) & mask;
+        done += numThisTime;
+
+        if (head.numFilled < head.partitionSize)
+            continue;
+
+        // Every stage gets its share of rendering whenever the head completes a partition:
+        for (size_t s = 0; s < stages.size(); ++s)
+        {
+            auto& stage = stages[s];
+
+            if (stage.numFilled >= stage.partitionSize)
+            {
+                continueRender (s, true); // Whatever's left should be due by now.
+                startRender (s);
+                stage.numFilled = 0;
+            }
+
+            continueRender (s, false);
+        }
+    }
+}
+
+int PartitionedConvolver::getNumPartitions (size_t stageIndex, int impulseResponseIndex) const noexcept
+{
+    const auto& irStages = impulseResponses[(size_t) impulseResponseIndex]->getStages();
+
+    if (stageIndex >= irStages.size())
+        return 0; // This response is too short to reach this stage.
+
+    return std::min (stages[stageIndex].numPartitions, irStages[stageIndex].numPartitions);
+}
+
+void PartitionedConvolver::startRender (size_t stageIndex) noexcept
+{
+    auto& stage = stages[stageIndex];
+    auto& render = stage.render;
+    const auto partitionSize = stage.partitionSize;
+
+    render.previousWeights = stage.weights;
+    render.weights = targetWeights;
+    stage.weights = targetWeights;
+
+    // Each response needed by either set of weights gets its own accumulator:
+    render.numActive = 0;
+
+    auto addActive = [&] (const Weights& w)
+    {
+        for (int i = 0; i < w.size; ++i)
+        {
+            const auto index = w.indices[(size_t) i];
+            const auto activeEnd = render.active.begin() + render.numActive;
+
+            if (isPositiveAndBelow (index, (int) impulseResponses.size())
+                && std::find (render.active.begin(), activeEnd, index) == activeEnd)
+                render.active[(size_t) render.numActive++] = index;
+        }
+    };
+
+    addActive (render.weights);
+
+    if (render.previousWeights != render.weights)
+        addActive (render.previousWeights);
+
+    // Keep hold of the latest windows, then slide them along so the newest half becomes the overlap:
+    FloatVectorOperations::copy (stage.renderInputs.data(), stage.inputs.data(), (int) stage.inputs.size());
+
+    for (int c = 0; c < numChannels; ++c)
+    {
+        auto* window = stage.inputs.data() + (c * partitionSize * 2);
+        FloatVectorOperations::copy (window, window + partitionSize, partitionSize);
+    }
+
+    render.delayLineSlot = stage.delayLineHead;
+    stage.delayLineHead = (stage.delayLineHead + 1) % stage.numPartitions;
+
+    // The head is due straight away, whereas a tail stage has until its next partition is complete:
+    const auto isTail = partitionSize > headPartitionSize;
+    render.outputStart = (outputPosition + (isTail ? partitionSize : 0)) & (outputSize - 1);
+
+    int numMultiplies = 0;
+
+    for (int a = 0; a < render.numActive; ++a)
+        numMultiplies += getNumPartitions (stageIndex, render.active[(size_t) a]);
+
+    const auto numInverseTransforms = render.previousWeights != render.weights ? 2 : 1;
+    const auto cost = numChannels * (numMultiplies + stage.transformCost * (1 + numInverseTransforms));
+    render.costPerBlock = isTail ? divideRoundingUp (cost, partitionSize / headPartitionSize) : cost;
+    render.budget = 0;
+
+    render.channel = 0;
+    render.response = 0;
+    render.partition = -1;
+}
+
+void PartitionedConvolver::continueRender (size_t stageIndex, bool finish) noexcept
+{
+    auto& stage = stages[stageIndex];
+    auto& render = stage.render;
+    const auto partitionSize = stage.partitionSize;
+    const auto numBins = stage.numBins;
+
+    if (render.channel >= numChannels)
+        return;
+
+    render.budget += render.costPerBlock;
+
+    while (render.channel < numChannels && (finish || render.budget > 0))
+    {
+        const auto c = render.channel;
+        auto* channelDelayLine = stage.delayLine.data() + (c * stage.numPartitions * numBins);
+
+        if (render.partition < 0)
+        {
+            // Transform the window into the delay line:
+            auto* fftData = fftBuffer.data();
+            FloatVectorOperations::copy (fftData, stage.renderInputs.data() + (c * partitionSize * 2), partitionSize * 2);
+            FloatVectorOperations::clear (fftData + partitionSize * 2, partitionSize * 2);
+            stage.fft->performRealOnlyForwardTransform (fftData, true);
+
+            std::copy_n (reinterpret_cast<const std::complex<float>*> (fftData), numBins,
+                         channelDelayLine + (render.delayLineSlot * numBins));
+
+            std::fill_n (stage.accumulators.begin(), render.numActive * numBins, std::complex<float>());
+            render.response = 0;
+            render.partition = 0;
+            render.budget -= stage.transformCost;
+        }
+        else if (render.response < render.numActive)
+        {
+            const auto index = render.active[(size_t) render.response];
+
+            if (render.partition >= getNumPartitions (stageIndex, index))
+            {
+                ++render.response;
+                render.partition = 0;
+                continue;
+            }
+
+            const auto& ir = *impulseResponses[(size_t) index];
+            const auto slot = (render.delayLineSlot - render.partition + stage.numPartitions) % stage.numPartitions;
+
+            multiplyAccumulate (stage.accumulators.data() + (render.response * numBins),
+                                channelDelayLine + (slot * numBins),
+                                ir.getPartition ((int) stageIndex, c % ir.getNumChannels(), render.partition),
+                                numBins);
+
+            ++render.partition;
+            --render.budget;
+        }
+        else
+        {
+            renderOutput (stage, c);
+            ++render.channel;
+            render.partition = -1;
+            render.budget -= stage.transformCost * (render.previousWeights != render.weights ? 2 : 1);
+        }
+    }
+}
+
+void PartitionedConvolver::renderOutput (StageState& stage, int channel) noexcept
+{
+    const auto& render = stage.render;
+    const auto partitionSize = stage.partitionSize;
+    const auto mask = outputSize - 1;
+    const auto crossfade = render.previousWeights != render.weights;
+
+    // Overlap-save keeps the second half of the inverse transform:
+    const auto* result = fftBuffer.data() + partitionSize;
+
+    if (crossfade)
+    {
+        renderMix (stage, render.previousWeights);
+        FloatVectorOperations::copy (previousOutput.data(), result, partitionSize);
+    }
+
+    renderMix (stage, render.weights);
+
+    auto* ring = outputs.data() + (channel * outputSize);
+    const auto fadeStep = 1.0f / (float) partitionSize;
+
+    for (int i = 0; i < partitionSize; ++i)
+    {
+        auto sample = result[i];
+
+        if (crossfade)
+        {
+            const auto alpha = (float) i * fadeStep;
+            sample = previousOutput[(size_t) i] + alpha * (sample - previousOutput[(size_t) i]);
+        }
+
+        ring[(render.outputStart + i) & mask] += sample;
+    }
+}
+
+void PartitionedConvolver::renderMix (const StageState& stage, const Weights& weights) noexcept
+{
+    const auto& render = stage.render;
+    const auto numBins = stage.numBins;
+    auto* mix = reinterpret_cast<std::complex<float>*> (fftBuffer.data());
+    std::fill (mix, mix + numBins, std::complex<float>());
+
+    const auto activeEnd = render.active.begin() + render.numActive;
+
+    for (int w = 0; w < weights.size; ++w)
+    {
+        const auto index = weights.indices[(size_t) w];
+        const auto gain = weights.gains[(size_t) w];
+        const auto a = (int) (std::find (render.active.begin(), activeEnd, index) - render.active.begin());
+
+        if (a >= render.numActive || exactlyEqual (gain, 0.0f))
+            continue;
+
+        const auto* accumulator = stage.accumulators.data() + (a * numBins);
+
+        for (int b = 0; b < numBins; ++b)
+            mix[b] += accumulator[b] * gain;
+    }
+
+    stage.fft->performRealOnlyInverseTransform (fftBuffer.data());
+}
@@ -0,0 +1,206 @@
+/** The frequency-domain partitions of an impulse response, ready for a PartitionedConvolver.
+
+    The start of the response is split into partitions the size of the convolver's
+    block, and anything beyond that into partitions that are several times larger.
+    This keeps the latency down to a single block, whilst long tails (eg: 10 second reverbs)
+    are covered by far fewer partitions than they would be with a uniform split.
+
+    These are immutable once created, and create() hands back the existing instance
+    for the same audio and partition size whilst one is still alive,
+    so the spectra are only computed once no matter how many convolvers use them.
+*/
+class PartitionedImpulseResponse final
+{
+public:
+    //==============================================================================
+    /** A run of equally sized partitions. */
+    struct Stage final
+    {
+        int partitionSize = 0,  // In samples, which is half the size of the stage's FFT.
+            offset = 0,         // Where the stage starts in the impulse response, in samples.
+            numPartitions = 0;
+    };
+
+    /** How many times larger the tail's partitions are than the head's. */
+    static constexpr int tailPartitionMultiple = 16;
+
+    /** The largest size the tail's partitions are allowed to grow to.
+
+        NB: Beyond this, JUCE's fallback FFT engine allocates its scratch space on the heap.
+    */
+    static constexpr int maxTailPartitionSize = 8192;
+
+    //==============================================================================
+    /** @returns the partitions of an impulse response, either freshly computed
+        or shared with anyone else already using the same ones.
+
+        This can take a while for long responses, so avoid calling it from the audio thread.
+
+        @param impulseResponse      The response, which may have any number of channels.
+        @param headPartitionSize    The convolver's block size, which must be a power of 2.
+    */
+    static std::shared_ptr<const PartitionedImpulseResponse> create (const juce::AudioBuffer<float>& impulseResponse,
+                                                                     int headPartitionSize);
+
+    /** @returns the stages a response of the given length is split into.
+
+        Each tail stage starts exactly two of its partitions, less the head's, into the response.
+        This lines its output up with the head's a whole partition after its input is complete,
+        which leaves the convolver that long to render it.
+    */
+    [[nodiscard]] static std::vector<Stage> createLayout (int length, int headPartitionSize);
+
+    //==============================================================================
+    /** @returns the number of channels of the response. */
+    [[nodiscard]] int getNumChannels() const noexcept { return numChannels; }
+
+    /** @returns the length of the response, in samples. */
+    [[nodiscard]] int getLength() const noexcept { return length; }
+
+    /** @returns the size of the head's partitions, which is the convolver's block size. */
+    [[nodiscard]] int getHeadPartitionSize() const noexcept { return headPartitionSize; }
+
+    /** @returns the stages the response is split into. */
+    [[nodiscard]] const std::vector<Stage>& getStages() const noexcept { return stages; }
+
+    /** @returns the spectrum of a partition, which has the stage's partition size + 1 bins. */
+    [[nodiscard]] const std::complex<float>* getPartition (int stageIndex, int channel, int partitionIndex) const noexcept;
+
+private:
+    //==============================================================================
+    int numChannels = 0, length = 0, headPartitionSize = 0;
+    std::vector<Stage> stages;
+    std::vector<std::vector<std::complex<float>>> spectra; // One per stage, laid out as [channel][partition][bin].
+
+    //==============================================================================
+    PartitionedImpulseResponse (const juce::AudioBuffer<float>&, int headPartitionSize);
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PartitionedImpulseResponse)
+};
+
+//==============================================================================
+/** A real-time convolver for a set of PartitionedImpulseResponses,
+    mixed together by weights that can change at any time.
+
+    Every partition of input is transformed once and kept in a frequency-domain
+    delay line per stage, which all of the responses share, so each additional
+    response only costs its multiply-accumulates. Since convolution is linear,
+    the weighted sum of the responses is taken in the frequency domain.
+
+    Whenever the weights change, a stage renders its next partition with both
+    the old and the new weights, then crossfades from one to the other over the
+    partition, so that moving between responses doesn't click.
+
+    The latency is a single head partition. A tail stage has until a whole partition
+    after its input is complete to render its output, so it spreads its transforms and
+    multiply-accumulates evenly over the blocks of that partition, rather than doing
+    them all at once in the block that completes it.
+
+    Besides preparing, none of the methods allocate, and they should all be called
+    from the same thread (typically the audio thread).
+
+    @see PartitionedImpulseResponse, PositionedConvolutionProcessor
+*/
+class PartitionedConvolver final
+{
+public:
+    //==============================================================================
+    /** The most responses that can be mixed together at once. */
+    static constexpr int maxNumWeights = 4;
+
+    /** A set of responses, by index, and the gains to mix them together with. */
+    struct Weights final
+    {
+        std::array<int, maxNumWeights> indices {};
+        std::array<float, maxNumWeights> gains {};
+        int size = 0;
+
+        /** Adds a response, unless the set is already full. */
+        void add (int index, float gain) noexcept;
+
+        bool operator== (const Weights&) const noexcept;
+        bool operator!= (const Weights& other) const noexcept { return ! operator== (other); }
+    };
+
+    //==============================================================================
+    /** Constructor. */
+    PartitionedConvolver() = default;
+
+    //==============================================================================
+    /** Allocates everything needed to convolve with the given responses,
+        which must all share the same head partition size.
+    */
+    void prepare (int numChannels, std::vector<std::shared_ptr<const PartitionedImpulseResponse>> impulseResponses);
+
+    /** Clears the delay lines and any pending output. */
+    void reset() noexcept;
+
+    /** @returns the number of responses, as per prepare(). */
+    [[nodiscard]] int getNumImpulseResponses() const noexcept { return (int) impulseResponses.size(); }
+
+    /** @returns the latency, which is the head partition size. */
+    [[nodiscard]] int getLatencyInSamples() const noexcept { return headPartitionSize; }
+
+    //==============================================================================
+    /** Changes the weights, which will be crossfaded to from the current ones. */
+    void setWeights (const Weights& newWeights) noexcept { targetWeights = newWeights; }
+
+    /** Replaces the audio with its convolution, which is purely the wet signal.
+
+        Any channels beyond those prepared for are left as they are.
+    */
+    void process (float* const* channels, int numChannels, int numSamples) noexcept;
+
+private:
+    //==============================================================================
+    /** A partition being rendered, which is worked through a step at a time:
+        for each channel, a forward transform, a multiply-accumulate per partition
+        of each response, and then the mix and the inverse transform.
+
+        The steps are budgeted by what they cost, counted in multiply-accumulates,
+        and a step that overdraws the budget is paid for out of the next block's.
+    */
+    struct Render final
+    {
+        Weights previousWeights, weights;
+        std::array<int, maxNumWeights * 2> active {};   // The responses either set of weights needs.
+        int numActive = 0,
+            delayLineSlot = 0,      // Where the partition's spectrum goes in the delay line.
+            outputStart = 0,        // Where the result goes in the output ring.
+            costPerBlock = 0, budget = 0,
+            channel = 0, response = 0,
+            partition = -1;         // -1 until the channel's input has been transformed.
+    };
+
+    struct StageState final
+    {
+        int partitionSize = 0, numBins = 0, numPartitions = 0,
+            numFilled = 0, delayLineHead = 0,
+            transformCost = 0;  // Roughly what one of the FFTs costs, in multiply-accumulates.
+        std::unique_ptr<dsp::FFT> fft;
+        std::vector<float> inputs;                      // [channel][partitionSize * 2], the overlap-save windows.
+        std::vector<float> renderInputs;                // [channel][partitionSize * 2], the windows being rendered.
+        std::vector<std::complex<float>> delayLine;     // [channel][partition][bin]
+        std::vector<std::complex<float>> accumulators;  // [response][bin], for the channel being rendered.
+        Weights weights;                                // Whatever the stage last rendered with.
+        Render render;
+    };
+
+    std::vector<std::shared_ptr<const PartitionedImpulseResponse>> impulseResponses;
+    std::vector<StageState> stages;
+    std::vector<float> outputs;     // [channel][outputSize], a ring of the pending output.
+    std::vector<float> fftBuffer, previousOutput;
+    Weights targetWeights;
+    int numChannels = 0, headPartitionSize = 0, outputSize = 0, outputPosition = 0;
+
+    //==============================================================================
+    int getNumPartitions (size_t stageIndex, int impulseResponseIndex) const noexcept;
+    void startRender (size_t stageIndex) noexcept;
+    void continueRender (size_t stageIndex, bool finish) noexcept;
+    void renderOutput (StageState&, int channel) noexcept;
+    void renderMix (const StageState&, const Weights&) noexcept;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PartitionedConvolver)
+};
@@ -33,6 +33,7 @@ BitCrusherProcessor::BitCrusherProcessor() :
     resetAPVTSWithLayout (std::move (layout));
 
     setCurrentProgramDirectly (1);
+    setOversamplingFactor (2);
 }
 
 //==============================================================================
@@ -72,6 +73,10 @@ void BitCrusherProcessor::prepareToPlay (const double sampleRate, const int esti
     const auto tc = jmax (2, getTotalNumInputChannels(), getTotalNumOutputChannels());
     floatStates.resize (tc);
     doubleStates.resize (tc);
+
+    floatStage.prepare (tc, estimatedSamplesPerBlock);
+    doubleStage.prepare (tc, estimatedSamplesPerBlock);
+    setLatencySamples (floatStage.getLatencyInSamples());
 }
 
 void BitCrusherProcessor::setBitDepth (int v)                   { bitDepthParam->operator= ((float) v); }
@@ -80,10 +85,17 @@ void BitCrusherProcessor::setDownsampleFactor (int v)           { downsampleFact
 int BitCrusherProcessor::getDownsampleFactor() const noexcept   { return (int) downsampleFactorParam->get(); }
 void BitCrusherProcessor::setDrive (float v)                    { driveParam->operator= (v); }
 float BitCrusherProcessor::getDrive() const noexcept            { return driveParam->get(); }
+int BitCrusherProcessor::getOversamplingFactor() const noexcept { return floatStage.getRequestedOversamplingFactor(); }
+
+void BitCrusherProcessor::setOversamplingFactor (int factor)
+{
+    floatStage.setOversamplingFactor (factor);
+    doubleStage.setOversamplingFactor (factor);
+}
 
 //==============================================================================
-void BitCrusherProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer&)  { process<float> (buffer, floatStates); }
-void BitCrusherProcessor::processBlock (juce::AudioBuffer<double>& buffer, MidiBuffer&) { process<double> (buffer, doubleStates); }
+void BitCrusherProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer&)  { process<float> (buffer, floatStates, floatStage); }
+void BitCrusherProcessor::processBlock (juce::AudioBuffer<double>& buffer, MidiBuffer&) { process<double> (buffer, doubleStates, doubleStage); }
 
 template<typename FloatType>
 FloatType BitCrusherProcessor::crush (FloatType sample, ChannelState<FloatType>& state,
@@ -111,7 +123,8 @@ FloatType BitCrusherProcessor::crush (FloatType sample, ChannelState<FloatType>&
 }
 
 template<typename FloatType>
-void BitCrusherProcessor::process (juce::AudioBuffer<FloatType>& buffer, Array<ChannelState<FloatType>>& states)
+void BitCrusherProcessor::process (juce::AudioBuffer<FloatType>& buffer, Array<ChannelState<FloatType>>& states,
+                                   NonlinearStage<FloatType>& stage)
 {
     const auto numChannels = buffer.getNumChannels();
     const auto numSamples = buffer.getNumSamples();
@@ -123,20 +136,21 @@ void BitCrusherProcessor::process (juce::AudioBuffer<FloatType>& buffer, Array<C
 
     const auto localBitDepth = getBitDepth();
     const auto localDrive = (FloatType) getDrive();
-    const auto localDownsampleFactor = getDownsampleFactor();
     const auto levels = FloatType (1 << localBitDepth);
     const auto makeup = FloatType (1) / std::sqrt (localDrive);
 
-    auto chans = buffer.getArrayOfWritePointers();
+    // The hold is stretched by the oversampling so that the reduced rate stays the same:
+    const auto localDownsampleFactor = getDownsampleFactor() * stage.getOversamplingFactor();
 
-    for (int i = 0; i < numChannels; ++i)
+    stage.process (buffer, [&] (FloatType* samples, int numOversampledSamples, int channel)
     {
-        if (auto chan = chans[i])
-        {
-            auto& state = states.getReference (i);
-            for (int f = 0; f < numSamples; ++f)
-                chan[f] = crush (chan[f], state, levels, makeup, localDrive, localDownsampleFactor);
-        }
-    }
+        if (! isPositiveAndBelow (channel, states.size()))
+            return;
+
+        auto& state = states.getReference (channel);
+
+        for (int f = 0; f < numOversampledSamples; ++f)
+            samples[f] = crush (samples[f], state, levels, makeup, localDrive, localDownsampleFactor);
+    });
 }
 
@@ -24,6 +24,16 @@ public:
     /** */
     [[nodiscard]] float getDrive() const noexcept;
 
+    /** Changes how much the crushing is oversampled by, which must be 1, 2, 4 or 8.
+
+        This takes effect the next time the processor is prepared,
+        and the latency it adds is reported then.
+    */
+    void setOversamplingFactor (int);
+
+    /** @returns how much the crushing is oversampled by. */
+    [[nodiscard]] int getOversamplingFactor() const noexcept;
+
     //==============================================================================
     /** @internal */
     const String getName() const override { return NEEDS_TRANS ("Bit Crusher"); }
@@ -95,6 +105,9 @@ private:
     Array<ChannelState<float>> floatStates;
     Array<ChannelState<double>> doubleStates;
 
+    NonlinearStage<float> floatStage;
+    NonlinearStage<double> doubleStage;
+
     //==============================================================================
     void setCurrentProgramDirectly (int);
 
@@ -104,7 +117,8 @@ private:
                             FloatType drive, int dsFactor);
 
     template<typename FloatType>
-    void process (juce::AudioBuffer<FloatType>& buffer, Array<ChannelState<FloatType>>& states);
+    void process (juce::AudioBuffer<FloatType>& buffer, Array<ChannelState<FloatType>>& states,
+                  NonlinearStage<FloatType>& stage);
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BitCrusherProcessor)
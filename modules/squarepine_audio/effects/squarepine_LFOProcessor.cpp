@@ -2,21 +2,13 @@
 class LFOProcessor::TypeParameter final : public AudioParameterChoice
 {
 public:
-    TypeParameter (LFOProcessor& p) :
+    TypeParameter() :
         AudioParameterChoice (ParameterID ("type", 1), TRANS ("Type"), getChoices(),
-                              static_cast<int> (LFOProcessor::LFOType::sine)),
-        parentProc (p)
+                              static_cast<int> (LFOProcessor::LFOType::sine))
     {
     }
 
-    void valueChanged (int) override
-    {
-        parentProc.setLFOType (parentProc.getLFOType(), true);
-    }
-
 private:
-    LFOProcessor& parentProc;
-
     static StringArray getChoices()
     {
         StringArray choices;
@@ -48,7 +40,7 @@ LFOProcessor::LFOProcessor (double minFreqHz, double maxFreqHz,
 
     auto layout = createDefaultParameterLayout();
 
-    auto tp = std::make_unique<TypeParameter> (*this);
+    auto tp = std::make_unique<TypeParameter>();
     type = tp.get();
     layout.add (std::move (tp));
 
@@ -58,49 +50,10 @@ LFOProcessor::LFOProcessor (double minFreqHz, double maxFreqHz,
     layout.add (std::move (pf));
 
     resetAPVTSWithLayout (std::move (layout));
-
-    setLFOType (LFOType::sine);
 }
 
 //==============================================================================
-template<typename FloatType>
-void LFOProcessor::setLFOType (dsp::Oscillator<FloatType>& osc, LFOType lfoType)
-{
-    std::function<FloatType (FloatType)> func;
-
-    switch (lfoType)
-    {
-        case LFOType::sine:             func = (FloatType (*) (FloatType)) &std::sin; break;
-        case LFOType::cosine:           func = (FloatType (*) (FloatType)) &std::cos; break;
-        case LFOType::tangent:          func = (FloatType (*) (FloatType)) &std::tan; break;
-        case LFOType::triangle:         func = oscillatorFunctions::triangle<FloatType>; break;
-        case LFOType::ramp:             func = oscillatorFunctions::ramp<FloatType>; break;
-        case LFOType::sawtooth:         func = oscillatorFunctions::saw<FloatType>; break;
-        case LFOType::square:           func = oscillatorFunctions::square<FloatType>; break;
-        case LFOType::whiteNoise:       func = [this] (FloatType v) { return whiteNoiseGenerator.process (v); }; break;
-        case LFOType::pinkNoise:        func = [this] (FloatType v) { return pinkNoiseGenerator.process (v); }; break;
-        case LFOType::blueNoise:        func = [this] (FloatType v) { return blueNoiseGenerator.process (v); }; break;
-        case LFOType::brownianNoise:    func = [this] (FloatType v) { return brownianNoiseGenerator.process (v); }; break;
-
-        default:
-            jassertfalse;
-        break;
-    };
-
-    osc.initialise (func);
-}
-
-void LFOProcessor::setLFOType (LFOType lfoType, bool force)
-{
-    if (! force)
-        if (type == nullptr || type->getIndex() == static_cast<int> (lfoType))
-            return;
-
-    setLFOType (floatOsc, lfoType);
-    setLFOType (doubleOsc, lfoType);
-}
-
-void LFOProcessor::setLFOType (LFOType lfoType)             { setLFOType (lfoType, true); }
+void LFOProcessor::setLFOType (LFOType lfoType)             { *type = static_cast<int> (lfoType); }
 void LFOProcessor::setFrequencyHz (double newFrequency)     { *frequency = (float) newFrequency; }
 void LFOProcessor::setFrequency (const Pitch& pitch)        { setFrequencyHz (pitch.getFrequencyHz()); }
 void LFOProcessor::setFrequencyFromMidiNote (int midiNote)  { setFrequencyHz (MidiMessage::getMidiNoteInHertz (midiNote)); }
@@ -113,65 +66,52 @@ void LFOProcessor::prepareToPlay (const double newSampleRate, const int samplesP
 {
     setRateAndBufferSizeDetails (newSampleRate, samplesPerBlock);
 
-    const auto numChans = std::max (getTotalNumInputChannels(), getTotalNumOutputChannels());
-
-    floatMulter.setSize (numChans, samplesPerBlock, false, true, true);
-    doubleMulter.setSize (numChans, samplesPerBlock, false, true, true);
-
-    const dsp::ProcessSpec spec =
-    {
-        newSampleRate,
-        (uint32) samplesPerBlock,
-        (uint32) numChans
-    };
-
-    floatOsc.prepare (spec);
-    doubleOsc.prepare (spec);
+    lfoBuffer.setSize (1, samplesPerBlock, false, true, true);
 
-    if (isFirstRun)
-    {
-        setLFOType (getLFOType(), true);
-        isFirstRun = false;
-    }
+    bank.prepare (newSampleRate, 1);
+    bank.setWaveform (0, getLFOType());
+    bank.reset();
 }
 
 //==============================================================================
 template<typename FloatType>
-void LFOProcessor::process (dsp::Oscillator<FloatType>& osc,
-                            juce::AudioBuffer<FloatType>& multer,
-                            juce::AudioBuffer<FloatType>& buffer)
+void LFOProcessor::process (juce::AudioBuffer<FloatType>& buffer)
 {
-    {
-        const auto v = getFrequencyHz();
-        floatOsc.setFrequency ((float) v);
-        doubleOsc.setFrequency (v);
-    }
+    const auto numSamples = buffer.getNumSamples();
+
+    bank.setFrequency (0, getFrequencyHz());
+    bank.setWaveform (0, getLFOType());
 
     if (isBypassed())
+    {
+        bank.advance (numSamples);
+        controlValue.store (bank.getControlValues()[0], std::memory_order_relaxed);
         return;
+    }
 
-    if (isMultiplying)
-    {
-        multer.setSize (buffer.getNumChannels(), buffer.getNumSamples(), false, true, true);
-        multer.clear();
+    // NB: This only allocates if the host didn't respect the prepared block size.
+    lfoBuffer.setSize (1, numSamples, false, false, true);
+
+    auto* lfo = lfoBuffer.getWritePointer (0);
+    bank.process (&lfo, numSamples);
+    controlValue.store (bank.getControlValues()[0], std::memory_order_relaxed);
 
-        dsp::AudioBlock<FloatType> abMulter (multer);
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+    {
+        auto* dest = buffer.getWritePointer (c);
 
+        if (isMultiplying)
         {
-            dsp::ProcessContextReplacing<FloatType> context (abMulter);
-            osc.process (context);
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] *= static_cast<FloatType> (lfo[i]);
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = static_cast<FloatType> (lfo[i]);
         }
-
-        dsp::AudioBlock<FloatType> (buffer)
-            .multiplyBy (abMulter);
-    }
-    else
-    {
-        dsp::AudioBlock<FloatType> audioBlock (buffer);
-        dsp::ProcessContextReplacing<FloatType> context (audioBlock);
-        osc.process (context);
     }
 }
 
-void LFOProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer&)     { process (floatOsc, floatMulter, buffer); }
-void LFOProcessor::processBlock (juce::AudioBuffer<double>& buffer, MidiBuffer&)    { process (doubleOsc, doubleMulter, buffer); }
+void LFOProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer&)     { process (buffer); }
+void LFOProcessor::processBlock (juce::AudioBuffer<double>& buffer, MidiBuffer&)    { process (buffer); }
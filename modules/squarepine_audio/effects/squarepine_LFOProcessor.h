@@ -1,30 +1,39 @@
 //==============================================================================
+/** The formulas the LFOProcessor used before it read from a WavetableLFOBank.
+
+    These are only kept for existing code; the bank's waveforms differ in places
+    (eg: LFOWaveform::ramp rises from 0 to 1 over the whole cycle, unlike ramp() here).
+*/
 namespace oscillatorFunctions
 {
-    /** */
+    /** @deprecated Use a WavetableLFOBank with LFOWaveform::triangle instead. */
     template<typename FloatType>
+    [[deprecated ("Please use a WavetableLFOBank instead.")]]
     inline constexpr FloatType triangle (FloatType phase)
     {
         return static_cast<FloatType> (1)
                - (static_cast<FloatType> (4) * cabs (phase - static_cast<FloatType> (0.5)));
     }
 
-    /** */
+    /** @deprecated Use a WavetableLFOBank with LFOWaveform::ramp instead. */
     template<typename FloatType>
+    [[deprecated ("Please use a WavetableLFOBank instead.")]]
     inline constexpr FloatType ramp (FloatType phase)
     {
         return (phase + cabs (phase)) * static_cast<FloatType> (0.5);
     }
 
-    /** */
+    /** @deprecated Use a WavetableLFOBank with LFOWaveform::sawtooth instead. */
     template<typename FloatType>
+    [[deprecated ("Please use a WavetableLFOBank instead.")]]
     inline constexpr FloatType saw (FloatType phase)
     {
         return (phase * static_cast<FloatType> (2)) - static_cast<FloatType> (1);
     }
 
-    /** */
+    /** @deprecated Use a WavetableLFOBank with LFOWaveform::square instead. */
     template<typename FloatType>
+    [[deprecated ("Please use a WavetableLFOBank instead.")]]
     inline constexpr FloatType square (FloatType phase)
     {
         constexpr auto one = static_cast<FloatType> (1);
@@ -39,8 +48,11 @@ namespace oscillatorFunctions
         virtual ~NoiseFunctionGenerator() noexcept = default;
     };
 
-    /** White noise generator using Gaussian distribution. */
-    struct WhiteNoiseGenerator final : NoiseFunctionGenerator
+    /** White noise generator using Gaussian distribution.
+
+        @deprecated Use a WavetableLFOBank with LFOWaveform::whiteNoise instead.
+    */
+    struct [[deprecated ("Please use a WavetableLFOBank instead.")]] WhiteNoiseGenerator final : NoiseFunctionGenerator
     {
         WhiteNoiseGenerator() noexcept = default;
 
@@ -54,8 +66,11 @@ namespace oscillatorFunctions
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WhiteNoiseGenerator)
     };
 
-    /** Pink noise generator. */
-    struct PinkNoiseGenerator final : NoiseFunctionGenerator
+    /** Pink noise generator.
+
+        @deprecated Use a WavetableLFOBank with LFOWaveform::pinkNoise instead.
+    */
+    struct [[deprecated ("Please use a WavetableLFOBank instead.")]] PinkNoiseGenerator final : NoiseFunctionGenerator
     {
         PinkNoiseGenerator() noexcept = default;
 
@@ -69,8 +84,11 @@ namespace oscillatorFunctions
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PinkNoiseGenerator)
     };
 
-    /** Blue noise generator. */
-    struct BlueNoiseGenerator final : NoiseFunctionGenerator
+    /** Blue noise generator.
+
+        @deprecated Use a WavetableLFOBank with LFOWaveform::blueNoise instead.
+    */
+    struct [[deprecated ("Please use a WavetableLFOBank instead.")]] BlueNoiseGenerator final : NoiseFunctionGenerator
     {
         BlueNoiseGenerator() noexcept = default;
 
@@ -84,8 +102,11 @@ namespace oscillatorFunctions
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlueNoiseGenerator)
     };
 
-    /** Brownian noise generator. */
-    struct BrownianNoiseGenerator final : NoiseFunctionGenerator
+    /** Brownian noise generator.
+
+        @deprecated Use a WavetableLFOBank with LFOWaveform::brownianNoise instead.
+    */
+    struct [[deprecated ("Please use a WavetableLFOBank instead.")]] BrownianNoiseGenerator final : NoiseFunctionGenerator
     {
         BrownianNoiseGenerator() noexcept = default;
 
@@ -107,6 +128,9 @@ namespace oscillatorFunctions
     identical functionality and properties for generator purposes;
     to do so, change the values in the constructor to something suitable
     for your needs.
+
+    The waveforms are read from band-limited wavetables (see WavetableLFOBank),
+    and changing the type crossfades to the new one.
 */
 class LFOProcessor final : public InternalProcessor
 {
@@ -127,20 +151,7 @@ public:
 
     //==============================================================================
     /** The type of wave generator function you want to use. */
-    enum class LFOType
-    {
-        sine,
-        cosine,
-        tangent,
-        triangle,
-        ramp,
-        sawtooth,
-        square,
-        whiteNoise,
-        pinkNoise,
-        blueNoise,
-        brownianNoise
-    };
+    using LFOType = LFOWaveform;
 
     /** Changes the current LFO function. */
     void setLFOType (LFOType);
@@ -162,6 +173,13 @@ public:
     /** @returns the currently set frequency as a Pitch object. */
     Pitch getFrequencyPitch() const;
 
+    /** @returns the LFO's value as of the last processed block.
+
+        This is meant for other processors to read as a modulation source,
+        and may be called from any thread.
+    */
+    float getControlValue() const noexcept { return controlValue.load (std::memory_order_relaxed); }
+
     //==============================================================================
     /** @internal */
     Identifier getIdentifier() const override { return "LFO"; }
@@ -177,33 +195,18 @@ public:
 private:
     //==============================================================================
     const bool isMultiplying = true;
-    bool isFirstRun = true;
-
-    oscillatorFunctions::WhiteNoiseGenerator whiteNoiseGenerator;
-    oscillatorFunctions::PinkNoiseGenerator pinkNoiseGenerator;
-    oscillatorFunctions::BlueNoiseGenerator blueNoiseGenerator;
-    oscillatorFunctions::BrownianNoiseGenerator brownianNoiseGenerator;
-
-    juce::AudioBuffer<float> floatMulter;
-    juce::AudioBuffer<double> doubleMulter;
 
-    dsp::Oscillator<float> floatOsc;
-    dsp::Oscillator<double> doubleOsc;
+    WavetableLFOBank bank;
+    juce::AudioBuffer<float> lfoBuffer;
+    std::atomic<float> controlValue { 0.0f };
 
     class TypeParameter;
     AudioParameterChoice* type = nullptr;
     AudioParameterFloat* frequency = nullptr;
 
     //==============================================================================
-    void setLFOType (LFOType, bool force);
-
-    template<typename FloatType>
-    void setLFOType (dsp::Oscillator<FloatType>&, LFOType);
-
     template<typename FloatType>
-    void process (dsp::Oscillator<FloatType>&,
-                  juce::AudioBuffer<FloatType>& multer,
-                  juce::AudioBuffer<FloatType>& buffer);
+    void process (juce::AudioBuffer<FloatType>&);
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LFOProcessor)
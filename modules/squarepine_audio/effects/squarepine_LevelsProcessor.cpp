@@ -16,6 +16,7 @@ private:
         choices.add (NEEDS_TRANS ("Peak"));
         choices.add (NEEDS_TRANS ("RMS"));
         choices.add (NEEDS_TRANS ("Mid/Side"));
+        choices.add (NEEDS_TRANS ("True Peak"));
         return choices;
     }
 
@@ -46,16 +47,47 @@ MeteringMode LevelsProcessor::getMeteringMode() const
     return static_cast<MeteringMode> (meteringModeParam->getIndex());
 }
 
-void LevelsProcessor::getChannelLevels (Array<float>& destData)
+float LevelsProcessor::getLevel (const MeterSnapshotTransport::ChannelLevels& levels, MeteringMode mode) noexcept
 {
-    destData = floatChannelDetails.channels;
+    switch (mode)
+    {
+        case MeteringMode::peak:        return levels.peak;
+        case MeteringMode::rms:         return levels.rms;
+        case MeteringMode::midSide:     return levels.peak;
+        case MeteringMode::truePeak:    return levels.truePeak;
+
+        default:
+            jassertfalse;
+        break;
+    };
+
+    return 0.0f;
+}
+
+template<typename FloatType>
+void LevelsProcessor::copyLevels (Array<FloatType>& destData)
+{
+    if (! transport.read (lastSnapshot))
+        return;
+
+    const auto mode = getMeteringMode();
+
+    destData.clearQuick();
+    destData.ensureStorageAllocated (lastSnapshot.numChannels);
+
+    for (int i = 0; i < lastSnapshot.numChannels; ++i)
+        destData.add (static_cast<FloatType> (getLevel (lastSnapshot.channels[(size_t) i], mode)));
 }
 
-void LevelsProcessor::getChannelLevels (Array<double>& destData)
+MeterSnapshotTransport::Loudness LevelsProcessor::getLoudness()
 {
-    destData = doubleChannelDetails.channels;
+    transport.read (lastSnapshot);
+    return lastSnapshot.loudness;
 }
 
+void LevelsProcessor::getChannelLevels (Array<float>& destData)     { copyLevels (destData); }
+void LevelsProcessor::getChannelLevels (Array<double>& destData)    { copyLevels (destData); }
+
 //==============================================================================
 void LevelsProcessor::prepareToPlay (double newSampleRate, int newBufferSize)
 {
@@ -63,8 +95,14 @@ void LevelsProcessor::prepareToPlay (double newSampleRate, int newBufferSize)
 
     const auto numChannels = std::max (getTotalNumInputChannels(), getTotalNumOutputChannels());
 
-    floatChannelDetails.prepare (numChannels);
-    doubleChannelDetails.prepare (numChannels);
+    // Any channels beyond this won't be measured!
+    jassert (numChannels <= MeterSnapshotTransport::maxNumChannels);
+
+    const auto layout = getBusCount (true) > 0 ? getChannelLayoutOfBus (true, 0) : AudioChannelSet();
+
+    engine.prepare (newSampleRate, numChannels, layout);
+    engine.ensureBlockSize (newBufferSize);
+    transport.publishSilence (numChannels);
 }
 
 void LevelsProcessor::processBlock (juce::AudioBuffer<float>& b, MidiBuffer&)   { process (b); }
@@ -73,12 +111,17 @@ void LevelsProcessor::processBlock (juce::AudioBuffer<double>& b, MidiBuffer&)
 template<typename FloatType>
 void LevelsProcessor::process (juce::AudioBuffer<FloatType>& buffer)
 {
-    volatile ScopedNoDenormals noDenormals;
-    ignoreUnused (noDenormals);
+    const ScopedNoDenormals noDenormals;
 
-    const auto mode = getMeteringMode();
-    const auto b = isBypassed();
+    const auto numChannels = std::min (buffer.getNumChannels(), MeterSnapshotTransport::maxNumChannels);
+    const auto numSamples = buffer.getNumSamples();
+
+    if (isBypassed() || numSamples <= 0)
+    {
+        transport.publishSilence (numChannels);
+        return;
+    }
 
-    floatChannelDetails.process (buffer, mode, b);
-    doubleChannelDetails.process (buffer, mode, b);
+    engine.process (buffer, numSamples, getMeteringMode() == MeteringMode::midSide);
+    transport.publish (engine.getChannelLevels(), std::min (numChannels, engine.getNumChannels()), engine.getLoudness());
 }
@@ -6,14 +6,19 @@ enum class MeteringMode
 {
     peak = 0,
     rms,
-    midSide
+    midSide,    // The first two channels are measured as mid and side, by their peaks.
+    truePeak    // The 4x oversampled peaks, as per ITU-R BS.1770.
 };
 
 /** Use an instance of this within an audio callback of some kind,
     and call getChannelLevels (on the main thread) to get the
     last known audio levels.
 
-    @see MeteringMode, Meter
+    The levels are handed over through a MeterSnapshotTransport,
+    which can also be polled directly (eg: by a Meter) without
+    locking or allocating.
+
+    @see MeteringMode, Meter, MeterSnapshotTransport
 */
 class LevelsProcessor final : public InternalProcessor
 {
@@ -22,11 +27,43 @@ public:
     LevelsProcessor();
 
     //==============================================================================
-    /** */
+    /** Copies the last known levels, as measured by the current MeteringMode.
+
+        If the levels are being updated at the time of calling,
+        the destination is left as it was.
+    */
     void getChannelLevels (Array<float>& destData);
-    /** */
+    /** Copies the last known levels, as measured by the current MeteringMode.
+
+        If the levels are being updated at the time of calling,
+        the destination is left as it was.
+    */
     void getChannelLevels (Array<double>& destData);
 
+    /** @returns the transport that the levels are published to from the audio thread. */
+    [[nodiscard]] const MeterSnapshotTransport& getSnapshotTransport() const noexcept { return transport; }
+
+    /** @returns the level of a channel as measured by the given mode. */
+    [[nodiscard]] static float getLevel (const MeterSnapshotTransport::ChannelLevels&, MeteringMode) noexcept;
+
+    /** @returns the last known momentary, short-term and integrated loudness. */
+    [[nodiscard]] MeterSnapshotTransport::Loudness getLoudness();
+
+    //==============================================================================
+    /** Changes the integration time of the RMS levels, which is 300 ms by default.
+
+        This can be called from any thread.
+
+        @see MeteringEngine::maxRMSWindowSeconds
+    */
+    void setRMSWindowSeconds (double seconds) noexcept { engine.setRMSWindowSeconds (seconds); }
+
+    /** @returns the integration time of the RMS levels. */
+    [[nodiscard]] double getRMSWindowSeconds() const noexcept { return engine.getRMSWindowSeconds(); }
+
+    /** Restarts the integrated loudness measurement. This can be called from any thread. */
+    void resetIntegratedLoudness() noexcept { engine.resetIntegratedLoudness(); }
+
     //==============================================================================
     /** Changes the mode of analysis for the audio levels. */
     void setMeteringMode (MeteringMode);
@@ -50,72 +87,20 @@ public:
 
 private:
     //==============================================================================
-    /** Stores the resulting measured levels depending on the MeteringMode. */
-    template<typename FloatType>
-    struct ChannelDetails final
-    {
-        void prepare (int numChannels)
-        {
-            for (auto& a : { &channels, &tempBuffer })
-            {
-                a->resize (numChannels);
-                a->fill (static_cast<FloatType> (0));
-            }
-        }
-
-        template<typename OtherFloatType>
-        void process (juce::AudioBuffer<OtherFloatType>& buffer,
-                      MeteringMode meteringMode,
-                      bool possiblyBypassed)
-        {
-            tempBuffer.fill (static_cast<FloatType> (0));
-
-            if (! possiblyBypassed)
-            {
-                const auto numChannels = std::min (buffer.getNumChannels(), tempBuffer.size());
-
-                switch (meteringMode)
-                {
-                    case MeteringMode::peak:
-                        for (int i = 0; i < numChannels; ++i)
-                            tempBuffer.set (i, (FloatType) buffer.getMagnitude (i, 0, buffer.getNumSamples()));
-                    break;
-
-                    case MeteringMode::rms:
-                        for (int i = 0; i < numChannels; ++i)
-                            tempBuffer.set (i, (FloatType) buffer.getRMSLevel (i, 0, buffer.getNumSamples()));
-                    break;
-
-                    case MeteringMode::midSide:
-                        for (int i = 0; i < numChannels; ++i)
-                        {
-                            const auto v = buffer.getMagnitude (i, 0, buffer.getNumSamples());
-                            tempBuffer.set (i, (FloatType) square (v));
-                        }
-                    break;
-
-                    default:
-                        jassertfalse;
-                    break;
-                };
-            }
-
-            channels.swapWith (tempBuffer);
-        }
-
-        Array<FloatType> channels, tempBuffer;
-    };
-
     class MeteringModeParameter;
     MeteringModeParameter* meteringModeParam = nullptr;
 
-    ChannelDetails<float> floatChannelDetails;
-    ChannelDetails<double> doubleChannelDetails;
+    MeterSnapshotTransport transport;
+    MeteringEngine engine;                          // Audio thread only.
+    MeterSnapshotTransport::Snapshot lastSnapshot;  // Reader only.
 
     //==============================================================================
     template<typename FloatType>
     void process (juce::AudioBuffer<FloatType>&);
 
+    template<typename FloatType>
+    void copyLevels (Array<FloatType>&);
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelsProcessor)
 };
@@ -0,0 +1,196 @@
+PositionedConvolutionProcessor::PositionedConvolutionProcessor() :
+    InternalProcessor (false)
+{
+    auto layout = createDefaultParameterLayout();
+
+    auto addPositionParam = [&] (StringRef id, StringRef name)
+    {
+        auto newParam = std::make_unique<AudioParameterFloat> (ParameterID (id, 1), name, 0.0f, 1.0f, 0.5f);
+        auto* np = newParam.get();
+        layout.add (std::move (newParam));
+        return np;
+    };
+
+    listenerX = addPositionParam ("listenerX", NEEDS_TRANS ("Listener X"));
+    listenerY = addPositionParam ("listenerY", NEEDS_TRANS ("Listener Y"));
+
+    resetAPVTSWithLayout (std::move (layout));
+}
+
+//==============================================================================
+void PositionedConvolutionProcessor::setImpulseResponses (const Array<PositionedImpulseResponse>& newImpulseResponses)
+{
+    impulseResponses = newImpulseResponses;
+
+    if (headPartitionSize > 0)
+    {
+        swapEngine (createEngine());
+        updateLatency();
+    }
+}
+
+void PositionedConvolutionProcessor::setListenerPosition (juce::Point<float> newPosition)
+{
+    *listenerX = newPosition.x;
+    *listenerY = newPosition.y;
+}
+
+juce::Point<float> PositionedConvolutionProcessor::getListenerPosition() const noexcept
+{
+    return { listenerX->get(), listenerY->get() };
+}
+
+void PositionedConvolutionProcessor::setNumNearestImpulseResponses (int newNumNearest) noexcept
+{
+    numNearest = jlimit (1, PartitionedConvolver::maxNumWeights, newNumNearest);
+}
+
+//==============================================================================
+std::unique_ptr<PositionedConvolutionProcessor::Engine> PositionedConvolutionProcessor::createEngine() const
+{
+    auto newEngine = std::make_unique<Engine>();
+
+    std::vector<std::shared_ptr<const PartitionedImpulseResponse>> partitions;
+    partitions.reserve ((size_t) impulseResponses.size());
+
+    for (const auto& ir : impulseResponses)
+    {
+        partitions.push_back (PartitionedImpulseResponse::create (ir.impulseResponse, headPartitionSize));
+        newEngine->locations.add (PositionedImpulseResponse ({}, ir.position));
+    }
+
+    const auto numChans = std::max (1, std::max (getTotalNumInputChannels(), getTotalNumOutputChannels()));
+    newEngine->convolver.prepare (numChans, std::move (partitions));
+    newEngine->convolver.setWeights (calculateWeights (*newEngine));
+    newEngine->convolver.reset();
+    return newEngine;
+}
+
+void PositionedConvolutionProcessor::swapEngine (std::unique_ptr<Engine> newEngine)
+{
+    {
+        const SpinLock::ScopedLockType sl (engineLock);
+        std::swap (engine, newEngine);
+    }
+
+    // NB: The old engine is destroyed here, outside of the lock.
+    newEngine.reset();
+}
+
+void PositionedConvolutionProcessor::updateLatency()
+{
+    // NB: Without any responses, the audio passes straight through, so there's nothing to compensate for.
+    setLatencySamples (impulseResponses.isEmpty() ? 0 : headPartitionSize);
+}
+
+PartitionedConvolver::Weights PositionedConvolutionProcessor::calculateWeights (const Engine& e) const noexcept
+{
+    constexpr auto maxNumNearest = PartitionedConvolver::maxNumWeights;
+
+    const auto listener = getListenerPosition();
+    const auto numToBlend = jlimit (1, maxNumNearest, numNearest.load());
+
+    // Keeps the nearest responses sorted, plus one more for fading out the furthest of them:
+    std::array<int, maxNumNearest + 1> indices {};
+    std::array<float, maxNumNearest + 1> distances {};
+    int numFound = 0;
+
+    for (int i = 0; i < e.locations.size(); ++i)
+    {
+        const auto distance = e.locations.getReference (i).distanceFrom (listener);
+
+        if (numFound == numToBlend + 1 && distance >= distances[(size_t) numToBlend])
+            continue;
+
+        auto pos = std::min (numFound, numToBlend);
+
+        for (; pos > 0 && distances[(size_t) pos - 1] > distance; --pos)
+        {
+            indices[(size_t) pos] = indices[(size_t) pos - 1];
+            distances[(size_t) pos] = distances[(size_t) pos - 1];
+        }
+
+        indices[(size_t) pos] = i;
+        distances[(size_t) pos] = distance;
+        numFound = std::min (numFound + 1, numToBlend + 1);
+    }
+
+    PartitionedConvolver::Weights weights;
+
+    if (numFound == 0)
+        return weights;
+
+    constexpr auto minDistance = 1.0e-6f;
+
+    if (distances.front() <= minDistance)
+    {
+        weights.add (indices.front(), 1.0f);
+        return weights;
+    }
+
+    const auto numBlended = std::min (numFound, numToBlend);
+    const auto cutoff = numFound > numToBlend ? 1.0f / distances[(size_t) numToBlend] : 0.0f;
+
+    std::array<float, maxNumNearest> gains {};
+    auto total = 0.0f;
+
+    for (size_t i = 0; i < (size_t) numBlended; ++i)
+    {
+        gains[i] = std::max (0.0f, 1.0f / distances[i] - cutoff);
+        total += gains[i];
+    }
+
+    // When several responses are equally far away, the next nearest ties with the furthest blended one:
+    if (total <= 0.0f)
+    {
+        weights.add (indices.front(), 1.0f);
+        return weights;
+    }
+
+    for (size_t i = 0; i < (size_t) numBlended; ++i)
+        if (gains[i] > 0.0f)
+            weights.add (indices[i], gains[i] / total);
+
+    return weights;
+}
+
+//==============================================================================
+void PositionedConvolutionProcessor::prepareToPlay (const double newSampleRate, const int bufferSize)
+{
+    setRateAndBufferSizeDetails (newSampleRate, bufferSize);
+
+    headPartitionSize = jlimit (64, 4096, nextPowerOfTwo (std::max (1, bufferSize)));
+    swapEngine (createEngine());
+    updateLatency();
+}
+
+void PositionedConvolutionProcessor::releaseResources()
+{
+    const SpinLock::ScopedLockType sl (engineLock);
+
+    if (engine != nullptr)
+        engine->convolver.reset();
+}
+
+void PositionedConvolutionProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    const auto numSamples = buffer.getNumSamples();
+
+    if (isBypassed() || numSamples <= 0)
+        return;
+
+    // NB: The engine is only ever swapped for a moment, in which case this block is silent.
+    const SpinLock::ScopedTryLockType sl (engineLock);
+
+    if (! sl.isLocked())
+    {
+        buffer.clear();
+        return;
+    }
+
+    if (engine == nullptr || engine->locations.isEmpty())
+        return;
+
+    engine->convolver.setWeights (calculateWeights (*engine));
+    engine->convolver.process (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numSamples);
+}
@@ -0,0 +1,90 @@
+/** Convolves the audio with a set of PositionedImpulseResponses,
+    blending between the ones nearest to a listener's position.
+
+    The listener's position is a pair of parameters, so it can be automated.
+    The nearest responses are weighted by the inverse of their distances,
+    less that of the next nearest one, so a response fades all the way out
+    before another takes its place. The PartitionedConvolver crossfades
+    whenever the weights change, so the listener can move freely without clicks.
+
+    The responses are partitioned for the block size given to prepareToPlay(),
+    and are shared with any other instances using the same ones.
+    The latency is a single partition, which is the block size rounded up to a power of 2,
+    though there's none whilst there are no responses and the audio passes straight through.
+
+    @see PositionedImpulseResponse, PartitionedConvolver
+*/
+class PositionedConvolutionProcessor final : public InternalProcessor
+{
+public:
+    /** Constructor. */
+    PositionedConvolutionProcessor();
+
+    //==============================================================================
+    /** Replaces the impulse responses.
+
+        If this processor is already prepared, the responses are partitioned
+        before being swapped in, so call this from the message thread.
+        The latency changes to suit whether there are any responses at all.
+    */
+    void setImpulseResponses (const Array<PositionedImpulseResponse>& newImpulseResponses);
+
+    /** @returns the number of impulse responses. */
+    [[nodiscard]] int getNumImpulseResponses() const noexcept { return impulseResponses.size(); }
+
+    //==============================================================================
+    /** Moves the listener, whose coordinates are normalised from 0 to 1
+        as per the PositionedImpulseResponse's.
+    */
+    void setListenerPosition (juce::Point<float> newPosition);
+
+    /** @returns the listener's position. */
+    [[nodiscard]] juce::Point<float> getListenerPosition() const noexcept;
+
+    /** Changes how many of the nearest impulse responses are blended together,
+        which is clamped from 1 to PartitionedConvolver::maxNumWeights.
+    */
+    void setNumNearestImpulseResponses (int newNumNearest) noexcept;
+
+    /** @returns how many of the nearest impulse responses are blended together. */
+    [[nodiscard]] int getNumNearestImpulseResponses() const noexcept { return numNearest.load(); }
+
+    //==============================================================================
+    /** @internal */
+    const String getName() const override { return NEEDS_TRANS ("Positioned Convolution"); }
+    /** @internal */
+    Identifier getIdentifier() const override { return "positionedConvolution"; }
+    /** @internal */
+    void prepareToPlay (double, int) override;
+    /** @internal */
+    void releaseResources() override;
+    /** @internal */
+    void processBlock (juce::AudioBuffer<float>&, MidiBuffer&) override;
+
+private:
+    //==============================================================================
+    /** What the audio thread works with, which is swapped out as a whole. */
+    struct Engine final
+    {
+        PartitionedConvolver convolver;
+        Array<PositionedImpulseResponse> locations; // Only the positions; the audio lives in the partitions.
+    };
+
+    Array<PositionedImpulseResponse> impulseResponses;
+    std::unique_ptr<Engine> engine;
+    SpinLock engineLock;
+
+    AudioParameterFloat* listenerX = nullptr;
+    AudioParameterFloat* listenerY = nullptr;
+    std::atomic<int> numNearest { 3 };
+    int headPartitionSize = 0;
+
+    //==============================================================================
+    std::unique_ptr<Engine> createEngine() const;
+    void swapEngine (std::unique_ptr<Engine>);
+    void updateLatency();
+    PartitionedConvolver::Weights calculateWeights (const Engine&) const noexcept;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PositionedConvolutionProcessor)
+};
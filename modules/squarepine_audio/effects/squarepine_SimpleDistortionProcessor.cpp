@@ -24,24 +24,47 @@ SimpleDistortionProcessor::SimpleDistortionProcessor() :
     amountParameter = ap.get();
     layout.add (std::move (ap));
     resetAPVTSWithLayout (std::move (layout));
+
+    floatStage.setShape (NonlinearStage<float>::Shape::sigmoid);
+    floatStage.setAntiderivativeAntialiasing (true);
+    doubleStage.setShape (NonlinearStage<double>::Shape::sigmoid);
+    doubleStage.setAntiderivativeAntialiasing (true);
+    setOversamplingFactor (2);
+}
+
+//==============================================================================
+void SimpleDistortionProcessor::setOversamplingFactor (int factor)
+{
+    floatStage.setOversamplingFactor (factor);
+    doubleStage.setOversamplingFactor (factor);
+}
+
+int SimpleDistortionProcessor::getOversamplingFactor() const noexcept
+{
+    return floatStage.getRequestedOversamplingFactor();
 }
 
 //==============================================================================
 void SimpleDistortionProcessor::prepareToPlay (double newSampleRate, int samplesPerBlock)
 {
     setRateAndBufferSizeDetails (newSampleRate, samplesPerBlock);
+
+    const auto numChans = std::max (getTotalNumInputChannels(), getTotalNumOutputChannels());
+    floatStage.prepare (numChans, samplesPerBlock);
+    doubleStage.prepare (numChans, samplesPerBlock);
+    setLatencySamples (floatStage.getLatencyInSamples());
 }
 
 template<typename FloatType>
-void SimpleDistortionProcessor::process (juce::AudioBuffer<FloatType>& buffer)
+void SimpleDistortionProcessor::process (juce::AudioBuffer<FloatType>& buffer, NonlinearStage<FloatType>& stage)
 {
     if (isBypassed())
         return;
 
-    using DistFuncs = DistortionFunctions<FloatType>;
-    const auto d = static_cast<FloatType> (amountParameter->get());
-    DistFuncs::perform (buffer, DistFuncs::sigmoid, d, static_cast<FloatType> (100));
+    stage.setDrive (static_cast<FloatType> (amountParameter->get()));
+    stage.setRange (static_cast<FloatType> (100));
+    stage.process (buffer);
 }
 
-void SimpleDistortionProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer&)    { process (buffer); }
-void SimpleDistortionProcessor::processBlock (juce::AudioBuffer<double>& buffer, MidiBuffer&)   { process (buffer); }
+void SimpleDistortionProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer&)    { process (buffer, floatStage); }
+void SimpleDistortionProcessor::processBlock (juce::AudioBuffer<double>& buffer, MidiBuffer&)   { process (buffer, doubleStage); }
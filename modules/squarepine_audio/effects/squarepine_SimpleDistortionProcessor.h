@@ -5,6 +5,17 @@ public:
     /** Constructor. */
     SimpleDistortionProcessor();
 
+    //==============================================================================
+    /** Changes how much the distortion is oversampled by, which must be 1, 2, 4 or 8.
+
+        This takes effect the next time the processor is prepared,
+        and the latency it adds is reported then.
+    */
+    void setOversamplingFactor (int);
+
+    /** @returns how much the distortion is oversampled by. */
+    [[nodiscard]] int getOversamplingFactor() const noexcept;
+
     //==============================================================================
     /** @internal */
     const String getName() const override { return NEEDS_TRANS ("Simple Distortion"); }
@@ -23,9 +34,12 @@ private:
     //==============================================================================
     AudioParameterFloat* amountParameter = nullptr;
 
+    NonlinearStage<float> floatStage;
+    NonlinearStage<double> doubleStage;
+
     //==============================================================================
     template<typename FloatType>
-    void process (juce::AudioBuffer<FloatType>&);
+    void process (juce::AudioBuffer<FloatType>&, NonlinearStage<FloatType>&);
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleDistortionProcessor)
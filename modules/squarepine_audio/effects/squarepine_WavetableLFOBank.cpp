@@ -0,0 +1,455 @@
+//==============================================================================
+class WavetableLFOBank::Tables final
+{
+public:
+    Tables()
+    {
+        for (int i = 0; i < numWaveforms; ++i)
+            build ((LFOWaveform) i);
+    }
+
+    static const Tables& get()
+    {
+        static const Tables tables;
+        return tables;
+    }
+
+    /** @returns the start of a table, which can be read
+        from one point before it up to two points after its end.
+    */
+    const float* get (LFOWaveform waveform) const noexcept
+    {
+        return tables[(size_t) waveform].data() + 1;
+    }
+
+private:
+    static constexpr int numWaveforms = (int) LFOWaveform::brownianNoise + 1;
+
+    std::array<std::vector<float>, (size_t) numWaveforms> tables;
+
+    //==============================================================================
+    static double evaluate (LFOWaveform waveform, double phase) noexcept
+    {
+        constexpr auto twoPi = MathConstants<double>::twoPi;
+
+        switch (waveform)
+        {
+            case LFOWaveform::sine:         return std::sin (twoPi * phase);
+            case LFOWaveform::cosine:       return std::cos (twoPi * phase);
+            case LFOWaveform::tangent:      return std::clamp (std::tan (MathConstants<double>::pi * phase), -1.0, 1.0);
+            case LFOWaveform::triangle:     return 1.0 - 4.0 * std::abs (phase - 0.5);
+            case LFOWaveform::ramp:         return phase;
+            case LFOWaveform::sawtooth:     return 2.0 * phase - 1.0;
+            case LFOWaveform::square:       return phase < 0.5 ? 1.0 : -1.0;
+
+            default:
+                jassertfalse;
+            break;
+        };
+
+        return 0.0;
+    }
+
+    /** @returns the exponent of the noise's spectral slope (ie: amplitude = 1 / h ^ exponent). */
+    static double getNoiseSlope (LFOWaveform waveform) noexcept
+    {
+        switch (waveform)
+        {
+            case LFOWaveform::whiteNoise:       return 0.0;
+            case LFOWaveform::pinkNoise:        return 0.5;
+            case LFOWaveform::blueNoise:        return -0.5;
+            case LFOWaveform::brownianNoise:    return 1.0;
+
+            default:
+                jassertfalse;
+            break;
+        };
+
+        return 0.0;
+    }
+
+    void build (LFOWaveform waveform)
+    {
+        constexpr auto size = (size_t) tableSize;
+
+        std::vector<double> cosines (size), sines (size);
+        for (size_t n = 0; n < size; ++n)
+        {
+            cosines[n] = std::cos (MathConstants<double>::twoPi * (double) n / (double) size);
+            sines[n] = std::sin (MathConstants<double>::twoPi * (double) n / (double) size);
+        }
+
+        // The waveforms are defined by their harmonics, truncated to band-limit them:
+        std::vector<double> real ((size_t) maxNumHarmonics + 1, 0.0), imag ((size_t) maxNumHarmonics + 1, 0.0);
+        auto targetPeak = 1.0;
+        auto dc = 0.0;
+
+        if (waveform >= LFOWaveform::whiteNoise)
+        {
+            // NB: Seeded by the waveform, so the noise is the same on every run.
+            Random random ((int64) waveform + 1);
+            const auto slope = getNoiseSlope (waveform);
+
+            for (size_t h = 1; h < real.size(); ++h)
+            {
+                const auto amplitude = std::pow ((double) h, -slope);
+                const auto angle = MathConstants<double>::twoPi * random.nextDouble();
+                real[h] = amplitude * std::cos (angle);
+                imag[h] = amplitude * std::sin (angle);
+            }
+        }
+        else
+        {
+            std::vector<double> samples (size);
+            targetPeak = 0.0;
+
+            for (size_t n = 0; n < size; ++n)
+            {
+                samples[n] = evaluate (waveform, (double) n / (double) size);
+                targetPeak = std::max (targetPeak, std::abs (samples[n]));
+                dc += samples[n];
+            }
+
+            dc /= (double) size;
+
+            for (size_t h = 1; h < real.size(); ++h)
+            {
+                for (size_t n = 0; n < size; ++n)
+                {
+                    const auto index = (h * n) % size;
+                    real[h] += samples[n] * cosines[index];
+                    imag[h] += samples[n] * sines[index];
+                }
+
+                // Lanczos sigma factors, to tame the ringing of the truncated series:
+                const auto x = MathConstants<double>::pi * (double) h / (double) (maxNumHarmonics + 1);
+                const auto sigma = std::sin (x) / x;
+                real[h] *= 2.0 * sigma / (double) size;
+                imag[h] *= 2.0 * sigma / (double) size;
+            }
+        }
+
+        std::vector<double> result (size, dc);
+        auto peak = 0.0;
+
+        for (size_t n = 0; n < size; ++n)
+        {
+            for (size_t h = 1; h < real.size(); ++h)
+            {
+                const auto index = (h * n) % size;
+                result[n] += real[h] * cosines[index] + imag[h] * sines[index];
+            }
+
+            peak = std::max (peak, std::abs (result[n]));
+        }
+
+        // Keep the original's peak level, whatever was removed:
+        const auto gain = peak > 0.0 ? targetPeak / peak : 0.0;
+
+        auto& table = tables[(size_t) waveform];
+        table.resize (size + 3);
+
+        for (size_t n = 0; n < size; ++n)
+            table[n + 1] = (float) (result[n] * gain);
+
+        // Wrap around, so that interpolating needs no bounds checks:
+        table[0] = table[size];
+        table[size + 1] = table[1];
+        table[size + 2] = table[2];
+    }
+};
+
+//==============================================================================
+namespace
+{
+    /** Interpolates between p0 and p1, where pm1 and p2 are the points on either side.
+
+        This works on plain floats and on SIMD registers alike.
+    */
+    template<WavetableLFOBank::Interpolation interpolation, typename Type>
+    inline Type interpolateLFOTable (Type pm1, Type p0, Type p1, Type p2, Type alpha) noexcept
+    {
+        if constexpr (interpolation == WavetableLFOBank::Interpolation::linear)
+        {
+            ignoreUnused (pm1, p2);
+            return p0 + alpha * (p1 - p0);
+        }
+        else
+        {
+            // Catmull-Rom, which passes through every point of the table:
+            const auto c1 = (p1 - pm1) * 0.5f;
+            const auto c2 = pm1 - p0 * 2.5f + p1 * 2.0f - p2 * 0.5f;
+            const auto c3 = (p2 - pm1) * 0.5f + (p0 - p1) * 1.5f;
+            return ((c3 * alpha + c2) * alpha + c1) * alpha + p0;
+        }
+    }
+
+    template<WavetableLFOBank::Interpolation interpolation>
+    inline float lookUpLFOTable (const float* table, int index, float alpha) noexcept
+    {
+        const auto* p = table + index;
+        return interpolateLFOTable<interpolation> (p[-1], p[0], p[1], p[2], alpha);
+    }
+}
+
+//==============================================================================
+void WavetableLFOBank::prepare (double newSampleRate, int numVoices)
+{
+    jassert (newSampleRate > 0.0);
+    jassert (numVoices >= 0);
+
+    tables = &Tables::get();
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    setCrossfadeLength (crossfadeSeconds);
+
+    const auto numVoicesToUse = (size_t) std::max (0, numVoices);
+    const auto* sine = tables->get (LFOWaveform::sine);
+
+    phases.assign (numVoicesToUse, 0);
+    increments.assign (numVoicesToUse, 0);
+    currentTables.assign (numVoicesToUse, sine);
+    previousTables.assign (numVoicesToUse, sine);
+    pendingTables.assign (numVoicesToUse, nullptr);
+    waveforms.assign (numVoicesToUse, LFOWaveform::sine);
+    fades.assign (numVoicesToUse, 1.0f);
+    controlValues.assign (numVoicesToUse, 0.0f);
+}
+
+void WavetableLFOBank::reset() noexcept
+{
+    std::fill (phases.begin(), phases.end(), (uint32) 0);
+    std::fill (fades.begin(), fades.end(), 1.0f);
+    std::fill (controlValues.begin(), controlValues.end(), 0.0f);
+
+    for (size_t v = 0; v < pendingTables.size(); ++v)
+        if (auto* pending = std::exchange (pendingTables[v], nullptr))
+            currentTables[v] = pending;
+
+    previousTables = currentTables;
+}
+
+//==============================================================================
+void WavetableLFOBank::setCrossfadeLength (double seconds) noexcept
+{
+    crossfadeSeconds = std::max (0.0, seconds);
+
+    const auto numSamples = crossfadeSeconds * sampleRate;
+    fadeIncrement = numSamples >= 1.0 ? (float) (1.0 / numSamples) : 1.0f;
+}
+
+void WavetableLFOBank::setFrequency (int voiceIndex, double frequencyHz) noexcept
+{
+    // NB: Anything beyond Nyquist would alias backwards, so that's the limit.
+    if (isPositiveAndBelow (voiceIndex, getNumVoices()))
+        increments[(size_t) voiceIndex] = (uint32) jlimit (0.0, 2147483647.0, std::round (frequencyHz / sampleRate * 4294967296.0));
+}
+
+void WavetableLFOBank::setPhase (int voiceIndex, double normalisedPhase) noexcept
+{
+    if (isPositiveAndBelow (voiceIndex, getNumVoices()))
+        phases[(size_t) voiceIndex] = (uint32) ((normalisedPhase - std::floor (normalisedPhase)) * 4294967296.0);
+}
+
+void WavetableLFOBank::setWaveform (int voiceIndex, LFOWaveform waveform) noexcept
+{
+    if (! isPositiveAndBelow (voiceIndex, getNumVoices()))
+        return;
+
+    const auto index = (size_t) voiceIndex;
+
+    if (waveforms[index] == waveform)
+        return;
+
+    waveforms[index] = waveform;
+    const auto* table = tables->get (waveform);
+
+    if (fades[index] >= 1.0f)
+    {
+        previousTables[index] = currentTables[index];
+        currentTables[index] = table;
+        pendingTables[index] = nullptr;
+        fades[index] = 0.0f;
+    }
+    else if (table == previousTables[index])
+    {
+        // Heading back to what's being faded out, so the crossfade turns around from where it's at:
+        std::swap (previousTables[index], currentTables[index]);
+        fades[index] = 1.0f - fades[index];
+        pendingTables[index] = nullptr;
+    }
+    else
+    {
+        // NB: Restarting the crossfade from here would jump from the partial mix to the old target,
+        //     so the new table waits until the crossfade is done.
+        pendingTables[index] = table != currentTables[index] ? table : nullptr;
+    }
+}
+
+void WavetableLFOBank::finishCrossfade (size_t index) noexcept
+{
+    previousTables[index] = currentTables[index];
+
+    if (auto* pending = std::exchange (pendingTables[index], nullptr))
+    {
+        currentTables[index] = pending;
+        fades[index] = 0.0f;
+    }
+}
+
+LFOWaveform WavetableLFOBank::getWaveform (int voiceIndex) const noexcept
+{
+    if (isPositiveAndBelow (voiceIndex, getNumVoices()))
+        return waveforms[(size_t) voiceIndex];
+
+    return LFOWaveform::sine;
+}
+
+//==============================================================================
+template<WavetableLFOBank::Interpolation interpolationToUse>
+void WavetableLFOBank::processLanes (size_t firstVoice, float* const* outputs, int numSamples) noexcept
+{
+    constexpr auto alignment = FloatVector::SIMDRegisterSize;
+    constexpr auto fractionMask = (uint32) ((1 << numPhaseFractionBits) - 1);
+    constexpr auto fractionScale = 1.0f / (float) (1 << numPhaseFractionBits);
+    constexpr auto isCubic = interpolationToUse == Interpolation::cubic;
+
+    const auto numActive = std::min (numLanes, phases.size() - firstVoice);
+
+    alignas (alignment) uint32 laneValues[numLanes] {};
+    alignas (alignment) float lanes[numLanes] {};
+    alignas (alignment) float alphas[numLanes] {};
+    alignas (alignment) float points[2][4][numLanes] {};
+    const float* tablesToRead[2][numLanes];
+
+    // The spare lanes just read the start of a table and are never written anywhere:
+    for (size_t l = 0; l < numLanes; ++l)
+    {
+        const auto isActive = l < numActive;
+        const auto v = firstVoice + l;
+
+        tablesToRead[0][l] = isActive ? previousTables[v] : currentTables[firstVoice];
+        tablesToRead[1][l] = isActive ? currentTables[v] : currentTables[firstVoice];
+        lanes[l] = isActive ? fades[v] : 1.0f;
+    }
+
+    auto fade = FloatVector::fromRawArray (lanes);
+    const auto fadeStep = FloatVector::expand (fadeIncrement);
+    const auto one = FloatVector::expand (1.0f);
+
+    for (size_t l = 0; l < numActive; ++l)
+        laneValues[l] = increments[firstVoice + l];
+
+    const auto increment = PhaseVector::fromRawArray (laneValues);
+
+    for (size_t l = 0; l < numActive; ++l)
+        laneValues[l] = phases[firstVoice + l];
+
+    auto phase = PhaseVector::fromRawArray (laneValues);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        phase.copyToRawArray (laneValues);
+
+        // Each voice reads its own tables at its own position, so the points are fetched lane by lane:
+        for (size_t l = 0; l < numLanes; ++l)
+        {
+            const auto index = (int) (laneValues[l] >> numPhaseFractionBits);
+            alphas[l] = (float) (laneValues[l] & fractionMask) * fractionScale;
+
+            for (size_t t = 0; t < 2; ++t)
+            {
+                const auto* p = tablesToRead[t][l] + index;
+
+                points[t][1][l] = p[0];
+                points[t][2][l] = p[1];
+
+                if constexpr (isCubic)
+                {
+                    points[t][0][l] = p[-1];
+                    points[t][3][l] = p[2];
+                }
+            }
+        }
+
+        const auto alpha = FloatVector::fromRawArray (alphas);
+
+        auto interpolate = [&] (size_t t)
+        {
+            return interpolateLFOTable<interpolationToUse> (FloatVector::fromRawArray (points[t][0]),
+                                                            FloatVector::fromRawArray (points[t][1]),
+                                                            FloatVector::fromRawArray (points[t][2]),
+                                                            FloatVector::fromRawArray (points[t][3]),
+                                                            alpha);
+        };
+
+        const auto from = interpolate (0);
+        const auto to = interpolate (1);
+        (from + fade * (to - from)).copyToRawArray (lanes);
+
+        for (size_t l = 0; l < numActive; ++l)
+            outputs[firstVoice + l][i] = lanes[l];
+
+        fade = FloatVector::min (fade + fadeStep, one);
+        phase += increment;
+    }
+
+    // NB: The lanes still hold the last output.
+    phase.copyToRawArray (laneValues);
+    fade.copyToRawArray (alphas);
+
+    for (size_t l = 0; l < numActive; ++l)
+    {
+        const auto v = firstVoice + l;
+        phases[v] = laneValues[l];
+        fades[v] = alphas[l];
+
+        if (numSamples > 0)
+            controlValues[v] = lanes[l];
+
+        if (alphas[l] >= 1.0f)
+            finishCrossfade (v);
+    }
+}
+
+void WavetableLFOBank::process (float* const* outputs, int numSamples) noexcept
+{
+    jassert (tables != nullptr); // Forgot to call prepare()?
+
+    for (size_t v = 0; v < phases.size(); v += numLanes)
+    {
+        if (interpolation == Interpolation::linear)
+            processLanes<Interpolation::linear> (v, outputs, numSamples);
+        else
+            processLanes<Interpolation::cubic> (v, outputs, numSamples);
+    }
+}
+
+void WavetableLFOBank::advance (int numSamples) noexcept
+{
+    jassert (tables != nullptr); // Forgot to call prepare()?
+
+    const auto fadeAmount = fadeIncrement * (float) std::max (0, numSamples);
+    constexpr auto fractionMask = (uint32) ((1 << numPhaseFractionBits) - 1);
+    constexpr auto fractionScale = 1.0f / (float) (1 << numPhaseFractionBits);
+
+    for (size_t v = 0; v < phases.size(); ++v)
+    {
+        // NB: The phase wraps on its own, being fixed point.
+        const auto phase = phases[v] + increments[v] * (uint32) std::max (0, numSamples);
+        phases[v] = phase;
+
+        const auto fade = std::min (1.0f, fades[v] + fadeAmount);
+        fades[v] = fade;
+
+        const auto tableIndex = (int) (phase >> numPhaseFractionBits);
+        const auto alpha = (float) (phase & fractionMask) * fractionScale;
+
+        // At block rate, linear interpolation is plenty:
+        const auto from = lookUpLFOTable<Interpolation::linear> (previousTables[v], tableIndex, alpha);
+        const auto to = lookUpLFOTable<Interpolation::linear> (currentTables[v], tableIndex, alpha);
+        controlValues[v] = from + fade * (to - from);
+
+        if (fade >= 1.0f)
+            finishCrossfade (v);
+    }
+}
@@ -0,0 +1,163 @@
+//==============================================================================
+/** The waveforms available to the WavetableLFOBank, and so the LFOProcessor.
+
+    NB: Since version 1.9.0 of this module, the ramp rises from 0 to 1 over the whole cycle
+    (it used to be a half-wave rectified sawtooth), and the tangent is clamped to -1 to 1.
+    The old formulas are still in oscillatorFunctions, but are deprecated.
+*/
+enum class LFOWaveform
+{
+    sine,
+    cosine,
+    tangent,
+    triangle,
+    ramp,
+    sawtooth,
+    square,
+    whiteNoise,
+    pinkNoise,
+    blueNoise,
+    brownianNoise
+};
+
+//==============================================================================
+/** A bank of LFO voices that read from shared, band-limited wavetables.
+
+    Every voice has its own phase accumulator, frequency and waveform,
+    and the voices are stored as parallel arrays so that many of them
+    can be evaluated in a single call without any per-sample branching
+    on the waveform or the interpolation.
+
+    process() runs the voices in groups the width of a SIMD register (see juce::dsp::SIMDRegister),
+    so the phase accumulation, interpolation and crossfading are done for a whole group at once.
+    Only fetching the table points is done lane by lane, since each voice reads its own tables
+    at its own position. The phases are 32-bit fixed point, which wraps for free.
+
+    Changing a voice's waveform crossfades from the old table to the new one,
+    rather than rebuilding anything, so it's free of clicks and allocations.
+    A change made mid-crossfade waits for the crossfade to finish, and then
+    crossfades onwards, so the output never jumps however fast the changes come.
+
+    There are two ways of running the bank:
+    - process() renders each voice at audio rate, for when the LFO is the audio.
+    - advance() only moves the voices along by a block, and evaluates each of them once,
+      for when the LFOs are modulation sources. Other processors can then read
+      the result from getControlValues() without running any audio-rate oscillators.
+
+    Besides preparing, none of the methods allocate, and they should all be called
+    from the same thread (typically the audio thread).
+*/
+class WavetableLFOBank final
+{
+public:
+    //==============================================================================
+    /** How the tables are read between their points. */
+    enum class Interpolation
+    {
+        linear,
+        cubic
+    };
+
+    /** The number of points per table, which must be a power of 2. */
+    static constexpr int tableSize = 2048;
+
+    /** The highest harmonic kept in the tables.
+
+        For LFO rates this is far beyond anything audible,
+        but it takes the edge off the discontinuous waveforms.
+    */
+    static constexpr int maxNumHarmonics = 256;
+
+    //==============================================================================
+    /** Constructor. */
+    WavetableLFOBank() = default;
+
+    //==============================================================================
+    /** Prepares the bank, resetting all of the voices.
+
+        This allocates, and builds the shared tables the first time around.
+    */
+    void prepare (double sampleRate, int numVoices);
+
+    /** Resets the phases of all of the voices, and finishes any crossfades. */
+    void reset() noexcept;
+
+    /** @returns the number of voices, as per prepare(). */
+    [[nodiscard]] int getNumVoices() const noexcept { return (int) phases.size(); }
+
+    //==============================================================================
+    /** Changes how the tables are read. The default is cubic. */
+    void setInterpolation (Interpolation newInterpolation) noexcept   { interpolation = newInterpolation; }
+
+    /** Changes how long a waveform change takes to crossfade, in seconds. */
+    void setCrossfadeLength (double seconds) noexcept;
+
+    /** Changes a voice's frequency, in Hz. */
+    void setFrequency (int voiceIndex, double frequencyHz) noexcept;
+
+    /** Changes a voice's phase, normalised from 0 to 1. */
+    void setPhase (int voiceIndex, double normalisedPhase) noexcept;
+
+    /** Changes a voice's waveform, crossfading to it from the current one.
+
+        If the voice is already crossfading, the new waveform is crossfaded to once that's done,
+        unless it's the one being faded out, in which case the crossfade is simply reversed.
+    */
+    void setWaveform (int voiceIndex, LFOWaveform) noexcept;
+
+    /** @returns the waveform the voice is playing, or crossfading to. */
+    [[nodiscard]] LFOWaveform getWaveform (int voiceIndex) const noexcept;
+
+    //==============================================================================
+    /** Renders every voice at audio rate.
+
+        @param outputs      One destination per voice, as per getNumVoices().
+        @param numSamples   The number of samples to render for each voice.
+    */
+    void process (float* const* outputs, int numSamples) noexcept;
+
+    /** Moves every voice along by a block without rendering it,
+        then evaluates each voice once at the end of the block.
+
+        @see getControlValues
+    */
+    void advance (int numSamples) noexcept;
+
+    /** @returns the value of every voice as of the last block,
+        from either process() or advance().
+    */
+    [[nodiscard]] const float* getControlValues() const noexcept { return controlValues.data(); }
+
+private:
+    //==============================================================================
+    class Tables;
+
+    double sampleRate = 44100.0, crossfadeSeconds = 0.05;
+    float fadeIncrement = 1.0f;
+    Interpolation interpolation = Interpolation::cubic;
+    const Tables* tables = nullptr;
+
+    using FloatVector = dsp::SIMDRegister<float>;
+    using PhaseVector = dsp::SIMDRegister<uint32>;
+    static constexpr size_t numLanes = FloatVector::SIMDNumElements;
+    static_assert (PhaseVector::SIMDNumElements == numLanes);
+
+    /** The phases are fixed point, where the top bits are the index into the table. */
+    static constexpr int numPhaseFractionBits = 21;
+    static_assert ((int64 (tableSize) << numPhaseFractionBits) == (int64 (1) << 32));
+
+    // One entry per voice:
+    std::vector<uint32> phases, increments;
+    std::vector<const float*> currentTables, previousTables;
+    std::vector<const float*> pendingTables;    // What to crossfade to next, once the current crossfade is done.
+    std::vector<LFOWaveform> waveforms;
+    std::vector<float> fades, controlValues;
+
+    //==============================================================================
+    template<Interpolation>
+    void processLanes (size_t firstVoice, float* const* outputs, int numSamples) noexcept;
+    void finishCrossfade (size_t voiceIndex) noexcept;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WavetableLFOBank)
+};
@@ -46,6 +46,7 @@ Meter::Meter (MeterModel* model_) :
     model (model_)
 {
     channels.resize (2);
+    levels.ensureStorageAllocated (MeterSnapshotTransport::maxNumChannels);
 }
 
 //==============================================================================
@@ -143,21 +144,54 @@ void Meter::paint (Graphics& g)
     }
 }
 
+void Meter::updateLevelsFromModel()
+{
+    if (model == nullptr)
+    {
+        levels.clearQuick();
+        return;
+    }
+
+    if (auto* transport = model->getSnapshotTransport())
+    {
+        // NB: If the snapshot was being written at the time, the last levels are kept.
+        if (transport->read (snapshot))
+        {
+            const auto mode = model->getMeteringMode();
+
+            levels.clearQuick();
+
+            for (int i = 0; i < snapshot.numChannels; ++i)
+                levels.add (LevelsProcessor::getLevel (snapshot.channels[(size_t) i], mode));
+        }
+    }
+    else
+    {
+        const auto& modelLevels = model->getChannelLevels();
+
+        levels.clearQuick();
+        levels.addArray (modelLevels);
+    }
+}
+
 bool Meter::refresh()
 {
-    levels.clearQuick();
     int64 maxLevelExpiryMs = 3000;
     bool needsMaxLevel = false;
     float decayRate = 0.8f;
 
+    updateLevelsFromModel();
+
     if (model != nullptr)
     {
-        levels = model->getChannelLevels();
         maxLevelExpiryMs = model->getExpiryTimeMs();
         needsMaxLevel = model->needsMaxLevel();
     }
 
     const auto numChans = std::min (levels.size(), channels.size());
+    if (numChans <= 0)
+        return false;
+
     const auto chanWidthPx = roundToIntAccurate ((double) getWidth() / (double) numChans);
     const auto hPx = getHeight();
 
@@ -222,3 +256,43 @@ void Meter::updateClippingLevel (bool forceUpdate)
     if (clippingLevel < currClippingLevel || forceUpdate)
         clippingLevel = currClippingLevel;
 }
+
+//==============================================================================
+MeterRefresher::MeterRefresher (int refreshRateHz)
+{
+    meters.ensureStorageAllocated (64);
+    startTimerHz (std::max (1, refreshRateHz));
+}
+
+MeterRefresher::~MeterRefresher()
+{
+    stopTimer();
+}
+
+void MeterRefresher::addMeter (Meter* meter)
+{
+    if (meter == nullptr)
+        return;
+
+    for (const auto& m : meters)
+        if (m.getComponent() == meter)
+            return;
+
+    meters.add (meter);
+}
+
+void MeterRefresher::removeMeter (Meter* meter)
+{
+    meters.removeIf ([meter] (const auto& m) { return m.getComponent() == meter; });
+}
+
+void MeterRefresher::timerCallback()
+{
+    // Deleted meters are dropped as they're found:
+    meters.removeIf ([] (const auto& m) { return m.getComponent() == nullptr; });
+
+    for (const auto& m : meters)
+        if (auto* meter = m.getComponent())
+            if (meter->isShowing() && meter->refresh())
+                meter->repaint();
+}
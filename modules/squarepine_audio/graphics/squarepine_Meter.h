@@ -121,7 +121,23 @@ public:
         In other words, the first index should be the left channel's peak,
         the next value should be for the right channel, and so on (as needed).
     */
-    virtual const Array<float>& getChannelLevels() const = 0;
+    virtual const Array<float>& getChannelLevels() const
+    {
+        static const Array<float> noLevels;
+        return noLevels;
+    }
+
+    /** @returns a transport to poll the levels from, or nullptr to use getChannelLevels() instead.
+
+        Polling a transport doesn't lock or allocate, which makes it
+        the better choice when displaying lots of meters at once.
+
+        @see LevelsProcessor::getSnapshotTransport
+    */
+    virtual const MeterSnapshotTransport* getSnapshotTransport() const { return nullptr; }
+
+    /** @returns the kind of level to display when polling a transport. */
+    virtual MeteringMode getMeteringMode() const { return MeteringMode::peak; }
 
     //==============================================================================
     /** */
@@ -250,6 +266,7 @@ private:
     MeterModel* model = nullptr;
     Array<ChannelContext> channels;
     Array<float> levels;
+    MeterSnapshotTransport::Snapshot snapshot;
     ClippingLevel clippingLevel = ClippingLevel::none;
 
     ColourGradient gradient;
@@ -264,7 +281,43 @@ private:
 
     //==============================================================================
     void updateClippingLevel (bool forceUpdate);
+    void updateLevelsFromModel();
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Meter)
 };
+
+//==============================================================================
+/** Refreshes and repaints any number of meters from a single timer.
+
+    This is much cheaper than giving each meter its own timer
+    when there are lots of channel strips on screen.
+*/
+class MeterRefresher final : private Timer
+{
+public:
+    /** Constructor. */
+    MeterRefresher (int refreshRateHz = 30);
+
+    /** Destructor. */
+    ~MeterRefresher() override;
+
+    //==============================================================================
+    /** Adds a meter to refresh. This does nothing if the meter was already added. */
+    void addMeter (Meter*);
+
+    /** Stops refreshing a meter. */
+    void removeMeter (Meter*);
+
+    /** @returns the number of meters being refreshed. */
+    [[nodiscard]] int getNumMeters() const noexcept { return meters.size(); }
+
+private:
+    //==============================================================================
+    Array<Component::SafePointer<Meter>> meters;
+
+    void timerCallback() override;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterRefresher)
+};
@@ -1,3 +1,206 @@
+//==============================================================================
+namespace
+{
+    /** Zeroth order modified Bessel function of the first kind, for the Kaiser window. */
+    inline double besselI0 (double x) noexcept
+    {
+        auto sum = 1.0, term = 1.0;
+        const auto halfX = x * 0.5;
+
+        for (int k = 1; k < 64; ++k)
+        {
+            term *= (halfX / (double) k) * (halfX / (double) k);
+            sum += term;
+
+            if (term < sum * 1.0e-12)
+                break;
+        }
+
+        return sum;
+    }
+
+    std::vector<float> createWindowedSincTable()
+    {
+        constexpr auto beta = 8.6;
+        constexpr auto numZeroCrossings = WindowedSincTable::numZeroCrossings;
+        constexpr auto numPhases = WindowedSincTable::numPhasesPerZeroCrossing;
+
+        const auto denominator = besselI0 (beta);
+        const auto size = (size_t) (numZeroCrossings * numPhases);
+
+        std::vector<float> table (size + 2, 0.0f);
+
+        for (size_t i = 0; i <= size; ++i)
+        {
+            const auto z = (double) i / (double) numPhases;
+            const auto sinc = i == 0 ? 1.0 : std::sin (MathConstants<double>::pi * z) / (MathConstants<double>::pi * z);
+            const auto w = z / (double) numZeroCrossings;
+            const auto window = besselI0 (beta * std::sqrt (std::max (0.0, 1.0 - w * w))) / denominator;
+
+            table[i] = (float) (sinc * window);
+        }
+
+        return table;
+    }
+}
+
+const std::vector<float>& WindowedSincTable::get()
+{
+    static const auto table = createWindowedSincTable();
+    return table;
+}
+
+//==============================================================================
+void PolyphaseResampler::prepare (int numChannels, double, int maxNumInputSamples)
+{
+    table = &WindowedSincTable::get();
+
+    // When downsampling, the kernel gets stretched to cut off below the new Nyquist frequency:
+    constexpr auto rollOff = 0.95;
+    const auto cutoff = rollOff * std::min (1.0, 1.0 / maximumRatio);
+
+    halfWidth = (int) std::ceil ((double) WindowedSincTable::numZeroCrossings / cutoff);
+    kernelScale = (float) (cutoff * WindowedSincTable::numPhasesPerZeroCrossing);
+
+    weights.assign ((size_t) (halfWidth * 2), 0.0f);
+    history.setSize (std::max (numChannels, 1), std::max (maxNumInputSamples, 1) + halfWidth * 2 + 8, false, false, true);
+
+    reset();
+}
+
+void PolyphaseResampler::reset()
+{
+    history.clear();
+
+    // NB: Priming the history so that the first output is centred on the first input sample.
+    numBuffered = std::max (halfWidth - 1, 0);
+    position = (double) numBuffered;
+    currentStep = targetStep = std::min (getRatio(), maximumRatio);
+    stepIncrement = 0.0;
+    numRampSamplesRemaining = 0;
+}
+
+void PolyphaseResampler::push (const float* const* input, int numChannels, int numSamples)
+{
+    const auto numFree = history.getNumSamples() - numBuffered;
+
+    // Not enough room! Pull more often, or prepare for larger blocks.
+    jassert (numSamples <= numFree);
+    numSamples = std::min (numSamples, numFree);
+
+    if (numSamples <= 0)
+        return;
+
+    for (int i = 0; i < history.getNumChannels(); ++i)
+    {
+        if (i < numChannels && input[i] != nullptr)
+            history.copyFrom (i, numBuffered, input[i], numSamples);
+        else
+            history.clear (i, numBuffered, numSamples);
+    }
+
+    numBuffered += numSamples;
+}
+
+int PolyphaseResampler::pull (float* const* output, int numChannels, int maxNumSamples)
+{
+    jassert (table != nullptr);
+
+    const auto newTarget = std::min (getRatio(), maximumRatio);
+
+    if (! approximatelyEqual (newTarget, targetStep))
+    {
+        targetStep = newTarget;
+        numRampSamplesRemaining = rampLength;
+        stepIncrement = (targetStep - currentStep) / (double) rampLength;
+    }
+
+    const auto numTaps = halfWidth * 2;
+    const auto numChans = std::min (numChannels, history.getNumChannels());
+    auto* const* channels = history.getArrayOfReadPointers();
+    int numProduced = 0;
+
+    while (numProduced < maxNumSamples)
+    {
+        const auto centre = (int) position;
+
+        if (centre + halfWidth >= numBuffered)
+            break;
+
+        // The kernel is symmetric, so only the distance from the centre matters:
+        const auto fraction = (float) (position - (double) centre);
+        float sum = 0.0f;
+
+        for (int k = 0; k < numTaps; ++k)
+        {
+            const auto w = WindowedSincTable::lookUp (*table, std::abs ((float) (k - halfWidth + 1) - fraction) * kernelScale);
+            weights[(size_t) k] = w;
+            sum += w;
+        }
+
+        // Normalising keeps the gain at DC exact, whatever the phase:
+        const auto normalisation = sum != 0.0f ? 1.0f / sum : 0.0f;
+        const auto firstTap = centre - halfWidth + 1;
+
+        for (int c = 0; c < numChans; ++c)
+        {
+            const auto* source = channels[c] + firstTap;
+            float value = 0.0f;
+
+            for (int k = 0; k < numTaps; ++k)
+                value += source[k] * weights[(size_t) k];
+
+            output[c][numProduced] = value * normalisation;
+        }
+
+        ++numProduced;
+
+        if (numRampSamplesRemaining > 0)
+        {
+            currentStep = --numRampSamplesRemaining > 0 ? currentStep + stepIncrement : targetStep;
+        }
+
+        position += currentStep;
+    }
+
+    for (int c = numChans; c < numChannels; ++c)
+        FloatVectorOperations::clear (output[c], numProduced);
+
+    // Drop whatever the next output won't need:
+    const auto numToDiscard = jlimit (0, numBuffered, (int) position - halfWidth + 1);
+
+    if (numToDiscard > 0)
+    {
+        const auto numRemaining = numBuffered - numToDiscard;
+
+        for (int c = 0; c < history.getNumChannels(); ++c)
+        {
+            auto* data = history.getWritePointer (c);
+            std::memmove (data, data + numToDiscard, sizeof (float) * (size_t) numRemaining);
+        }
+
+        numBuffered = numRemaining;
+        position -= (double) numToDiscard;
+    }
+
+    return numProduced;
+}
+
+int PolyphaseResampler::process (juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& destination)
+{
+    const auto numSourceSamples = source.getNumSamples();
+
+    push (source.getArrayOfReadPointers(), source.getNumChannels(), numSourceSamples);
+
+    const auto numProduced = pull (destination.getArrayOfWritePointers(), destination.getNumChannels(),
+                                   destination.getNumSamples());
+
+    for (int i = 0; i < destination.getNumChannels(); ++i)
+        destination.clear (i, numProduced, destination.getNumSamples() - numProduced);
+
+    return numSourceSamples;
+}
+
 //==============================================================================
 #if SQUAREPINE_USE_R8BRAIN
 
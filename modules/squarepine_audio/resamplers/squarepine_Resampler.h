@@ -143,17 +143,407 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TemplatedResampler)
 };
 
+//==============================================================================
+/** A Kaiser-windowed sinc, tabulated once and shared by the windowed-sinc resamplers.
+
+    @see PolyphaseResampler, ResamplingAudioFormatReader
+*/
+struct WindowedSincTable final
+{
+    /** Number of zero crossings on either side of the kernel's centre.
+
+        Higher means a steeper anti-aliasing filter, at the cost of processing time.
+    */
+    static constexpr int numZeroCrossings = 16;
+
+    /** The kernel is tabulated at this many points per zero crossing,
+        and linearly interpolated in-between.
+    */
+    static constexpr int numPhasesPerZeroCrossing = 512;
+
+    /** @returns the table, where entry i is the kernel's value at
+        (i / numPhasesPerZeroCrossing) zero crossings from its centre.
+
+        The first call builds the table, so make sure that doesn't happen on the audio thread.
+    */
+    [[nodiscard]] static const std::vector<float>& get();
+
+    /** @returns the kernel's value at a distance from its centre, in table entries. */
+    [[nodiscard]] static float lookUp (const std::vector<float>& table, float distance) noexcept
+    {
+        // NB: The table has a trailing zero, so the interpolation never reads past its end.
+        if (distance >= (float) (table.size() - 2))
+            return 0.0f;
+
+        const auto index = (size_t) distance;
+        const auto alpha = distance - (float) index;
+        return table[index] + alpha * (table[index + 1] - table[index]);
+    }
+};
+
+//==============================================================================
+/** The interpolation kernels available to the MultichannelResampler.
+
+    Each one provides its number of taps, the index of the tap the output
+    position is relative to, and a way of computing its weights for a position
+    between that tap and the next one.
+*/
+namespace ResamplerKernels
+{
+    /** Repeats the previous sample. */
+    struct ZeroOrderHold final
+    {
+        static constexpr int numTaps = 1;
+        static constexpr int centreTap = 0;
+
+        void prepare() {}
+        void computeWeights (float, float* weights) const noexcept { weights[0] = 1.0f; }
+    };
+
+    /** Draws a straight line between two samples. */
+    struct Linear final
+    {
+        static constexpr int numTaps = 2;
+        static constexpr int centreTap = 0;
+
+        void prepare() {}
+
+        void computeWeights (float x, float* weights) const noexcept
+        {
+            weights[0] = 1.0f - x;
+            weights[1] = x;
+        }
+    };
+
+    /** A 4-point, 3rd-order Lagrange polynomial. */
+    struct Lagrange final
+    {
+        static constexpr int numTaps = 4;
+        static constexpr int centreTap = 1;
+
+        void prepare() {}
+
+        void computeWeights (float x, float* weights) const noexcept
+        {
+            const auto xp1 = x + 1.0f, xm1 = x - 1.0f, xm2 = x - 2.0f;
+
+            weights[0] = -x * xm1 * xm2 / 6.0f;
+            weights[1] = xp1 * xm1 * xm2 * 0.5f;
+            weights[2] = -xp1 * x * xm2 * 0.5f;
+            weights[3] = xp1 * x * xm1 / 6.0f;
+        }
+    };
+
+    /** A Catmull-Rom spline, which passes through every sample. */
+    struct CatmullRom final
+    {
+        static constexpr int numTaps = 4;
+        static constexpr int centreTap = 1;
+
+        void prepare() {}
+
+        void computeWeights (float x, float* weights) const noexcept
+        {
+            const auto x2 = x * x, x3 = x2 * x;
+
+            weights[0] = 0.5f * (-x3 + 2.0f * x2 - x);
+            weights[1] = 0.5f * (3.0f * x3 - 5.0f * x2 + 2.0f);
+            weights[2] = 0.5f * (-3.0f * x3 + 4.0f * x2 + x);
+            weights[3] = 0.5f * (x3 - x2);
+        }
+    };
+
+    /** A Kaiser-windowed sinc, using the shared WindowedSincTable.
+
+        NB: The cutoff is fixed at the source's Nyquist frequency,
+        so prefer the PolyphaseResampler for heavy downsampling.
+    */
+    struct WindowedSinc final
+    {
+        static constexpr int numTaps = WindowedSincTable::numZeroCrossings * 2;
+        static constexpr int centreTap = WindowedSincTable::numZeroCrossings - 1;
+
+        void prepare() { table = &WindowedSincTable::get(); }
+
+        void computeWeights (float x, float* weights) const noexcept
+        {
+            jassert (table != nullptr);
+
+            constexpr auto scale = (float) WindowedSincTable::numPhasesPerZeroCrossing;
+            float sum = 0.0f;
+
+            for (int k = 0; k < numTaps; ++k)
+            {
+                weights[k] = WindowedSincTable::lookUp (*table, std::abs ((float) (k - centreTap) - x) * scale);
+                sum += weights[k];
+            }
+
+            // Normalising keeps the gain at DC exact, whatever the phase:
+            if (sum != 0.0f)
+                for (int k = 0; k < numTaps; ++k)
+                    weights[k] /= sum;
+        }
+
+        const std::vector<float>* table = nullptr;
+    };
+}
+
+//==============================================================================
+/** A stateful resampler that computes the position and kernel weights once
+    per output frame, then applies them to all of the channels at once.
+
+    The history is kept interleaved and padded to the SIMD register width,
+    so the inner loop runs across the channels using juce::dsp::SIMDRegister
+    (ie: SSE or NEON, depending on the platform). This makes the cost per channel
+    drop as the channel count rises, unlike the TemplatedResampler which
+    runs a separate interpolator per channel.
+
+    The kernel is chosen at compile time; see ResamplerKernels.
+
+    Both planar buffers (via process()) and interleaved ones (via processInterleaved())
+    are supported. Like JUCE's interpolators, the source must contain at least
+    (ratio * number of output samples) samples.
+*/
+template<typename KernelType>
+class MultichannelResampler final : public Resampler
+{
+public:
+    /** Constructor. */
+    MultichannelResampler() = default;
+
+    //==============================================================================
+    /** Clears the history and sub-sample position, as if nothing had been processed yet. */
+    void reset() noexcept
+    {
+        std::fill (historyStorage.begin(), historyStorage.end(), 0.0f);
+        writeIndex = 0;
+        subSamplePosition = 1.0;
+    }
+
+    /** @returns the number of channels this was prepared for. */
+    [[nodiscard]] int getNumChannels() const noexcept { return numChannels; }
+
+    /** @returns the delay this introduces, in source samples. */
+    [[nodiscard]] static constexpr int getLatencyInInputSamples() noexcept { return KernelType::numTaps - KernelType::centreTap - 1; }
+
+    //==============================================================================
+    /** Resamples interleaved audio.
+
+        @param source               The interleaved source frames, of getNumChannels() samples each.
+        @param numSourceFrames      The number of frames available from the source.
+        @param destination          The interleaved frames to write to.
+        @param numDestinationFrames The number of frames to produce.
+
+        @returns the number of source frames that were used.
+    */
+    int processInterleaved (const float* source, int numSourceFrames,
+                            float* destination, int numDestinationFrames) noexcept
+    {
+        return run (numSourceFrames, numDestinationFrames,
+                    [&] (int frame, float* dest)
+                    {
+                        std::copy_n (source + (size_t) frame * (size_t) numChannels, numChannels, dest);
+                    },
+                    [&] (int frame, const float* result)
+                    {
+                        std::copy_n (result, numChannels, destination + (size_t) frame * (size_t) numChannels);
+                    });
+    }
+
+    //==============================================================================
+    /** @internal */
+    void prepare (int newNumChannels, double, int) override
+    {
+        numChannels = std::max (newNumChannels, 1);
+        stride = (int) (((size_t) numChannels + numLanes - 1) / numLanes * numLanes);
+
+        kernel.prepare();
+
+        // NB: Every frame is written twice, numTaps apart, so that the
+        //     most recent numTaps frames are always contiguous.
+        historyStorage.assign ((size_t) (stride * KernelType::numTaps * 2 + stride) + numLanes, 0.0f);
+        history = SIMDType::getNextSIMDAlignedPtr (historyStorage.data());
+
+        accumulatorStorage.assign ((size_t) stride + numLanes, 0.0f);
+        accumulator = SIMDType::getNextSIMDAlignedPtr (accumulatorStorage.data());
+
+        reset();
+    }
+
+    /** @internal */
+    int process (juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest) override
+    {
+        const auto numSourceChans = std::min (source.getNumChannels(), numChannels);
+        const auto numDestChans = std::min (dest.getNumChannels(), numChannels);
+        auto* const* inputs = source.getArrayOfReadPointers();
+        auto* const* outputs = dest.getArrayOfWritePointers();
+
+        for (int i = numDestChans; i < dest.getNumChannels(); ++i)
+            dest.clear (i, 0, dest.getNumSamples());
+
+        return run (source.getNumSamples(), dest.getNumSamples(),
+                    [&] (int frame, float* frameDest)
+                    {
+                        for (int i = 0; i < numSourceChans; ++i)
+                            frameDest[i] = inputs[i][frame];
+
+                        std::fill (frameDest + numSourceChans, frameDest + numChannels, 0.0f);
+                    },
+                    [&] (int frame, const float* result)
+                    {
+                        for (int i = 0; i < numDestChans; ++i)
+                            outputs[i][frame] = result[i];
+                    });
+    }
+
+private:
+    //==============================================================================
+    using SIMDType = dsp::SIMDRegister<float>;
+    static constexpr size_t numLanes = SIMDType::SIMDNumElements;
+
+    KernelType kernel;
+    std::vector<float> historyStorage, accumulatorStorage;
+    float* history = nullptr;
+    float* accumulator = nullptr;
+    int numChannels = 0, stride = 0, writeIndex = 0;
+    double subSamplePosition = 1.0;
+
+    //==============================================================================
+    template<typename ReadFrame, typename WriteFrame>
+    int run (int numSourceFrames, int numDestinationFrames, ReadFrame&& readFrame, WriteFrame&& writeFrame) noexcept
+    {
+        jassert (history != nullptr); // Forgot to call prepare()?
+
+        constexpr auto numTaps = KernelType::numTaps;
+        const auto localRatio = getRatio();
+        const auto numVectors = stride / (int) numLanes;
+        float weights[(size_t) numTaps];
+        int numUsed = 0;
+
+        for (int i = 0; i < numDestinationFrames; ++i)
+        {
+            while (subSamplePosition >= 1.0)
+            {
+                auto* frame = history + (size_t) (writeIndex * stride);
+
+                // Not enough source samples!
+                jassert (numUsed < numSourceFrames);
+
+                if (numUsed < numSourceFrames)
+                    readFrame (numUsed++, frame);
+                else
+                    std::fill (frame, frame + numChannels, 0.0f);
+
+                std::copy_n (frame, stride, frame + (size_t) (numTaps * stride));
+                writeIndex = (writeIndex + 1) % numTaps;
+                subSamplePosition -= 1.0;
+            }
+
+            kernel.computeWeights ((float) subSamplePosition, weights);
+
+            // The oldest of the last numTaps frames is the one about to be overwritten:
+            const auto* window = history + (size_t) (writeIndex * stride);
+
+            for (int v = 0; v < numVectors; ++v)
+            {
+                const auto* lane = window + (size_t) v * numLanes;
+                auto sum = SIMDType::fromRawArray (lane) * weights[0];
+
+                for (int k = 1; k < numTaps; ++k)
+                    sum += SIMDType::fromRawArray (lane + (size_t) (k * stride)) * weights[k];
+
+                sum.copyToRawArray (accumulator + (size_t) v * numLanes);
+            }
+
+            writeFrame (i, accumulator);
+            subSamplePosition += localRatio;
+        }
+
+        return numUsed;
+    }
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultichannelResampler)
+};
+
 //==============================================================================
 /** */
-using WindowedSincResampler = TemplatedResampler<WindowedSincInterpolator>;
+using WindowedSincResampler = MultichannelResampler<ResamplerKernels::WindowedSinc>;
 /** */
-using LagrangeResampler = TemplatedResampler<LagrangeInterpolator>;
+using LagrangeResampler = MultichannelResampler<ResamplerKernels::Lagrange>;
 /** */
-using CatmullRomResampler = TemplatedResampler<CatmullRomInterpolator>;
+using CatmullRomResampler = MultichannelResampler<ResamplerKernels::CatmullRom>;
 /** */
-using LinearResampler = TemplatedResampler<LinearInterpolator>;
+using LinearResampler = MultichannelResampler<ResamplerKernels::Linear>;
 /** */
-using ZeroOrderHoldResampler = TemplatedResampler<ZeroOrderHoldInterpolator>;
+using ZeroOrderHoldResampler = MultichannelResampler<ResamplerKernels::ZeroOrderHold>;
+
+//==============================================================================
+/** A stateful windowed-sinc resampler that processes all of the channels together,
+    and that supports smoothly changing ratios (eg: for varispeed).
+
+    Other than the usual Resampler interface, this can be used as a stream:
+    push() any amount of input, then pull() however much output that allows for.
+
+    The kernel's cutoff is set up for the largest ratio that's expected,
+    so set that with setMaximumRatio() before preparing.
+*/
+class PolyphaseResampler final : public Resampler
+{
+public:
+    /** Constructor. */
+    PolyphaseResampler() = default;
+
+    //==============================================================================
+    /** Sets the largest ratio (source over destination rate) that will be used.
+
+        When downsampling, the kernel is widened to cut off below the lower Nyquist frequency,
+        so this determines the filter and how much memory gets allocated.
+        Call prepare() after changing this.
+    */
+    void setMaximumRatio (double newMaximumRatio) noexcept  { maximumRatio = std::max (newMaximumRatio, 0.0001); }
+
+    /** Sets how many output samples a change of ratio is spread over. */
+    void setRampLength (int numOutputSamples) noexcept      { rampLength = std::max (numOutputSamples, 1); }
+
+    /** Clears the history, as if nothing had been pushed yet. */
+    void reset();
+
+    //==============================================================================
+    /** Adds some input samples. There must be room for them, as per the size given to prepare(). */
+    void push (const float* const* input, int numChannels, int numSamples);
+
+    /** Produces as many output samples as the pushed input allows for.
+
+        @returns the number of samples written, which might be less than the maximum.
+    */
+    int pull (float* const* output, int numChannels, int maxNumSamples);
+
+    /** @returns the number of input samples that must follow a sample before its output can be produced. */
+    [[nodiscard]] int getLatencyInInputSamples() const noexcept { return halfWidth; }
+
+    //==============================================================================
+    /** @internal */
+    void prepare (int numChannels, double sampleRate, int maxNumInputSamples) override;
+    /** Pushes all of the source, and pulls as much as fits into the destination,
+        clearing whatever couldn't be produced.
+
+        @returns the number of source samples used, which is always all of them.
+    */
+    int process (juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& destination) override;
+
+private:
+    //==============================================================================
+    juce::AudioBuffer<float> history;
+    std::vector<float> weights;
+    const std::vector<float>* table = nullptr;
+    double maximumRatio = 1.0, position = 0.0, currentStep = 1.0, targetStep = 1.0, stepIncrement = 0.0;
+    int halfWidth = 0, numBuffered = 0, rampLength = 512, numRampSamplesRemaining = 0;
+    float kernelScale = 1.0f;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseResampler)
+};
 
 //==============================================================================
 #if SQUAREPINE_USE_R8BRAIN
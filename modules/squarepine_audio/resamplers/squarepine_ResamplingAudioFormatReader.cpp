@@ -1,8 +1,17 @@
-ResamplingAudioFormatReader::ResamplingAudioFormatReader (std::shared_ptr<AudioFormatReader> formatReader,
-                                                          std::shared_ptr<TimeSliceThread> tst) :
+//==============================================================================
+namespace
+{
+    /** @returns the rate as an integer number of millihertz. */
+    inline int64 toMillihertz (double rate) noexcept
+    {
+        return std::max ((int64) 1, (int64) std::llround (rate * 1000.0));
+    }
+}
+
+//==============================================================================
+ResamplingAudioFormatReader::ResamplingAudioFormatReader (std::shared_ptr<AudioFormatReader> formatReader) :
     AudioFormatReader (formatReader->input, formatReader->getFormatName() + "-SRC"),
-    reader (formatReader),
-    timeSliceThread (tst)
+    reader (formatReader)
 {
     jassert (reader != nullptr);
 
@@ -18,17 +27,15 @@ ResamplingAudioFormatReader::ResamplingAudioFormatReader (std::shared_ptr<AudioF
 }
 
 ResamplingAudioFormatReader::ResamplingAudioFormatReader (std::shared_ptr<AudioFormatReader> formatReader,
-                                                          int expectedReadBlockSize, double outputSampleRate,
-                                                          std::shared_ptr<TimeSliceThread> tst) :
-    ResamplingAudioFormatReader (formatReader, tst)
+                                                          int expectedReadBlockSize, double outputSampleRate) :
+    ResamplingAudioFormatReader (formatReader)
 {
     prepare (outputSampleRate, expectedReadBlockSize);
 }
 
 ResamplingAudioFormatReader::~ResamplingAudioFormatReader()
 {
-    input = nullptr;    // Prevent the base-class from deleting the input...
-    source = nullptr;   // Clear before the time-slice thread...
+    input = nullptr; // Prevent the base-class from deleting the input...
 }
 
 //==============================================================================
@@ -40,38 +47,222 @@ void ResamplingAudioFormatReader::prepare (double currentOutputSampleRate, int e
         return;
     }
 
+    sampleRate = currentOutputSampleRate;
     sourceRatio = currentOutputSampleRate / originalSampleRate;
 
-    // We're in a resampling situation, and the block size has changed, probably due to time-stretching
-    const bool blockSizeChanged = approximatelyEqual (sampleRate, currentOutputSampleRate)
-                               && ! approximatelyEqual (currentOutputSampleRate, originalSampleRate)
-                               && expectedReadBlockSize != sourceBlockSize;
+    // NB: Keeping the ratio as a fraction means that positions never drift, no matter how far into the file.
+    const auto source = toMillihertz (originalSampleRate);
+    const auto destination = toMillihertz (currentOutputSampleRate);
+    const auto divisor = std::gcd (source, destination);
+    positionNumerator = source / divisor;
+    positionDenominator = destination / divisor;
+
+    lengthInSamples = (reader->lengthInSamples / positionNumerator) * positionDenominator
+                    + ((reader->lengthInSamples % positionNumerator) * positionDenominator) / positionNumerator;
 
-    // We're currently using a sample rate that's different than the current sample rate used by the interface
-    if (! approximatelyEqual (sampleRate, currentOutputSampleRate) || blockSizeChanged)
+    if (approximatelyEqual (sourceRatio, 1.0))
+        return;
+
+    prepareKernel();
+    prepareBuffers (expectedReadBlockSize);
+}
+
+void ResamplingAudioFormatReader::prepareKernel()
+{
+    // When downsampling, the kernel gets stretched to cut off below the new Nyquist frequency:
+    constexpr auto rollOff = 0.95;
+    const auto cutoff = rollOff * std::min (1.0, sourceRatio);
+
+    halfWidth = (int) std::ceil ((double) WindowedSincTable::numZeroCrossings / cutoff);
+    kernelScale = (float) (cutoff * WindowedSincTable::numPhasesPerZeroCrossing);
+    kernel = &WindowedSincTable::get();
+    weights.assign ((size_t) (halfWidth * 2), 0.0f);
+}
+
+void ResamplingAudioFormatReader::prepareBuffers (int expectedReadBlockSize)
+{
+    const auto numChans = (int) numChannels;
+
+    for (auto& block : cache)
     {
-        sampleRate = currentOutputSampleRate;
-        lengthInSamples = std::llround (static_cast<double> (reader->lengthInSamples) * sourceRatio);
+        block.samples.setSize (numChans, cachedBlockSize, false, false, true);
+        block.index = -1;
+        block.lastUsed = 0;
+        block.numValidSamples = 0;
+    }
+
+    const auto blockSize = std::max (expectedReadBlockSize, 256);
+    const auto numSourceSamples = (int) std::ceil ((double) blockSize / sourceRatio);
 
-        if (! approximatelyEqual (sampleRate, originalSampleRate)
-            || expectedReadBlockSize != sourceBlockSize)
+    window.setSize (numChans, std::max (numSourceSamples, cachedBlockSize) + halfWidth * 2 + 2, false, false, true);
+    output.setSize (numChans, blockSize, false, false, true);
+}
+
+//==============================================================================
+const ResamplingAudioFormatReader::CachedBlock* ResamplingAudioFormatReader::getBlock (int64 blockIndex)
+{
+    auto* leastRecentlyUsed = &cache.front();
+
+    for (auto& block : cache)
+    {
+        if (block.index == blockIndex)
         {
-            if (source == nullptr)
-                source.reset (new AudioTransportSource());
+            block.lastUsed = ++cacheCounter;
+            return &block;
+        }
+
+        if (block.lastUsed < leastRecentlyUsed->lastUsed)
+            leastRecentlyUsed = &block;
+    }
+
+    auto& block = *leastRecentlyUsed;
+    const auto start = blockIndex * cachedBlockSize;
+    const auto numSamples = (int) std::min ((int64) cachedBlockSize, reader->lengthInSamples - start);
+
+    block.index = -1;
 
-            sourceBlockSize = expectedReadBlockSize;
-            source->prepareToPlay (sourceBlockSize, currentOutputSampleRate);
+    if (numSamples <= 0)
+        return nullptr;
 
-            if (rSource == nullptr)
-                rSource.reset (new AudioFormatReaderSource (reader.get(), false));
+    // NB: Reading the ints straight into the float buffer, then converting in place, as AudioFormatReader does.
+    auto* const* channels = block.samples.getArrayOfWritePointers();
 
-            const auto readAheadSize = timeSliceThread == nullptr ? 0 : 2048;
+    if (! reader->read (reinterpret_cast<int* const*> (channels), block.samples.getNumChannels(),
+                        start, numSamples, false))
+        return nullptr;
 
-            source->setSource (rSource.get(), readAheadSize, timeSliceThread.get(), reader->sampleRate);
+    if (! reader->usesFloatingPointData)
+        for (int i = 0; i < block.samples.getNumChannels(); ++i)
+            FloatVectorOperations::convertFixedToFloat (channels[i], reinterpret_cast<const int*> (channels[i]),
+                                                        1.0f / (float) 0x7fffffff, numSamples);
 
-            outputBuffer.setSize ((int) numChannels, sourceBlockSize, false, true, true);
+    block.index = blockIndex;
+    block.lastUsed = ++cacheCounter;
+    block.numValidSamples = numSamples;
+    return &block;
+}
+
+bool ResamplingAudioFormatReader::fillWindow (int64 sourceStart, int numSourceSamples)
+{
+    jassert (numSourceSamples <= window.getNumSamples());
+
+    bool ok = true;
+    int offset = 0;
+
+    while (offset < numSourceSamples)
+    {
+        const auto position = sourceStart + offset;
+        const auto blockIndex = position >= 0 ? position / cachedBlockSize : -1;
+        const auto offsetInBlock = (int) (position - blockIndex * cachedBlockSize);
+        auto numThisTime = std::min (numSourceSamples - offset, cachedBlockSize - offsetInBlock);
+
+        const auto* block = position >= 0 && position < reader->lengthInSamples ? getBlock (blockIndex) : nullptr;
+
+        if (block == nullptr)
+        {
+            // Before the start, or past the end: silence.
+            if (position < 0)
+                numThisTime = (int) std::min ((int64) numThisTime, -position);
+            else if (position < reader->lengthInSamples)
+                ok = false;
+
+            for (int i = 0; i < window.getNumChannels(); ++i)
+                FloatVectorOperations::clear (window.getWritePointer (i, offset), numThisTime);
         }
+        else
+        {
+            const auto numValid = jlimit (0, numThisTime, block->numValidSamples - offsetInBlock);
+
+            for (int i = 0; i < window.getNumChannels(); ++i)
+            {
+                auto* dest = window.getWritePointer (i, offset);
+                FloatVectorOperations::copy (dest, block->samples.getReadPointer (i, offsetInBlock), numValid);
+                FloatVectorOperations::clear (dest + numValid, numThisTime - numValid);
+            }
+        }
+
+        offset += numThisTime;
     }
+
+    return ok;
+}
+
+bool ResamplingAudioFormatReader::resample (int64 startSampleInFile, int numSamples)
+{
+    jassert (numSamples <= output.getNumSamples());
+
+    // Split the position into whole and fractional source samples, exactly:
+    const auto n = startSampleInFile;
+    const auto quotient = n / positionDenominator;
+    const auto remainder = n % positionDenominator;
+    auto position = quotient * positionNumerator + (remainder * positionNumerator) / positionDenominator;
+    auto fraction = (remainder * positionNumerator) % positionDenominator;
+
+    const auto wholeStep = positionNumerator / positionDenominator;
+    const auto fractionStep = positionNumerator % positionDenominator;
+    const auto inverseDenominator = 1.0 / (double) positionDenominator;
+
+    const auto numTaps = halfWidth * 2;
+    const auto numChans = output.getNumChannels();
+
+    int64 windowStart = 0;
+    int windowSize = 0;
+    bool ok = true;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto firstTap = position - halfWidth + 1;
+
+        if (windowSize == 0 || firstTap + numTaps > windowStart + windowSize)
+        {
+            // NB: Only filling as much as the rest of this read needs.
+            const auto numRemaining = (double) (numSamples - i - 1);
+            const auto numNeeded = (int64) std::ceil (numRemaining / sourceRatio) + numTaps + 2;
+
+            windowStart = firstTap;
+            windowSize = (int) std::min ((int64) window.getNumSamples(), numNeeded);
+            ok = fillWindow (windowStart, windowSize) && ok;
+        }
+
+        // The kernel is symmetric, so only the distance from the centre matters:
+        const auto frac = (float) ((double) fraction * inverseDenominator);
+        float sum = 0.0f;
+
+        for (int k = 0; k < numTaps; ++k)
+        {
+            const auto w = WindowedSincTable::lookUp (*kernel, std::abs ((float) (k - halfWidth + 1) - frac) * kernelScale);
+            weights[(size_t) k] = w;
+            sum += w;
+        }
+
+        // Normalising keeps the gain at DC exact, whatever the phase:
+        if (sum != 0.0f)
+            FloatVectorOperations::multiply (weights.data(), 1.0f / sum, numTaps);
+
+        const auto offset = (int) (firstTap - windowStart);
+
+        for (int c = 0; c < numChans; ++c)
+        {
+            const auto* source = window.getReadPointer (c, offset);
+            float value = 0.0f;
+
+            for (int k = 0; k < numTaps; ++k)
+                value += source[k] * weights[(size_t) k];
+
+            output.setSample (c, i, value);
+        }
+
+        position += wholeStep;
+        fraction += fractionStep;
+
+        if (fraction >= positionDenominator)
+        {
+            fraction -= positionDenominator;
+            ++position;
+        }
+    }
+
+    return ok;
 }
 
 //==============================================================================
@@ -86,32 +277,29 @@ bool ResamplingAudioFormatReader::readSamples (int* const* destSamples, int numD
     if (approximatelyEqual (sourceRatio, 1.0))
         return reader->readSamples (destSamples, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
 
-    if (source != nullptr)
-    {
-        if (outputBuffer.getNumSamples() != numSamples)
-            outputBuffer.setSize (numDestChannels, numSamples);
+    // You must call prepare() first!
+    jassert (output.getNumSamples() > 0 && kernel != nullptr);
+    if (output.getNumSamples() <= 0 || kernel == nullptr)
+        return false;
 
-        if (! source->isPlaying())
-            source->start();
+    clearSamplesBeyondAvailableLength (destSamples, numDestChannels, startOffsetInDestBuffer,
+                                       startSampleInFile, numSamples, lengthInSamples);
 
-        /** To avoid playback issues when moving from block to block, "source" manages its position
-            The interface to this function specifies a playback position, so we check to see whether that new position
-            is different to the "source" position (within a tolerance) if it is then we move the source's position to the requested position
-        */
-        const auto newPosition = std::llround ((double) startSampleInFile * (1.0 / sourceRatio));
-        const auto diff = std::abs (rSource->getNextReadPosition() - newPosition);
+    bool ok = true;
 
-        constexpr auto positionDiff = 5;
-        if (diff > positionDiff)
-            rSource->setNextReadPosition (newPosition);
+    while (numSamples > 0)
+    {
+        const auto numThisTime = std::min (numSamples, output.getNumSamples());
 
-        AudioSourceChannelInfo info (&outputBuffer, 0, numSamples);
-        source->getNextAudioBlock (info);
-    }
+        ok = resample (startSampleInFile, numThisTime) && ok;
+        writeOutputBuffers (destSamples, numDestChannels, startOffsetInDestBuffer, numThisTime);
 
-    writeOutputBuffers (destSamples, numDestChannels, startOffsetInDestBuffer, numSamples);
+        startSampleInFile += numThisTime;
+        startOffsetInDestBuffer += numThisTime;
+        numSamples -= numThisTime;
+    }
 
-    return true;
+    return ok;
 }
 
 //==============================================================================
@@ -132,7 +320,7 @@ void ResamplingAudioFormatReader::writeOutputBuffers (int* const* destSamples, i
                 const float* sourceChannel = nullptr;
 
                 if (i < localNumChannels)
-                    sourceChannel = outputBuffer.getReadPointer (i, 0);
+                    sourceChannel = output.getReadPointer (i, 0);
 
                 if (sourceChannel != nullptr)
                     FloatVectorOperations::copy (reinterpret_cast<float*> (targetChannel) + offset, sourceChannel, numSamples);
@@ -157,7 +345,7 @@ void ResamplingAudioFormatReader::writeOutputBuffers (int* const* destSamples, i
                 const float* sourceChannel = nullptr;
 
                 if (i < localNumChannels)
-                    sourceChannel = outputBuffer.getReadPointer (i, 0);
+                    sourceChannel = output.getReadPointer (i, 0);
 
                 if (sourceChannel != nullptr)
                     dest.convertSamples (SourceType (sourceChannel), numSamples);
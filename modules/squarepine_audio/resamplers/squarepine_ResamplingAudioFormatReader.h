@@ -1,4 +1,15 @@
-/** */
+/** Wraps an AudioFormatReader, presenting its audio at a different sample rate.
+
+    Every output sample is computed from the source with a windowed-sinc
+    kernel at an exact source position, so reads are stateless: the same
+    range always produces the same samples no matter what was read before,
+    making this suitable for random access (eg: samplers and thumbnails).
+
+    Recently decoded blocks of the source are cached so overlapping,
+    consecutive or backward reads don't hit the source reader again.
+
+    Nothing gets allocated when reading; all of the memory is set up by prepare().
+*/
 class ResamplingAudioFormatReader final : public AudioFormatReader
 {
 public:
@@ -6,24 +17,36 @@ public:
 
         Remember to call prepare when the desired output sample rate is known.
     */
-    ResamplingAudioFormatReader (std::shared_ptr<AudioFormatReader> formatReader,
-                                 std::shared_ptr<TimeSliceThread> timeSliceThread = {});
+    ResamplingAudioFormatReader (std::shared_ptr<AudioFormatReader> formatReader);
 
-    /** */
+    /** Creates a reader that converts the source to the output sample rate. */
     ResamplingAudioFormatReader (std::shared_ptr<AudioFormatReader> formatReader,
-                                 int expectedReadBlockSize, double outputSampleRate,
-                                 std::shared_ptr<TimeSliceThread> timeSliceThread = {});
+                                 int expectedReadBlockSize, double outputSampleRate);
 
-    /** */
+    /** Destructor. */
     ~ResamplingAudioFormatReader() override;
 
     //==============================================================================
-    /** */
+    /** Changes the output sample rate, and sets up the kernel and cache.
+
+        This allocates, so don't call it from a realtime thread.
+
+        @param outputRate               The sample rate to present the audio at.
+        @param expectedReadBlockSize    The typical number of samples per read.
+                                        Reads may be larger; they'll simply be split up.
+    */
     void prepare (double outputRate, int expectedReadBlockSize);
 
-    /** */
+    /** @returns the output rate divided by the source rate. */
     double getConversionRatio() const noexcept { return sourceRatio; }
 
+    //==============================================================================
+    /** Number of source blocks to keep decoded. */
+    static constexpr int numCachedBlocks = 8;
+
+    /** Number of source samples per cached block. */
+    static constexpr int cachedBlockSize = 4096;
+
     //==============================================================================
     /** @internal */
     bool readSamples (int* const*, int, int, int64, int) override;
@@ -34,18 +57,37 @@ public:
 
 private:
     //==============================================================================
-    juce::AudioBuffer<float> outputBuffer;
+    struct CachedBlock final
+    {
+        juce::AudioBuffer<float> samples;
+        int64 index = -1;
+        uint64 lastUsed = 0;
+        int numValidSamples = 0;
+    };
 
     std::shared_ptr<AudioFormatReader> reader;
-    std::shared_ptr<TimeSliceThread> timeSliceThread;
 
-    std::unique_ptr<AudioFormatReaderSource> rSource;
-    std::unique_ptr<AudioTransportSource> source;
+    double sourceRatio = 1.0;
+
+    // The source position of an output sample n is (n * positionNumerator) / positionDenominator:
+    int64 positionNumerator = 1, positionDenominator = 1;
+
+    const std::vector<float>* kernel = nullptr;
+    std::vector<float> weights;
+    int halfWidth = 0;           // In source samples, for either side of the kernel.
+    float kernelScale = 1.0f;    // Kernel steps per source sample.
+
+    std::array<CachedBlock, numCachedBlocks> cache;
+    uint64 cacheCounter = 0;
 
-    double sourceRatio = 0.0;
-    int sourceBlockSize = 0;
+    juce::AudioBuffer<float> window, output;
 
     //==============================================================================
+    void prepareKernel();
+    void prepareBuffers (int expectedReadBlockSize);
+    const CachedBlock* getBlock (int64 blockIndex);
+    bool fillWindow (int64 sourceStart, int numSourceSamples);
+    bool resample (int64 startSampleInFile, int numSamples);
     void writeOutputBuffers (int* const* destSamples, int numDestChannels, int startOffsetInDestBuffer, int numSamples);
 
     //==============================================================================
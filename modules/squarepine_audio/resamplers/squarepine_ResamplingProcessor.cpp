@@ -1,71 +1,290 @@
-#if 0
+ResamplingProcessor::ResamplingProcessor()
+{
+}
+
+ResamplingProcessor::~ResamplingProcessor()
+{
+    if (processor != nullptr)
+        processor->releaseResources();
+}
 
-template <typename ResamplerType>
-ResamplingProcessor::ResamplingProcessor() :
-    realtime (new ResamplerType()),
-    offline (new ResamplerType())
+//==============================================================================
+void ResamplingProcessor::setInternalSampleRate (double newSampleRate)
 {
-    static_assert (std::is_base_of<Resampler, ResamplerType>::value, "Class must derive from Resampler");
+    internalSampleRate = std::max (0.0, newSampleRate);
 }
 
-void ResamplingProcessor::setResamplers (Resampler* realtimeResampler, Resampler* offlineResampler)
+void ResamplingProcessor::setVarispeedRange (Range<double> newRange)
 {
-    if (realtime.get() != realtimeResampler || offline.get() != offlineResampler)
+    jassert (newRange.getStart() > 0.0);
+
+    const auto start = std::max (0.01, newRange.getStart());
+    minVarispeed = start;
+    maxVarispeed = std::max (start, newRange.getEnd());
+    setVarispeed (getVarispeed());
+}
+
+void ResamplingProcessor::setVarispeed (double newSpeed)
+{
+    varispeed = getVarispeedRange().clipValue (newSpeed);
+}
+
+//==============================================================================
+void ResamplingProcessor::setProcessor (AudioPluginPtr newProcessor)
+{
+    if (newProcessor == processor)
+        return;
+
+    if (newProcessor != nullptr && maxBlockSize > 0)
+        prepareProcessor (*newProcessor);
+
     {
-        realtime.reset (realtimeResampler);
-        offline.reset (offlineResampler);
+        const SpinLock::ScopedLockType sl (processorLock);
+        std::swap (processor, newProcessor);
     }
 
-    jassert (realtime != nullptr);
+    if (newProcessor != nullptr)
+        newProcessor->releaseResources();
+
+    updateLatency();
+}
+
+AudioPluginPtr ResamplingProcessor::getProcessor() const
+{
+    const SpinLock::ScopedLockType sl (processorLock);
+    return processor;
+}
+
+//==============================================================================
+double ResamplingProcessor::getEffectiveInternalRate (double outerRate) const noexcept
+{
+    return internalSampleRate > 0.0 ? internalSampleRate : outerRate;
 }
 
-void ResamplingProcessor::setRatio (double newRatio)
+void ResamplingProcessor::prepareProcessor (AudioPluginInstance& p) const
 {
-    ratio = std::clamp (newRatio, 0.00001, 5.0);
+    const auto numChans = std::max (getTotalNumInputChannels(), getTotalNumOutputChannels());
+
+    p.setPlayConfigDetails (numChans, numChans, preparedInternalRate, maxInternalBlockSize);
+    p.setNonRealtime (isNonRealtime());
+    p.prepareToPlay (preparedInternalRate, maxInternalBlockSize);
 }
 
-void ResamplingProcessor::setRatio (double sourceRate, double destinationRate)
+void ResamplingProcessor::updateLatency()
 {
-    if (sourceRate > 0.0 && destinationRate > 0.0)
-        setRatio (sourceRate / destinationRate);
+    auto latency = conversionLatency;
+
+    if (auto p = getProcessor())
+        latency += roundToInt ((double) p->getLatencySamples() * getSampleRate() / preparedInternalRate);
+
+    setLatencySamples (latency);
 }
 
 void ResamplingProcessor::prepareToPlay (double newSampleRate, int estimatedSamplesPerBlock)
 {
     setRateAndBufferSizeDetails (newSampleRate, estimatedSamplesPerBlock);
 
-    const int numChans = std::max (getTotalNumInputChannels(), getTotalNumOutputChannels());
+    const auto numChans = std::max (1, std::max (getTotalNumInputChannels(), getTotalNumOutputChannels()));
+
+    preparedInternalRate = getEffectiveInternalRate (newSampleRate);
+    preparedVarispeedRange = getVarispeedRange();
+    maxBlockSize = std::max (1, estimatedSamplesPerBlock);
+    needsConversion = ! approximatelyEqual (preparedInternalRate, newSampleRate)
+                      || preparedVarispeedRange != Range<double> (1.0, 1.0);
+
+    if (needsConversion)
+    {
+        // Everything is sized for the worst-case ratio in either direction:
+        const auto slowest = preparedInternalRate * preparedVarispeedRange.getStart() / newSampleRate;
+        const auto fastest = preparedInternalRate * preparedVarispeedRange.getEnd() / newSampleRate;
+
+        maxInternalBlockSize = (int) std::ceil (maxBlockSize * fastest) + 4;
+        const auto maxConvertedSize = (int) std::ceil (maxInternalBlockSize / slowest) + 4;
+
+        currentSpeed = targetSpeed = preparedVarispeedRange.clipValue (varispeed.load());
+        numRampSamplesRemaining = 0;
+
+        const auto ratio = preparedInternalRate * currentSpeed / newSampleRate;
+        downsampler.setRatio (1.0 / ratio);
+        upsampler.setRatio (ratio);
+
+        downsampler.setMaximumRatio (1.0 / slowest);
+        downsampler.prepare (numChans, newSampleRate, maxBlockSize);
+        upsampler.setMaximumRatio (fastest);
+        upsampler.prepare (numChans, preparedInternalRate, maxInternalBlockSize);
+
+        // NB: The varispeed is ramped here instead, in lockstep (see varispeedStepLength).
+        downsampler.setRampLength (1);
+        upsampler.setRampLength (1);
+
+        internalBuffer.setSize (numChans, maxInternalBlockSize, false, true, true);
+        convertedBuffer.setSize (numChans, maxConvertedSize, false, true, true);
+
+        // Output is only available once both kernels have seen enough input, so the FIFO is primed
+        // with that much silence, at the slowest speed, plus a little slack for rounding.
+        // As the resamplers change ratio in lockstep, this is enough for the FIFO never to run dry:
+        const auto upsamplerLatency = (double) upsampler.getLatencyInInputSamples() / slowest;
+        conversionLatency = downsampler.getLatencyInInputSamples() + (int) std::ceil (upsamplerLatency) + 2;
+
+        outputFIFO.setSize (numChans, conversionLatency + maxConvertedSize + maxBlockSize + 16);
+        outputFIFO.pushSilence (conversionLatency);
+    }
+    else
+    {
+        conversionLatency = 0;
+        maxInternalBlockSize = maxBlockSize;
+        internalBuffer.setSize (0, 0);
+        convertedBuffer.setSize (0, 0);
+    }
+
+    inputMidi.ensureSize (2048);
+    internalMidi.ensureSize (2048);
+
+    if (auto p = getProcessor())
+        prepareProcessor (*p);
+
+    updateLatency();
+}
 
-    jassert (realtime != nullptr);
-    realtime->prepare (numChans, estimatedSamplesPerBlock, newSampleRate);
+void ResamplingProcessor::releaseResources()
+{
+    if (auto p = getProcessor())
+        p->releaseResources();
+}
 
-    if (offline != nullptr)
-        offline->prepare (numChans, estimatedSamplesPerBlock, newSampleRate);
+//==============================================================================
+bool ResamplingProcessor::acceptsMidi() const
+{
+    if (auto p = getProcessor())
+        return p->acceptsMidi();
 
-    result.setSize (numChans, estimatedSamplesPerBlock, false, true, true);
+    return false;
 }
 
-void ResamplingProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer&)
+bool ResamplingProcessor::producesMidi() const
 {
-    const int numSamples = buffer.getNumSamples();
-    const auto r = getRatio();
+    if (auto p = getProcessor())
+        return p->producesMidi();
+
+    return false;
+}
 
-    if (isBypassed() || numSamples <= 0 || r == 1.0000000000)
+//==============================================================================
+void ResamplingProcessor::processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    const auto numSamples = buffer.getNumSamples();
+
+    if (isBypassed() || numSamples <= 0)
         return;
 
-    auto* resamplerToUse = realtime.get();
+    // NB: The processor is only ever swapped for a moment, in which case this block skips it.
+    const SpinLock::ScopedTryLockType sl (processorLock);
+    auto* p = sl.isLocked() ? processor.get() : nullptr;
+
+    if (! needsConversion)
+    {
+        if (p != nullptr)
+            p->processBlock (buffer, midiMessages);
+
+        return;
+    }
+
+    // NB: The incoming events are handed out chunk by chunk, and replaced by whatever the processor produces.
+    inputMidi.clear();
+
+    if (p != nullptr)
+    {
+        inputMidi.addEvents (midiMessages, 0, numSamples, 0);
+        midiMessages.clear();
+    }
+
+    const auto newTarget = preparedVarispeedRange.clipValue (varispeed.load());
+
+    if (! approximatelyEqual (newTarget, targetSpeed))
+    {
+        targetSpeed = newTarget;
+        numRampSamplesRemaining = varispeedRampLength;
+    }
+
+    for (int start = 0; start < numSamples;)
+    {
+        auto numThisTime = std::min (maxBlockSize, numSamples - start);
 
-    if (isNonRealtime() && offline != nullptr)
-        resamplerToUse = offline.get();
+        if (numRampSamplesRemaining > 0)
+        {
+            numThisTime = std::min (numThisTime, varispeedStepLength);
+            currentSpeed += (targetSpeed - currentSpeed) * (double) numThisTime / (double) numRampSamplesRemaining;
+            numRampSamplesRemaining = std::max (0, numRampSamplesRemaining - numThisTime);
 
-    jassert (resamplerToUse != nullptr);
-    resamplerToUse->setRatio (r);
+            if (numRampSamplesRemaining == 0)
+                currentSpeed = targetSpeed;
 
-    const auto newSize = (int) std::max (1.0, (double) numSamples / r);
-    result.setSize (buffer.getNumChannels(), newSize, false, false, true);
-    result.clear();
+            const auto ratio = preparedInternalRate * currentSpeed / getSampleRate();
+            downsampler.setRatio (1.0 / ratio);
+            upsampler.setRatio (ratio);
+        }
 
-    resamplerToUse->process (buffer, result, r);
+        processChunk (buffer, midiMessages, start, numThisTime, p);
+        start += numThisTime;
+    }
 }
 
-#endif // 
+void ResamplingProcessor::processChunk (juce::AudioBuffer<float>& buffer, MidiBuffer& midiMessages,
+                                        int startSample, int numSamples, AudioPluginInstance* p)
+{
+    const auto numChans = std::min (buffer.getNumChannels(), outputFIFO.getNumChannels());
+
+    juce::AudioBuffer<float> chunk (buffer.getArrayOfWritePointers(), numChans, startSample, numSamples);
+
+    // Device rate to internal rate:
+    downsampler.push (chunk.getArrayOfReadPointers(), numChans, numSamples);
+    const auto numInternal = downsampler.pull (internalBuffer.getArrayOfWritePointers(),
+                                               internalBuffer.getNumChannels(), internalBuffer.getNumSamples());
+
+    if (p != nullptr)
+    {
+        // NB: Events stay pending if there aren't any internal samples to put them with yet.
+        for (auto iter = inputMidi.findNextSamplePosition (startSample); iter != inputMidi.cend(); ++iter)
+        {
+            const auto metadata = *iter;
+
+            if (metadata.samplePosition >= startSample + numSamples)
+                break;
+
+            const auto position = (int) ((int64) (metadata.samplePosition - startSample) * numInternal / numSamples);
+            internalMidi.addEvent (metadata.data, metadata.numBytes, position);
+        }
+
+        if (numInternal > 0)
+        {
+            juce::AudioBuffer<float> internalChunk (internalBuffer.getArrayOfWritePointers(), internalBuffer.getNumChannels(), numInternal);
+            p->processBlock (internalChunk, internalMidi);
+
+            for (const auto metadata : internalMidi)
+            {
+                const auto position = (int) ((int64) metadata.samplePosition * numSamples / numInternal);
+                midiMessages.addEvent (metadata.data, metadata.numBytes, startSample + jlimit (0, numSamples - 1, position));
+            }
+
+            internalMidi.clear();
+        }
+    }
+    else
+    {
+        internalMidi.clear();
+    }
+
+    // And back again:
+    upsampler.push (internalBuffer.getArrayOfReadPointers(), internalBuffer.getNumChannels(), numInternal);
+    const auto numConverted = upsampler.pull (convertedBuffer.getArrayOfWritePointers(),
+                                              convertedBuffer.getNumChannels(), convertedBuffer.getNumSamples());
+
+    outputFIFO.push (convertedBuffer.getArrayOfReadPointers(), numConverted);
+
+    // The pre-roll should make a shortfall impossible, but if there ever is one it comes out as silence:
+    const auto numReady = std::min (numSamples, outputFIFO.getNumReady());
+    jassert (numReady == numSamples);
+
+    outputFIFO.readTo (chunk.getArrayOfWritePointers(), numReady);
+    chunk.clear (numReady, numSamples - numReady);
+}
@@ -1,49 +1,129 @@
-#if 0
+/** Runs a processor at a different sample rate than the one this is played at,
+    (eg: a plugin that must run at the session's rate whilst the device runs at another),
+    converting the audio on the way in and back out again.
 
-class ResamplingProcessor : public InternalProcessor
+    The conversion uses internal FIFOs so that the hosted processor can be handed
+    however many samples the conversion produced, no matter the device's block size.
+    All of the memory is allocated in prepareToPlay() for the worst-case ratio,
+    and the added latency is reported via getLatencySamples().
+
+    The internal rate can also be varied smoothly (ie: varispeed),
+    within the range given to setVarispeedRange().
+
+    MIDI is passed to the hosted processor with its timestamps scaled to the
+    internal block, and any MIDI the hosted processor produces is scaled back.
+    The events are placed as accurately as the conversion allows, but aren't
+    delayed by the conversion's latency.
+
+    Without a hosted processor, this simply converts to the internal rate and back,
+    which band-limits the audio to the lower of the two rates.
+*/
+class ResamplingProcessor final : public InternalProcessor
 {
 public:
     /** Constructor. */
-    template <typename ResamplerType>
     ResamplingProcessor();
 
+    /** Destructor. */
+    ~ResamplingProcessor() override;
+
+    //==============================================================================
+    /** Changes the rate the hosted processor runs at.
+
+        Zero or less means to run at the same rate as this processor.
+        This takes effect the next time this processor is prepared.
+    */
+    void setInternalSampleRate (double newSampleRate);
+
+    /** @returns the rate the hosted processor runs at, or zero if it follows this processor's rate. */
+    [[nodiscard]] double getInternalSampleRate() const noexcept { return internalSampleRate; }
+
     //==============================================================================
-    /** Change the resampling ratio.
+    /** Changes the range the varispeed can move within.
 
-        A value of 1.0 means no change.
+        The default is no variation at all, and this takes effect the next time
+        this processor is prepared, seeing that it determines the anti-aliasing
+        filter and how much memory is needed.
     */
-    void setRatio (double newRatio);
+    void setVarispeedRange (Range<double> newRange);
 
-    /** Set the ratio via sampling rates.
+    /** @returns the range the varispeed can move within. */
+    [[nodiscard]] Range<double> getVarispeedRange() const noexcept { return { minVarispeed.load(), maxVarispeed.load() }; }
 
-        @param sourceRate       The source rate of the audio content.
-        @param destinationRate  The target rate to correct to.
+    /** Changes the speed the hosted processor runs at, relative to its internal rate.
+
+        This changes smoothly, and is clamped to the range given to setVarispeedRange().
+        This may be called from any thread.
     */
-    void setRatio (double sourceRate, double destinationRate);
+    void setVarispeed (double newSpeed);
 
-    /** @returns The currently set ratio. */
-    double getRatio() const noexcept { return ratio.load(); }
+    /** @returns the currently targeted speed. */
+    [[nodiscard]] double getVarispeed() const noexcept { return varispeed.load(); }
 
     //==============================================================================
-    /** Changes the resamplers to use. */
-    void setResamplers (Resampler* realtimeResampler, Resampler* offlineResampler);
+    /** Changes the processor running at the internal rate, which may be null.
+
+        If this processor is already prepared, the new one is prepared
+        before being swapped in, so call this from the message thread.
+    */
+    void setProcessor (AudioPluginPtr newProcessor);
+
+    /** @returns the processor running at the internal rate, if any. */
+    [[nodiscard]] AudioPluginPtr getProcessor() const;
 
     //==============================================================================
     /** @internal */
-    Identifier getIdentifier() const override { return NEEDS_TRANS ("Resampler"); }
+    const String getName() const override { return NEEDS_TRANS ("Resampler"); }
+    /** @internal */
+    Identifier getIdentifier() const override { return "resampler"; }
     /** @internal */
     void prepareToPlay (double, int) override;
     /** @internal */
+    void releaseResources() override;
+    /** @internal */
+    bool acceptsMidi() const override;
+    /** @internal */
+    bool producesMidi() const override;
+    /** @internal */
     void processBlock (juce::AudioBuffer<float>&, MidiBuffer&) override;
 
 private:
     //==============================================================================
-    std::atomic<double> ratio { 1.0 };
-    std::unique_ptr<Resampler> realtime, offline;
-    AudioBuffer<float> result;
+    double internalSampleRate = 0.0;
+    std::atomic<double> minVarispeed { 1.0 }, maxVarispeed { 1.0 }, varispeed { 1.0 };
+
+    /** How long the varispeed takes to ramp to a new speed, in samples at this processor's rate. */
+    static constexpr int varispeedRampLength = 1024;
+
+    /** The most samples processed at once whilst the varispeed ramps.
+
+        Both resamplers step to each new ratio together, at the start of a chunk:
+        ramping them separately lets the number of samples in flight drift,
+        which would run the output FIFO dry.
+    */
+    static constexpr int varispeedStepLength = 32;
+
+    AudioPluginPtr processor;
+    mutable SpinLock processorLock;
+
+    PolyphaseResampler downsampler, upsampler;
+    AudioBufferFIFO<float> outputFIFO;
+    juce::AudioBuffer<float> internalBuffer, convertedBuffer;
+    MidiBuffer inputMidi, internalMidi;
+
+    double preparedInternalRate = 0.0;
+    Range<double> preparedVarispeedRange { 1.0, 1.0 }; // NB: Only the audio thread reads this, as of the last prepare.
+    double currentSpeed = 1.0, targetSpeed = 1.0;
+    int numRampSamplesRemaining = 0;
+    int maxBlockSize = 0, maxInternalBlockSize = 0, conversionLatency = 0;
+    bool needsConversion = false;
+
+    //==============================================================================
+    [[nodiscard]] double getEffectiveInternalRate (double outerRate) const noexcept;
+    void prepareProcessor (AudioPluginInstance&) const;
+    void updateLatency();
+    void processChunk (juce::AudioBuffer<float>&, MidiBuffer&, int startSample, int numSamples, AudioPluginInstance*);
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ResamplingProcessor)
 };
-
-#endif //
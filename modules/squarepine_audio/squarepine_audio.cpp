@@ -38,6 +38,7 @@ namespace sp
     #include "codecs/squarepine_ALACAudioFormat.cpp"
     #include "codecs/squarepine_REXAudioFormat.cpp"
     #include "core/squarepine_ChildProcessPluginScanner.cpp"
+    #include "core/squarepine_RealtimeWorkerPool.cpp"
     #include "core/squarepine_EffectProcessor.cpp"
     #include "core/squarepine_EffectProcessorChain.cpp"
     #include "core/squarepine_EffectProcessorFactory.cpp"
@@ -47,15 +48,19 @@ namespace sp
     #include "devices/squarepine_DummyAudioIODeviceCallback.cpp"
     #include "devices/squarepine_DummyAudioIODeviceType.cpp"
     #include "devices/squarepine_MediaDevicePoller.cpp"
+    #include "devices/squarepine_OfflineRenderer.cpp"
+    #include "dsp/squarepine_PartitionedConvolver.cpp"
     #include "effects/squarepine_ADSRProcessor.cpp"
     #include "effects/squarepine_BitCrusherProcessor.cpp"
     #include "effects/squarepine_DitherProcessor.cpp"
     #include "effects/squarepine_HissingProcessor.cpp"
     #include "effects/squarepine_LevelsProcessor.cpp"
     #include "effects/squarepine_LFOProcessor.cpp"
+    #include "effects/squarepine_WavetableLFOBank.cpp"
     #include "effects/squarepine_MuteProcessor.cpp"
     #include "effects/squarepine_PanProcessor.cpp"
     #include "effects/squarepine_PolarityInversionProcessor.cpp"
+    #include "effects/squarepine_PositionedConvolutionProcessor.cpp"
     #include "effects/squarepine_SimpleChorusProcessor.cpp"
     #include "effects/squarepine_SimpleCompressorProcessor.cpp"
     #include "effects/squarepine_SimpleDistortionProcessor.cpp"
@@ -81,8 +86,17 @@ namespace sp
     #include "time/squarepine_MBTTime.cpp"
     #include "time/squarepine_SMPTETime.cpp"
     #include "time/squarepine_Tempo.cpp"
+    #include "time/squarepine_TempoMap.cpp"
     #include "time/squarepine_TimeKeeper.cpp"
     #include "time/squarepine_TimeSignature.cpp"
+    #include "unittests/squarepine_ALACAudioFormatUnitTests.cpp"
+    #include "unittests/squarepine_EffectProcessorChainUnitTests.cpp"
+    #include "unittests/squarepine_MultichannelResamplerUnitTests.cpp"
+    #include "unittests/squarepine_NonlinearStageUnitTests.cpp"
+    #include "unittests/squarepine_PartitionedConvolverUnitTests.cpp"
+    #include "unittests/squarepine_ResamplerUnitTests.cpp"
+    #include "unittests/squarepine_TempoMapUnitTests.cpp"
+    #include "unittests/squarepine_SquarePineAudioUnitTestGatherer.cpp"
     #include "wrappers/squarepine_AudioSourceProcessor.cpp"
     #include "wrappers/squarepine_AudioTransportProcessor.cpp"
 }
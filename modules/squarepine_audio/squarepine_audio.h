@@ -5,7 +5,7 @@
 
     ID:                 squarepine_audio
     vendor:             SquarePine
-    version:            1.7.0
+    version:            1.9.0
     name:               SquarePine Audio
     description:        A great backbone for any typical audio project.
     website:            https://www.squarepine.io
@@ -128,6 +128,10 @@ namespace sp
     #include "core/squarepine_ChildProcessPluginScanner.h"
     #include "core/squarepine_SquarePineAudioPluginFormat.h"
     #include "core/squarepine_InternalProcessor.h"
+    #include "dsp/squarepine_DelayCompensator.h"
+    #include "core/squarepine_RealtimeWorkerPool.h"
+    #include "core/squarepine_MeterSnapshotTransport.h"
+    #include "dsp/squarepine_MeteringEngine.h"
     #include "effects/squarepine_LevelsProcessor.h"
     class EffectProcessorChain;
     #include "core/squarepine_EffectProcessor.h"
@@ -146,18 +150,23 @@ namespace sp
     #include "devices/squarepine_DummyAudioIODeviceCallback.h"
     #include "devices/squarepine_DummyAudioIODeviceType.h"
     #include "devices/squarepine_MediaDevicePoller.h"
+    #include "devices/squarepine_OfflineRenderer.h"
     #include "dsp/squarepine_BasicDither.h"
     #include "dsp/squarepine_DistortionFunctions.h"
     #include "dsp/squarepine_EnvelopeFollower.h"
+    #include "dsp/squarepine_NonlinearStage.h"
     #include "dsp/squarepine_PositionedImpulseResponse.h"
+    #include "dsp/squarepine_PartitionedConvolver.h"
     #include "effects/squarepine_ADSRProcessor.h"
     #include "effects/squarepine_BitCrusherProcessor.h"
     #include "effects/squarepine_DitherProcessor.h"
     #include "effects/squarepine_HissingProcessor.h"
+    #include "effects/squarepine_WavetableLFOBank.h"
     #include "effects/squarepine_LFOProcessor.h"
     #include "effects/squarepine_MuteProcessor.h"
     #include "effects/squarepine_PanProcessor.h"
     #include "effects/squarepine_PolarityInversionProcessor.h"
+    #include "effects/squarepine_PositionedConvolutionProcessor.h"
     #include "effects/squarepine_SimpleChorusProcessor.h"
     #include "effects/squarepine_SimpleCompressorProcessor.h"
     #include "effects/squarepine_SimpleDistortionProcessor.h"
@@ -182,7 +191,9 @@ namespace sp
     #include "time/squarepine_Tempo.h"
     #include "time/squarepine_TimeSignature.h"
     #include "time/squarepine_MBTTime.h"
+    #include "time/squarepine_TempoMap.h"
     #include "time/squarepine_TimeKeeper.h"
+    #include "unittests/squarepine_SquarePineAudioUnitTestGatherer.h"
     #include "wrappers/squarepine_AudioSourceProcessor.h"
     #include "wrappers/squarepine_AudioTransportProcessor.h"
 }
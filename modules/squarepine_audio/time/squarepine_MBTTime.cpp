@@ -5,9 +5,14 @@ MBTTime::MBTTime (const int m, const int b, const int t) :
 {
 }
 
-MBTTime::MBTTime (const double ticks, const int ppq, const Array<TimeSignature>& timeSigs, const double songLength)
+MBTTime::MBTTime (const double ticks, const int ppq, const TimeSignature& timeSignature)
+{
+    MBTTime::ticksToMBTTime (*this, ticks, ppq, timeSignature);
+}
+
+MBTTime::MBTTime (const double ticks, const int ppq, const Array<TimeSignature>& timeSigs, const double) :
+    MBTTime (ticks, ppq, timeSigs.isEmpty() ? TimeSignature() : timeSigs.getFirst())
 {
-    MBTTime::ticksToMBTTime (*this, ticks, ppq, timeSigs, songLength);
 }
 
 MBTTime::MBTTime (const MBTTime& mbt) :
@@ -44,54 +49,52 @@ bool MBTTime::operator!= (const MBTTime& other) const
 }
 
 //==============================================================================
-void MBTTime::ticksToMBTTime (MBTTime&, double, int, const Array<TimeSignature>&, double)
+void MBTTime::ticksToMBTTime (MBTTime& out, double ticks, int ppq, const TimeSignature& timeSignature)
 {
-#if 0
-    jassert (ticks >= 0);        //Our MIDI setup is not meant to play in a different spacetime continuum...
-    jassert (ppq > 0);           //Invalid PPQ! You might as well try to figure out how to divide by 0!
-    jassert (songLength >= 0);   //A song's length cannot be negative!
+    jassert (ticks >= 0);   //Our MIDI setup is not meant to play in a different spacetime continuum...
+    jassert (ppq > 0);      //Invalid PPQ! You might as well try to figure out how to divide by 0!
 
-    if ((ticks < 0) || (ppq <= 0) || (songLength < 0))
+    if ((ticks < 0) || (ppq <= 0))
     {
         out = MBTTime();
         return;
     }
 
-    auto timeDelta = 0.0;
-    int i;
+    // NB: This is the same as a TempoMap with a single time signature, without building one.
+    const auto ticksPerBeat = (double) ppq * 4.0 / (double) timeSignature.denominator;
+    const auto ticksPerMeasure = ticksPerBeat * (double) timeSignature.numerator;
 
-    for (i = 0; i < timeSigs.size(); ++i)
-    {
-        const auto tsATime = timeSigs.getUnchecked (i).timestamp;
+    const auto measures = std::floor (ticks / ticksPerMeasure);
+    const auto remainder = std::max (0.0, ticks - measures * ticksPerMeasure);
+    const auto beats = std::min (std::floor (remainder / ticksPerBeat), (double) timeSignature.numerator - 1.0);
+    const auto remainingTicks = std::max (0.0, remainder - beats * ticksPerBeat);
 
-        double tsBTime = songLength;
-        if ((i + 1) < timeSigs.size())
-            tsBTime = timeSigs[i + 1].timestamp;
+    out = MBTTime ((int) measures + 1, (int) beats + 1, (int) remainingTicks);
+}
 
-        if ((ticks >= tsATime) && (ticks < tsBTime))
-        {
-            timeDelta = tsBTime - tsATime;
-            break;
-        }
-    }
+void MBTTime::ticksToMBTTime (MBTTime& out, double ticks, int ppq, const Array<TimeSignature>& timeSigs, double)
+{
+    ticksToMBTTime (out, ticks, ppq, timeSigs.isEmpty() ? TimeSignature() : timeSigs.getFirst());
+}
+
+//==============================================================================
+double MBTTime::toTicks (const TimeSignature& timeSignature, int ppq) const
+{
+    jassert (ppq > 0); //Invalid PPQ! You might as well try to figure out how to divide by 0!
 
-    const auto timeSig = timeSigs.getUnchecked (i);
+    if (ppq <= 0)
+        return 0.0;
 
-    double integral = 0;
-    const auto fractional   = std::modf ((double) (ticks / ppq), &integral);
-    const auto barLength    = determineBarLengthInTicks (timeSig.numerator, timeSig.denominator, (short) ppq);
-    const auto delta        = (ticks - timeSig.timestamp);
+    const auto ticksPerBeat = (double) ppq * 4.0 / (double) timeSignature.denominator;
 
-    out.tick    = (int) std::round (fractional * (double) ppq);
-    out.beat    = ((int) (delta / (barLength / timeSig.denominator)) % timeSig.denominator) + 1;
-    out.measure = (int) std::round ((delta / barLength) + 1.0);
-#endif
+    return (double) (measure - 1) * ticksPerBeat * (double) timeSignature.numerator
+         + (double) (beat - 1) * ticksPerBeat
+         + (double) tick;
 }
 
-//==============================================================================
-double MBTTime::toTicks (const Array<TimeSignature>&, int)
+double MBTTime::toTicks (const Array<TimeSignature>& timeSigs, int ppq) const
 {
-    return 0.0;
+    return toTicks (timeSigs.isEmpty() ? TimeSignature() : timeSigs.getFirst(), ppq);
 }
 
 //==============================================================================
@@ -9,7 +9,14 @@ public:
     //==============================================================================
     /** */
     MBTTime (int measure = 0, int beat = 0, int tick = 0);
-    /** */
+    /** Converts some ticks to a 1-based measure and beat, and the remaining ticks,
+        in a constant time signature.
+
+        Use a TempoMap when the time signature changes.
+    */
+    MBTTime (double ticks, int ppq, const TimeSignature& timeSignature);
+    /** @deprecated The song length was never needed, and only the first time signature is used. */
+    [[deprecated ("Please use the constructor taking a single TimeSignature, or a TempoMap, instead.")]]
     MBTTime (double ticks, int ppq, const Array<TimeSignature>& timeSigs, double songLength);
     /** */
     MBTTime (const MBTTime& other);
@@ -17,11 +24,33 @@ public:
     ~MBTTime() override;
 
     //==============================================================================
-    /** */
-    double toTicks (const Array<TimeSignature>& timeSigs, int ppq);
+    /** Converts this to ticks, where the measure and beat are 1-based,
+        in a constant time signature.
+
+        Use a TempoMap when the time signature changes.
+    */
+    [[nodiscard]] double toTicks (const TimeSignature& timeSignature, int ppq) const;
+
+    /** Converts this to ticks, where the measure and beat are 1-based.
+
+        A TimeSignature carries no position, so only the first one is used.
+        Use a TempoMap when the time signature changes.
+    */
+    [[nodiscard]] double toTicks (const Array<TimeSignature>& timeSigs, int ppq) const;
 
     //==============================================================================
-    /** */
+    /** Converts some ticks to a 1-based measure and beat, and the remaining ticks,
+        in a constant time signature.
+
+        Use a TempoMap when the time signature changes.
+    */
+    static void ticksToMBTTime (MBTTime& out,
+                                double ticks,
+                                int ppq,
+                                const TimeSignature& timeSignature);
+
+    /** @deprecated The song length was never needed, and only the first time signature is used. */
+    [[deprecated ("Please use the overload taking a single TimeSignature, or a TempoMap, instead.")]]
     static void ticksToMBTTime (MBTTime& out,
                                 double ticks,
                                 int ppq,
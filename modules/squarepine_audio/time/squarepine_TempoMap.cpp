@@ -0,0 +1,276 @@
+TempoMap::TempoMap (const Tempo& tempo, const TimeSignature& timeSignature, int ppq)
+{
+    build ({ { 0.0, tempo } }, { { 0.0, timeSignature } }, ppq);
+}
+
+TempoMap::TempoMap (const Array<TempoChange>& tempoChanges,
+                    const Array<TimeSignatureChange>& timeSignatureChanges,
+                    int ppq)
+{
+    build (tempoChanges, timeSignatureChanges, ppq);
+}
+
+TempoMap::TempoMap (const MidiMessageSequence& events, int timeFormat)
+{
+    Array<TempoChange> tempoChanges;
+    Array<TimeSignatureChange> timeSignatureChanges;
+
+    for (const auto* meh : events)
+    {
+        const auto& m = meh->message;
+
+        if (m.isTempoMetaEvent() && timeFormat > 0)
+        {
+            tempoChanges.add ({ m.getTimeStamp(), Tempo (determineTempo (m.getTempoSecondsPerQuarterNote())) });
+        }
+        else if (m.isTimeSignatureMetaEvent())
+        {
+            int numerator = 0, denominator = 0;
+            m.getTimeSignatureInfo (numerator, denominator);
+            timeSignatureChanges.add ({ m.getTimeStamp(), { numerator, denominator } });
+        }
+    }
+
+    if (timeFormat > 0)
+    {
+        build (tempoChanges, timeSignatureChanges, timeFormat & 0x7fff);
+        return;
+    }
+
+    // NB: With SMPTE timing, a tick is a fraction of a frame, so the tempo is whatever
+    //     makes a quarter note about half a second long, as it would be at the default tempo.
+    const auto framesPerSecond = (double) -(int8) ((timeFormat >> 8) & 0xff);
+    const auto ticksPerSecond = std::max (1.0, framesPerSecond * (double) (timeFormat & 0xff));
+    const auto ppq = std::max (1, roundToInt (ticksPerSecond * determineSecondsPerQuarterNote (Tempo::defaultTempo)));
+
+    build ({ { 0.0, Tempo (60.0 * ticksPerSecond / (double) ppq) } }, timeSignatureChanges, ppq);
+}
+
+TempoMap TempoMap::fromMidiFile (const MidiFile& midiFile)
+{
+    MidiMessageSequence events;
+    midiFile.findAllTempoEvents (events);
+    midiFile.findAllTimeSigEvents (events);
+    return { events, (int) midiFile.getTimeFormat() };
+}
+
+//==============================================================================
+void TempoMap::build (Array<TempoChange> tempoChanges,
+                      Array<TimeSignatureChange> timeSignatureChanges,
+                      int ppq)
+{
+    jassert (ppq > 0);
+    ticksPerQuarterNote = std::max (1, ppq);
+
+    // NB: Stable sorting, so that of several changes at the same tick, the last one wins.
+    std::stable_sort (tempoChanges.begin(), tempoChanges.end(),
+                      [] (const auto& a, const auto& b) { return a.tick < b.tick; });
+
+    std::stable_sort (timeSignatureChanges.begin(), timeSignatureChanges.end(),
+                      [] (const auto& a, const auto& b) { return a.tick < b.tick; });
+
+    tempoSegments.clear();
+    tempoSegments.reserve ((size_t) tempoChanges.size() + 1);
+    tempoSegments.push_back ({});
+    tempoSegments.front().secondsPerTick = determineSecondsPerQuarterNote (Tempo::defaultTempo) / (double) ticksPerQuarterNote;
+
+    for (const auto& change : tempoChanges)
+    {
+        const auto tick = std::max (0.0, change.tick);
+        auto* last = &tempoSegments.back();
+
+        if (tick > last->startTick)
+        {
+            TempoSegment segment;
+            segment.startTick = tick;
+            segment.startSeconds = toSeconds (*last, tick);
+            tempoSegments.push_back (segment);
+            last = &tempoSegments.back();
+        }
+
+        last->tempo = change.tempo;
+        last->secondsPerTick = determineSecondsPerQuarterNote (change.tempo.get()) / (double) ticksPerQuarterNote;
+    }
+
+    meterSegments.clear();
+    meterSegments.reserve ((size_t) timeSignatureChanges.size() + 1);
+
+    auto setTimeSignature = [ticksPerQuarter = (double) ticksPerQuarterNote] (MeterSegment& segment, const TimeSignature& ts)
+    {
+        segment.timeSignature = ts;
+        segment.ticksPerBeat = ticksPerQuarter * 4.0 / (double) ts.denominator;
+        segment.ticksPerMeasure = segment.ticksPerBeat * (double) ts.numerator;
+    };
+
+    setTimeSignature (meterSegments.emplace_back(), {});
+
+    for (const auto& change : timeSignatureChanges)
+    {
+        const auto tick = std::max (0.0, change.tick);
+        auto* last = &meterSegments.back();
+
+        if (tick > last->startTick)
+        {
+            // A change partway through a measure cuts it short, but it still counts:
+            const auto numMeasures = std::ceil ((tick - last->startTick) / last->ticksPerMeasure - 1.0e-9);
+
+            MeterSegment segment;
+            segment.startTick = tick;
+            segment.startMeasure = last->startMeasure + (int64) numMeasures;
+            meterSegments.push_back (segment);
+            last = &meterSegments.back();
+        }
+
+        setTimeSignature (*last, change.timeSignature);
+    }
+}
+
+//==============================================================================
+size_t TempoMap::findTempoSegmentByTick (double ticks) const noexcept
+{
+    const auto iter = std::upper_bound (tempoSegments.cbegin() + 1, tempoSegments.cend(), ticks,
+                                        [] (double t, const auto& segment) { return t < segment.startTick; });
+
+    return (size_t) std::distance (tempoSegments.cbegin(), iter) - 1;
+}
+
+size_t TempoMap::findTempoSegmentBySeconds (double seconds) const noexcept
+{
+    const auto iter = std::upper_bound (tempoSegments.cbegin() + 1, tempoSegments.cend(), seconds,
+                                        [] (double s, const auto& segment) { return s < segment.startSeconds; });
+
+    return (size_t) std::distance (tempoSegments.cbegin(), iter) - 1;
+}
+
+size_t TempoMap::findMeterSegmentByTick (double ticks) const noexcept
+{
+    const auto iter = std::upper_bound (meterSegments.cbegin() + 1, meterSegments.cend(), ticks,
+                                        [] (double t, const auto& segment) { return t < segment.startTick; });
+
+    return (size_t) std::distance (meterSegments.cbegin(), iter) - 1;
+}
+
+//==============================================================================
+double TempoMap::toSeconds (const TempoSegment& segment, double ticks) noexcept
+{
+    return segment.startSeconds + (ticks - segment.startTick) * segment.secondsPerTick;
+}
+
+double TempoMap::toTicks (const TempoSegment& segment, double seconds) noexcept
+{
+    return segment.startTick + (seconds - segment.startSeconds) / segment.secondsPerTick;
+}
+
+MBTTime TempoMap::toMBT (const MeterSegment& segment, double ticks) noexcept
+{
+    const auto delta = ticks - segment.startTick;
+    const auto measures = std::floor (delta / segment.ticksPerMeasure);
+    const auto remainder = std::max (0.0, delta - measures * segment.ticksPerMeasure);
+    const auto beats = std::min (std::floor (remainder / segment.ticksPerBeat), (double) segment.timeSignature.numerator - 1.0);
+    const auto remainingTicks = std::max (0.0, remainder - beats * segment.ticksPerBeat);
+
+    return { (int) (segment.startMeasure + (int64) measures) + 1,
+             (int) beats + 1,
+             (int) remainingTicks };
+}
+
+//==============================================================================
+Tempo TempoMap::getTempoAt (double ticks) const noexcept
+{
+    return tempoSegments[findTempoSegmentByTick (ticks)].tempo;
+}
+
+TimeSignature TempoMap::getTimeSignatureAt (double ticks) const noexcept
+{
+    return meterSegments[findMeterSegmentByTick (ticks)].timeSignature;
+}
+
+double TempoMap::ticksToSeconds (double ticks) const noexcept
+{
+    return toSeconds (tempoSegments[findTempoSegmentByTick (ticks)], ticks);
+}
+
+double TempoMap::secondsToTicks (double seconds) const noexcept
+{
+    return toTicks (tempoSegments[findTempoSegmentBySeconds (seconds)], seconds);
+}
+
+int64 TempoMap::ticksToSamples (double ticks, double sampleRate) const noexcept
+{
+    return secondsToSamples<int64> (ticksToSeconds (ticks), sampleRate);
+}
+
+double TempoMap::samplesToTicks (int64 samples, double sampleRate) const noexcept
+{
+    return secondsToTicks (samplesToSeconds (samples, sampleRate));
+}
+
+MBTTime TempoMap::ticksToMBT (double ticks) const noexcept
+{
+    return toMBT (meterSegments[findMeterSegmentByTick (ticks)], ticks);
+}
+
+double TempoMap::mbtToTicks (const MBTTime& mbt) const noexcept
+{
+    const auto measure = (int64) mbt.measure - 1;
+
+    const auto iter = std::upper_bound (meterSegments.cbegin() + 1, meterSegments.cend(), measure,
+                                        [] (int64 m, const auto& segment) { return m < segment.startMeasure; });
+
+    const auto& segment = *std::prev (iter);
+
+    return segment.startTick
+         + (double) (measure - segment.startMeasure) * segment.ticksPerMeasure
+         + (double) (mbt.beat - 1) * segment.ticksPerBeat
+         + (double) mbt.tick;
+}
+
+SMPTETime TempoMap::ticksToSMPTE (double ticks, double frameRate) const noexcept
+{
+    return SMPTETime::fromSeconds (ticksToSeconds (ticks), frameRate);
+}
+
+double TempoMap::smpteToTicks (const SMPTETime& smpte) const
+{
+    return secondsToTicks (smpte.toSeconds());
+}
+
+//==============================================================================
+double TempoMap::Cursor::ticksToSeconds (double ticks) noexcept
+{
+    const auto& segments = tempoMap.tempoSegments;
+
+    while (tempoIndex + 1 < segments.size() && segments[tempoIndex + 1].startTick <= ticks)
+        ++tempoIndex;
+
+    while (tempoIndex > 0 && segments[tempoIndex].startTick > ticks)
+        --tempoIndex;
+
+    return toSeconds (segments[tempoIndex], ticks);
+}
+
+double TempoMap::Cursor::secondsToTicks (double seconds) noexcept
+{
+    const auto& segments = tempoMap.tempoSegments;
+
+    while (tempoIndex + 1 < segments.size() && segments[tempoIndex + 1].startSeconds <= seconds)
+        ++tempoIndex;
+
+    while (tempoIndex > 0 && segments[tempoIndex].startSeconds > seconds)
+        --tempoIndex;
+
+    return toTicks (segments[tempoIndex], seconds);
+}
+
+MBTTime TempoMap::Cursor::ticksToMBT (double ticks) noexcept
+{
+    const auto& segments = tempoMap.meterSegments;
+
+    while (meterIndex + 1 < segments.size() && segments[meterIndex + 1].startTick <= ticks)
+        ++meterIndex;
+
+    while (meterIndex > 0 && segments[meterIndex].startTick > ticks)
+        --meterIndex;
+
+    return toMBT (segments[meterIndex], ticks);
+}
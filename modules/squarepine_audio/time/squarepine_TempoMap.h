@@ -0,0 +1,169 @@
+/** An immutable map of the tempo and time-signature changes of a piece of music,
+    for converting between ticks, seconds, samples, measures/beats/ticks and SMPTE.
+
+    The changes are turned into segments with prefix-summed start times when
+    the map is built, so every conversion is a binary search followed by a
+    little arithmetic. For monotonic access (eg: playback, or drawing a ruler),
+    use a Cursor to make the search amortised constant time.
+
+    Measures and beats are 1-based, as they are displayed, whereas ticks,
+    seconds and samples start at 0.
+
+    @see Tempo, TimeSignature, MBTTime, TimeKeeper
+*/
+class TempoMap final
+{
+public:
+    //==============================================================================
+    /** A tempo change, at a position in ticks. */
+    struct TempoChange final
+    {
+        double tick = 0.0;
+        Tempo tempo;
+    };
+
+    /** A time-signature change, at a position in ticks.
+
+        These should fall on measure boundaries. If one doesn't,
+        the measure it interrupts is counted as a complete one.
+    */
+    struct TimeSignatureChange final
+    {
+        double tick = 0.0;
+        TimeSignature timeSignature;
+    };
+
+    //==============================================================================
+    /** Creates a map of a constant tempo and time signature. */
+    TempoMap (const Tempo& tempo = {}, const TimeSignature& timeSignature = {},
+              int ticksPerQuarterNote = (int) MBTTime::defaultTicksResolution);
+
+    /** Creates a map from some tempo and time-signature changes, which needn't be sorted.
+
+        Whatever comes before the first change of either kind
+        uses the default tempo or time-signature.
+    */
+    TempoMap (const Array<TempoChange>& tempoChanges,
+              const Array<TimeSignatureChange>& timeSignatureChanges,
+              int ticksPerQuarterNote = (int) MBTTime::defaultTicksResolution);
+
+    /** Creates a map from the tempo and time-signature meta events of a sequence.
+
+        @param tempoAndTimeSignatureEvents  The events, with their timestamps in ticks.
+                                            Any other kinds of events are ignored.
+        @param timeFormat                   The sequence's time format, as per MidiFile::getTimeFormat().
+                                            If this is an SMPTE format, the tempo events are ignored
+                                            since the ticks are then a fixed length of time.
+    */
+    TempoMap (const MidiMessageSequence& tempoAndTimeSignatureEvents, int timeFormat);
+
+    /** Creates a map from all of the tempo and time-signature events of a MIDI file. */
+    static TempoMap fromMidiFile (const MidiFile&);
+
+    //==============================================================================
+    /** @returns the number of ticks per quarter note. */
+    [[nodiscard]] int getTicksPerQuarterNote() const noexcept { return ticksPerQuarterNote; }
+
+    /** @returns the tempo in effect at a position in ticks. */
+    [[nodiscard]] Tempo getTempoAt (double ticks) const noexcept;
+
+    /** @returns the time signature in effect at a position in ticks. */
+    [[nodiscard]] TimeSignature getTimeSignatureAt (double ticks) const noexcept;
+
+    //==============================================================================
+    /** @returns a position in ticks converted to seconds. */
+    [[nodiscard]] double ticksToSeconds (double ticks) const noexcept;
+
+    /** @returns a position in seconds converted to ticks. */
+    [[nodiscard]] double secondsToTicks (double seconds) const noexcept;
+
+    /** @returns a position in ticks converted to samples. */
+    [[nodiscard]] int64 ticksToSamples (double ticks, double sampleRate) const noexcept;
+
+    /** @returns a position in samples converted to ticks. */
+    [[nodiscard]] double samplesToTicks (int64 samples, double sampleRate) const noexcept;
+
+    /** @returns a position in ticks converted to measures, beats and ticks. */
+    [[nodiscard]] MBTTime ticksToMBT (double ticks) const noexcept;
+
+    /** @returns a position in measures, beats and ticks converted to ticks. */
+    [[nodiscard]] double mbtToTicks (const MBTTime&) const noexcept;
+
+    /** @returns a position in seconds converted to measures, beats and ticks. */
+    [[nodiscard]] MBTTime secondsToMBT (double seconds) const noexcept   { return ticksToMBT (secondsToTicks (seconds)); }
+
+    /** @returns a position in measures, beats and ticks converted to seconds. */
+    [[nodiscard]] double mbtToSeconds (const MBTTime& mbt) const noexcept  { return ticksToSeconds (mbtToTicks (mbt)); }
+
+    /** @returns a position in ticks converted to SMPTE. */
+    [[nodiscard]] SMPTETime ticksToSMPTE (double ticks, double frameRate) const noexcept;
+
+    /** @returns a position in SMPTE converted to ticks. */
+    [[nodiscard]] double smpteToTicks (const SMPTETime&) const;
+
+    //==============================================================================
+    /** Converts positions whilst remembering where the last one was,
+        so that the search is amortised constant time when the positions
+        only move a little each time (eg: during playback).
+
+        Random access still works, it'll just search linearly from the last position.
+        A cursor isn't thread safe, so use one per thread.
+    */
+    class Cursor final
+    {
+    public:
+        /** Creates a cursor for a map, which must outlive it. */
+        explicit Cursor (const TempoMap& map) noexcept : tempoMap (map) {}
+
+        /** @returns a position in ticks converted to seconds. */
+        [[nodiscard]] double ticksToSeconds (double ticks) noexcept;
+
+        /** @returns a position in seconds converted to ticks. */
+        [[nodiscard]] double secondsToTicks (double seconds) noexcept;
+
+        /** @returns a position in ticks converted to measures, beats and ticks. */
+        [[nodiscard]] MBTTime ticksToMBT (double ticks) noexcept;
+
+        /** @returns a position in seconds converted to measures, beats and ticks. */
+        [[nodiscard]] MBTTime secondsToMBT (double seconds) noexcept  { return ticksToMBT (secondsToTicks (seconds)); }
+
+    private:
+        const TempoMap& tempoMap;
+        size_t tempoIndex = 0, meterIndex = 0;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Cursor)
+    };
+
+private:
+    //==============================================================================
+    struct TempoSegment final
+    {
+        double startTick = 0.0, startSeconds = 0.0, secondsPerTick = 0.0;
+        Tempo tempo;
+    };
+
+    struct MeterSegment final
+    {
+        double startTick = 0.0, ticksPerBeat = 0.0, ticksPerMeasure = 0.0;
+        int64 startMeasure = 0; // 0-based
+        TimeSignature timeSignature;
+    };
+
+    int ticksPerQuarterNote = (int) MBTTime::defaultTicksResolution;
+    std::vector<TempoSegment> tempoSegments;    // Never empty, and the first starts at tick 0.
+    std::vector<MeterSegment> meterSegments;    // Never empty, and the first starts at tick 0.
+
+    //==============================================================================
+    void build (Array<TempoChange>, Array<TimeSignatureChange>, int ppq);
+
+    size_t findTempoSegmentByTick (double ticks) const noexcept;
+    size_t findTempoSegmentBySeconds (double seconds) const noexcept;
+    size_t findMeterSegmentByTick (double ticks) const noexcept;
+
+    static double toSeconds (const TempoSegment&, double ticks) noexcept;
+    static double toTicks (const TempoSegment&, double seconds) noexcept;
+    static MBTTime toMBT (const MeterSegment&, double ticks) noexcept;
+
+    //==============================================================================
+    JUCE_LEAK_DETECTOR (TempoMap)
+};
@@ -85,7 +85,9 @@ constexpr double ticksToSeconds (double timeStamp, double tempo, int ppq = 960)
     return (60.0 / (tempo * (double) ppq)) * timeStamp;
 }
 
-/** */
+/** This walks the events from the start on every call,
+    so prefer a TempoMap when converting repeatedly.
+*/
 inline double ticksToSeconds (double time, const MidiMessageSequence& tempoAndTSEvents, int timeFormat)
 {
     if (timeFormat > 0)
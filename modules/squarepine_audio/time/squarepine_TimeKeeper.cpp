@@ -94,6 +94,12 @@ TimeKeeper& TimeKeeper::setTimeSignature (const TimeSignature& ts)
     return *this;
 }
 
+TimeKeeper& TimeKeeper::setTempoMap (std::shared_ptr<const TempoMap> newTempoMap)
+{
+    tempoMap = std::move (newTempoMap);
+    return *this;
+}
+
 //==============================================================================
 TimeKeeper& TimeKeeper::setTimeFormat (TimeFormat format)
 {
@@ -120,6 +126,9 @@ String TimeKeeper::toString() const
 
         case TimeFormat::measuresBeatsTicks:
         {
+            if (tempoMap != nullptr)
+                return tempoMap->secondsToMBT (timeSeconds).toString();
+
             auto whole = timeSeconds / timeSignature.getNumSecondsPerMeasure (tempo);
             auto beats = std::modf (whole, &whole);
             const auto ticks = std::modf (beats * timeSignature.numerator, &beats)
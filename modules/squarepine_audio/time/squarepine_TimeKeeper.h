@@ -41,6 +41,13 @@ public:
     /** @returns */
     TimeKeeper& setTimeSignature (const TimeSignature&);
 
+    /** Sets a map to use for the measures, beats and ticks instead of
+        the constant tempo and time signature. This may be null.
+
+        @returns
+    */
+    TimeKeeper& setTempoMap (std::shared_ptr<const TempoMap>);
+
     //==============================================================================
     /** */
     enum class TimeFormat
@@ -67,6 +74,7 @@ private:
     double frameRate = 60.0, sampleRate = 44100.0, timeSeconds = 0.0;
     Tempo tempo;
     TimeSignature timeSignature;
+    std::shared_ptr<const TempoMap> tempoMap;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimeKeeper)
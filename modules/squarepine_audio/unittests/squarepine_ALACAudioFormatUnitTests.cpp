@@ -0,0 +1,365 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Encodes and decodes ALAC files in memory, checking that every sample comes back
+    exactly and that surround channels are stored in ALAC's order.
+
+    It also logs how long it takes to skim through 10k small files with the stream
+    and mapped file readers. The timings are far too noisy to fail on,
+    so they're only there to be read.
+*/
+class ALACAudioFormatUnitTests final : public UnitTest
+{
+public:
+    ALACAudioFormatUnitTests() :
+        UnitTest ("ALAC Audio Format", UnitTestCategories::audio)
+    {
+    }
+
+    void runTest() override
+    {
+        random = getRandom();
+
+        beginTest ("Round Trip - Default Layouts");
+
+        for (int numChannels = 1; numChannels <= (int) alac::maxChannels; ++numChannels)
+            for (int bitDepth : { 16, 24, 32 })
+                runRoundTrip (alac::getDefaultChannelSet (numChannels), alac::getDefaultChannelSet (numChannels), bitDepth);
+
+        beginTest ("Round Trip - Other Layouts");
+
+        // NB: ALAC has no equivalent for these, so they're stored and read back in order.
+        for (const auto& layout : { AudioChannelSet::discreteChannels (2),
+                                    AudioChannelSet::quadraphonic(),
+                                    AudioChannelSet::create7point1() })
+            runRoundTrip (layout, AudioChannelSet::discreteChannels (layout.size()), 24);
+
+        beginTest ("Channels are stored in ALAC order");
+        runChannelOrderTest();
+
+        beginTest ("Concurrent decoding matches the reader");
+        runConcurrentDecodingTest();
+
+        beginTest ("Benchmark - 10k Files, Cold and Warm");
+        runFileBenchmark();
+    }
+
+private:
+    //==============================================================================
+    Random random;
+    ALACAudioFormat format;
+
+    static constexpr int sampleRate = 44100;
+
+    // NB: Not a whole number of packets, so the short last packet gets covered too.
+    static constexpr int numSamples = alac::defaultFramesPerPacket * 2 + 123;
+
+    //==============================================================================
+    /** @returns left-justified samples at the given bit depth:
+        a sine, which the predictor copes with, and then noise, which it doesn't.
+    */
+    std::vector<std::vector<int>> createSamples (int numChannels, int bitDepth, int numSamplesToCreate = numSamples)
+    {
+        const auto mask = bitDepth < 32 ? ~((1u << (32 - bitDepth)) - 1u) : ~0u;
+        std::vector<std::vector<int>> samples ((size_t) numChannels, std::vector<int> ((size_t) numSamplesToCreate));
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            auto& channel = samples[(size_t) c];
+            const auto increment = MathConstants<double>::twoPi * 110.0 * (double) (c + 1) / (double) sampleRate;
+
+            for (int i = 0; i < numSamplesToCreate; ++i)
+            {
+                const auto value = i < numSamplesToCreate / 2
+                                    ? (uint32) (int) (std::sin (increment * (double) i) * 0.9 * (double) std::numeric_limits<int>::max())
+                                    : (uint32) random.nextInt();
+
+                channel[(size_t) i] = (int) (value & mask);
+            }
+        }
+
+        return samples;
+    }
+
+    MemoryBlock write (const AudioChannelSet& layout, int bitDepth, const std::vector<std::vector<int>>& samples,
+                       int numSamplesToWrite = numSamples)
+    {
+        MemoryBlock block;
+        std::unique_ptr<OutputStream> out = std::make_unique<MemoryOutputStream> (block, false);
+
+        const auto options = AudioFormatWriterOptions{}.withSampleRate (sampleRate)
+                                                       .withChannelLayout (layout)
+                                                       .withBitsPerSample (bitDepth);
+
+        auto writer = format.createWriterFor (out, options);
+
+        if (writer == nullptr)
+        {
+            expect (false, "Couldn't create a writer");
+            return {};
+        }
+
+        std::vector<const int*> pointers;
+        for (const auto& channel : samples)
+            pointers.push_back (channel.data());
+
+        pointers.push_back (nullptr);
+
+        // NB: Uneven blocks, so that they straddle the packets.
+        for (int start = 0; start < numSamplesToWrite;)
+        {
+            const auto numThisTime = jmin (numSamplesToWrite - start, 1000 + random.nextInt (3000));
+
+            std::vector<const int*> offsetPointers;
+            for (auto* p : pointers)
+                offsetPointers.push_back (p != nullptr ? p + start : nullptr);
+
+            expect (writer->write (offsetPointers.data(), numThisTime));
+            start += numThisTime;
+        }
+
+        writer.reset(); // Finishes the file.
+        return block;
+    }
+
+    void runRoundTrip (const AudioChannelSet& layout, const AudioChannelSet& expectedLayout, int bitDepth)
+    {
+        const auto description = layout.getDescription() + ", " + String (bitDepth) + " bits";
+        const auto numChannels = layout.size();
+        const auto samples = createSamples (numChannels, bitDepth);
+        const auto block = write (layout, bitDepth, samples);
+
+        std::unique_ptr<AudioFormatReader> reader (format.createReaderFor (new MemoryInputStream (block, false), true));
+
+        if (reader == nullptr)
+        {
+            expect (false, "Couldn't read " + description);
+            return;
+        }
+
+        expectEquals ((int) reader->numChannels, numChannels);
+        expectEquals ((int) reader->bitsPerSample, bitDepth);
+        expectEquals (reader->lengthInSamples, (int64) numSamples);
+        expect (reader->getChannelLayout() == expectedLayout, "Wrong layout for " + description);
+
+        std::vector<std::vector<int>> result ((size_t) numChannels, std::vector<int> ((size_t) numSamples));
+        std::vector<int*> pointers;
+
+        for (auto& channel : result)
+            pointers.push_back (channel.data());
+
+        expect (reader->read (pointers.data(), numChannels, 0, numSamples, false));
+        expect (result == samples, "Mismatch with " + description);
+    }
+
+    //==============================================================================
+    void runChannelOrderTest()
+    {
+        const auto layout = AudioChannelSet::create5point1();
+        const auto numChannels = layout.size();
+        const auto samples = createSamples (numChannels, 16);
+        const auto block = write (layout, 16, samples);
+
+        MemoryInputStream in (block, false);
+        alac::ALACSpecificConfig config;
+        alac::ALACAudioChannelLayout channelLayout;
+        std::vector<alac::Packet> packets;
+
+        if (! alac::parseContainer (in, config, channelLayout, packets))
+        {
+            expect (false, "Couldn't parse the file");
+            return;
+        }
+
+        expectEquals (channelLayout.channelLayoutTag, (uint32_t) alac::ChannelLayout::MPEG_5_1_D);
+
+        alac::Decoder decoder (config);
+        std::vector<std::vector<int32>> channels ((size_t) numChannels, std::vector<int32> (config.frameLength));
+        std::vector<int32*> pointers;
+
+        for (auto& channel : channels)
+            pointers.push_back (channel.data());
+
+        const auto& packet = packets.front();
+        const auto* data = addBytesToPointer (static_cast<const uint8*> (block.getData()), packet.fileOffset);
+        const auto numFrames = decoder.decode (data, packet.numBytes, pointers.data());
+        expectEquals (numFrames, (int) packet.numFrames);
+
+        // NB: C L R Ls Rs LFE
+        const AudioChannelSet::ChannelType alacOrder[] =
+        {
+            AudioChannelSet::centre, AudioChannelSet::left, AudioChannelSet::right,
+            AudioChannelSet::leftSurround, AudioChannelSet::rightSurround, AudioChannelSet::LFE
+        };
+
+        for (int i = 0; i < numChannels; ++i)
+        {
+            const auto& source = samples[(size_t) layout.getChannelIndexForType (alacOrder[i])];
+            bool matches = true;
+
+            for (int s = 0; s < numFrames; ++s)
+                matches &= channels[(size_t) i][(size_t) s] == (source[(size_t) s] >> 16);
+
+            expect (matches, "ALAC channel " + String (i) + " should be the " + AudioChannelSet::getChannelTypeName (alacOrder[i]));
+        }
+    }
+
+    //==============================================================================
+    void runConcurrentDecodingTest()
+    {
+        ThreadPool pool (4);
+
+        for (int numChannels : { 1, 2, 6, 8 })
+        {
+            const auto layout = alac::getDefaultChannelSet (numChannels);
+            const auto block = write (layout, 24, createSamples (numChannels, 24));
+
+            std::unique_ptr<AudioFormatReader> reader (format.createReaderFor (new MemoryInputStream (block, false), true));
+            expect (reader != nullptr);
+
+            if (reader == nullptr)
+                continue;
+
+            juce::AudioBuffer<float> expected (numChannels, numSamples), result;
+            reader->read (&expected, 0, numSamples, 0, true, true);
+
+            MemoryInputStream in (block, false);
+            double rate = 0.0;
+            expect (ALACAudioFormat::decodeConcurrently (in, result, pool, &rate));
+            expectEquals (rate, (double) sampleRate);
+            expectEquals (result.getNumChannels(), numChannels);
+            expectEquals (result.getNumSamples(), numSamples);
+
+            auto maxError = 0.0f;
+
+            for (int c = 0; c < jmin (numChannels, result.getNumChannels()); ++c)
+                for (int i = 0; i < jmin (numSamples, result.getNumSamples()); ++i)
+                    maxError = jmax (maxError, std::abs (expected.getSample (c, i) - result.getSample (c, i)));
+
+            expectLessOrEqual (maxError, 1.0e-6f, layout.getDescription());
+        }
+    }
+
+    //==============================================================================
+    /** @returns the time it took to open and fully decode every file, in milliseconds. */
+    template<typename CreateReader>
+    double readAll (const Array<File>& files, CreateReader&& createReader)
+    {
+        juce::AudioBuffer<float> buffer;
+        MillisecondStopWatch stopWatch;
+        int numFailures = 0;
+
+        {
+            const ScopedStartStop<MillisecondStopWatch> sss (stopWatch);
+
+            for (const auto& file : files)
+            {
+                if (std::unique_ptr<AudioFormatReader> reader = createReader (file))
+                {
+                    buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples, false, false, true);
+                    reader->read (&buffer, 0, buffer.getNumSamples(), 0, true, true);
+                }
+                else
+                {
+                    ++numFailures;
+                }
+            }
+        }
+
+        expectEquals (numFailures, 0);
+        return stopWatch.getDelta();
+    }
+
+    /** Writes two identical sets of files, so that each reader gets a set to itself
+        that it's the first to read after they've been written.
+
+        NB: "Cold" is only as cold as the OS makes it, as the freshly written files
+        are likely to still be in its cache; clear that before running this
+        to see the effect of the disk.
+    */
+    void runFileBenchmark()
+    {
+        constexpr int numFiles = 10000;
+        constexpr int numFileSamples = 2048;
+
+        const auto root = File::getSpecialLocation (File::tempDirectory).getNonexistentChildFile ("ALACBenchmark", {});
+        const auto streamFolder = root.getChildFile ("Stream");
+        const auto mappedFolder = root.getChildFile ("Mapped");
+
+        if (! streamFolder.createDirectory() || ! mappedFolder.createDirectory())
+        {
+            expect (false, "Couldn't create " + root.getFullPathName());
+            return;
+        }
+
+        const auto layout = AudioChannelSet::stereo();
+        Array<File> streamFiles, mappedFiles;
+
+        for (int i = 0; i < numFiles; ++i)
+        {
+            const auto samples = createSamples (layout.size(), 16, numFileSamples);
+            const auto block = write (layout, 16, samples, numFileSamples);
+            const auto name = String (i) + ".m4a";
+
+            streamFiles.add (streamFolder.getChildFile (name));
+            mappedFiles.add (mappedFolder.getChildFile (name));
+
+            streamFiles.getReference (i).replaceWithData (block.getData(), block.getSize());
+            mappedFiles.getReference (i).replaceWithData (block.getData(), block.getSize());
+        }
+
+        // Both readers must give back the same samples:
+        for (int i = 0; i < 10; ++i)
+        {
+            std::unique_ptr<AudioFormatReader> streamReader (format.createReaderFor (streamFiles[i].createInputStream().release(), true));
+            auto mappedReader = format.createMappedFileReader (mappedFiles[i]);
+
+            if (streamReader == nullptr || mappedReader == nullptr)
+            {
+                expect (false, "Couldn't open " + streamFiles[i].getFileName());
+                continue;
+            }
+
+            expect (mappedReader->getChannelLayout() == streamReader->getChannelLayout());
+            expectEquals (mappedReader->lengthInSamples, streamReader->lengthInSamples);
+
+            juce::AudioBuffer<float> a (2, numFileSamples), b (2, numFileSamples);
+            streamReader->read (&a, 0, numFileSamples, 0, true, true);
+            mappedReader->read (&b, 0, numFileSamples, 0, true, true);
+
+            bool matches = true;
+            for (int c = 0; c < 2; ++c)
+                matches &= std::memcmp (a.getReadPointer (c), b.getReadPointer (c), sizeof (float) * (size_t) numFileSamples) == 0;
+
+            expect (matches, "Mismatch with " + streamFiles[i].getFileName());
+        }
+
+        auto createStreamReader = [this] (const File& file)
+        {
+            return std::unique_ptr<AudioFormatReader> (format.createReaderFor (file.createInputStream().release(), true));
+        };
+
+        auto createMappedReader = [this] (const File& file)
+        {
+            return format.createMappedFileReader (file);
+        };
+
+        // NB: The first ten of each set were read above, which is negligible.
+        const auto streamCold = readAll (streamFiles, createStreamReader);
+        const auto mappedCold = readAll (mappedFiles, createMappedReader);
+        const auto streamWarm = readAll (streamFiles, createStreamReader);
+        const auto mappedWarm = readAll (mappedFiles, createMappedReader);
+
+        auto describe = [&] (double ms)
+        {
+            return String (ms, 1) + " ms (" + String ((double) numFiles / jmax (ms / 1000.0, 1.0e-9), 0) + " files/s)";
+        };
+
+        logMessage ("Stream reader: cold " + describe (streamCold) + ", warm " + describe (streamWarm));
+        logMessage ("Mapped file reader: cold " + describe (mappedCold) + ", warm " + describe (mappedWarm));
+
+        root.deleteRecursively();
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
@@ -0,0 +1,297 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Checks that the EffectProcessorChain's saved states restore the same chain,
+    in the binary format (with and without compression) and in JSON,
+    and logs how long saving and restoring a large session takes in each.
+
+    The effects are SquarePine's own, since those are always available.
+*/
+class EffectProcessorChainUnitTests final : public UnitTest
+{
+public:
+    EffectProcessorChainUnitTests() :
+        UnitTest ("Effect Processor Chain", UnitTestCategories::audio)
+    {
+    }
+
+    void runTest() override
+    {
+        random = getRandom();
+
+        if (factory == nullptr)
+        {
+            auto format = std::make_unique<SquarePineAudioPluginFormat>();
+            format->addEffectPluginDescriptionsTo (knownPluginList);
+            formatManager.addFormat (std::move (format));
+            factory = std::make_shared<EffectProcessorFactory> (formatManager, knownPluginList);
+        }
+
+        beginTest ("Binary State Round Trip");
+        runRoundTripTest (false);
+
+        beginTest ("Compressed Binary State Round Trip");
+        runRoundTripTest (true);
+
+        beginTest ("Changes after Restoring are Saved");
+        runChangeAfterRestoringTest();
+
+        beginTest ("Truncated Binary State");
+        runTruncatedStateTest();
+
+        beginTest ("JSON State Round Trip");
+        runJSONTest();
+
+        beginTest ("Large Session - Save and Restore");
+        runLargeSessionBenchmark();
+    }
+
+private:
+    //==============================================================================
+    Random random;
+    AudioPluginFormatManager formatManager;
+    KnownPluginList knownPluginList;
+    EffectProcessorFactory::Ptr factory;
+
+    static constexpr const char* pluginIdentifiers[] =
+    {
+        "gain", "stereoPanner", "equaliser", "compressor",
+        "simpleReverb", "stereoWidth", "chorus", "phaser"
+    };
+
+    //==============================================================================
+    /** @returns a chain of random effects, with random settings and parameter values. */
+    std::unique_ptr<EffectProcessorChain> createRandomChain (int numEffects)
+    {
+        auto chain = std::make_unique<EffectProcessorChain> (factory);
+        chain->setBypassed (random.nextBool());
+
+        for (int i = 0; i < numEffects; ++i)
+        {
+            const String identifier (pluginIdentifiers[random.nextInt (numElementsInArray (pluginIdentifiers))]);
+
+            if (chain->add (identifier) == nullptr)
+            {
+                expect (false, "Couldn't create " + identifier);
+                continue;
+            }
+
+            const auto index = chain->getNumEffects() - 1;
+            chain->setEffectName (index, identifier + " " + String (index));
+            chain->setBypass (index, random.nextBool());
+            chain->setMixLevel (index, random.nextFloat());
+            chain->setProcessedInParallel (index, index > 0 && random.nextInt (4) == 0);
+            chain->setMeteringMode (index, static_cast<MeteringMode> (random.nextInt (static_cast<int> (MeteringMode::truePeak) + 1)));
+
+            if (auto plugin = chain->getPluginInstance (index).value_or (nullptr))
+                for (auto* parameter : plugin->getParameters())
+                    parameter->setValueNotifyingHost (random.nextFloat());
+        }
+
+        return chain;
+    }
+
+    static MemoryBlock saveState (EffectProcessorChain& chain)
+    {
+        MemoryBlock data;
+        chain.getStateInformation (data);
+        return data;
+    }
+
+    std::unique_ptr<EffectProcessorChain> restoreState (const MemoryBlock& data, bool compress = false)
+    {
+        auto chain = std::make_unique<EffectProcessorChain> (factory);
+        chain->setStateCompressionEnabled (compress);
+        chain->setStateInformation (data.getData(), (int) data.getSize());
+        return chain;
+    }
+
+    void expectSameEffect (const EffectProcessorChain& expected, const EffectProcessorChain& actual, int index)
+    {
+        const auto description = "Effect " + String (index);
+
+        expectEquals (actual.getEffectName (index).value_or (String()), expected.getEffectName (index).value_or (String()), description);
+        expectEquals (actual.getPluginDescription (index).value_or (PluginDescription()).fileOrIdentifier,
+                      expected.getPluginDescription (index).value_or (PluginDescription()).fileOrIdentifier, description);
+        expect (actual.isBypassed (index) == expected.isBypassed (index), description);
+        expect (actual.isProcessedInParallel (index) == expected.isProcessedInParallel (index), description);
+        expect (actual.getMixLevel (index) == expected.getMixLevel (index), description);
+        expect (actual.getMeteringMode (index) == expected.getMeteringMode (index), description);
+
+        const auto expectedPlugin = expected.getPluginInstance (index).value_or (nullptr);
+        const auto actualPlugin = actual.getPluginInstance (index).value_or (nullptr);
+
+        if (expectedPlugin == nullptr || actualPlugin == nullptr)
+        {
+            expect (false, description + " has no plugin");
+            return;
+        }
+
+        const auto& expectedParameters = expectedPlugin->getParameters();
+        const auto& actualParameters = actualPlugin->getParameters();
+        expectEquals (actualParameters.size(), expectedParameters.size(), description);
+
+        for (int i = 0; i < jmin (actualParameters.size(), expectedParameters.size()); ++i)
+            expectWithinAbsoluteError (actualParameters[i]->getValue(), expectedParameters[i]->getValue(), 1.0e-6f,
+                                       description + ", " + expectedParameters[i]->getName (64));
+    }
+
+    void expectSameChains (const EffectProcessorChain& expected, const EffectProcessorChain& actual)
+    {
+        expect (actual.isBypassed() == expected.isBypassed());
+        expectEquals (actual.getNumEffects(), expected.getNumEffects());
+
+        for (int i = 0; i < jmin (actual.getNumEffects(), expected.getNumEffects()); ++i)
+            expectSameEffect (expected, actual, i);
+    }
+
+    //==============================================================================
+    void runRoundTripTest (bool compress)
+    {
+        const auto original = createRandomChain (24);
+        original->setStateCompressionEnabled (compress);
+
+        const auto saved = saveState (*original);
+        const auto restored = restoreState (saved, compress);
+        expectSameChains (*original, *restored);
+
+        // A restored state counts as unchanged, so saving again straight away writes the very same bytes:
+        expect (saveState (*restored) == saved);
+    }
+
+    void runChangeAfterRestoringTest()
+    {
+        const auto original = createRandomChain (8);
+        const auto restored = restoreState (saveState (*original));
+
+        for (int i = 0; i < restored->getNumEffects(); ++i)
+            if (auto plugin = restored->getPluginInstance (i).value_or (nullptr))
+                if (auto* parameter = plugin->getParameters()[0])
+                    parameter->setValueNotifyingHost (1.0f - parameter->getValue());
+
+        // The changes were reported by the plugins, so they mustn't be lost to the cached states:
+        const auto restoredAgain = restoreState (saveState (*restored));
+        expectSameChains (*restored, *restoredAgain);
+    }
+
+    void runTruncatedStateTest()
+    {
+        const auto original = createRandomChain (8);
+        const auto saved = saveState (*original);
+
+        for (int i = 0; i < 20; ++i)
+        {
+            const auto size = (size_t) random.nextInt ((int) saved.getSize());
+            const auto restored = restoreState (MemoryBlock (saved.getData(), size));
+
+            // Whatever was cut off is dropped, but everything before it is intact:
+            expectLessThan (restored->getNumEffects(), original->getNumEffects());
+
+            for (int e = 0; e < restored->getNumEffects(); ++e)
+                expectSameEffect (*original, *restored, e);
+        }
+    }
+
+    void runJSONTest()
+    {
+        const auto original = createRandomChain (12);
+        original->setStateFormat (EffectProcessorChain::StateFormat::json);
+
+        const auto restored = restoreState (saveState (*original));
+        expectSameChains (*original, *restored);
+    }
+
+    //==============================================================================
+    /** @returns the best time of a few runs, in milliseconds, which shakes off most of the noise. */
+    template<typename Function>
+    static double timeBestOf (Function&& function)
+    {
+        constexpr int numRuns = 3;
+        auto best = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < numRuns; ++i)
+        {
+            MillisecondStopWatch stopWatch;
+
+            {
+                const ScopedStartStop<MillisecondStopWatch> sss (stopWatch);
+                function();
+            }
+
+            best = std::min (best, stopWatch.getDelta());
+        }
+
+        return best;
+    }
+
+    /** Saves and restores a session of many chains, as a host would,
+        in each format, and logs the times and sizes.
+    */
+    void runLargeSessionBenchmark()
+    {
+        constexpr int numChains = 32;
+        constexpr int numEffectsPerChain = 16;
+
+        OwnedArray<EffectProcessorChain> chains;
+
+        for (int i = 0; i < numChains; ++i)
+            chains.add (createRandomChain (numEffectsPerChain).release());
+
+        auto saveAll = [&] (bool invalidate)
+        {
+            size_t numBytes = 0;
+
+            for (auto* chain : chains)
+            {
+                if (invalidate)
+                    chain->invalidateCachedStates();
+
+                numBytes += saveState (*chain).getSize();
+            }
+
+            return numBytes;
+        };
+
+        const String sessionName (String (numChains) + " chains of " + String (numEffectsPerChain) + " effects");
+
+        for (auto format : { EffectProcessorChain::StateFormat::binary, EffectProcessorChain::StateFormat::json })
+        {
+            for (bool compress : { false, true })
+            {
+                if (format == EffectProcessorChain::StateFormat::json && compress)
+                    continue;
+
+                const auto name = String (format == EffectProcessorChain::StateFormat::json ? "JSON" : "Binary")
+                                + (compress ? " (compressed)" : "");
+
+                for (auto* chain : chains)
+                {
+                    chain->setStateFormat (format);
+                    chain->setStateCompressionEnabled (compress);
+                }
+
+                size_t numBytes = 0;
+                const auto coldMs = timeBestOf ([&] { numBytes = saveAll (true); });
+                const auto warmMs = timeBestOf ([&] { saveAll (false); });
+
+                Array<MemoryBlock> states;
+
+                for (auto* chain : chains)
+                    states.add (saveState (*chain));
+
+                const auto restoreMs = timeBestOf ([&]
+                {
+                    for (const auto& state : states)
+                        restoreState (state, compress);
+                });
+
+                logMessage (sessionName + ", " + name + ": saving " + String (coldMs, 2) + " ms ("
+                            + File::descriptionOfSizeInBytes ((int64) numBytes) + ")"
+                            + ", saving unchanged " + String (warmMs, 2) + " ms"
+                            + ", restoring " + String (restoreMs, 2) + " ms");
+            }
+        }
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
@@ -0,0 +1,292 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Checks the SIMD MultichannelResampler against a plain scalar version of itself,
+    and logs how its cost scales with the channel count next to the TemplatedResampler.
+    The timings are far too noisy to fail on, so they're only there to be read.
+*/
+class MultichannelResamplerUnitTests final : public UnitTest
+{
+public:
+    MultichannelResamplerUnitTests() :
+        UnitTest ("Multichannel Resampler", UnitTestCategories::audio)
+    {
+    }
+
+    void runTest() override
+    {
+        random = getRandom();
+
+        beginTest ("Matches Scalar");
+        runAllKernels ([this] (auto kernel) { runScalarTest (kernel); });
+
+        beginTest ("Planar matches Interleaved");
+        runAllKernels ([this] (auto kernel) { runInterleavedTest (kernel); });
+
+        beginTest ("Linear - Ramps");
+        runRampTest();
+
+        beginTest ("Throughput");
+        runThroughputTest();
+    }
+
+private:
+    //==============================================================================
+    Random random;
+
+    static constexpr int channelCounts[] = { 1, 2, 3, 5, 8, 13, 32 };
+
+    //==============================================================================
+    template<typename Function>
+    static void runAllKernels (Function&& function)
+    {
+        function (ResamplerKernels::ZeroOrderHold());
+        function (ResamplerKernels::Linear());
+        function (ResamplerKernels::Lagrange());
+        function (ResamplerKernels::CatmullRom());
+        function (ResamplerKernels::WindowedSinc());
+    }
+
+    juce::AudioBuffer<float> createNoise (int numChannels, int numSamples)
+    {
+        juce::AudioBuffer<float> buffer (numChannels, numSamples);
+
+        for (int c = 0; c < numChannels; ++c)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample (c, i, random.nextFloat() * 2.0f - 1.0f);
+
+        return buffer;
+    }
+
+    double createRatio()
+    {
+        // Both up and down, and never a neat fraction:
+        return random.nextBool() ? 0.3 + random.nextDouble() * 0.69
+                                 : 1.01 + random.nextDouble() * 2.5;
+    }
+
+    //==============================================================================
+    /** Resamples one channel the slow way, one tap at a time, for comparison. */
+    template<typename KernelType>
+    static std::vector<float> resampleScalar (KernelType kernel, const float* source, int numSourceSamples,
+                                              int numDestinationSamples, double ratio)
+    {
+        constexpr auto numTaps = KernelType::numTaps;
+
+        kernel.prepare();
+
+        std::vector<float> history ((size_t) numTaps, 0.0f), result;
+        float weights[(size_t) numTaps];
+        auto position = 1.0;
+        int numUsed = 0;
+
+        for (int i = 0; i < numDestinationSamples; ++i)
+        {
+            for (; position >= 1.0; position -= 1.0)
+            {
+                history.erase (history.begin());
+                history.push_back (numUsed < numSourceSamples ? source[numUsed++] : 0.0f);
+            }
+
+            kernel.computeWeights ((float) position, weights);
+
+            float sum = 0.0f;
+
+            for (int k = 0; k < numTaps; ++k)
+                sum += history[(size_t) k] * weights[k];
+
+            result.push_back (sum);
+            position += ratio;
+        }
+
+        return result;
+    }
+
+    template<typename KernelType>
+    void runScalarTest (KernelType kernel)
+    {
+        for (int numChannels : channelCounts)
+        {
+            const auto ratio = createRatio();
+            const auto numDestinationSamples = 1000;
+            const auto source = createNoise (numChannels, (int) std::ceil (ratio * numDestinationSamples) + 4);
+            juce::AudioBuffer<float> destination (numChannels, numDestinationSamples);
+
+            MultichannelResampler<KernelType> resampler;
+            resampler.setRatio (ratio);
+            resampler.prepare (numChannels, 44100.0, source.getNumSamples());
+
+            // NB: Split in two, to check that the history carries over.
+            auto sourceCopy = source;
+            juce::AudioBuffer<float> firstHalf (destination.getArrayOfWritePointers(), numChannels, 0, numDestinationSamples / 2);
+            juce::AudioBuffer<float> secondHalf (destination.getArrayOfWritePointers(), numChannels, numDestinationSamples / 2, numDestinationSamples / 2);
+
+            const auto numUsed = resampler.process (sourceCopy, firstHalf);
+            juce::AudioBuffer<float> remainder (sourceCopy.getArrayOfWritePointers(), numChannels, numUsed, sourceCopy.getNumSamples() - numUsed);
+            resampler.process (remainder, secondHalf);
+
+            auto maxError = 0.0f;
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                const auto expected = resampleScalar (kernel, source.getReadPointer (c), source.getNumSamples(),
+                                                      numDestinationSamples, ratio);
+
+                for (int i = 0; i < numDestinationSamples; ++i)
+                    maxError = jmax (maxError, std::abs (destination.getSample (c, i) - expected[(size_t) i]));
+            }
+
+            // NB: Only the order of operations can differ, depending on what the compiler fuses.
+            expectLessOrEqual (maxError, 1.0e-5f, String (numChannels) + " channels at a ratio of " + String (ratio));
+        }
+    }
+
+    template<typename KernelType>
+    void runInterleavedTest (KernelType)
+    {
+        for (int numChannels : channelCounts)
+        {
+            const auto ratio = createRatio();
+            const auto numDestinationSamples = 777;
+            auto source = createNoise (numChannels, (int) std::ceil (ratio * numDestinationSamples) + 4);
+            juce::AudioBuffer<float> planar (numChannels, numDestinationSamples);
+
+            std::vector<float> interleavedSource ((size_t) (numChannels * source.getNumSamples()));
+            std::vector<float> interleaved ((size_t) (numChannels * numDestinationSamples));
+
+            for (int c = 0; c < numChannels; ++c)
+                for (int i = 0; i < source.getNumSamples(); ++i)
+                    interleavedSource[(size_t) (i * numChannels + c)] = source.getSample (c, i);
+
+            MultichannelResampler<KernelType> planarResampler, interleavedResampler;
+
+            for (auto* r : { &planarResampler, &interleavedResampler })
+            {
+                r->setRatio (ratio);
+                r->prepare (numChannels, 44100.0, source.getNumSamples());
+            }
+
+            const auto numUsedPlanar = planarResampler.process (source, planar);
+            const auto numUsedInterleaved = interleavedResampler.processInterleaved (interleavedSource.data(), source.getNumSamples(),
+                                                                                     interleaved.data(), numDestinationSamples);
+
+            const auto description = String (numChannels) + " channels";
+            expectEquals (numUsedInterleaved, numUsedPlanar, description);
+
+            auto isIdentical = true;
+
+            for (int c = 0; c < numChannels; ++c)
+                for (int i = 0; i < numDestinationSamples; ++i)
+                    isIdentical &= planar.getSample (c, i) == interleaved[(size_t) (i * numChannels + c)];
+
+            expect (isIdentical, description);
+        }
+    }
+
+    //==============================================================================
+    void runRampTest()
+    {
+        for (double ratio : { 0.25, 0.5, 0.9, 1.0, 1.5, 3.0 })
+        {
+            constexpr int numDestinationSamples = 256;
+            juce::AudioBuffer<float> source (2, (int) std::ceil (ratio * numDestinationSamples) + 4);
+            juce::AudioBuffer<float> destination (2, numDestinationSamples);
+
+            for (int i = 0; i < source.getNumSamples(); ++i)
+            {
+                source.setSample (0, i, (float) i);
+                source.setSample (1, i, (float) -i);
+            }
+
+            LinearResampler resampler;
+            resampler.setRatio (ratio);
+            resampler.prepare (2, 44100.0, source.getNumSamples());
+            resampler.process (source, destination);
+
+            // Anything sampled along a straight line comes out exactly, once the history is full:
+            auto maxError = 0.0f;
+            const auto latency = (double) LinearResampler::getLatencyInInputSamples();
+
+            for (int i = (int) std::ceil (latency / ratio); i < numDestinationSamples; ++i)
+            {
+                const auto expected = (float) ((double) i * ratio - latency);
+
+                maxError = jmax (maxError, std::abs (destination.getSample (0, i) - expected));
+                maxError = jmax (maxError, std::abs (destination.getSample (1, i) + expected));
+            }
+
+            expectLessOrEqual (maxError, 1.0e-3f, "At a ratio of " + String (ratio));
+        }
+    }
+
+    //==============================================================================
+    /** @returns the best time of a few runs, in milliseconds, which shakes off most of the noise. */
+    template<typename Function>
+    static double timeBestOf (Function&& function)
+    {
+        constexpr int numRuns = 5;
+        auto best = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < numRuns; ++i)
+        {
+            MillisecondStopWatch stopWatch;
+
+            {
+                const ScopedStartStop<MillisecondStopWatch> sss (stopWatch);
+                function();
+            }
+
+            best = std::min (best, stopWatch.getDelta());
+        }
+
+        return best;
+    }
+
+    /** Converts a second of audio from 44.1 kHz to 48 kHz at each channel count,
+        with both the SIMD resamplers and the per-channel JUCE interpolators.
+    */
+    void runThroughputTest()
+    {
+        constexpr auto ratio = 44100.0 / 48000.0;
+        constexpr int numDestinationSamples = 48000;
+
+        auto time = [&] (Resampler& resampler, juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& destination)
+        {
+            resampler.setRatio (ratio);
+            resampler.prepare (source.getNumChannels(), 44100.0, source.getNumSamples());
+            return timeBestOf ([&] { resampler.process (source, destination); });
+        };
+
+        for (int numChannels : { 1, 2, 8, 32 })
+        {
+            auto source = createNoise (numChannels, (int) std::ceil (ratio * numDestinationSamples) + 4);
+            juce::AudioBuffer<float> destination (numChannels, numDestinationSamples);
+
+            LagrangeResampler lagrange;
+            TemplatedResampler<LagrangeInterpolator> lagrangeInterpolators;
+            CatmullRomResampler catmullRom;
+            TemplatedResampler<CatmullRomInterpolator> catmullRomInterpolators;
+            WindowedSincResampler windowedSinc;
+
+            const auto lagrangeMs = time (lagrange, source, destination);
+            const auto lagrangeInterpolatorsMs = time (lagrangeInterpolators, source, destination);
+            const auto catmullRomMs = time (catmullRom, source, destination);
+            const auto catmullRomInterpolatorsMs = time (catmullRomInterpolators, source, destination);
+            const auto windowedSincMs = time (windowedSinc, source, destination);
+
+            auto describe = [numChannels] (double ms)
+            {
+                return String (ms, 2) + " ms (" + String (ms / (double) numChannels, 3) + " ms per channel)";
+            };
+
+            logMessage (String (numChannels) + " channels:"
+                        + " Lagrange " + describe (lagrangeMs)
+                        + " vs. interpolators " + describe (lagrangeInterpolatorsMs)
+                        + ", Catmull-Rom " + describe (catmullRomMs)
+                        + " vs. interpolators " + describe (catmullRomInterpolatorsMs)
+                        + ", windowed sinc " + describe (windowedSincMs));
+        }
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
@@ -0,0 +1,156 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Measures how much a hard-driven NonlinearStage aliases at each oversampling factor,
+    with and without ADAA, and logs how much processing time each one costs.
+
+    Only the aliasing going down as the factor goes up is checked;
+    the levels and timings are there to be read.
+*/
+class NonlinearStageUnitTests final : public UnitTest
+{
+public:
+    NonlinearStageUnitTests() :
+        UnitTest ("Nonlinear Stage", UnitTestCategories::audio)
+    {
+    }
+
+    void runTest() override
+    {
+        beginTest ("Aliasing");
+        runAliasingTest();
+
+        beginTest ("Throughput");
+        runThroughputTest();
+    }
+
+private:
+    //==============================================================================
+    using Stage = NonlinearStage<float>;
+
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+
+    /** The sine's frequency, in FFT bins. Being odd, and the FFT size a power of 2,
+        none of the aliases can land on a harmonic.
+    */
+    static constexpr int fundamentalBin = 441; // ~5.2 kHz
+
+    static void fillSine (juce::AudioBuffer<float>& buffer)
+    {
+        for (int c = 0; c < buffer.getNumChannels(); ++c)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample (c, i, 0.9f * (float) std::sin (MathConstants<double>::twoPi * fundamentalBin * (double) i / (double) fftSize));
+    }
+
+    static void prepareStage (Stage& stage, int factor, bool useADAA, int numChannels, int blockSize)
+    {
+        stage.setOversamplingFactor (factor);
+        stage.setAntiderivativeAntialiasing (useADAA);
+        stage.setShape (Stage::Shape::hardClip);
+        stage.setDrive (8.0f);
+        stage.prepare (numChannels, blockSize);
+    }
+
+    /** @returns the level of everything that isn't a harmonic of the sine, relative to everything that is, in decibels. */
+    static float measureAliasing (int factor, bool useADAA)
+    {
+        Stage stage;
+        prepareStage (stage, factor, useADAA, 1, fftSize);
+
+        // NB: The sine is periodic in the block, so once the filters settle, so is the output,
+        //     and every harmonic and alias falls exactly on a bin without any windowing.
+        juce::AudioBuffer<float> buffer (1, fftSize);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            fillSine (buffer);
+            stage.process (buffer);
+        }
+
+        std::vector<float> fftData ((size_t) fftSize * 2, 0.0f);
+        FloatVectorOperations::copy (fftData.data(), buffer.getReadPointer (0), fftSize);
+
+        dsp::FFT fft (fftOrder);
+        fft.performFrequencyOnlyForwardTransform (fftData.data());
+
+        auto harmonicPower = 0.0, aliasPower = 0.0;
+
+        for (int bin = 1; bin < fftSize / 2; ++bin)
+        {
+            const auto power = square ((double) fftData[(size_t) bin]);
+
+            if (bin % fundamentalBin == 0)
+                harmonicPower += power;
+            else
+                aliasPower += power;
+        }
+
+        return (float) (10.0 * std::log10 (jmax (aliasPower, 1.0e-30) / jmax (harmonicPower, 1.0e-30)));
+    }
+
+    void runAliasingTest()
+    {
+        for (bool useADAA : { false, true })
+        {
+            auto previousLevel = std::numeric_limits<float>::max();
+
+            for (int factor : { 1, 2, 4, 8 })
+            {
+                const auto level = measureAliasing (factor, useADAA);
+                const auto description = String (factor) + "x" + (useADAA ? " with ADAA" : "");
+
+                logMessage ("Aliasing at " + description + ": " + String (level, 1) + " dB");
+                expectLessThan (level, previousLevel, description);
+                previousLevel = level;
+            }
+        }
+    }
+
+    //==============================================================================
+    /** Processes 10 seconds of stereo at each factor, and logs the best of a few runs. */
+    void runThroughputTest()
+    {
+        constexpr int blockSize = 512;
+        constexpr double seconds = 10.0;
+        constexpr int numBlocks = (int) (seconds * sampleRate) / blockSize;
+
+        juce::AudioBuffer<float> source (2, blockSize), buffer (2, blockSize);
+        fillSine (source);
+
+        for (bool useADAA : { false, true })
+        {
+            for (int factor : { 1, 2, 4, 8 })
+            {
+                Stage stage;
+                prepareStage (stage, factor, useADAA, 2, blockSize);
+
+                auto best = std::numeric_limits<double>::max();
+
+                for (int run = 0; run < 3; ++run)
+                {
+                    MillisecondStopWatch stopWatch;
+
+                    {
+                        const ScopedStartStop<MillisecondStopWatch> sss (stopWatch);
+
+                        for (int i = 0; i < numBlocks; ++i)
+                        {
+                            buffer.makeCopyOf (source, true);
+                            stage.process (buffer);
+                        }
+                    }
+
+                    best = std::min (best, stopWatch.getDelta());
+                }
+
+                logMessage (String (factor) + "x" + (useADAA ? " with ADAA" : "") + ": "
+                            + String (best, 2) + " ms ("
+                            + String (seconds * 1000.0 / jmax (best, 1.0e-6), 0) + "x realtime)");
+            }
+        }
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
@@ -0,0 +1,222 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Checks the PartitionedConvolver against plain, direct convolution,
+    for responses short enough to fit in the head and long enough to need a tail,
+    fed with blocks of all sorts of sizes.
+*/
+class PartitionedConvolverUnitTests final : public UnitTest
+{
+public:
+    PartitionedConvolverUnitTests() :
+        UnitTest ("Partitioned Convolver", UnitTestCategories::audio)
+    {
+    }
+
+    void runTest() override
+    {
+        random = getRandom();
+
+        beginTest ("Layout");
+        runLayoutTest();
+
+        beginTest ("No Impulse Responses");
+        runEmptyTest();
+
+        beginTest ("Matches Direct Convolution");
+        runDirectConvolutionTest();
+
+        beginTest ("Weighted Mix matches Direct Convolution");
+        runWeightedMixTest();
+    }
+
+private:
+    //==============================================================================
+    Random random;
+    static constexpr int numChannels = 2;
+
+    /** @returns a decaying noise burst, like a reverb's response, so the output stays in a sensible range. */
+    juce::AudioBuffer<float> createImpulseResponse (int numIRChannels, int length)
+    {
+        juce::AudioBuffer<float> ir (numIRChannels, length);
+        const auto gain = 1.0f / std::sqrt ((float) length);
+
+        for (int c = 0; c < numIRChannels; ++c)
+            for (int i = 0; i < length; ++i)
+                ir.setSample (c, i, gain * (random.nextFloat() * 2.0f - 1.0f) * std::exp (-4.0f * (float) i / (float) length));
+
+        return ir;
+    }
+
+    juce::AudioBuffer<float> createNoise (int numSamples)
+    {
+        juce::AudioBuffer<float> buffer (numChannels, numSamples);
+
+        for (int c = 0; c < numChannels; ++c)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample (c, i, random.nextFloat() * 2.0f - 1.0f);
+
+        return buffer;
+    }
+
+    /** Runs the input through the convolver in randomly sized blocks. */
+    void processInRandomBlocks (PartitionedConvolver& convolver, juce::AudioBuffer<float>& buffer)
+    {
+        for (int start = 0; start < buffer.getNumSamples();)
+        {
+            const auto numThisTime = jmin (1 + random.nextInt (700), buffer.getNumSamples() - start);
+            float* channels[] = { buffer.getWritePointer (0) + start, buffer.getWritePointer (1) + start };
+
+            convolver.process (channels, numChannels, numThisTime);
+            start += numThisTime;
+        }
+    }
+
+    /** Compares the output against the direct convolution of the input, delayed by the latency.
+
+        To keep the direct convolution from taking forever with the long responses,
+        only evenly spread positions are checked, which still covers every partition.
+    */
+    void expectMatchesDirectConvolution (const juce::AudioBuffer<float>& input,
+                                         const juce::AudioBuffer<float>& output,
+                                         const juce::AudioBuffer<float>& ir,
+                                         int latency, const String& description)
+    {
+        const auto numSamples = input.getNumSamples();
+        const auto step = jmax (1, (int) ((int64) ir.getNumSamples() * numSamples / 20000000));
+        auto maxError = 0.0, peak = 0.0;
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            const auto* x = input.getReadPointer (c);
+            const auto* h = ir.getReadPointer (c % ir.getNumChannels());
+
+            for (int n = 0; n < numSamples; n += step)
+            {
+                auto expected = 0.0;
+                const auto end = n - latency;
+
+                for (int k = 0; k < ir.getNumSamples() && end - k >= 0; ++k)
+                    expected += (double) h[k] * (double) x[end - k];
+
+                maxError = jmax (maxError, std::abs (expected - (double) output.getSample (c, n)));
+                peak = jmax (peak, std::abs (expected));
+            }
+        }
+
+        // NB: The FFTs are in single precision, so the error grows a little with the level.
+        expectLessOrEqual (maxError, 1.0e-4 * jmax (1.0, peak), description);
+    }
+
+    //==============================================================================
+    void runLayoutTest()
+    {
+        for (int headSize : { 32, 64, 256, 1024 })
+        {
+            for (int length : { 1, 100, 7000, 50000, 480000 })
+            {
+                const auto layout = PartitionedImpulseResponse::createLayout (length, headSize);
+                const auto description = String (length) + " samples with " + String (headSize) + " sample partitions";
+
+                expect (! layout.empty(), description);
+                expectEquals (layout.front().partitionSize, headSize, description);
+                expectEquals (layout.front().offset, 0, description);
+
+                // The stages cover the whole response, without gaps or overlaps:
+                auto end = 0;
+
+                for (const auto& stage : layout)
+                {
+                    expectEquals (stage.offset, end, description);
+                    expect (isPowerOfTwo (stage.partitionSize), description);
+                    end = stage.offset + stage.partitionSize * stage.numPartitions;
+                }
+
+                expectGreaterOrEqual (end, length, description);
+                expectLessThan (end - layout.back().partitionSize, length, description);
+            }
+        }
+    }
+
+    void runEmptyTest()
+    {
+        PartitionedConvolver convolver;
+        convolver.prepare (numChannels, {});
+
+        expectEquals (convolver.getLatencyInSamples(), 0);
+
+        auto buffer = createNoise (1000);
+        processInRandomBlocks (convolver, buffer);
+
+        expectEquals (buffer.getMagnitude (0, buffer.getNumSamples()), 0.0f);
+    }
+
+    void runDirectConvolutionTest()
+    {
+        for (int headSize : { 64, 256 })
+        {
+            // From a single tap, up to several partitions of the tail:
+            for (int length : { 1, 63, headSize, headSize * 5 + 17, 5000, 12000 })
+            {
+                for (int numIRChannels : { 1, 2 })
+                {
+                    const auto ir = createImpulseResponse (numIRChannels, length);
+
+                    PartitionedConvolver convolver;
+                    convolver.prepare (numChannels, { PartitionedImpulseResponse::create (ir, headSize) });
+
+                    PartitionedConvolver::Weights weights;
+                    weights.add (0, 1.0f);
+                    convolver.setWeights (weights);
+                    convolver.reset(); // NB: So that there's no crossfade in from the previous (empty) weights.
+
+                    expectEquals (convolver.getLatencyInSamples(), headSize);
+
+                    const auto input = createNoise (length + 4 * PartitionedImpulseResponse::maxTailPartitionSize);
+                    auto output = input;
+                    processInRandomBlocks (convolver, output);
+
+                    expectMatchesDirectConvolution (input, output, ir, convolver.getLatencyInSamples(),
+                                                    String (length) + " samples, " + String (numIRChannels)
+                                                    + " channel(s), with " + String (headSize) + " sample partitions");
+                }
+            }
+        }
+    }
+
+    void runWeightedMixTest()
+    {
+        constexpr int headSize = 128;
+
+        const auto first = createImpulseResponse (2, 9000);
+        const auto second = createImpulseResponse (1, 3000);
+
+        PartitionedConvolver convolver;
+        convolver.prepare (numChannels, { PartitionedImpulseResponse::create (first, headSize),
+                                          PartitionedImpulseResponse::create (second, headSize) });
+
+        PartitionedConvolver::Weights weights;
+        weights.add (0, 0.25f);
+        weights.add (1, 0.75f);
+        convolver.setWeights (weights);
+        convolver.reset();
+
+        // Convolution is linear, so the mix of the outputs is the output of the mixed responses:
+        juce::AudioBuffer<float> mixed (2, first.getNumSamples());
+        mixed.clear();
+
+        for (int c = 0; c < 2; ++c)
+        {
+            mixed.addFrom (c, 0, first, c, 0, first.getNumSamples(), 0.25f);
+            mixed.addFrom (c, 0, second, 0, 0, second.getNumSamples(), 0.75f);
+        }
+
+        const auto input = createNoise (first.getNumSamples() + 4 * PartitionedImpulseResponse::maxTailPartitionSize);
+        auto output = input;
+        processInRandomBlocks (convolver, output);
+
+        expectMatchesDirectConvolution (input, output, mixed, convolver.getLatencyInSamples(), "Mixed");
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
@@ -0,0 +1,370 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Checks the PolyphaseResampler and the ResamplingProcessor built on it,
+    and logs how fast the resamplers run. The timings are far too noisy to fail on,
+    so they're only there to be read.
+*/
+class ResamplerUnitTests final : public UnitTest
+{
+public:
+    ResamplerUnitTests() :
+        UnitTest ("Resamplers", UnitTestCategories::audio)
+    {
+    }
+
+    void runTest() override
+    {
+        random = getRandom();
+
+        beginTest ("Windowed Sinc Table");
+        runTableTest();
+
+        beginTest ("Polyphase Resampler - Sines");
+        runSineTest();
+
+        beginTest ("Polyphase Resampler - Anti-aliasing");
+        runAntiAliasingTest();
+
+        beginTest ("Resampling Processor - No Dropouts Whilst Varying Speed");
+        runVarispeedTest();
+
+        beginTest ("Resampling Processor - MIDI");
+        runMidiTest();
+
+        beginTest ("Throughput");
+        runThroughputTest();
+    }
+
+private:
+    //==============================================================================
+    Random random;
+
+    //==============================================================================
+    void runTableTest()
+    {
+        const auto& table = WindowedSincTable::get();
+        constexpr auto numPhases = WindowedSincTable::numPhasesPerZeroCrossing;
+
+        expectEquals ((int) table.size(), WindowedSincTable::numZeroCrossings * numPhases + 2);
+        expectWithinAbsoluteError (table.front(), 1.0f, 1.0e-6f);
+        expectEquals (table.back(), 0.0f);
+
+        auto maxAtZeroCrossings = 0.0f;
+
+        for (int i = 1; i <= WindowedSincTable::numZeroCrossings; ++i)
+            maxAtZeroCrossings = jmax (maxAtZeroCrossings, std::abs (table[(size_t) (i * numPhases)]));
+
+        expectLessOrEqual (maxAtZeroCrossings, 1.0e-6f, "The kernel should be zero at every zero crossing");
+        expectEquals (WindowedSincTable::lookUp (table, (float) table.size()), 0.0f);
+    }
+
+    //==============================================================================
+    /** Streams a sine through a resampler in uneven blocks.
+
+        @returns the largest error against the ideal resampled sine,
+                 ignoring the start while the kernel fills up.
+    */
+    float resampleSine (double sourceRate, double destinationRate, double frequency, int& numProduced, int& numConsumed)
+    {
+        const auto ratio = sourceRate / destinationRate;
+
+        PolyphaseResampler resampler;
+        resampler.setRatio (ratio);
+        resampler.setMaximumRatio (jmax (1.0, ratio));
+
+        constexpr int maxBlockSize = 512;
+        resampler.prepare (1, sourceRate, maxBlockSize);
+
+        std::vector<float> input ((size_t) maxBlockSize), output ((size_t) std::ceil (maxBlockSize * 4 / ratio) + 16);
+        auto* in = input.data();
+        auto* out = output.data();
+
+        numProduced = numConsumed = 0;
+        auto maxError = 0.0f;
+
+        while (numConsumed < (int) sourceRate)
+        {
+            const auto numThisTime = 1 + random.nextInt (maxBlockSize);
+
+            for (int i = 0; i < numThisTime; ++i)
+                input[(size_t) i] = (float) std::sin (MathConstants<double>::twoPi * frequency * (double) (numConsumed + i) / sourceRate);
+
+            resampler.push (&in, 1, numThisTime);
+            numConsumed += numThisTime;
+
+            const auto numOut = resampler.pull (&out, 1, (int) output.size());
+
+            for (int i = 0; i < numOut; ++i)
+            {
+                const auto index = numProduced + i;
+                const auto time = (double) index * ratio / sourceRate;
+                const auto expected = frequency * 2.0 < destinationRate ? std::sin (MathConstants<double>::twoPi * frequency * time) : 0.0;
+
+                if (index > resampler.getLatencyInInputSamples() * 2)
+                    maxError = jmax (maxError, (float) std::abs (output[(size_t) i] - expected));
+            }
+
+            numProduced += numOut;
+        }
+
+        return maxError;
+    }
+
+    void runSineTest()
+    {
+        for (double sourceRate : { 44100.0, 48000.0, 96000.0 })
+        {
+            for (double destinationRate : { 44100.0, 48000.0, 96000.0 })
+            {
+                for (double frequency : { 100.0, 1000.0, 10000.0 })
+                {
+                    int numProduced = 0, numConsumed = 0;
+                    const auto maxError = resampleSine (sourceRate, destinationRate, frequency, numProduced, numConsumed);
+                    const auto description = String (sourceRate) + " Hz to " + String (destinationRate) + " Hz, at " + String (frequency) + " Hz";
+
+                    expectLessOrEqual (maxError, 1.0e-3f, description);
+
+                    // Everything but what's held back for the kernel comes out:
+                    const auto expectedNumProduced = (double) numConsumed * destinationRate / sourceRate;
+                    expectWithinAbsoluteError ((double) numProduced, expectedNumProduced, 64.0, description);
+                }
+            }
+        }
+    }
+
+    void runAntiAliasingTest()
+    {
+        // Well above the destination's Nyquist frequency, so nothing of it should remain:
+        for (double destinationRate : { 44100.0, 48000.0 })
+        {
+            int numProduced = 0, numConsumed = 0;
+            const auto maxLevel = resampleSine (96000.0, destinationRate, 30000.0, numProduced, numConsumed);
+            expectLessOrEqual (maxLevel, 1.0e-3f, "At " + String (destinationRate) + " Hz");
+        }
+    }
+
+    //==============================================================================
+    void runVarispeedTest()
+    {
+        for (auto range : { Range<double> (1.0, 1.0), Range<double> (0.8, 1.25), Range<double> (0.25, 4.0) })
+        {
+            ResamplingProcessor processor;
+            processor.setInternalSampleRate (48000.0);
+            processor.setVarispeedRange (range);
+
+            constexpr int maxBlockSize = 1024;
+            processor.prepareToPlay (44100.0, maxBlockSize);
+
+            const auto latency = processor.getLatencySamples();
+            juce::AudioBuffer<float> buffer (2, maxBlockSize);
+            MidiBuffer midi;
+
+            int64 numProcessed = 0;
+            auto minLevel = 1.0f, maxLevel = 1.0f;
+
+            // NB: DC comes through the resamplers untouched, whatever the speed, so any dip is a dropout.
+            //     The start is skipped, as that's where the kernels ring from the step up from silence.
+            for (int block = 0; block < 2000; ++block)
+            {
+                if (random.nextInt (20) == 0)
+                    processor.setVarispeed (range.getStart() + random.nextDouble() * range.getLength());
+
+                const auto numSamples = 1 + random.nextInt (maxBlockSize);
+                juce::AudioBuffer<float> view (buffer.getArrayOfWritePointers(), 2, numSamples);
+
+                for (int c = 0; c < 2; ++c)
+                    FloatVectorOperations::fill (view.getWritePointer (c), 1.0f, numSamples);
+
+                processor.processBlock (view, midi);
+
+                for (int c = 0; c < 2; ++c)
+                {
+                    for (int i = 0; i < numSamples; ++i)
+                    {
+                        if (numProcessed + i > (int64) (latency * 2 + 256))
+                        {
+                            minLevel = jmin (minLevel, view.getSample (c, i));
+                            maxLevel = jmax (maxLevel, view.getSample (c, i));
+                        }
+                    }
+                }
+
+                numProcessed += numSamples;
+            }
+
+            const auto description = "Speeds from " + String (range.getStart()) + " to " + String (range.getEnd());
+            expectGreaterOrEqual (minLevel, 0.999f, description);
+            expectLessOrEqual (maxLevel, 1.001f, description);
+        }
+    }
+
+    //==============================================================================
+    /** Leaves the MIDI it gets in place, so that it comes back out again, and keeps track of it. */
+    class MidiThroughProcessor final : public InternalProcessor
+    {
+    public:
+        MidiThroughProcessor() :
+            InternalProcessor (false)
+        {
+        }
+
+        Identifier getIdentifier() const override { return "midiThrough"; }
+        bool acceptsMidi() const override { return true; }
+        bool producesMidi() const override { return true; }
+
+        void processBlock (juce::AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override
+        {
+            for (const auto metadata : midiMessages)
+                allInRange &= isPositiveAndBelow (metadata.samplePosition, buffer.getNumSamples());
+
+            numEvents += midiMessages.getNumEvents();
+        }
+
+        int numEvents = 0;
+        bool allInRange = true;
+    };
+
+    void runMidiTest()
+    {
+        for (double internalRate : { 22050.0, 44100.0, 48000.0, 96000.0 })
+        {
+            ResamplingProcessor processor;
+            processor.setInternalSampleRate (internalRate);
+
+            constexpr int blockSize = 512;
+            processor.prepareToPlay (44100.0, blockSize);
+
+            auto hosted = std::make_shared<MidiThroughProcessor>();
+            processor.setProcessor (hosted);
+            expect (processor.acceptsMidi() && processor.producesMidi());
+
+            juce::AudioBuffer<float> buffer (2, blockSize);
+            MidiBuffer midi;
+            const int positions[] = { 0, 1, 100, 257, blockSize - 1 };
+            int numSent = 0, numReceived = 0, maxOffset = 0;
+
+            for (int block = 0; block < 100; ++block)
+            {
+                buffer.clear();
+                midi.clear();
+
+                // NB: The controller value is the index of the position each event was sent at.
+                for (int i = 0; i < numElementsInArray (positions); ++i)
+                    midi.addEvent (MidiMessage::controllerEvent (1, 1, i), positions[i]);
+
+                numSent += midi.getNumEvents();
+                processor.processBlock (buffer, midi);
+
+                for (const auto metadata : midi)
+                {
+                    const auto index = metadata.getMessage().getControllerValue();
+
+                    if (isPositiveAndBelow (index, numElementsInArray (positions)))
+                        maxOffset = jmax (maxOffset, std::abs (metadata.samplePosition - positions[index]));
+                    else
+                        maxOffset = std::numeric_limits<int>::max();
+
+                    ++numReceived;
+                }
+            }
+
+            const auto description = "At " + String (internalRate) + " Hz";
+            expectEquals (hosted->numEvents, numSent, description);
+            expectEquals (numReceived, numSent, description);
+            expect (hosted->allInRange, description);
+
+            // NB: Each event is rounded down to an internal sample, and back again.
+            expectLessOrEqual (maxOffset, (int) std::ceil (44100.0 / internalRate) + 1, description);
+        }
+    }
+
+    //==============================================================================
+    /** @returns the best time of a few runs, in milliseconds, which shakes off most of the noise. */
+    template<typename Function>
+    static double timeBestOf (Function&& function)
+    {
+        constexpr int numRuns = 5;
+        auto best = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < numRuns; ++i)
+        {
+            MillisecondStopWatch stopWatch;
+
+            {
+                const ScopedStartStop<MillisecondStopWatch> sss (stopWatch);
+                function();
+            }
+
+            best = std::min (best, stopWatch.getDelta());
+        }
+
+        return best;
+    }
+
+    void logThroughput (const String& name, double seconds, double ms)
+    {
+        logMessage (name + ": " + String (ms, 2) + " ms (" + String (seconds * 1000.0 / jmax (ms, 1.0e-6), 0) + "x realtime)");
+    }
+
+    /** Converts 10 seconds of stereo from 44.1 kHz to 48 kHz with each resampler. */
+    void runThroughputTest()
+    {
+        constexpr int numChannels = 2;
+        constexpr double sourceRate = 44100.0, destinationRate = 48000.0, seconds = 10.0;
+        constexpr int blockSize = 512;
+        constexpr auto ratio = sourceRate / destinationRate;
+
+        juce::AudioBuffer<float> source (numChannels, (int) (sourceRate * seconds));
+
+        for (int c = 0; c < numChannels; ++c)
+            for (int i = 0; i < source.getNumSamples(); ++i)
+                source.setSample (c, i, random.nextFloat() * 2.0f - 1.0f);
+
+        const auto numDestinationSamples = (int) ((double) source.getNumSamples() / ratio) - 64;
+        juce::AudioBuffer<float> destination (numChannels, numDestinationSamples);
+
+        {
+            PolyphaseResampler resampler;
+            resampler.setRatio (ratio);
+            resampler.prepare (numChannels, sourceRate, blockSize);
+
+            logThroughput ("Polyphase", seconds, timeBestOf ([&]
+            {
+                resampler.reset();
+                int numProduced = 0;
+
+                for (int start = 0; start < source.getNumSamples(); start += blockSize)
+                {
+                    const auto numThisTime = jmin (blockSize, source.getNumSamples() - start);
+                    const float* inputs[] = { source.getReadPointer (0, start), source.getReadPointer (1, start) };
+                    float* outputs[] = { destination.getWritePointer (0) + numProduced, destination.getWritePointer (1) + numProduced };
+
+                    resampler.push (inputs, numChannels, numThisTime);
+                    numProduced += resampler.pull (outputs, numChannels, numDestinationSamples - numProduced);
+                }
+            }));
+        }
+
+        auto timeOneShot = [&] (const String& name, Resampler& resampler)
+        {
+            resampler.setRatio (ratio);
+            resampler.prepare (numChannels, sourceRate, source.getNumSamples());
+
+            logThroughput (name, seconds, timeBestOf ([&] { resampler.process (source, destination); }));
+        };
+
+        LagrangeResampler lagrange;
+        timeOneShot ("Lagrange", lagrange);
+
+        WindowedSincResampler windowedSinc;
+        timeOneShot ("Windowed Sinc", windowedSinc);
+
+       #if SQUAREPINE_USE_R8BRAIN
+        R8brainResampler r8brain;
+        timeOneShot ("r8brain", r8brain);
+       #endif
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
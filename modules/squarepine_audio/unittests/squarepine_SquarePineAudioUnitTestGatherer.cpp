@@ -0,0 +1,16 @@
+OwnedArray<UnitTest> SquarePineAudioUnitTestGatherer::createTests()
+{
+    OwnedArray<UnitTest> tests;
+
+   #if SQUAREPINE_COMPILE_UNIT_TESTS
+    tests.add (new ALACAudioFormatUnitTests());
+    tests.add (new EffectProcessorChainUnitTests());
+    tests.add (new MultichannelResamplerUnitTests());
+    tests.add (new NonlinearStageUnitTests());
+    tests.add (new PartitionedConvolverUnitTests());
+    tests.add (new ResamplerUnitTests());
+    tests.add (new TempoMapUnitTests());
+   #endif
+
+    return tests;
+}
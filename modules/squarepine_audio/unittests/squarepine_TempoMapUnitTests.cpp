@@ -0,0 +1,204 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Checks the TempoMap's conversions against hand-worked positions,
+    its cursor against its random access, and the constant-signature
+    MBTTime conversions against the map.
+*/
+class TempoMapUnitTests final : public UnitTest
+{
+public:
+    TempoMapUnitTests() :
+        UnitTest ("Tempo Map", UnitTestCategories::audio)
+    {
+    }
+
+    void runTest() override
+    {
+        random = getRandom();
+
+        beginTest ("Constant");
+        runConstantTest();
+
+        beginTest ("Tempo Changes");
+        runTempoChangeTest();
+
+        beginTest ("Time Signature Changes");
+        runTimeSignatureChangeTest();
+
+        beginTest ("MIDI File");
+        runMidiFileTest();
+
+        beginTest ("Cursor matches Random Access");
+        runCursorTest();
+
+        beginTest ("MBTTime matches a Constant Map");
+        runMBTTimeTest();
+    }
+
+private:
+    //==============================================================================
+    Random random;
+    static constexpr int ppq = 960;
+    static constexpr double tolerance = 1.0e-9;
+
+    void expectMBT (const MBTTime& actual, int measure, int beat, int tick, const String& description = {})
+    {
+        expectEquals (actual.toString(), MBTTime (measure, beat, tick).toString(), description);
+    }
+
+    //==============================================================================
+    void runConstantTest()
+    {
+        const TempoMap map (Tempo (120.0), TimeSignature (4, 4), ppq);
+
+        // At 120 BPM, a quarter note lasts half a second:
+        expectWithinAbsoluteError (map.ticksToSeconds (ppq), 0.5, tolerance);
+        expectWithinAbsoluteError (map.secondsToTicks (3.0), 6.0 * ppq, tolerance);
+        expectEquals (map.ticksToSamples (ppq, 48000.0), (int64) 24000);
+        expectWithinAbsoluteError (map.samplesToTicks (48000, 48000.0), 2.0 * ppq, tolerance);
+
+        expectMBT (map.ticksToMBT (0.0), 1, 1, 0);
+        expectMBT (map.ticksToMBT (ppq * 5 + 17), 2, 2, 17);
+        expectWithinAbsoluteError (map.mbtToTicks ({ 3, 4, 5 }), (double) (ppq * 11 + 5), tolerance);
+        expectWithinAbsoluteError (map.mbtToSeconds ({ 2, 1, 0 }), 2.0, tolerance);
+    }
+
+    void runTempoChangeTest()
+    {
+        // 120 BPM for two beats, then 60 BPM for two more, then 240 BPM:
+        const TempoMap map ({ { ppq * 4, Tempo (240.0) }, { 0.0, Tempo (120.0) }, { ppq * 2, Tempo (60.0) } },
+                            {}, ppq);
+
+        expectWithinAbsoluteError (map.ticksToSeconds (ppq * 2), 1.0, tolerance);
+        expectWithinAbsoluteError (map.ticksToSeconds (ppq * 3), 2.0, tolerance);
+        expectWithinAbsoluteError (map.ticksToSeconds (ppq * 4), 3.0, tolerance);
+        expectWithinAbsoluteError (map.ticksToSeconds (ppq * 6), 3.5, tolerance);
+
+        expectWithinAbsoluteError (map.secondsToTicks (2.5), ppq * 3.5, tolerance);
+        expectWithinAbsoluteError (map.secondsToTicks (3.25), ppq * 5.0, tolerance);
+
+        expectEquals (map.getTempoAt (ppq * 2 - 1).get(), 120.0);
+        expectEquals (map.getTempoAt (ppq * 2).get(), 60.0);
+        expectEquals (map.getTempoAt (1.0e9).get(), 240.0);
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            const auto ticks = random.nextDouble() * ppq * 100.0;
+            expectWithinAbsoluteError (map.secondsToTicks (map.ticksToSeconds (ticks)), ticks, 1.0e-6);
+        }
+
+        // Of several changes at the same position, the last one wins:
+        const TempoMap duplicates ({ { 0.0, Tempo (100.0) }, { 0.0, Tempo (150.0) } }, {}, ppq);
+        expectEquals (duplicates.getTempoAt (0.0).get(), 150.0);
+    }
+
+    void runTimeSignatureChangeTest()
+    {
+        // Two measures of 4/4, then 3/4, then 7/8 from measure 5:
+        const TempoMap map ({}, { { ppq * 8, TimeSignature (3, 4) }, { ppq * 14, TimeSignature (7, 8) } }, ppq);
+
+        expectMBT (map.ticksToMBT (ppq * 8 - 1), 2, 4, ppq - 1);
+        expectMBT (map.ticksToMBT (ppq * 8), 3, 1, 0);
+        expectMBT (map.ticksToMBT (ppq * 11), 4, 1, 0);
+        expectMBT (map.ticksToMBT (ppq * 14), 5, 1, 0);
+        expectMBT (map.ticksToMBT (ppq * 14 + ppq / 2 * 6 + 3), 5, 7, 3);
+        expectMBT (map.ticksToMBT (ppq * 14 + ppq / 2 * 7), 6, 1, 0);
+
+        expectEquals (map.getTimeSignatureAt (ppq * 9).numerator, 3);
+        expectEquals (map.getTimeSignatureAt (ppq * 20).denominator, 8);
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            const auto ticks = (double) random.nextInt (ppq * 100);
+            expectWithinAbsoluteError (map.mbtToTicks (map.ticksToMBT (ticks)), ticks, tolerance);
+        }
+
+        // A change partway through a measure cuts it short, but it still counts as a whole one:
+        const TempoMap cutShort ({}, { { ppq * 2, TimeSignature (6, 8) } }, ppq);
+        expectMBT (cutShort.ticksToMBT (ppq * 2), 2, 1, 0);
+        expectMBT (cutShort.ticksToMBT (ppq * 5), 3, 1, 0);
+    }
+
+    void runMidiFileTest()
+    {
+        MidiMessageSequence track;
+        track.addEvent (MidiMessage::tempoMetaEvent (500000), 0.0);                 // 120 BPM
+        track.addEvent (MidiMessage::timeSignatureMetaEvent (3, 4), 0.0);
+        track.addEvent (MidiMessage::tempoMetaEvent (1000000), ppq * 3.0);          // 60 BPM
+        track.addEvent (MidiMessage::noteOn (1, 60, 1.0f), ppq * 4.0);
+
+        MidiFile file;
+        file.setTicksPerQuarterNote (ppq);
+        file.addTrack (track);
+
+        const auto map = TempoMap::fromMidiFile (file);
+
+        expectEquals (map.getTicksPerQuarterNote(), ppq);
+        expectWithinAbsoluteError (map.ticksToSeconds (ppq * 3), 1.5, tolerance);
+        expectWithinAbsoluteError (map.ticksToSeconds (ppq * 4), 2.5, tolerance);
+        expectMBT (map.ticksToMBT (ppq * 4), 2, 2, 0);
+    }
+
+    //==============================================================================
+    TempoMap createRandomMap()
+    {
+        Array<TempoMap::TempoChange> tempoChanges;
+        Array<TempoMap::TimeSignatureChange> timeSignatureChanges;
+
+        for (int i = 0; i < 50; ++i)
+            tempoChanges.add ({ random.nextDouble() * ppq * 1000.0, Tempo (40.0 + random.nextDouble() * 200.0) });
+
+        for (int i = 0; i < 20; ++i)
+            timeSignatureChanges.add ({ (double) (random.nextInt (250) * ppq * 4),
+                                        TimeSignature (1 + random.nextInt (12), 1 << random.nextInt (5)) });
+
+        return { tempoChanges, timeSignatureChanges, ppq };
+    }
+
+    void runCursorTest()
+    {
+        const auto map = createRandomMap();
+
+        for (bool isMonotonic : { true, false })
+        {
+            TempoMap::Cursor cursor (map);
+            auto ticks = 0.0;
+            auto isIdentical = true;
+
+            for (int i = 0; i < 5000; ++i)
+            {
+                ticks = isMonotonic ? ticks + random.nextDouble() * ppq : random.nextDouble() * ppq * 1200.0;
+                const auto seconds = map.ticksToSeconds (ticks);
+
+                isIdentical &= cursor.ticksToSeconds (ticks) == seconds;
+                isIdentical &= cursor.secondsToTicks (seconds) == map.secondsToTicks (seconds);
+                isIdentical &= cursor.ticksToMBT (ticks) == map.ticksToMBT (ticks);
+            }
+
+            expect (isIdentical, isMonotonic ? "Monotonic" : "Random");
+        }
+    }
+
+    void runMBTTimeTest()
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            const TimeSignature timeSignature (1 + random.nextInt (16), 1 << random.nextInt (6));
+            // NB: A multiple of 8, so that even a 32nd note beat is a whole number of ticks and round trips exactly.
+            const auto ticksPerQuarterNote = 8 * (3 + random.nextInt (120));
+            const TempoMap map ({}, timeSignature, ticksPerQuarterNote);
+
+            for (int j = 0; j < 100; ++j)
+            {
+                const auto ticks = (double) random.nextInt (ticksPerQuarterNote * 1000);
+                const MBTTime mbt (ticks, ticksPerQuarterNote, timeSignature);
+
+                expect (mbt == map.ticksToMBT (ticks), mbt.toString() + " vs. " + map.ticksToMBT (ticks).toString());
+                expectWithinAbsoluteError (mbt.toTicks (timeSignature, ticksPerQuarterNote), ticks, tolerance);
+            }
+        }
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
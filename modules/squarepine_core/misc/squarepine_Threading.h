@@ -102,8 +102,204 @@ inline void callInBackground (std::function<void (void)> function)
 }
 
 //==============================================================================
-/** Runs a for-loop that is split between each available core,
-    as provided by the thread pool.
+#if ! DOXYGEN
+
+namespace detail
+{
+    /** The shared state of a parallel loop, which is split into contiguous chunks.
+
+        Each participant starts off owning a contiguous run of the chunks, which it
+        takes from the front of. Once its own run is empty, it steals from the back
+        of the others' runs, so uneven workloads still balance out.
+
+        NB: This is shared with the pool's jobs since those might only start
+            once the loop is over, in which case they simply find nothing to do.
+    */
+    class ParallelLoop final
+    {
+    public:
+        using ChunkFunction = void (*) (void* context, int64 chunkIndex);
+
+        ParallelLoop (int numParticipants, int64 numChunksToRun, ChunkFunction f, void* c) :
+            slots ((size_t) numParticipants),
+            numChunksRemaining (numChunksToRun),
+            function (f),
+            context (c)
+        {
+            for (int i = 0; i < numParticipants; ++i)
+            {
+                const auto first = (numChunksToRun * i) / numParticipants;
+                const auto last = (numChunksToRun * (i + 1)) / numParticipants;
+                slots[(size_t) i].range.store (pack (first, last));
+            }
+        }
+
+        /** Runs chunks until there are none left to claim.
+
+            @param participantIndex Which participant's chunks to start with,
+                                    which is -1 to only steal from the others.
+        */
+        void participate (int participantIndex) noexcept
+        {
+            const auto numSlots = (int) slots.size();
+
+            if (isPositiveAndBelow (participantIndex, numSlots))
+                while (run (takeFront (slots[(size_t) participantIndex])))
+                {}
+
+            const auto firstVictim = participantIndex + 1;
+
+            for (int i = 0; i < numSlots; ++i)
+            {
+                auto& victim = slots[(size_t) ((firstVictim + i) % numSlots)];
+
+                while (run (takeBack (victim)))
+                {}
+            }
+        }
+
+        /** Participates as a job from the pool. */
+        void participateAsHelper() noexcept
+        {
+            participate (nextHelperIndex.fetch_add (1, std::memory_order_relaxed));
+        }
+
+        /** Waits for all of the chunks, including those being run by others, to be complete. */
+        void waitUntilFinished()
+        {
+            while (numChunksRemaining.load (std::memory_order_acquire) > 0)
+                finished.wait (1);
+        }
+
+    private:
+        // NB: Each run is padded out to a cache line so that
+        //     claiming chunks doesn't bounce the others' lines around.
+        struct alignas (64) Slot final
+        {
+            std::atomic<uint64> range { 0 }; // The first chunk in the low bits, the end in the high bits.
+        };
+
+        std::vector<Slot> slots;
+        std::atomic<int64> numChunksRemaining;
+        std::atomic<int> nextHelperIndex { 1 }; // The caller is always participant 0.
+        const ChunkFunction function;
+        void* const context;
+        WaitableEvent finished;
+
+        static uint64 pack (int64 first, int64 last) noexcept   { return (uint64) (uint32) first | ((uint64) (uint32) last << 32); }
+        static int64 getFirst (uint64 range) noexcept           { return (int64) (range & 0xffffffff); }
+        static int64 getLast (uint64 range) noexcept            { return (int64) (range >> 32); }
+
+        static int64 takeFront (Slot& slot) noexcept
+        {
+            auto range = slot.range.load (std::memory_order_relaxed);
+
+            while (getFirst (range) < getLast (range))
+                if (slot.range.compare_exchange_weak (range, pack (getFirst (range) + 1, getLast (range)), std::memory_order_acq_rel))
+                    return getFirst (range);
+
+            return -1;
+        }
+
+        static int64 takeBack (Slot& slot) noexcept
+        {
+            auto range = slot.range.load (std::memory_order_relaxed);
+
+            while (getFirst (range) < getLast (range))
+                if (slot.range.compare_exchange_weak (range, pack (getFirst (range), getLast (range) - 1), std::memory_order_acq_rel))
+                    return getLast (range) - 1;
+
+            return -1;
+        }
+
+        bool run (int64 chunkIndex) noexcept
+        {
+            if (chunkIndex < 0)
+                return false;
+
+            function (context, chunkIndex);
+
+            if (numChunksRemaining.fetch_sub (1, std::memory_order_acq_rel) == 1)
+                finished.signal();
+
+            return true;
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParallelLoop)
+    };
+}
+
+#endif // DOXYGEN
+
+/** Runs a for-loop over a range, split into contiguous chunks between
+    the calling thread and the threads of the given pool.
+
+    The callback is called once per chunk with the chunk's half-open range,
+    which is handy for when each chunk can set up its work once, or can
+    process its range in one go (eg: a run of image rows or samples).
+
+    @param start        The first index.
+    @param end          The index to stop before.
+    @param threadPool   The pool to share the work with. If this is null,
+                        the whole range is run on the calling thread as a single chunk.
+    @param callback     Called as (Type chunkStart, Type chunkEnd) for each chunk.
+    @param grainSize    The chunk sizes will be multiples of this, other than
+                        the last one. Use this to keep the chunks' boundaries
+                        on cache lines, eg: 64 / sizeof (float) when writing to floats.
+
+    The calling thread runs chunks too, and will take over any that the pool
+    hasn't got around to, so this is safe to call from within another
+    job of the same pool (ie: nested loops) without risking a deadlock.
+
+    @note Make sure each chunk is independant!
+*/
+template<typename Type, typename Callback>
+inline void multithreadedForChunks (Type start, Type end, ThreadPool* threadPool, Callback&& callback, Type grainSize = 1)
+{
+    const auto count = static_cast<int64> (end) - static_cast<int64> (start);
+    if (count <= 0)
+        return;
+
+    const auto grain = std::max ((int64) 1, static_cast<int64> (grainSize));
+    const auto numThreads = threadPool != nullptr ? threadPool->getNumThreads() : 0;
+
+    // Aims for a few chunks per participant, which leaves something to steal when the work is uneven:
+    constexpr int64 chunksPerParticipant = 4;
+    const auto numParticipants = (int64) numThreads + 1;
+    auto chunkSize = (count + numParticipants * chunksPerParticipant - 1) / (numParticipants * chunksPerParticipant);
+    chunkSize = ((chunkSize + grain - 1) / grain) * grain;
+
+    const auto numChunks = (count + chunkSize - 1) / chunkSize;
+
+    if (numThreads <= 0 || numChunks <= 1)
+    {
+        callback (start, end);
+        return;
+    }
+
+    auto runChunk = [&] (int64 chunkIndex)
+    {
+        const auto chunkStart = static_cast<int64> (start) + chunkIndex * chunkSize;
+        callback (static_cast<Type> (chunkStart),
+                  static_cast<Type> (std::min (chunkStart + chunkSize, static_cast<int64> (end))));
+    };
+
+    using RunChunk = decltype (runChunk);
+
+    const auto numHelpers = (int) std::min ((int64) numThreads, numChunks - 1);
+    auto loop = std::make_shared<detail::ParallelLoop> (numHelpers + 1, numChunks,
+                                                        [] (void* context, int64 chunkIndex) { (*static_cast<RunChunk*> (context)) (chunkIndex); },
+                                                        &runChunk);
+
+    for (int i = 0; i < numHelpers; ++i)
+        threadPool->addJob ([loop]() { loop->participateAsHelper(); });
+
+    loop->participate (0);
+    loop->waitUntilFinished();
+}
+
+/** Runs a for-loop that is split between the calling thread and
+    each available core, as provided by the thread pool.
 
     If no thread pool is provided, this will retain the
     for-loop by performing it as per the usual.
@@ -119,39 +315,36 @@ inline void callInBackground (std::function<void (void)> function)
         multithreadedFor<int> (0, 10, 1, threadPool, [&] (int i) {});
     @endcode
 
+    Each thread is handed contiguous runs of iterations, rather than
+    interleaved ones, so neighbouring iterations (eg: image rows) stay
+    on the same core and keep their locality.
+
     @note Make sure each iteration of the loop is independant!
+
+    @see multithreadedForChunks
 */
-template<typename Type>
-inline void multithreadedFor (Type start, Type end, Type interval, ThreadPool* threadPool, std::function<void (Type)> callback)
+template<typename Type, typename Callback>
+inline void multithreadedFor (Type start, Type end, Type interval, ThreadPool* threadPool, Callback&& callback)
 {
+    jassert (interval > 0);
+
     if (threadPool == nullptr)
     {
-        for (int i = start; i < end; i += interval)
+        for (auto i = start; i < end; i += interval)
             callback (i);
 
         return;
     }
 
-    const auto num = threadPool->getNumThreads();
-
-    WaitableEvent wait;
-    std::atomic<int> threadsRunning (num);
+    // NB: The loop is run over the iteration numbers, which are mapped back onto the indexes.
+    const auto numIterations = (static_cast<int64> (end) - static_cast<int64> (start) + static_cast<int64> (interval) - 1)
+                               / static_cast<int64> (interval);
 
-    for (int i = 0; i < num; ++i)
+    multithreadedForChunks<int64> (0, numIterations, threadPool, [&] (int64 first, int64 last)
     {
-        threadPool->addJob
-        ([&]()
-        {
-            for (int j = start + interval * i; j < end; j += interval * num)
-                callback (j);
-
-            const auto stillRunning = --threadsRunning;
-            if (stillRunning == 0)
-                wait.signal();
-        });
-    }
-
-    wait.wait();
+        for (auto i = first; i < last; ++i)
+            callback (static_cast<Type> (static_cast<int64> (start) + i * static_cast<int64> (interval)));
+    });
 }
 
 //==============================================================================
@@ -73,5 +73,6 @@ namespace sp
     #include "unittests/squarepine_AllocatorUnitTests.cpp"
     #include "unittests/squarepine_AngleUnitTests.cpp"
     #include "unittests/squarepine_MathsUnitTests.cpp"
+    #include "unittests/squarepine_ThreadingUnitTests.cpp"
     #include "unittests/squarepine_SquarePineCoreUnitTestGatherer.cpp"
 }
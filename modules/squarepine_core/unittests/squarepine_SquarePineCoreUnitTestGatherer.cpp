@@ -17,6 +17,7 @@ OwnedArray<UnitTest> SquarePineCoreUnitTestGatherer::createTests()
     tests.add (new AngleUnitTests());
     tests.add (new MathsUnitTests());
     tests.add (new MovingAccumulatorTests());
+    tests.add (new ThreadingUnitTests());
    #endif
 
     return tests;
@@ -0,0 +1,76 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+class ThreadingUnitTests final : public UnitTest
+{
+public:
+    ThreadingUnitTests() : UnitTest ("Threading", UnitTestCategories::threads) {}
+
+    void runTest()
+    {
+        ThreadPool pool (4);
+
+        beginTest ("multithreadedFor - Every Index Once");
+
+        for (int numIndexes : { 0, 1, 2, 7, 100, 4321 })
+        {
+            for (int interval : { 1, 3 })
+            {
+                std::vector<std::atomic<int>> hits ((size_t) numIndexes);
+                multithreadedFor<int> (0, numIndexes, interval, &pool, [&] (int i) { ++hits[(size_t) i]; });
+
+                bool allCorrect = true;
+                for (int i = 0; i < numIndexes; ++i)
+                    allCorrect &= hits[(size_t) i].load() == (i % interval == 0 ? 1 : 0);
+
+                expect (allCorrect, "Failed with " + String (numIndexes) + " indexes and an interval of " + String (interval));
+            }
+        }
+
+        beginTest ("multithreadedFor - No Pool");
+
+        {
+            std::vector<int> order;
+            multithreadedFor<int> (0, 5, 1, nullptr, [&] (int i) { order.push_back (i); });
+            expect (order == std::vector<int> { 0, 1, 2, 3, 4 });
+        }
+
+        beginTest ("multithreadedFor - Uneven and Nested");
+
+        {
+            constexpr int size = 64;
+            std::vector<std::atomic<int>> hits ((size_t) (size * size));
+
+            multithreadedFor<int> (0, size, 1, &pool, [&] (int y)
+            {
+                // The first rows are far slower, so the others must be stolen:
+                if (y < 4)
+                    Thread::sleep (10);
+
+                multithreadedFor<int> (0, size, 1, &pool, [&] (int x) { ++hits[(size_t) (y * size + x)]; });
+            });
+
+            expect (std::all_of (hits.begin(), hits.end(), [] (const auto& h) { return h.load() == 1; }));
+        }
+
+        beginTest ("multithreadedForChunks");
+
+        {
+            std::atomic<int> total { 0 };
+            std::atomic<bool> allAligned { true };
+
+            multithreadedForChunks<int> (5, 1005, &pool, [&] (int chunkStart, int chunkEnd)
+            {
+                if (chunkStart < 5 || chunkEnd > 1005 || chunkStart >= chunkEnd || (chunkStart - 5) % 16 != 0)
+                    allAligned = false;
+
+                total += chunkEnd - chunkStart;
+            }, 16);
+
+            expectEquals (total.load(), 1000);
+            expect (allAligned.load());
+        }
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
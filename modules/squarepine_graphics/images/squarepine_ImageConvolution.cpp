@@ -0,0 +1,424 @@
+ImageConvolutionKernel ImageConvolutionKernel::createMatrix (int w, int h, std::vector<float> weights)
+{
+    if (w <= 0 || h <= 0 || weights.size() != (size_t) (w * h))
+    {
+        jassertfalse; // The weights don't match the size!
+        return {};
+    }
+
+    ImageConvolutionKernel k;
+    k.width = w;
+    k.height = h;
+    k.matrix = std::move (weights);
+    return k;
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::createSeparable (std::vector<float> h, std::vector<float> v)
+{
+    if (h.empty() || v.empty())
+    {
+        jassertfalse;
+        return {};
+    }
+
+    ImageConvolutionKernel k;
+    k.width = (int) h.size();
+    k.height = (int) v.size();
+    k.horizontal = std::move (h);
+    k.vertical = std::move (v);
+    k.separable = true;
+    return k;
+}
+
+//==============================================================================
+ImageConvolutionKernel ImageConvolutionKernel::createBox (int radius)
+{
+    radius = std::max (0, radius);
+
+    const auto size = radius * 2 + 1;
+    std::vector<float> weights ((size_t) size, 1.0f / (float) size);
+    return createSeparable (weights, weights);
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::createGaussian (float radius)
+{
+    const auto r = std::max (0, (int) std::ceil (radius));
+    const auto sigma = std::max (radius / 3.0f, 0.01f);
+
+    std::vector<float> weights ((size_t) (r * 2 + 1));
+    float sum = 0.0f;
+
+    for (int i = -r; i <= r; ++i)
+    {
+        const auto w = std::exp (-(float) (i * i) / (2.0f * sigma * sigma));
+        weights[(size_t) (i + r)] = w;
+        sum += w;
+    }
+
+    for (auto& w : weights)
+        w /= sum;
+
+    return createSeparable (weights, weights);
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::createSoften()
+{
+    return createBox (1);
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::createSharpen()
+{
+    return createMatrix (3, 3, { 0.0f, -1.0f, 0.0f,
+                                -1.0f, 5.0f, -1.0f,
+                                 0.0f, -1.0f, 0.0f });
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::createUnsharpMask (float radius, float amount)
+{
+    // ie: source + amount * (source - blurred), with the blur kept separable.
+    auto k = createGaussian (radius);
+
+    for (auto& w : k.horizontal)
+        w *= -amount;
+
+    k.identityWeight = 1.0f + amount;
+    return k;
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::createEmboss()
+{
+    return createMatrix (3, 3, { -2.0f, -1.0f, 0.0f,
+                                 -1.0f,  1.0f, 1.0f,
+                                  0.0f,  1.0f, 2.0f })
+            .withAlphaFiltered (false);
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::createEdgeDetection()
+{
+    return createMatrix (3, 3, { -1.0f, -1.0f, -1.0f,
+                                 -1.0f,  8.0f, -1.0f,
+                                 -1.0f, -1.0f, -1.0f })
+            .withAlphaFiltered (false);
+}
+
+//==============================================================================
+ImageConvolutionKernel ImageConvolutionKernel::withBias (float newBias) const
+{
+    auto k = *this;
+    k.bias = newBias;
+    return k;
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::withIdentityWeight (float newIdentityWeight) const
+{
+    auto k = *this;
+    k.identityWeight = newIdentityWeight;
+    return k;
+}
+
+ImageConvolutionKernel ImageConvolutionKernel::withAlphaFiltered (bool shouldFilterAlpha) const
+{
+    auto k = *this;
+    k.filtersAlpha = shouldFilterAlpha;
+    return k;
+}
+
+//==============================================================================
+int ImageConvolver::mapIndex (int index, int size, BorderMode mode) noexcept
+{
+    jassert (size > 0);
+
+    if (isPositiveAndBelow (index, size))
+        return index;
+
+    switch (mode)
+    {
+        case BorderMode::wrap:
+            index %= size;
+            return index < 0 ? index + size : index;
+
+        case BorderMode::mirror:
+        {
+            if (size == 1)
+                return 0;
+
+            const auto period = 2 * (size - 1);
+            index %= period;
+
+            if (index < 0)
+                index += period;
+
+            return index < size ? index : period - index;
+        }
+
+        case BorderMode::clamp:
+        default:
+            return jlimit (0, size - 1, index);
+    };
+}
+
+void ImageConvolver::releaseScratchBuffers()
+{
+    const SpinLock::ScopedLockType sl (workspaceLock);
+    edgeRows = {};
+    workspaces.clear();
+    workspaces.shrink_to_fit();
+}
+
+std::unique_ptr<ImageConvolver::Workspace> ImageConvolver::takeWorkspace()
+{
+    {
+        const SpinLock::ScopedLockType sl (workspaceLock);
+
+        if (! workspaces.empty())
+        {
+            auto workspace = std::move (workspaces.back());
+            workspaces.pop_back();
+            return workspace;
+        }
+    }
+
+    return std::make_unique<Workspace>();
+}
+
+void ImageConvolver::returnWorkspace (std::unique_ptr<Workspace> workspace)
+{
+    const SpinLock::ScopedLockType sl (workspaceLock);
+    workspaces.push_back (std::move (workspace));
+}
+
+//==============================================================================
+void ImageConvolver::writePixels (uint8* destination, const float* filtered, const float* original,
+                                  int numPixels, int numChannels, bool isARGB,
+                                  const ImageConvolutionKernel& kernel) noexcept
+{
+    const auto identityWeight = kernel.identityWeight;
+    const auto bias = kernel.bias + 0.5f;
+
+    for (int j = 0; j < numPixels * numChannels; ++j)
+        destination[j] = (uint8) std::clamp (filtered[j] + identityWeight * original[j] + bias, 0.0f, 255.0f);
+
+    if (! isARGB)
+        return;
+
+    // Keeps the pixels valid as premultiplied colours, which sharpening and the likes otherwise wouldn't:
+    for (int x = 0; x < numPixels; ++x)
+    {
+        auto* p = destination + x * 4;
+
+        if (! kernel.filtersAlpha)
+            p[PixelARGB::indexA] = (uint8) original[x * 4 + PixelARGB::indexA];
+
+        const auto a = p[PixelARGB::indexA];
+        p[PixelARGB::indexR] = std::min (p[PixelARGB::indexR], a);
+        p[PixelARGB::indexG] = std::min (p[PixelARGB::indexG], a);
+        p[PixelARGB::indexB] = std::min (p[PixelARGB::indexB], a);
+    }
+}
+
+void ImageConvolver::convolveRow (const float* source, float* destination, int numPixels, int numChannels,
+                                  const float* weights, int numWeights, bool accumulate) const noexcept
+{
+    const auto before = numWeights / 2;
+    const auto after = numWeights - 1 - before;
+    const auto interiorStart = std::min (before, numPixels);
+    const auto interiorEnd = std::max (interiorStart, numPixels - after);
+
+    auto convolveBorderPixel = [&] (int x)
+    {
+        for (int c = 0; c < numChannels; ++c)
+        {
+            float sum = 0.0f;
+
+            for (int i = 0; i < numWeights; ++i)
+                sum += weights[i] * source[mapIndex (x + i - before, numPixels, borderMode) * numChannels + c];
+
+            auto& d = destination[x * numChannels + c];
+            d = accumulate ? d + sum : sum;
+        }
+    };
+
+    for (int x = 0; x < interiorStart; ++x)
+        convolveBorderPixel (x);
+
+    // The interior needs no bounds checks, and each weight's pass is a straight multiply-add over the row:
+    auto* d = destination + interiorStart * numChannels;
+    const auto numValues = (interiorEnd - interiorStart) * numChannels;
+
+    if (! accumulate)
+        std::fill (d, d + numValues, 0.0f);
+
+    for (int i = 0; i < numWeights; ++i)
+    {
+        const auto w = weights[i];
+        if (w == 0.0f)
+            continue;
+
+        const auto* s = source + (interiorStart + i - before) * numChannels;
+
+        for (int j = 0; j < numValues; ++j)
+            d[j] += w * s[j];
+    }
+
+    for (int x = interiorEnd; x < numPixels; ++x)
+        convolveBorderPixel (x);
+}
+
+void ImageConvolver::apply (Image& img, const ImageConvolutionKernel& kernel, ThreadPool* threadPool)
+{
+    const auto w = img.getWidth();
+    const auto h = img.getHeight();
+
+    if (w <= 0 || h <= 0 || kernel.isEmpty())
+        return;
+
+    threadPool = (w >= 256 || h >= 256) ? threadPool : nullptr;
+
+    Image::BitmapData data (img, Image::BitmapData::readWrite);
+
+    const auto numChannels = data.pixelStride;
+    jassert (numChannels <= maxChannels);
+    const auto rowSize = (size_t) (w * numChannels);
+    const auto isARGB = img.getFormat() == Image::ARGB;
+
+    const auto kernelHeight = kernel.height;
+    const auto numAbove = kernelHeight / 2;
+    const auto numEdgeRows = kernelHeight - 1;
+
+    // A few bands per thread leaves something to steal, whilst bands at least as tall
+    // as the kernel keep the edge copies from outgrowing the image:
+    const auto numParticipants = threadPool != nullptr ? threadPool->getNumThreads() + 1 : 1;
+    const auto targetNumBands = numParticipants > 1 ? numParticipants * 4 : 1;
+    const auto rowsPerBand = std::max ({ minRowsPerBand, numEdgeRows, (h + targetNumBands - 1) / targetNumBands });
+    const auto numBands = (h + rowsPerBand - 1) / rowsPerBand;
+    const auto edgeSize = (size_t) numEdgeRows * rowSize;
+
+    // NB: These only ever grow, so that reusing a convolver doesn't allocate.
+    if (edgeRows.size() < edgeSize * (size_t) numBands)
+        edgeRows.resize (edgeSize * (size_t) numBands);
+
+    {
+        const SpinLock::ScopedLockType sl (workspaceLock);
+        workspaces.reserve ((size_t) numParticipants);
+    }
+
+    auto getBandRange = [&] (int band)
+    {
+        const auto start = band * rowsPerBand;
+        return Range<int> (start, std::min (h, start + rowsPerBand));
+    };
+
+    // Copies the rows each band reads from beyond its edges, before any of them are written over:
+    multithreadedForChunks<int> (0, numBands, threadPool, [&] (int startBand, int endBand)
+    {
+        for (int band = startBand; band < endBand; ++band)
+        {
+            const auto range = getBandRange (band);
+            auto* edges = edgeRows.data() + (size_t) band * edgeSize;
+
+            for (int i = 0; i < numEdgeRows; ++i)
+            {
+                const auto virtualRow = i < numAbove ? range.getStart() - numAbove + i
+                                                     : range.getEnd() + i - numAbove;
+
+                std::memcpy (edges + (size_t) i * rowSize, data.getLinePointer (mapIndex (virtualRow, h, borderMode)), rowSize);
+            }
+        }
+    });
+
+    multithreadedForChunks<int> (0, numBands, threadPool, [&] (int startBand, int endBand)
+    {
+        auto workspace = takeWorkspace();
+        auto& ws = *workspace;
+
+        if (ws.window.size() < rowSize * (size_t) kernelHeight)    ws.window.resize (rowSize * (size_t) kernelHeight);
+        if (ws.source.size() < rowSize)                             ws.source.resize (rowSize);
+        if (ws.original.size() < rowSize)                           ws.original.resize (rowSize);
+        if (ws.result.size() < rowSize)                             ws.result.resize (rowSize);
+
+        for (int band = startBand; band < endBand; ++band)
+        {
+            const auto range = getBandRange (band);
+            const auto start = range.getStart();
+            const auto end = range.getEnd();
+            const auto firstVirtualRow = start - numAbove;
+            const auto* edges = edgeRows.data() + (size_t) band * edgeSize;
+
+            auto getWindowRow = [&] (int virtualRow)
+            {
+                return ws.window.data() + (size_t) ((virtualRow - firstVirtualRow) % kernelHeight) * rowSize;
+            };
+
+            // The rows within the band are read from the image, which is only ever written behind them:
+            auto loadRow = [&] (int virtualRow)
+            {
+                const uint8* line = nullptr;
+
+                if (virtualRow < start)         line = edges + (size_t) (virtualRow - firstVirtualRow) * rowSize;
+                else if (virtualRow >= end)     line = edges + (size_t) (numAbove + virtualRow - end) * rowSize;
+                else                            line = data.getLinePointer (virtualRow);
+
+                auto* dest = getWindowRow (virtualRow);
+                auto* source = kernel.separable ? ws.source.data() : dest;
+
+                for (size_t i = 0; i < rowSize; ++i)
+                    source[i] = (float) line[i];
+
+                if (kernel.separable)
+                    convolveRow (source, dest, w, numChannels, kernel.horizontal.data(), kernel.width, false);
+            };
+
+            for (int v = firstVirtualRow; v < firstVirtualRow + numEdgeRows; ++v)
+                loadRow (v);
+
+            for (int y = start; y < end; ++y)
+            {
+                loadRow (y + kernelHeight - 1 - numAbove);
+
+                auto* line = data.getLinePointer (y);
+                auto* original = ws.original.data();
+
+                for (size_t i = 0; i < rowSize; ++i)
+                    original[i] = (float) line[i];
+
+                if (! kernel.separable)
+                {
+                    auto* result = ws.result.data();
+
+                    for (int i = 0; i < kernelHeight; ++i)
+                        convolveRow (getWindowRow (y + i - numAbove), result, w, numChannels,
+                                     kernel.matrix.data() + (size_t) (i * kernel.width), kernel.width, i > 0);
+
+                    writePixels (line, result, original, w, numChannels, isARGB, kernel);
+                    continue;
+                }
+
+                // The vertical pass sums up a tile of the row at a time on the stack:
+                constexpr int pixelsPerTile = 64;
+                float sum[pixelsPerTile * maxChannels];
+
+                for (int x = 0; x < w; x += pixelsPerTile)
+                {
+                    const auto numPixels = std::min (pixelsPerTile, w - x);
+                    const auto numTileValues = numPixels * numChannels;
+                    const auto offset = (size_t) (x * numChannels);
+
+                    std::fill (sum, sum + numTileValues, 0.0f);
+
+                    for (int i = 0; i < kernelHeight; ++i)
+                    {
+                        const auto weight = kernel.vertical[(size_t) i];
+                        const auto* row = getWindowRow (y + i - numAbove) + offset;
+
+                        for (int j = 0; j < numTileValues; ++j)
+                            sum[j] += weight * row[j];
+                    }
+
+                    writePixels (line + offset, sum, original + offset, numPixels, numChannels, isARGB, kernel);
+                }
+            }
+        }
+
+        returnWorkspace (std::move (workspace));
+    });
+}
@@ -0,0 +1,182 @@
+/** A kernel for an ImageConvolver, which is either separable
+    (ie: a horizontal pass followed by a vertical one) or a full matrix.
+
+    Each channel of the result is the weighted sum of the channel's neighbourhood,
+    plus the source channel times the identity weight, plus the bias.
+
+    Kernels of any size can be used, where the anchor is the centre,
+    or just before the centre for even sizes.
+
+    @see ImageConvolver
+*/
+class ImageConvolutionKernel final
+{
+public:
+    //==============================================================================
+    /** Creates an empty kernel, which leaves an image as is. */
+    ImageConvolutionKernel() = default;
+
+    /** Creates a kernel from a full matrix of weights.
+
+        @param width    The number of columns.
+        @param height   The number of rows.
+        @param weights  The weights, row by row, which must be width * height long.
+    */
+    static ImageConvolutionKernel createMatrix (int width, int height, std::vector<float> weights);
+
+    /** Creates a separable kernel, which is far cheaper than an equivalent matrix
+        since it costs the sum of its sizes per pixel rather than their product.
+    */
+    static ImageConvolutionKernel createSeparable (std::vector<float> horizontal, std::vector<float> vertical);
+
+    //==============================================================================
+    /** Creates a box blur, which averages the square neighbourhood of a pixel. */
+    static ImageConvolutionKernel createBox (int radius);
+
+    /** Creates a Gaussian blur, where the standard deviation is a third of the radius. */
+    static ImageConvolutionKernel createGaussian (float radius);
+
+    /** Creates the 3x3 box blur used by applySoften. */
+    static ImageConvolutionKernel createSoften();
+
+    /** Creates the 3x3 Laplacian sharpening kernel used by applySharpen. */
+    static ImageConvolutionKernel createSharpen();
+
+    /** Creates an unsharp mask, which sharpens by adding the difference
+        between an image and its Gaussian blur.
+
+        @param radius   The radius of the blur.
+        @param amount   How much of the difference to add, where 0 leaves the image be.
+    */
+    static ImageConvolutionKernel createUnsharpMask (float radius, float amount);
+
+    /** Creates a kernel that makes an image look embossed, lit from the top left. */
+    static ImageConvolutionKernel createEmboss();
+
+    /** Creates a Laplacian edge detector, which leaves the edges bright and the rest black. */
+    static ImageConvolutionKernel createEdgeDetection();
+
+    //==============================================================================
+    /** @returns a copy of this kernel with a value added to each resulting channel, in the range of 0 to 255. */
+    [[nodiscard]] ImageConvolutionKernel withBias (float newBias) const;
+
+    /** @returns a copy of this kernel with the weight that the source pixel is added with. */
+    [[nodiscard]] ImageConvolutionKernel withIdentityWeight (float newIdentityWeight) const;
+
+    /** @returns a copy of this kernel that filters the alpha channel too, or leaves it as is.
+
+        Either way, the colour channels of premultiplied images are kept within the alpha.
+        By default, the blurs and sharpeners filter the alpha whereas the effects don't.
+    */
+    [[nodiscard]] ImageConvolutionKernel withAlphaFiltered (bool shouldFilterAlpha) const;
+
+    //==============================================================================
+    /** @returns true if this is a separable kernel. */
+    [[nodiscard]] bool isSeparable() const noexcept     { return separable; }
+
+    /** @returns the number of columns of the kernel. */
+    [[nodiscard]] int getWidth() const noexcept         { return width; }
+
+    /** @returns the number of rows of the kernel. */
+    [[nodiscard]] int getHeight() const noexcept        { return height; }
+
+    /** @returns true if the kernel has no weights. */
+    [[nodiscard]] bool isEmpty() const noexcept         { return width <= 0 || height <= 0; }
+
+private:
+    //==============================================================================
+    friend class ImageConvolver;
+
+    std::vector<float> horizontal, vertical, matrix;
+    int width = 0, height = 0;
+    bool separable = false;
+    float bias = 0.0f, identityWeight = 0.0f;
+    bool filtersAlpha = true;
+};
+
+//==============================================================================
+/** Convolves images with an ImageConvolutionKernel.
+
+    The image is filtered in floating point, straight on its premultiplied data,
+    with all of its channels treated alike (other than the alpha, as per the kernel),
+    so the edges of transparent areas don't pick up any stray colour.
+
+    The pixels near the edges are handled as per the border mode, whereas the rest
+    of each row runs through a path without any bounds checks that the compiler can vectorise.
+
+    The rows are split into bands, which are shared with the thread pool if one is given.
+    Each band only keeps a window of the kernel's height of rows in floating point,
+    rather than the whole image, along with copies of the rows just beyond its edges.
+
+    The convolver keeps hold of its scratch buffers, so reusing one for a series of images
+    of the same size avoids any further allocations. Only use a convolver on one thread at a time.
+
+    @see ImageConvolutionKernel, applySoften, applySharpen
+*/
+class ImageConvolver final
+{
+public:
+    //==============================================================================
+    /** How to treat the pixels beyond the edges of an image. */
+    enum class BorderMode
+    {
+        clamp,  // The edge pixels are repeated.
+        wrap,   // The image is tiled.
+        mirror  // The image is reflected, without repeating the edge pixels.
+    };
+
+    //==============================================================================
+    /** Constructor. */
+    ImageConvolver() = default;
+
+    //==============================================================================
+    /** Changes the border mode, which is clamp by default. */
+    void setBorderMode (BorderMode newMode) noexcept    { borderMode = newMode; }
+
+    /** @returns the current border mode. */
+    [[nodiscard]] BorderMode getBorderMode() const noexcept { return borderMode; }
+
+    //==============================================================================
+    /** Convolves an image in place, which may be ARGB, RGB or SingleChannel. */
+    void apply (Image&, const ImageConvolutionKernel&, ThreadPool* threadPool = nullptr);
+
+    /** Frees the scratch buffers. */
+    void releaseScratchBuffers();
+
+    //==============================================================================
+    /** @returns the index of a pixel, or a row, mapped into an image as per a border mode. */
+    [[nodiscard]] static int mapIndex (int index, int size, BorderMode) noexcept;
+
+private:
+    //==============================================================================
+    BorderMode borderMode = BorderMode::clamp;
+
+    /** What a band works in, which is handed to each band that runs at the same time. */
+    struct Workspace final
+    {
+        std::vector<float> window;      // [kernel row][row], the horizontal results or the source rows for a matrix.
+        std::vector<float> source, original, result;
+    };
+
+    // NB: The bands overwrite the image as they go, so the rows beyond each band's edges
+    //     are copied up front. These are laid out as [band][kernel height - 1][row].
+    std::vector<uint8> edgeRows;
+    std::vector<std::unique_ptr<Workspace>> workspaces; // The ones that aren't in use.
+    SpinLock workspaceLock;
+
+    //==============================================================================
+    static constexpr int maxChannels = 4;
+    static constexpr int minRowsPerBand = 8;
+
+    std::unique_ptr<Workspace> takeWorkspace();
+    void returnWorkspace (std::unique_ptr<Workspace>);
+
+    void convolveRow (const float* source, float* destination, int numPixels, int numChannels,
+                      const float* weights, int numWeights, bool accumulate) const noexcept;
+
+    static void writePixels (uint8* destination, const float* filtered, const float* original,
+                             int numPixels, int numChannels, bool isARGB,
+                             const ImageConvolutionKernel&) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ImageConvolver)
+};
@@ -14,12 +14,35 @@ void applySepia (Image&, ThreadPool* threadPool = nullptr);
 /** Converts image to B/W, heavier weighting towards greens */
 void applyGreyScale (Image&, ThreadPool* threadPool = nullptr);
 
-/** Softens an image */
+/** Softens an image with a 3x3 box blur.
+
+    @see ImageConvolver, ImageConvolutionKernel::createSoften
+*/
 void applySoften (Image&, ThreadPool* threadPool = nullptr);
 
-/** Sharpens an image */
+/** Sharpens an image with a 3x3 Laplacian kernel.
+
+    @see ImageConvolver, ImageConvolutionKernel::createSharpen
+*/
 void applySharpen (Image&, ThreadPool* threadPool = nullptr);
 
+/** Sharpens an image by adding the difference between it and its Gaussian blur.
+
+    @param img
+    @param radius       The radius of the blur, in pixels.
+    @param amount       How much of the difference to add. 0 leaves the image be.
+    @param threadPool
+
+    @see ImageConvolver, ImageConvolutionKernel::createUnsharpMask
+*/
+void applyUnsharpMask (Image&, float radius, float amount, ThreadPool* threadPool = nullptr);
+
+/** Makes an image look embossed, leaving its alpha be. */
+void applyEmboss (Image&, ThreadPool* threadPool = nullptr);
+
+/** Leaves the edges of an image bright and the rest black, leaving its alpha be. */
+void applyEdgeDetection (Image&, ThreadPool* threadPool = nullptr);
+
 /** */
 void applyGamma (Image&, float gamma, ThreadPool* threadPool = nullptr);
 
@@ -58,10 +81,15 @@ void applyHueSaturationLightness (Image&, float hue, float saturation, float lig
     It creates much better looking blurs than Box Blur, but is 7x faster than some Gaussian Blur
     implementations.
 
+    The blur is done in place, on premultiplied ARGB, RGB or SingleChannel images,
+    with the rows and then the bands of columns shared with the thread pool.
+
     @param image
-    @param radius From 2 to 254.
+    @param radius       From 2 upwards. Radii above 254 are made up of several smaller passes,
+                        which approximate the larger radius.
+    @param threadPool
 */
-void applyStackBlur (Image&, int radius);
+void applyStackBlur (Image&, int radius, ThreadPool* threadPool = nullptr);
 
 //==============================================================================
 /** GradientMap a image.
@@ -77,6 +105,128 @@ void applyGradientMap (Image&, Colour c1, Colour c2, ThreadPool* threadPool = nu
 /** Set an image to a solid colour. */
 void applyColour (Image&, Colour, ThreadPool* threadPool = nullptr);
 
+//==============================================================================
+/** An ordered list of image effects, which runs as few passes over an image as it can.
+
+    Each run of per-pixel effects (eg: a vignette, then a brightness/contrast, then a gradient map)
+    is fused into a single pass, where every effect is applied to a tile of a row before
+    moving on to the next tile, so the pixels stay in the cache between effects.
+    The neighbourhood effects (ie: the convolutions and blurs) need the whole image as it was,
+    so these are run as passes of their own, and split the fused passes up.
+
+    The lookup tables and the likes are built when the effects are added, and the kernels
+    for an image's format and size are built on the first run. Running the pipeline again on
+    an image of the same format and size reuses them all, including the convolution buffers,
+    so a pipeline is worth keeping around for effects that are applied over and over.
+
+    @code
+        ImageEffectPipeline pipeline;
+        pipeline.addVignette (0.5f, 0.9f, 0.5f)
+                .addBrightnessContrast (10.0f, 20.0f)
+                .addGradientMap (ColourGradient (Colours::black, {}, Colours::orange, {}, false));
+
+        pipeline.apply (image, &threadPool);
+    @endcode
+
+    Only run a pipeline on one thread at a time.
+
+    @see applyVignette, applyBrightnessContrast, applyGradientMap, ImageConvolver
+*/
+class ImageEffectPipeline final
+{
+public:
+    //==============================================================================
+    /** Constructor. */
+    ImageEffectPipeline() = default;
+
+    //==============================================================================
+    /** @see applyVignette */
+    ImageEffectPipeline& addVignette (float amount, float radius, float falloff);
+    /** @see applySepia */
+    ImageEffectPipeline& addSepia();
+    /** @see applyGreyScale */
+    ImageEffectPipeline& addGreyScale();
+    /** @see applyGamma */
+    ImageEffectPipeline& addGamma (float gamma);
+    /** @see applyInvert */
+    ImageEffectPipeline& addInvert();
+    /** @see applyContrast */
+    ImageEffectPipeline& addContrast (float contrast);
+    /** @see applyBrightnessContrast */
+    ImageEffectPipeline& addBrightnessContrast (float brightness, float contrast);
+    /** @see applyHueSaturationLightness */
+    ImageEffectPipeline& addHueSaturationLightness (float hue, float saturation, float lightness);
+    /** @see applyGradientMap */
+    ImageEffectPipeline& addGradientMap (const ColourGradient&);
+    /** @see applyColour */
+    ImageEffectPipeline& addColour (Colour);
+
+    //==============================================================================
+    /** Adds a convolution, which is run as a pass of its own. */
+    ImageEffectPipeline& addConvolution (const ImageConvolutionKernel&,
+                                         ImageConvolver::BorderMode borderMode = ImageConvolver::BorderMode::clamp);
+    /** @see applySoften */
+    ImageEffectPipeline& addSoften();
+    /** @see applySharpen */
+    ImageEffectPipeline& addSharpen();
+    /** @see applyStackBlur */
+    ImageEffectPipeline& addStackBlur (int radius);
+
+    //==============================================================================
+    /** Removes all of the effects. */
+    void clear();
+
+    /** @returns the number of effects. */
+    [[nodiscard]] int getNumEffects() const noexcept { return (int) stages.size(); }
+
+    /** @returns the number of passes over the image that a run takes, once the effects are fused. */
+    [[nodiscard]] int getNumPasses() const noexcept;
+
+    //==============================================================================
+    /** Applies the effects, in order, to an image in place. */
+    void apply (Image&, ThreadPool* threadPool = nullptr);
+
+private:
+    //==============================================================================
+    /** Processes a run of pixels in place, as (uint8* pixels, int x, int y, int numPixels),
+        where (x, y) is the position of the first pixel.
+    */
+    using PixelKernel = std::function<void (uint8*, int, int, int)>;
+
+    struct Stage final
+    {
+        /** Creates the kernel for an image format, pixel stride and size, for per-pixel effects. */
+        std::function<PixelKernel (Image::PixelFormat, int pixelStride, int width, int height)> createKernel;
+
+        /** Runs a neighbourhood effect over a whole image. */
+        std::function<void (Image&, ThreadPool*, ImageConvolver&)> applyToImage;
+    };
+
+    /** A fused run of per-pixel kernels, or a single neighbourhood effect. */
+    struct Pass final
+    {
+        std::vector<PixelKernel> kernels;
+        int neighbourhoodStage = -1;
+    };
+
+    std::vector<Stage> stages;
+    std::vector<Pass> passes;
+    ImageConvolver convolver;
+
+    // The format and size that the passes were last prepared for:
+    Image::PixelFormat preparedFormat = Image::UnknownFormat;
+    int preparedWidth = 0, preparedHeight = 0;
+
+    //==============================================================================
+    ImageEffectPipeline& addPixelStage (std::function<PixelKernel (Image::PixelFormat, int, int, int)>);
+    ImageEffectPipeline& addNeighbourhoodStage (std::function<void (Image&, ThreadPool*, ImageConvolver&)>);
+    void prepare (Image::PixelFormat, int pixelStride, int width, int height);
+    void applyFused (Image&, const std::vector<PixelKernel>&, ThreadPool*) const;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ImageEffectPipeline)
+};
+
 //==============================================================================
 /** Blending modes for applyBlend */
 enum class BlendMode
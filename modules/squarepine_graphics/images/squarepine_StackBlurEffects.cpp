@@ -39,658 +39,291 @@ static const int stackblur_shr[255] =
     24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
     24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24
 };
+//==============================================================================
+/** The four channels of a stack entry, or of one of the sums, side by side in 32-bit lanes.
 
-inline void applyStackBlurBW (Image& img, uint32 radius)
-{
-    const auto w = (uint32)img.getWidth();
-    const auto h = (uint32)img.getHeight();
-
-    Image::BitmapData data (img, Image::BitmapData::readWrite);
-
-    radius = jlimit (2u, 254u, radius);
-
-    uint8 stack[(254 * 2 + 1) * 1];
-
-    uint32 x, y, xp, yp, i, sp, stack_start;
-
-    uint8* stack_ptr = nullptr;
-    uint8* src_ptr = nullptr;
-    uint8* dst_ptr = nullptr;
+    The sums always fit: the multipliers above are picked so that even a sum at
+    the largest radius, times its multiplier, stays within 32 bits.
 
-    unsigned long sum, sum_in, sum_out;
-
-    auto wm = w - 1;
-    auto hm = h - 1;
-    auto w1 = (uint32) data.lineStride;
-    auto div = (uint32) (radius * 2) + 1;
-    auto mul_sum = stackblur_mul[radius];
-    auto shr_sum = stackblur_shr[radius];
+    This is the scalar version, which every platform has, and which the SIMD ones must match exactly.
+*/
+struct ScalarStackBlurLanes final
+{
+    std::array<uint32, 4> v {};
 
-    for (y = 0; y < h; ++y)
+    template<int numChannels>
+    static ScalarStackBlurLanes load (const uint8* p) noexcept
     {
-        sum = sum_in = sum_out = 0;
+        ScalarStackBlurLanes l;
 
-        src_ptr = data.getLinePointer (int (y));
-
-        for (i = 0; i <= radius; ++i)
-        {
-            stack_ptr    = &stack[i];
-            stack_ptr[0] = src_ptr[0];
-            sum += src_ptr[0] * (i + 1);
-            sum_out += src_ptr[0];
-        }
+        for (int c = 0; c < numChannels; ++c)
+            l.v[(size_t) c] = p[c];
 
-        for (i = 1; i <= radius; ++i)
-        {
-            if (i <= wm)
-                src_ptr += 1;
-
-            stack_ptr = &stack[1 * (i + radius)];
-            stack_ptr[0] = src_ptr[0];
-            sum += src_ptr[0] * (radius + 1 - i);
-            sum_in += src_ptr[0];
-        }
-
-        sp = radius;
-        xp = radius;
-        if (xp > wm)
-            xp = wm;
-
-        src_ptr = data.getLinePointer (int (y)) + (uint32)data.pixelStride * xp;
-        dst_ptr = data.getLinePointer (int (y));
-
-        for (x = 0; x < w; ++x)
-        {
-            dst_ptr[0] = (uint8)((sum * mul_sum) >> shr_sum);
-            dst_ptr += 1;
-
-            sum -= sum_out;
-
-            stack_start = sp + div - radius;
+        return l;
+    }
 
-            if (stack_start >= div)
-                stack_start -= div;
+    template<int numChannels>
+    void store (uint8* p, uint32 mul, uint32 shr) const noexcept
+    {
+        for (int c = 0; c < numChannels; ++c)
+            p[c] = (uint8) (((uint64) v[(size_t) c] * mul) >> shr);
+    }
 
-            stack_ptr = &stack[1 * stack_start];
+    /** @returns the lanes times a weight, where both the lanes and the weight are below 256. */
+    ScalarStackBlurLanes weighted (uint32 weight) const noexcept
+    {
+        auto l = *this;
 
-            sum_out -= stack_ptr[0];
+        for (auto& x : l.v)
+            x *= weight;
 
-            if (xp < wm)
-            {
-                src_ptr += 1;
-                ++xp;
-            }
+        return l;
+    }
 
-            stack_ptr[0] = src_ptr[0];
+    void operator+= (ScalarStackBlurLanes other) noexcept { for (size_t i = 0; i < 4; ++i) v[i] += other.v[i]; }
+    void operator-= (ScalarStackBlurLanes other) noexcept { for (size_t i = 0; i < 4; ++i) v[i] -= other.v[i]; }
+};
 
-            sum_in += src_ptr[0];
-            sum    += sum_in;
+#if SQUAREPINE_PIXEL_KERNELS_SSE2 || SQUAREPINE_PIXEL_KERNELS_NEON
 
-            ++sp;
-            if (sp >= div)
-                sp = 0;
+/** The same as the ScalarStackBlurLanes, only with all four lanes done at once. */
+struct SIMDStackBlurLanes final
+{
+   #if SQUAREPINE_PIXEL_KERNELS_SSE2
+    __m128i v = _mm_setzero_si128();
 
-            stack_ptr = &stack[sp*1];
+    template<int numChannels>
+    static SIMDStackBlurLanes load (const uint8* p) noexcept
+    {
+        int packed = 0;
+        std::memcpy (&packed, p, (size_t) numChannels);
 
-            sum_out += stack_ptr[0];
-            sum_in  -= stack_ptr[0];
-        }
+        const auto zero = _mm_setzero_si128();
+        return { _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (packed), zero), zero) };
     }
 
-    for (x = 0; x < w; ++x)
+    template<int numChannels>
+    void store (uint8* p, uint32 mul, uint32 shr) const noexcept
     {
-        sum = sum_in = sum_out = 0;
+        // NB: The products need more than 32 bits, so the even and odd lanes are done as 64-bit values.
+        const auto multiplier = _mm_set1_epi32 ((int) mul);
+        const auto shift = _mm_cvtsi32_si128 ((int) shr);
+        const auto even = _mm_srl_epi64 (_mm_mul_epu32 (v, multiplier), shift);
+        const auto odd = _mm_srl_epi64 (_mm_mul_epu32 (_mm_srli_epi64 (v, 32), multiplier), shift);
+        const auto result = _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (3, 1, 2, 0)),
+                                                _mm_shuffle_epi32 (odd, _MM_SHUFFLE (3, 1, 2, 0)));
+
+        const auto words = _mm_packs_epi32 (result, result);
+        const auto packed = _mm_cvtsi128_si32 (_mm_packus_epi16 (words, words));
+        std::memcpy (p, &packed, (size_t) numChannels);
+    }
 
-        src_ptr = data.getLinePointer (0) + (uint32)data.pixelStride * x;
+    /** @returns the lanes times a weight, where both the lanes and the weight are below 256. */
+    SIMDStackBlurLanes weighted (uint32 weight) const noexcept  { return { _mm_madd_epi16 (v, _mm_set1_epi32 ((int) weight)) }; }
 
-        for (i = 0; i <= radius; ++i)
-        {
-            stack_ptr    = &stack[i * 1];
-            stack_ptr[0] = src_ptr[0];
-            sum           += src_ptr[0] * (i + 1);
-            sum_out       += src_ptr[0];
-        }
+    void operator+= (SIMDStackBlurLanes other) noexcept         { v = _mm_add_epi32 (v, other.v); }
+    void operator-= (SIMDStackBlurLanes other) noexcept         { v = _mm_sub_epi32 (v, other.v); }
 
-        for (i = 1; i <= radius; ++i)
-        {
-            if (i <= hm)
-                src_ptr += w1;
+   #elif SQUAREPINE_PIXEL_KERNELS_NEON
+    uint32x4_t v = vdupq_n_u32 (0);
 
-            stack_ptr = &stack[1 * (i + radius)];
-            stack_ptr[0] = src_ptr[0];
-            sum += src_ptr[0] * (radius + 1 - i);
-            sum_in += src_ptr[0];
-        }
-
-        sp = radius;
-        yp = radius;
-        if (yp > hm)
-            yp = hm;
-
-        src_ptr = data.getLinePointer (int (yp)) + (uint32)data.pixelStride * x;
-        dst_ptr = data.getLinePointer (0) + (uint32)data.pixelStride * x;
+    template<int numChannels>
+    static SIMDStackBlurLanes load (const uint8* p) noexcept
+    {
+        uint32 packed = 0;
+        std::memcpy (&packed, p, (size_t) numChannels);
+        return { vmovl_u16 (vget_low_u16 (vmovl_u8 (vreinterpret_u8_u32 (vdup_n_u32 (packed))))) };
+    }
 
-        for (y = 0; y < h; ++y)
-        {
-            dst_ptr[0] = (uint8)((sum * mul_sum) >> shr_sum);
-            dst_ptr += w1;
+    template<int numChannels>
+    void store (uint8* p, uint32 mul, uint32 shr) const noexcept
+    {
+        // NB: The products need more than 32 bits, so they're done as 64-bit values.
+        const auto shift = vdupq_n_s64 (-(int64) shr);
+        const auto lo = vshlq_u64 (vmull_n_u32 (vget_low_u32 (v), mul), shift);
+        const auto hi = vshlq_u64 (vmull_n_u32 (vget_high_u32 (v), mul), shift);
+        const auto result = vcombine_u32 (vmovn_u64 (lo), vmovn_u64 (hi));
+        const auto bytes = vmovn_u16 (vcombine_u16 (vmovn_u32 (result), vmovn_u32 (result)));
+
+        const auto packed = vget_lane_u32 (vreinterpret_u32_u8 (bytes), 0);
+        std::memcpy (p, &packed, (size_t) numChannels);
+    }
 
-            sum -= sum_out;
+    /** @returns the lanes times a weight, where both the lanes and the weight are below 256. */
+    SIMDStackBlurLanes weighted (uint32 weight) const noexcept  { return { vmulq_n_u32 (v, weight) }; }
 
-            stack_start = sp + div - radius;
-            if (stack_start >= div)
-                stack_start -= div;
+    void operator+= (SIMDStackBlurLanes other) noexcept         { v = vaddq_u32 (v, other.v); }
+    void operator-= (SIMDStackBlurLanes other) noexcept         { v = vsubq_u32 (v, other.v); }
 
-            stack_ptr = &stack[1 * stack_start];
+   #endif
+};
 
-            sum_out -= stack_ptr[0];
+using StackBlurLanes = SIMDStackBlurLanes;
 
-            if (yp < hm)
-            {
-                src_ptr += w1;
-                ++yp;
-            }
+#else
 
-            stack_ptr[0] = src_ptr[0];
+using StackBlurLanes = ScalarStackBlurLanes;
 
-            sum_in += src_ptr[0];
-            sum    += sum_in;
+#endif
 
-            ++sp;
-            if (sp >= div)
-                sp = 0;
+//==============================================================================
+/** Blurs a band of lines along one direction, in place, stepping through all of the lines together.
 
-            stack_ptr = &stack[sp * 1];
+    For the horizontal pass, a band is a single row. For the vertical pass, it's a run of
+    neighbouring columns, which means each step reads a contiguous stretch of a row rather than
+    striding down a single column, and so the vertical pass is as cache friendly as the horizontal one.
 
-            sum_out += stack_ptr[0];
-            sum_in  -= stack_ptr[0];
-        }
-    }
-}
-
-inline void applyStackBlurRGB (Image& img, uint32 radius)
+    @param base         The first pixel of the first line.
+    @param length       The number of pixels along each line.
+    @param step         The number of bytes between neighbouring pixels along a line.
+    @param numLines     The number of lines in the band.
+    @param lineStep     The number of bytes between the same pixel of neighbouring lines.
+    @param stack        The scratch space for the stacks, which must fit (radius * 2 + 1) * numLines entries.
+*/
+template<int numChannels, typename Lanes>
+void stackBlurBand (uint8* base, int length, size_t step, int numLines, size_t lineStep,
+                    uint32 radius, Lanes* stack) noexcept
 {
-    const auto w = (uint32)img.getWidth();
-    const auto h = (uint32)img.getHeight();
-
-    Image::BitmapData data (img, Image::BitmapData::readWrite);
-
-    radius = jlimit (2u, 254u, radius);
-
-    uint8 stack[(254 * 2 + 1) * 3];
-
-    uint32 x, y, xp, yp, i, sp, stack_start;
+    jassert (numLines <= 64);
 
-    uint8* stack_ptr = nullptr;
-    uint8* src_ptr = nullptr;
-    uint8* dst_ptr = nullptr;
+    const auto lines = (size_t) numLines;
+    const auto wm = (uint32) length - 1;
+    const auto div = radius * 2 + 1;
+    const auto mulSum = (uint32) stackblur_mul[radius];
+    const auto shrSum = (uint32) stackblur_shr[radius];
 
-    unsigned long sum_r, sum_g, sum_b, sum_in_r, sum_in_g, sum_in_b,
-                  sum_out_r, sum_out_g, sum_out_b;
+    Lanes sum[64], sumIn[64], sumOut[64];
 
-    auto wm = w - 1;
-    auto hm = h - 1;
-    auto w3 = (uint32) data.lineStride;
-    auto div = (uint32)(radius * 2) + 1;
-    auto mul_sum = stackblur_mul[radius];
-    auto shr_sum = stackblur_shr[radius];
+    auto pixel = [&] (uint32 index, size_t line) { return base + index * step + line * lineStep; };
 
-    for (y = 0; y < h; ++y)
+    for (size_t l = 0; l < lines; ++l)
     {
-        sum_r = sum_g = sum_b =
-        sum_in_r = sum_in_g = sum_in_b =
-        sum_out_r = sum_out_g = sum_out_b = 0;
+        sum[l] = sumIn[l] = sumOut[l] = {};
 
-        src_ptr = data.getLinePointer (int (y));
+        const auto first = Lanes::template load<numChannels> (pixel (0, l));
 
-        for (i = 0; i <= radius; ++i)
+        for (uint32 i = 0; i <= radius; ++i)
         {
-            stack_ptr    = &stack[3 * i];
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            sum_r += src_ptr[0] * (i + 1);
-            sum_g += src_ptr[1] * (i + 1);
-            sum_b += src_ptr[2] * (i + 1);
-            sum_out_r += src_ptr[0];
-            sum_out_g += src_ptr[1];
-            sum_out_b += src_ptr[2];
+            stack[i * lines + l] = first;
+            sum[l] += first.weighted (i + 1);
+            sumOut[l] += first;
         }
 
-        for (i = 1; i <= radius; ++i)
+        for (uint32 i = 1; i <= radius; ++i)
         {
-            if (i <= wm)
-                src_ptr += 3;
-
-            stack_ptr = &stack[3 * (i + radius)];
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            sum_r += src_ptr[0] * (radius + 1 - i);
-            sum_g += src_ptr[1] * (radius + 1 - i);
-            sum_b += src_ptr[2] * (radius + 1 - i);
-            sum_in_r += src_ptr[0];
-            sum_in_g += src_ptr[1];
-            sum_in_b += src_ptr[2];
-        }
-
-        sp = radius;
-        xp = radius;
-        if (xp > wm)
-            xp = wm;
-
-        src_ptr = data.getLinePointer (int (y)) + (uint32)data.pixelStride * xp;
-        dst_ptr = data.getLinePointer (int (y));
-
-        for (x = 0; x < w; ++x)
-        {
-            dst_ptr[0] = (uint8)((sum_r * mul_sum) >> shr_sum);
-            dst_ptr[1] = (uint8)((sum_g * mul_sum) >> shr_sum);
-            dst_ptr[2] = (uint8)((sum_b * mul_sum) >> shr_sum);
-            dst_ptr += 3;
-
-            sum_r -= sum_out_r;
-            sum_g -= sum_out_g;
-            sum_b -= sum_out_b;
-
-            stack_start = sp + div - radius;
-
-            if (stack_start >= div)
-                stack_start -= div;
-
-            stack_ptr = &stack[3 * stack_start];
-
-            sum_out_r -= stack_ptr[0];
-            sum_out_g -= stack_ptr[1];
-            sum_out_b -= stack_ptr[2];
-
-            if (xp < wm)
-            {
-                src_ptr += 3;
-                ++xp;
-            }
-
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-
-            sum_in_r += src_ptr[0];
-            sum_in_g += src_ptr[1];
-            sum_in_b += src_ptr[2];
-            sum_r    += sum_in_r;
-            sum_g    += sum_in_g;
-            sum_b    += sum_in_b;
-
-            ++sp;
-            if (sp >= div)
-                sp = 0;
-
-            stack_ptr = &stack[sp*3];
-
-            sum_out_r += stack_ptr[0];
-            sum_out_g += stack_ptr[1];
-            sum_out_b += stack_ptr[2];
-            sum_in_r  -= stack_ptr[0];
-            sum_in_g  -= stack_ptr[1];
-            sum_in_b  -= stack_ptr[2];
+            const auto p = Lanes::template load<numChannels> (pixel (std::min (i, wm), l));
+            stack[(i + radius) * lines + l] = p;
+            sum[l] += p.weighted (radius + 1 - i);
+            sumIn[l] += p;
         }
     }
 
-    for (x = 0; x < w; ++x)
+    auto sp = radius;
+    auto xp = std::min (radius, wm);
+
+    for (uint32 x = 0; x <= wm; ++x)
     {
-        sum_r =    sum_g =    sum_b =
-        sum_in_r = sum_in_g = sum_in_b =
-        sum_out_r = sum_out_g = sum_out_b = 0;
+        auto stackStart = sp + div - radius;
+        if (stackStart >= div)
+            stackStart -= div;
 
-        src_ptr = data.getLinePointer (0) + (uint32)data.pixelStride * x;
+        if (xp < wm)
+            ++xp;
 
-        for (i = 0; i <= radius; ++i)
-        {
-            stack_ptr    = &stack[i * 3];
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            sum_r           += src_ptr[0] * (i + 1);
-            sum_g           += src_ptr[1] * (i + 1);
-            sum_b           += src_ptr[2] * (i + 1);
-            sum_out_r       += src_ptr[0];
-            sum_out_g       += src_ptr[1];
-            sum_out_b       += src_ptr[2];
-        }
+        if (++sp >= div)
+            sp = 0;
+
+        auto* outgoing = stack + stackStart * lines;
+        const auto* next = stack + sp * lines;
 
-        for (i = 1; i <= radius; ++i)
+        // NB: The pixel read in can only ever be the one just written out when it's the last one,
+        //     at which point it's never used, so the blur can happily run in place.
+        for (size_t l = 0; l < lines; ++l)
         {
-            if (i <= hm)
-                src_ptr += w3;
-
-            stack_ptr = &stack[3 * (i + radius)];
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            sum_r += src_ptr[0] * (radius + 1 - i);
-            sum_g += src_ptr[1] * (radius + 1 - i);
-            sum_b += src_ptr[2] * (radius + 1 - i);
-            sum_in_r += src_ptr[0];
-            sum_in_g += src_ptr[1];
-            sum_in_b += src_ptr[2];
-        }
+            sum[l].template store<numChannels> (pixel (x, l), mulSum, shrSum);
 
-        sp = radius;
-        yp = radius;
-        if (yp > hm)
-            yp = hm;
+            sum[l] -= sumOut[l];
+            sumOut[l] -= outgoing[l];
 
-        src_ptr = data.getLinePointer (int (yp)) + (uint32)data.pixelStride * x;
-        dst_ptr = data.getLinePointer (0) + (uint32)data.pixelStride * x;
+            outgoing[l] = Lanes::template load<numChannels> (pixel (xp, l));
+            sumIn[l] += outgoing[l];
+            sum[l] += sumIn[l];
 
-        for (y = 0; y < h; ++y)
-        {
-            dst_ptr[0] = (uint8)((sum_r * mul_sum) >> shr_sum);
-            dst_ptr[1] = (uint8)((sum_g * mul_sum) >> shr_sum);
-            dst_ptr[2] = (uint8)((sum_b * mul_sum) >> shr_sum);
-            dst_ptr += w3;
-
-            sum_r -= sum_out_r;
-            sum_g -= sum_out_g;
-            sum_b -= sum_out_b;
-
-            stack_start = sp + div - radius;
-            if (stack_start >= div)
-                stack_start -= div;
-
-            stack_ptr = &stack[3 * stack_start];
-
-            sum_out_r -= stack_ptr[0];
-            sum_out_g -= stack_ptr[1];
-            sum_out_b -= stack_ptr[2];
-
-            if (yp < hm)
-            {
-                src_ptr += w3;
-                ++yp;
-            }
-
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-
-            sum_in_r += src_ptr[0];
-            sum_in_g += src_ptr[1];
-            sum_in_b += src_ptr[2];
-            sum_r    += sum_in_r;
-            sum_g    += sum_in_g;
-            sum_b    += sum_in_b;
-
-            ++sp;
-            if (sp >= div)
-                sp = 0;
-
-            stack_ptr = &stack[sp * 3];
-
-            sum_out_r += stack_ptr[0];
-            sum_out_g += stack_ptr[1];
-            sum_out_b += stack_ptr[2];
-            sum_in_r  -= stack_ptr[0];
-            sum_in_g  -= stack_ptr[1];
-            sum_in_b  -= stack_ptr[2];
+            sumOut[l] += next[l];
+            sumIn[l] -= next[l];
         }
     }
 }
 
-inline void applyStackBlurARGB (Image& img, uint32 radius)
+template<int numChannels, typename Lanes>
+void applyStackBlurPass (Image::BitmapData& data, uint32 radius, ThreadPool* threadPool)
 {
-    const auto w = (uint32)img.getWidth();
-    const auto h = (uint32)img.getHeight();
-
-    Image::BitmapData data (img, Image::BitmapData::readWrite);
+    const auto w = data.width;
+    const auto h = data.height;
+    const auto pixelStride = (size_t) data.pixelStride;
+    const auto lineStride = (size_t) data.lineStride;
+    const auto stackSize = (size_t) (radius * 2 + 1);
 
-    radius = jlimit (2u, 254u, radius);
-
-    uint8 stack[(254 * 2 + 1) * 4];
-
-    uint32 x, y, xp, yp, i, sp, stack_start;
-
-    uint8* stack_ptr = nullptr;
-    uint8* src_ptr = nullptr;
-    uint8* dst_ptr = nullptr;
+    multithreadedForChunks<int> (0, h, threadPool, [&] (int startRow, int endRow)
+    {
+        std::vector<Lanes> stack (stackSize);
 
-    unsigned long sum_r, sum_g, sum_b, sum_a, sum_in_r, sum_in_g, sum_in_b, sum_in_a,
-    sum_out_r, sum_out_g, sum_out_b, sum_out_a;
+        for (int y = startRow; y < endRow; ++y)
+            stackBlurBand<numChannels, Lanes> (data.getLinePointer (y), w, pixelStride, 1, lineStride, radius, stack.data());
+    });
 
-    auto wm = w - 1;
-    auto hm = h - 1;
-    auto w4 = (uint32) data.lineStride;
-    auto div = (uint32)(radius * 2) + 1;
-    auto mul_sum = stackblur_mul[radius];
-    auto shr_sum = stackblur_shr[radius];
+    // The columns are done in bands of 16, which is a cache line's worth of ARGB pixels per row:
+    constexpr int bandSize = 16;
 
-    for (y = 0; y < h; ++y)
+    multithreadedForChunks<int> (0, w, threadPool, [&] (int startColumn, int endColumn)
     {
-        sum_r = sum_g = sum_b = sum_a =
-        sum_in_r = sum_in_g = sum_in_b = sum_in_a =
-        sum_out_r = sum_out_g = sum_out_b = sum_out_a = 0;
-
-        src_ptr = data.getLinePointer (int (y));
+        std::vector<Lanes> stack (stackSize * (size_t) bandSize);
 
-        for (i = 0; i <= radius; ++i)
-        {
-            stack_ptr    = &stack[4 * i];
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            stack_ptr[3] = src_ptr[3];
-            sum_r += src_ptr[0] * (i + 1);
-            sum_g += src_ptr[1] * (i + 1);
-            sum_b += src_ptr[2] * (i + 1);
-            sum_a += src_ptr[3] * (i + 1);
-            sum_out_r += src_ptr[0];
-            sum_out_g += src_ptr[1];
-            sum_out_b += src_ptr[2];
-            sum_out_a += src_ptr[3];
-        }
+        for (int x = startColumn; x < endColumn; x += bandSize)
+            stackBlurBand<numChannels, Lanes> (data.getPixelPointer (x, 0), h, lineStride,
+                                               std::min (bandSize, endColumn - x), pixelStride,
+                                               radius, stack.data());
+    }, bandSize);
+}
 
-        for (i = 1; i <= radius; ++i)
-        {
-            if (i <= wm)
-                src_ptr += 4;
-
-            stack_ptr = &stack[4 * (i + radius)];
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            stack_ptr[3] = src_ptr[3];
-            sum_r += src_ptr[0] * (radius + 1 - i);
-            sum_g += src_ptr[1] * (radius + 1 - i);
-            sum_b += src_ptr[2] * (radius + 1 - i);
-            sum_a += src_ptr[3] * (radius + 1 - i);
-            sum_in_r += src_ptr[0];
-            sum_in_g += src_ptr[1];
-            sum_in_b += src_ptr[2];
-            sum_in_a += src_ptr[3];
-        }
+/** Stack blurs an image with the given lanes, which the unit tests use to compare the SIMD and scalar ones. */
+template<typename Lanes>
+void applyStackBlurWithLanes (Image& image, int radius, ThreadPool* threadPool)
+{
+    const auto w = image.getWidth();
+    const auto h = image.getHeight();
 
-        sp = radius;
-        xp = radius;
-        if (xp > wm)
-            xp = wm;
+    if (w <= 0 || h <= 0)
+        return;
 
-        src_ptr = data.getLinePointer (int (y)) + (uint32)data.pixelStride * xp;
-        dst_ptr = data.getLinePointer (int (y));
+    threadPool = (w >= 256 || h >= 256) ? threadPool : nullptr;
+    radius = std::max (radius, 2);
 
-        for (x = 0; x < w; ++x)
-        {
-            dst_ptr[0] = (uint8)((sum_r * mul_sum) >> shr_sum);
-            dst_ptr[1] = (uint8)((sum_g * mul_sum) >> shr_sum);
-            dst_ptr[2] = (uint8)((sum_b * mul_sum) >> shr_sum);
-            dst_ptr[3] = (uint8)((sum_a * mul_sum) >> shr_sum);
-            dst_ptr += 4;
-
-            sum_r -= sum_out_r;
-            sum_g -= sum_out_g;
-            sum_b -= sum_out_b;
-            sum_a -= sum_out_a;
-
-            stack_start = sp + div - radius;
-
-            if (stack_start >= div)
-                stack_start -= div;
-
-            stack_ptr = &stack[4 * stack_start];
-
-            sum_out_r -= stack_ptr[0];
-            sum_out_g -= stack_ptr[1];
-            sum_out_b -= stack_ptr[2];
-            sum_out_a -= stack_ptr[3];
-
-            if (xp < wm)
-            {
-                src_ptr += 4;
-                ++xp;
-            }
-
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            stack_ptr[3] = src_ptr[3];
-
-            sum_in_r += src_ptr[0];
-            sum_in_g += src_ptr[1];
-            sum_in_b += src_ptr[2];
-            sum_in_a += src_ptr[3];
-            sum_r    += sum_in_r;
-            sum_g    += sum_in_g;
-            sum_b    += sum_in_b;
-            sum_a    += sum_in_a;
-
-            ++sp;
-            if (sp >= div)
-                sp = 0;
-
-            stack_ptr = &stack[sp*4];
-
-            sum_out_r += stack_ptr[0];
-            sum_out_g += stack_ptr[1];
-            sum_out_b += stack_ptr[2];
-            sum_out_a += stack_ptr[3];
-            sum_in_r  -= stack_ptr[0];
-            sum_in_g  -= stack_ptr[1];
-            sum_in_b  -= stack_ptr[2];
-            sum_in_a  -= stack_ptr[3];
-        }
-    }
+    // A stack blur's kernel is a triangle with a variance of about (radius + 1)^2 / 6, and the variances
+    // of repeated blurs add up, so the radii beyond the tables are made up of several smaller passes:
+    int numPasses = 1;
+    auto passRadius = radius;
 
-    for (x = 0; x < w; ++x)
+    if (radius > 254)
     {
-        sum_r =    sum_g =    sum_b =    sum_a =
-        sum_in_r = sum_in_g = sum_in_b = sum_in_a =
-        sum_out_r = sum_out_g = sum_out_b = sum_out_a = 0;
-
-        src_ptr = data.getLinePointer (0) + (uint32)data.pixelStride * x;
-
-        for (i = 0; i <= radius; ++i)
-        {
-            stack_ptr    = &stack[i * 4];
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            stack_ptr[3] = src_ptr[3];
-            sum_r           += src_ptr[0] * (i + 1);
-            sum_g           += src_ptr[1] * (i + 1);
-            sum_b           += src_ptr[2] * (i + 1);
-            sum_a           += src_ptr[3] * (i + 1);
-            sum_out_r       += src_ptr[0];
-            sum_out_g       += src_ptr[1];
-            sum_out_b       += src_ptr[2];
-            sum_out_a       += src_ptr[3];
-        }
-
-        for (i = 1; i <= radius; ++i)
-        {
-            if (i <= hm)
-                src_ptr += w4;
-
-            stack_ptr = &stack[4 * (i + radius)];
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            stack_ptr[3] = src_ptr[3];
-            sum_r += src_ptr[0] * (radius + 1 - i);
-            sum_g += src_ptr[1] * (radius + 1 - i);
-            sum_b += src_ptr[2] * (radius + 1 - i);
-            sum_a += src_ptr[3] * (radius + 1 - i);
-            sum_in_r += src_ptr[0];
-            sum_in_g += src_ptr[1];
-            sum_in_b += src_ptr[2];
-            sum_in_a += src_ptr[3];
-        }
-
-        sp = radius;
-        yp = radius;
-        if (yp > hm)
-            yp = hm;
+        numPasses = (int) std::ceil (square ((radius + 1) / 255.0));
+        passRadius = std::clamp (roundToInt ((radius + 1) / std::sqrt ((double) numPasses)) - 1, 2, 254);
+    }
 
-        src_ptr = data.getLinePointer (int (yp)) + (uint32)data.pixelStride * x;
-        dst_ptr = data.getLinePointer (0) + (uint32)data.pixelStride * x;
+    Image::BitmapData data (image, Image::BitmapData::readWrite);
 
-        for (y = 0; y < h; ++y)
+    for (int i = 0; i < numPasses; ++i)
+    {
+        switch (image.getFormat())
         {
-            dst_ptr[0] = (uint8)((sum_r * mul_sum) >> shr_sum);
-            dst_ptr[1] = (uint8)((sum_g * mul_sum) >> shr_sum);
-            dst_ptr[2] = (uint8)((sum_b * mul_sum) >> shr_sum);
-            dst_ptr[3] = (uint8)((sum_a * mul_sum) >> shr_sum);
-            dst_ptr += w4;
-
-            sum_r -= sum_out_r;
-            sum_g -= sum_out_g;
-            sum_b -= sum_out_b;
-            sum_a -= sum_out_a;
-
-            stack_start = sp + div - radius;
-            if (stack_start >= div)
-                stack_start -= div;
-
-            stack_ptr = &stack[4 * stack_start];
-
-            sum_out_r -= stack_ptr[0];
-            sum_out_g -= stack_ptr[1];
-            sum_out_b -= stack_ptr[2];
-            sum_out_a -= stack_ptr[3];
-
-            if (yp < hm)
-            {
-                src_ptr += w4;
-                ++yp;
-            }
-
-            stack_ptr[0] = src_ptr[0];
-            stack_ptr[1] = src_ptr[1];
-            stack_ptr[2] = src_ptr[2];
-            stack_ptr[3] = src_ptr[3];
-
-            sum_in_r += src_ptr[0];
-            sum_in_g += src_ptr[1];
-            sum_in_b += src_ptr[2];
-            sum_in_a += src_ptr[3];
-            sum_r    += sum_in_r;
-            sum_g    += sum_in_g;
-            sum_b    += sum_in_b;
-            sum_a    += sum_in_a;
-
-            ++sp;
-            if (sp >= div)
-                sp = 0;
-
-            stack_ptr = &stack[sp * 4];
-
-            sum_out_r += stack_ptr[0];
-            sum_out_g += stack_ptr[1];
-            sum_out_b += stack_ptr[2];
-            sum_out_a += stack_ptr[3];
-            sum_in_r  -= stack_ptr[0];
-            sum_in_g  -= stack_ptr[1];
-            sum_in_b  -= stack_ptr[2];
-            sum_in_a  -= stack_ptr[3];
-        }
+            case Image::ARGB:           applyStackBlurPass<4, Lanes> (data, (uint32) passRadius, threadPool); break;
+            case Image::RGB:            applyStackBlurPass<3, Lanes> (data, (uint32) passRadius, threadPool); break;
+            case Image::SingleChannel:  applyStackBlurPass<1, Lanes> (data, (uint32) passRadius, threadPool); break;
+
+            default:
+                jassertfalse;
+            return;
+        };
     }
 }
 
@@ -705,20 +338,9 @@ inline void applyStackBlurARGB (Image& img, uint32 radius)
     https://gist.github.com/benjamin9999/3809142
     http://www.antigrain.com/__code/include/agg_blur.h.html
 */
-void applyStackBlur (Image& image, int radius)
+void applyStackBlur (Image& image, int radius, ThreadPool* threadPool)
 {
-    radius = std::clamp (radius, 2, 254);
-
-    switch (image.getFormat())
-    {
-        case Image::ARGB:           applyStackBlurARGB (image, (uint32) radius); break;
-        case Image::RGB:            applyStackBlurRGB (image, (uint32) radius); break;
-        case Image::SingleChannel:  applyStackBlurBW (image, (uint32) radius); break;
-
-        default:
-            jassertfalse;
-        break;  
-    };
+    applyStackBlurWithLanes<StackBlurLanes> (image, radius, threadPool);
 }
 
 JUCE_END_IGNORE_WARNINGS_GCC_LIKE
@@ -6,6 +6,16 @@
     #include <squarepine_images/squarepine_images.h>
 #endif
 
+#if SQUAREPINE_USE_SIMD_PIXEL_KERNELS
+    #if (JUCE_INTEL && JUCE_64BIT) || defined (__SSE2__) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+        #include <emmintrin.h>
+        #define SQUAREPINE_PIXEL_KERNELS_SSE2 1
+    #elif JUCE_ARM && (defined (__ARM_NEON) || defined (__ARM_NEON__))
+        #include <arm_neon.h>
+        #define SQUAREPINE_PIXEL_KERNELS_NEON 1
+    #endif
+#endif
+
 #if JUCE_ANDROID
     #include <sys/system_properties.h>
     #include <android/api-level.h>
@@ -27,6 +37,7 @@ namespace sp
     #include "images/squarepine_BlendingEffects.cpp"
     #include "images/squarepine_BMPImageFormat.cpp"
     #include "images/squarepine_DrawableHelpers.cpp"
+    #include "images/squarepine_ImageConvolution.cpp"
     #include "images/squarepine_ImageEffects.cpp"
     #include "images/squarepine_ImageFormatManager.cpp"
     #include "images/squarepine_Resizer.cpp"
@@ -35,4 +46,8 @@ namespace sp
     #include "images/squarepine_TGAImageFormat.cpp"
     #include "lookandfeels/squarepine_Windows10LookAndFeel.cpp"
    // #include "tokenisers/squarepine_JavascriptCodeTokeniser.cpp"
+    #include "unittests/squarepine_ImageConvolverUnitTests.cpp"
+    #include "unittests/squarepine_ImageEffectsUnitTests.cpp"
+    #include "unittests/squarepine_PixelKernelUnitTests.cpp"
+    #include "unittests/squarepine_SquarePineGraphicsUnitTestGatherer.cpp"
 }
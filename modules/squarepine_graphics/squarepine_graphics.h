@@ -53,6 +53,17 @@
     #define SQUAREPINE_USE_WINRTRGB 1
 #endif
 
+/** Config: SQUAREPINE_USE_SIMD_PIXEL_KERNELS
+
+    Enables the SSE2 and NEON paths of the image effects that have them,
+    which produce the exact same output as the scalar paths.
+
+    Disable this to compare against the scalar paths.
+*/
+#ifndef SQUAREPINE_USE_SIMD_PIXEL_KERNELS
+    #define SQUAREPINE_USE_SIMD_PIXEL_KERNELS 1
+#endif
+
 //==============================================================================
 #if ! JUCE_WINDOWS
     #undef SQUAREPINE_USE_WINRTRGB
@@ -204,6 +215,7 @@ namespace sp
     #include "images/squarepine_BlendingEffects.h"
     #include "images/squarepine_BMPImageFormat.h"
     #include "images/squarepine_DrawableHelpers.h"
+    #include "images/squarepine_ImageConvolution.h"
     #include "images/squarepine_ImageEffects.h"
     #include "images/squarepine_ImageFormatManager.h"
     #include "images/squarepine_Resizer.h"
@@ -213,6 +225,7 @@ namespace sp
     #include "lighting/squarepine_WinRTRGB.h"
     #include "lookandfeels/squarepine_Windows10LookAndFeel.h"
     //#include "tokenisers/JavascriptCodeTokeniser.h"
+    #include "unittests/squarepine_SquarePineGraphicsUnitTestGatherer.h"
     #include "utilities/squarepine_Fonts.h"
     #include "utilities/squarepine_Resolution.h"
 }
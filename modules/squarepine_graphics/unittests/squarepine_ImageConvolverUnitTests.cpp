@@ -0,0 +1,333 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Checks the ImageConvolver against a plain, double precision convolution,
+    for matrices and separable kernels of all sorts of sizes, each border mode,
+    each pixel format, and with and without a thread pool.
+
+    The convolver sums in single precision, so a result sitting right on
+    the rounding boundary may land on the neighbouring value, but never further.
+*/
+class ImageConvolverUnitTests final : public UnitTest
+{
+public:
+    ImageConvolverUnitTests() :
+        UnitTest ("Image Convolver", UnitTestCategories::gui)
+    {
+    }
+
+    void runTest() override
+    {
+        random = getRandom();
+        ThreadPool pool (4);
+
+        beginTest ("Border Mapping");
+        runBorderMappingTest();
+
+        beginTest ("Matrix - Matches Reference");
+        runReferenceTest (false, pool);
+
+        beginTest ("Separable - Matches Reference");
+        runReferenceTest (true, pool);
+
+        beginTest ("Presets - Match Reference");
+        runPresetTest();
+    }
+
+private:
+    //==============================================================================
+    using BorderMode = ImageConvolver::BorderMode;
+
+    Random random;
+    ImageConvolver convolver; // NB: Shared by every test, so the scratch buffers are reused across sizes.
+
+    /** A kernel along with its weights, which the convolver keeps to itself. */
+    struct TestKernel final
+    {
+        ImageConvolutionKernel kernel;
+        int width = 0, height = 0;
+        std::vector<double> weights; // As a full matrix, row by row.
+        double bias = 0.0, identityWeight = 0.0;
+        bool filtersAlpha = true;
+    };
+
+    //==============================================================================
+    /** @returns an index mapped into an image the slow way, for comparison. */
+    static int mapIndexReference (int index, int size, BorderMode mode)
+    {
+        switch (mode)
+        {
+            case BorderMode::wrap:
+                return ((index % size) + size) % size;
+
+            case BorderMode::mirror:
+                if (size == 1)
+                    return 0;
+
+                while (! isPositiveAndBelow (index, size))
+                    index = index < 0 ? -index : 2 * (size - 1) - index;
+
+                return index;
+
+            case BorderMode::clamp:
+            default:
+                return jlimit (0, size - 1, index);
+        };
+    }
+
+    void runBorderMappingTest()
+    {
+        expectEquals (ImageConvolver::mapIndex (-1, 5, BorderMode::clamp), 0);
+        expectEquals (ImageConvolver::mapIndex (7, 5, BorderMode::clamp), 4);
+        expectEquals (ImageConvolver::mapIndex (-1, 5, BorderMode::wrap), 4);
+        expectEquals (ImageConvolver::mapIndex (5, 5, BorderMode::wrap), 0);
+        expectEquals (ImageConvolver::mapIndex (-1, 5, BorderMode::mirror), 1);
+        expectEquals (ImageConvolver::mapIndex (5, 5, BorderMode::mirror), 3);
+
+        auto isIdentical = true;
+
+        for (auto mode : { BorderMode::clamp, BorderMode::wrap, BorderMode::mirror })
+            for (int size = 1; size < 12; ++size)
+                for (int index = -40; index < 40; ++index)
+                    isIdentical &= ImageConvolver::mapIndex (index, size, mode) == mapIndexReference (index, size, mode);
+
+        expect (isIdentical);
+    }
+
+    //==============================================================================
+    /** @returns an image of random pixels, which are kept valid as premultiplied ARGB. */
+    Image createNoise (Image::PixelFormat format, int width, int height)
+    {
+        Image image (format, width, height, false);
+        Image::BitmapData data (image, Image::BitmapData::writeOnly);
+
+        for (int y = 0; y < height; ++y)
+        {
+            auto* line = data.getLinePointer (y);
+
+            for (int i = 0; i < width * data.pixelStride; ++i)
+                line[i] = (uint8) random.nextInt (256);
+
+            if (format == Image::ARGB)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    auto* p = line + x * 4;
+                    const auto a = p[PixelARGB::indexA];
+                    p[PixelARGB::indexR] = std::min (p[PixelARGB::indexR], a);
+                    p[PixelARGB::indexG] = std::min (p[PixelARGB::indexG], a);
+                    p[PixelARGB::indexB] = std::min (p[PixelARGB::indexB], a);
+                }
+            }
+        }
+
+        return image;
+    }
+
+    static String describe (const Image& image, const TestKernel& k, BorderMode mode)
+    {
+        return String (image.getWidth()) + "x" + String (image.getHeight())
+             + (image.getFormat() == Image::ARGB ? " ARGB" : image.getFormat() == Image::RGB ? " RGB" : " SingleChannel")
+             + ", " + String (k.width) + "x" + String (k.height) + " kernel"
+             + (mode == BorderMode::clamp ? ", clamped" : mode == BorderMode::wrap ? ", wrapped" : ", mirrored");
+    }
+
+    //==============================================================================
+    /** @returns weights that sum to something sensible, so that not everything ends up clipped. */
+    std::vector<float> createWeights (int size)
+    {
+        std::vector<float> weights ((size_t) size);
+        auto sum = 0.0f;
+
+        for (auto& w : weights)
+        {
+            w = random.nextFloat() * 1.5f - 0.5f;
+            sum += std::abs (w);
+        }
+
+        for (auto& w : weights)
+            w /= jmax (sum, 1.0e-3f);
+
+        return weights;
+    }
+
+    TestKernel createRandomKernel (bool separable)
+    {
+        TestKernel k;
+        k.width = 1 + random.nextInt (7);
+        k.height = 1 + random.nextInt (7);
+        k.weights.resize ((size_t) (k.width * k.height));
+
+        if (separable)
+        {
+            const auto horizontal = createWeights (k.width);
+            const auto vertical = createWeights (k.height);
+
+            for (int y = 0; y < k.height; ++y)
+                for (int x = 0; x < k.width; ++x)
+                    k.weights[(size_t) (y * k.width + x)] = (double) vertical[(size_t) y] * (double) horizontal[(size_t) x];
+
+            k.kernel = ImageConvolutionKernel::createSeparable (horizontal, vertical);
+        }
+        else
+        {
+            const auto matrix = createWeights (k.width * k.height);
+
+            for (size_t i = 0; i < matrix.size(); ++i)
+                k.weights[i] = (double) matrix[i];
+
+            k.kernel = ImageConvolutionKernel::createMatrix (k.width, k.height, matrix);
+        }
+
+        if (random.nextBool())
+        {
+            const auto bias = random.nextFloat() * 40.0f - 20.0f;
+            const auto identityWeight = random.nextFloat() * 2.0f - 0.5f;
+
+            k.kernel = k.kernel.withBias (bias).withIdentityWeight (identityWeight);
+            k.bias = (double) bias;
+            k.identityWeight = (double) identityWeight;
+        }
+
+        k.filtersAlpha = random.nextBool();
+        k.kernel = k.kernel.withAlphaFiltered (k.filtersAlpha);
+        return k;
+    }
+
+    //==============================================================================
+    /** Convolves the image the slow way, in double precision, as per the ImageConvolver's documented behaviour. */
+    static Image convolveReference (const Image& source, const TestKernel& k, BorderMode mode)
+    {
+        const auto w = source.getWidth();
+        const auto h = source.getHeight();
+        const auto isARGB = source.getFormat() == Image::ARGB;
+
+        auto result = source.createCopy();
+        const Image::BitmapData src (source, Image::BitmapData::readOnly);
+        Image::BitmapData dest (result, Image::BitmapData::writeOnly);
+        const auto numChannels = src.pixelStride;
+
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                const auto* original = src.getPixelPointer (x, y);
+                auto* p = dest.getPixelPointer (x, y);
+
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    auto sum = 0.0;
+
+                    for (int ky = 0; ky < k.height; ++ky)
+                    {
+                        const auto sy = mapIndexReference (y + ky - k.height / 2, h, mode);
+
+                        for (int kx = 0; kx < k.width; ++kx)
+                        {
+                            const auto sx = mapIndexReference (x + kx - k.width / 2, w, mode);
+                            sum += k.weights[(size_t) (ky * k.width + kx)] * (double) src.getPixelPointer (sx, sy)[c];
+                        }
+                    }
+
+                    const auto value = sum + k.identityWeight * (double) original[c] + k.bias;
+                    p[c] = (uint8) jlimit (0.0, 255.0, std::floor (value + 0.5));
+                }
+
+                if (isARGB)
+                {
+                    if (! k.filtersAlpha)
+                        p[PixelARGB::indexA] = original[PixelARGB::indexA];
+
+                    const auto a = p[PixelARGB::indexA];
+                    p[PixelARGB::indexR] = std::min (p[PixelARGB::indexR], a);
+                    p[PixelARGB::indexG] = std::min (p[PixelARGB::indexG], a);
+                    p[PixelARGB::indexB] = std::min (p[PixelARGB::indexB], a);
+                }
+            }
+        }
+
+        return result;
+    }
+
+    /** @returns the largest difference between any two channels of the images. */
+    static int getMaxDifference (const Image& a, const Image& b)
+    {
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+        auto maxDifference = 0;
+
+        for (int y = 0; y < a.getHeight(); ++y)
+        {
+            const auto* la = da.getLinePointer (y);
+            const auto* lb = db.getLinePointer (y);
+
+            for (int i = 0; i < a.getWidth() * da.pixelStride; ++i)
+                maxDifference = jmax (maxDifference, std::abs ((int) la[i] - (int) lb[i]));
+        }
+
+        return maxDifference;
+    }
+
+    void expectMatchesReference (const Image& source, const TestKernel& k, BorderMode mode, ThreadPool* threadPool)
+    {
+        auto image = source.createCopy();
+        convolver.setBorderMode (mode);
+        convolver.apply (image, k.kernel, threadPool);
+
+        const auto expected = convolveReference (source, k, mode);
+        expectLessOrEqual (getMaxDifference (image, expected), 1,
+                           describe (source, k, mode) + (threadPool != nullptr ? ", pooled" : ""));
+    }
+
+    //==============================================================================
+    void runReferenceTest (bool separable, ThreadPool& pool)
+    {
+        // From images smaller than the kernels, up to ones big enough to be split into bands for the pool:
+        const juce::Point<int> sizes[] = { { 1, 1 }, { 2, 5 }, { 7, 3 }, { 33, 17 }, { 300, 40 }, { 64, 270 } };
+
+        for (auto format : { Image::ARGB, Image::RGB, Image::SingleChannel })
+        {
+            for (const auto& size : sizes)
+            {
+                const auto source = createNoise (format, size.x, size.y);
+
+                for (auto mode : { BorderMode::clamp, BorderMode::wrap, BorderMode::mirror })
+                {
+                    const auto k = createRandomKernel (separable);
+
+                    for (auto* threadPool : { (ThreadPool*) nullptr, &pool })
+                        expectMatchesReference (source, k, mode, threadPool);
+                }
+            }
+        }
+    }
+
+    void runPresetTest()
+    {
+        auto toTestKernel = [] (ImageConvolutionKernel kernel, int size, std::vector<double> weights, bool filtersAlpha)
+        {
+            TestKernel k;
+            k.kernel = std::move (kernel);
+            k.width = k.height = size;
+            k.weights = std::move (weights);
+            k.filtersAlpha = filtersAlpha;
+            return k;
+        };
+
+        const auto soften = toTestKernel (ImageConvolutionKernel::createSoften(), 3,
+                                          std::vector<double> (9, (double) (1.0f / 3.0f) * (double) (1.0f / 3.0f)), true);
+
+        const auto sharpen = toTestKernel (ImageConvolutionKernel::createSharpen(), 3,
+                                           { 0.0, -1.0, 0.0, -1.0, 5.0, -1.0, 0.0, -1.0, 0.0 }, true);
+
+        const auto edges = toTestKernel (ImageConvolutionKernel::createEdgeDetection(), 3,
+                                         { -1.0, -1.0, -1.0, -1.0, 8.0, -1.0, -1.0, -1.0, -1.0 }, false);
+
+        const auto source = createNoise (Image::ARGB, 61, 43);
+
+        for (const auto* k : { &soften, &sharpen, &edges })
+            expectMatchesReference (source, *k, BorderMode::clamp, nullptr);
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
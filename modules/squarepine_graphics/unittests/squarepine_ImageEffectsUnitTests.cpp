@@ -0,0 +1,162 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Runs the image effects over 4K and 8K images, on the calling thread alone
+    and shared out with a thread pool, checking that both come out the same
+    and logging how much the pool speeds each effect up.
+
+    The timings are far too noisy to fail on, so they're only there to be read.
+*/
+class ImageEffectsUnitTests final : public UnitTest
+{
+public:
+    ImageEffectsUnitTests() :
+        UnitTest ("Image Effects", UnitTestCategories::gui)
+    {
+    }
+
+    void runTest() override
+    {
+        random = getRandom();
+        ThreadPool pool (jmax (2, SystemStats::getNumCpus()));
+
+        for (const auto& size : { juce::Point<int> (3840, 2160), juce::Point<int> (7680, 4320) })
+        {
+            const auto source = createNoise (size.x, size.y);
+
+            beginTest ("Pooled matches Serial - " + describe (source));
+            runPooledTest (source, pool);
+
+            beginTest ("Throughput - " + describe (source));
+            runThroughputTest (source, pool);
+        }
+    }
+
+private:
+    //==============================================================================
+    Random random;
+
+    struct Effect final
+    {
+        String name;
+        std::function<void (Image&, ThreadPool*)> apply;
+    };
+
+    static std::vector<Effect> createEffects()
+    {
+        return
+        {
+            { "Sepia",                    [] (Image& i, ThreadPool* p) { applySepia (i, p); } },
+            { "Brightness/Contrast",      [] (Image& i, ThreadPool* p) { applyBrightnessContrast (i, 20.0f, 30.0f, p); } },
+            { "Hue/Saturation/Lightness", [] (Image& i, ThreadPool* p) { applyHueSaturationLightness (i, 45.0f, 150.0f, 10.0f, p); } },
+            { "Vignette",                 [] (Image& i, ThreadPool* p) { applyVignette (i, 0.5f, 0.8f, 0.5f, p); } },
+            { "Sharpen",                  [] (Image& i, ThreadPool* p) { applySharpen (i, p); } },
+            { "Unsharp Mask",             [] (Image& i, ThreadPool* p) { applyUnsharpMask (i, 4.0f, 0.6f, p); } },
+            { "Stack Blur, radius 16",    [] (Image& i, ThreadPool* p) { applyStackBlur (i, 16, p); } }
+        };
+    }
+
+    //==============================================================================
+    /** @returns an image of random pixels, which are kept valid as premultiplied ARGB. */
+    Image createNoise (int width, int height)
+    {
+        Image image (Image::ARGB, width, height, false);
+        Image::BitmapData data (image, Image::BitmapData::writeOnly);
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                auto* p = data.getPixelPointer (x, y);
+                const auto a = (uint8) random.nextInt (256);
+                p[PixelARGB::indexA] = a;
+                p[PixelARGB::indexR] = (uint8) random.nextInt (a + 1);
+                p[PixelARGB::indexG] = (uint8) random.nextInt (a + 1);
+                p[PixelARGB::indexB] = (uint8) random.nextInt (a + 1);
+            }
+        }
+
+        return image;
+    }
+
+    static bool isIdentical (const Image& a, const Image& b)
+    {
+        if (a.getBounds() != b.getBounds() || a.getFormat() != b.getFormat())
+            return false;
+
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+
+        for (int y = 0; y < a.getHeight(); ++y)
+            if (std::memcmp (da.getLinePointer (y), db.getLinePointer (y), (size_t) (a.getWidth() * da.pixelStride)) != 0)
+                return false;
+
+        return true;
+    }
+
+    static String describe (const Image& image)
+    {
+        return String (image.getWidth()) + "x" + String (image.getHeight());
+    }
+
+    //==============================================================================
+    void runPooledTest (const Image& source, ThreadPool& pool)
+    {
+        for (const auto& effect : createEffects())
+        {
+            auto serial = source.createCopy();
+            auto pooled = source.createCopy();
+
+            effect.apply (serial, nullptr);
+            effect.apply (pooled, &pool);
+
+            expect (isIdentical (serial, pooled), effect.name);
+        }
+    }
+
+    //==============================================================================
+    /** @returns the best time of a few runs, in milliseconds, which shakes off most of the noise. */
+    template<typename Function>
+    static double timeBestOf (const Image& source, Function&& function)
+    {
+        constexpr int numRuns = 3;
+        auto best = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < numRuns; ++i)
+        {
+            auto image = source.createCopy();
+            MillisecondStopWatch stopWatch;
+
+            {
+                const ScopedStartStop<MillisecondStopWatch> sss (stopWatch);
+                function (image);
+            }
+
+            best = std::min (best, stopWatch.getDelta());
+        }
+
+        return best;
+    }
+
+    void runThroughputTest (const Image& source, ThreadPool& pool)
+    {
+        const auto megapixels = (double) source.getWidth() * (double) source.getHeight() / 1.0e6;
+
+        auto describeRate = [&] (double ms)
+        {
+            return String (ms, 1) + " ms (" + String (megapixels / jmax (ms / 1000.0, 1.0e-9), 1) + " MP/s)";
+        };
+
+        for (const auto& effect : createEffects())
+        {
+            const auto serialMs = timeBestOf (source, [&] (Image& image) { effect.apply (image, nullptr); });
+            const auto pooledMs = timeBestOf (source, [&] (Image& image) { effect.apply (image, &pool); });
+
+            logMessage (effect.name + ", " + describe (source) + ": serial " + describeRate (serialMs)
+                        + ", " + String (pool.getNumThreads()) + " threads " + describeRate (pooledMs)
+                        + " (" + String (serialMs / jmax (pooledMs, 1.0e-6), 2) + "x)");
+        }
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
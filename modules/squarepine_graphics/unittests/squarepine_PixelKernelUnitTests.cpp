@@ -0,0 +1,247 @@
+#if SQUAREPINE_COMPILE_UNIT_TESTS
+
+//==============================================================================
+/** Checks that the SIMD pixel kernels match the scalar ones bit for bit,
+    and logs how fast each of them runs. The timings are far too noisy to fail on,
+    so they're only there to be read.
+
+    When SQUAREPINE_USE_SIMD_PIXEL_KERNELS is off, or there's no SSE2 or NEON,
+    both sides are the scalar kernels, so this only checks they're deterministic.
+*/
+class PixelKernelUnitTests final : public UnitTest
+{
+public:
+    PixelKernelUnitTests() :
+        UnitTest ("Pixel Kernels", UnitTestCategories::gui)
+    {
+    }
+
+    void runTest() override
+    {
+       #if ! (SQUAREPINE_PIXEL_KERNELS_SSE2 || SQUAREPINE_PIXEL_KERNELS_NEON)
+        logMessage ("No SIMD pixel kernels are compiled in, so both sides are the scalar kernels.");
+       #endif
+
+        random = getRandom();
+        ThreadPool pool (4);
+
+        beginTest ("Colour Matrix - SIMD matches Scalar");
+        runColourMatrixTest();
+
+        beginTest ("Stack Blur - SIMD matches Scalar");
+        runStackBlurTest (pool);
+
+        beginTest ("Throughput");
+        runThroughputTest (pool);
+    }
+
+private:
+    //==============================================================================
+    Random random;
+
+    //==============================================================================
+    /** @returns an image of random pixels, which are kept valid as premultiplied ARGB. */
+    Image createNoise (Image::PixelFormat format, int width, int height)
+    {
+        Image image (format, width, height, false);
+        Image::BitmapData data (image, Image::BitmapData::writeOnly);
+
+        for (int y = 0; y < height; ++y)
+        {
+            auto* line = data.getLinePointer (y);
+
+            for (int i = 0; i < width * data.pixelStride; ++i)
+                line[i] = (uint8) random.nextInt (256);
+
+            if (format == Image::ARGB)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    auto* p = line + x * 4;
+                    const auto a = p[PixelARGB::indexA];
+                    p[PixelARGB::indexR] = std::min (p[PixelARGB::indexR], a);
+                    p[PixelARGB::indexG] = std::min (p[PixelARGB::indexG], a);
+                    p[PixelARGB::indexB] = std::min (p[PixelARGB::indexB], a);
+                }
+            }
+        }
+
+        return image;
+    }
+
+    static bool isIdentical (const Image& a, const Image& b)
+    {
+        if (a.getBounds() != b.getBounds() || a.getFormat() != b.getFormat())
+            return false;
+
+        const Image::BitmapData da (a, Image::BitmapData::readOnly);
+        const Image::BitmapData db (b, Image::BitmapData::readOnly);
+
+        for (int y = 0; y < a.getHeight(); ++y)
+            if (std::memcmp (da.getLinePointer (y), db.getLinePointer (y), (size_t) (a.getWidth() * da.pixelStride)) != 0)
+                return false;
+
+        return true;
+    }
+
+    static String describe (const Image& image)
+    {
+        return String (image.getWidth()) + "x" + String (image.getHeight())
+             + (image.getFormat() == Image::ARGB ? " ARGB" : image.getFormat() == Image::RGB ? " RGB" : " SingleChannel");
+    }
+
+    //==============================================================================
+    template<bool useSIMD>
+    static void applyColourMatrix (Image& image, const ColourMatrix& m)
+    {
+        Image::BitmapData data (image, Image::BitmapData::readWrite);
+
+        for (int y = 0; y < image.getHeight(); ++y)
+        {
+            if (image.getFormat() == Image::ARGB)
+                applyColourMatrixToRow<PixelARGB, useSIMD> (data.getLinePointer (y), image.getWidth(), data.pixelStride, m);
+            else
+                applyColourMatrixToRow<PixelRGB, useSIMD> (data.getLinePointer (y), image.getWidth(), data.pixelStride, m);
+        }
+    }
+
+    void runColourMatrixTest()
+    {
+        std::vector<ColourMatrix> matrices;
+
+        // Sepia, which truncates, and a greyscale that rounds:
+        matrices.push_back (ColourMatrix::fromCoefficients ({{ { .393, .769, .189 },
+                                                               { .349, .686, .168 },
+                                                               { .272, .534, .131 } }}, false));
+
+        matrices.push_back (ColourMatrix::fromCoefficients ({{ { 0.30, 0.59, 0.11 },
+                                                               { 0.30, 0.59, 0.11 },
+                                                               { 0.30, 0.59, 0.11 } }}, true));
+
+        // Random ones, which push the results well beyond the range of a channel in both directions:
+        for (int i = 0; i < 8; ++i)
+        {
+            std::array<std::array<double, 3>, 3> coefficients {};
+
+            for (auto& row : coefficients)
+                for (auto& c : row)
+                    c = random.nextDouble() * 3.9 - 1.95;
+
+            matrices.push_back (ColourMatrix::fromCoefficients (coefficients, random.nextBool()));
+        }
+
+        // The widths cover the vector loops, their remainders, and rows too short for either:
+        for (auto format : { Image::ARGB, Image::RGB })
+        {
+            for (int width : { 1, 3, 4, 5, 7, 8, 9, 16, 31, 257 })
+            {
+                const auto source = createNoise (format, width, 3);
+
+                for (const auto& m : matrices)
+                {
+                    auto simd = source.createCopy();
+                    auto scalar = source.createCopy();
+
+                    applyColourMatrix<true> (simd, m);
+                    applyColourMatrix<false> (scalar, m);
+
+                    expect (isIdentical (simd, scalar), "Mismatch with " + describe (source));
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    void runStackBlurTest (ThreadPool& pool)
+    {
+        const juce::Point<int> sizes[] = { { 1, 1 }, { 7, 3 }, { 33, 65 }, { 300, 17 }, { 260, 300 } };
+
+        for (auto format : { Image::ARGB, Image::RGB, Image::SingleChannel })
+        {
+            for (const auto& size : sizes)
+            {
+                const auto source = createNoise (format, size.x, size.y);
+
+                for (int radius : { 2, 5, 31, 254, 300 })
+                {
+                    for (auto* threadPool : { (ThreadPool*) nullptr, &pool })
+                    {
+                        auto simd = source.createCopy();
+                        auto scalar = source.createCopy();
+
+                        applyStackBlurWithLanes<StackBlurLanes> (simd, radius, threadPool);
+                        applyStackBlurWithLanes<ScalarStackBlurLanes> (scalar, radius, threadPool);
+
+                        expect (isIdentical (simd, scalar),
+                                "Mismatch with " + describe (source) + " at a radius of " + String (radius));
+                    }
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    /** @returns the best time of a few runs, in milliseconds, which shakes off most of the noise. */
+    template<typename Function>
+    static double timeBestOf (const Image& source, Function&& function)
+    {
+        constexpr int numRuns = 5;
+        auto best = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < numRuns; ++i)
+        {
+            auto image = source.createCopy();
+            MillisecondStopWatch stopWatch;
+
+            {
+                const ScopedStartStop<MillisecondStopWatch> sss (stopWatch);
+                function (image);
+            }
+
+            best = std::min (best, stopWatch.getDelta());
+        }
+
+        return best;
+    }
+
+    void logThroughput (const String& name, const Image& source, double simdMs, double scalarMs)
+    {
+        const auto megapixels = (double) source.getWidth() * (double) source.getHeight() / 1.0e6;
+
+        auto describeRate = [&] (double ms)
+        {
+            return String (megapixels / jmax (ms / 1000.0, 1.0e-9), 1) + " MP/s";
+        };
+
+        logMessage (name + ", " + describe (source) + ": SIMD " + describeRate (simdMs)
+                    + ", scalar " + describeRate (scalarMs)
+                    + " (" + String (scalarMs / jmax (simdMs, 1.0e-6), 2) + "x)");
+    }
+
+    void runThroughputTest (ThreadPool& pool)
+    {
+        const auto source = createNoise (Image::ARGB, 1920, 1080);
+
+        const auto sepia = ColourMatrix::fromCoefficients ({{ { .393, .769, .189 },
+                                                              { .349, .686, .168 },
+                                                              { .272, .534, .131 } }}, false);
+
+        logThroughput ("Colour Matrix", source,
+                       timeBestOf (source, [&] (Image& image) { applyColourMatrix<true> (image, sepia); }),
+                       timeBestOf (source, [&] (Image& image) { applyColourMatrix<false> (image, sepia); }));
+
+        for (int radius : { 8, 64 })
+        {
+            for (auto* threadPool : { (ThreadPool*) nullptr, &pool })
+            {
+                const auto name = "Stack Blur, radius " + String (radius) + (threadPool != nullptr ? ", pooled" : "");
+
+                logThroughput (name, source,
+                               timeBestOf (source, [&] (Image& image) { applyStackBlurWithLanes<StackBlurLanes> (image, radius, threadPool); }),
+                               timeBestOf (source, [&] (Image& image) { applyStackBlurWithLanes<ScalarStackBlurLanes> (image, radius, threadPool); }));
+            }
+        }
+    }
+};
+
+#endif // SQUAREPINE_COMPILE_UNIT_TESTS
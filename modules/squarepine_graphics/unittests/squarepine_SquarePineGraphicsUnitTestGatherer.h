@@ -0,0 +1,15 @@
+/** Assembles all unit tests for the SquarePine Graphics module. */
+class SquarePineGraphicsUnitTestGatherer final : public UnitTestGatherer
+{
+public:
+    /** Constructor. */
+    SquarePineGraphicsUnitTestGatherer() = default;
+
+    //==============================================================================
+    /** @internal */
+    OwnedArray<UnitTest> createTests() override;
+
+private:
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SquarePineGraphicsUnitTestGatherer)
+};